@@ -0,0 +1,3241 @@
+//
+//  CannonBench.cpp
+//  GameDevFramework
+//
+//  Headless, deterministic benchmark driver for the simulation core. Loads
+//  the game through every GameLoadStep, fires a fixed schedule of volleys
+//  from the cannon and reports the time spent in each part of the step.
+//
+
+#include "Game.h"
+#include "DeviceUtils.h"
+#include "b2Simd.h"
+#include "b2ThreadPool.h"
+#include "OpenGLRecordingBackend.h"
+#include "OpenGLAtlasIndex.h"
+#include "OpenGLTextLayout.h"
+#include "OpenGLTextureCache.h"
+#include "OpenGLTextureDecoder.h"
+#include "ProfilerUtils.h"
+#include "LogUtils.h"
+#include "png.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+
+
+namespace
+{
+  //Fixed frame delta for the standalone worlds, the benchmark never uses wall time to drive the world
+  const double BENCH_FRAME_DELTA = 1.0 / 60.0;
+
+  //Zones kept for the --profile trace, a frame of the default scene closes a few dozen
+  const int BENCH_PROFILE_MAX_EVENTS = 1 << 20;
+
+  const char* BENCH_LOAD_STEP_NAMES[GameLoadStepCount] =
+  {
+    "Initial",
+    "World",
+    "Tower",
+    "Cannon",
+    "Final"
+  };
+
+  struct BenchOptions
+  {
+    int volleys;
+    int framesBetweenVolleys;
+    int settleFrames;
+    float screenWidth;
+    float screenHeight;
+    int piles;
+    int pileHeight;
+    double frameRate;
+    double physicsRate;
+    int maxStepsPerFrame;
+    int stressBalls;
+    int bullets;
+    int maxTOIEvents;
+    int tunnelingShots;
+    int poolSize;
+    int sprites;
+    int texts;
+    int atlasSprites;
+    int textures;
+    int decodeThreads;
+    int treeProxies;
+    int pairProxies;
+    int fixtures;
+    int rays;
+    int trajectory;
+    int logMessages;
+    int stackSize;
+    bool simdSolver;
+    bool warmStartCache;
+    bool sortFreePairs;
+    bool speculativeContacts;
+    bool checkSolver;
+    bool settleCheck;
+    bool checkAllocations;
+    bool checkSnapshot;
+    bool checkReplay;
+    const char* recordPath;
+    const char* replayPath;
+    const char* profilePath;
+    std::vector<int> threadCounts;
+    std::vector<b2BroadPhaseType> broadPhases;
+  };
+
+  typedef std::chrono::high_resolution_clock BenchClock;
+
+  const char* broadPhaseName(b2BroadPhaseType aBroadPhase)
+  {
+    return aBroadPhase == b2_sweepAndPruneBroadPhase ? "sweep-and-prune" : "dynamic tree";
+  }
+
+  double millisecondsSince(BenchClock::time_point aStart)
+  {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - aStart).count();
+  }
+
+  double percentile(std::vector<double> aSamples, double aPercentile)
+  {
+    if(aSamples.empty() == true)
+    {
+      return 0.0;
+    }
+
+    std::sort(aSamples.begin(), aSamples.end());
+    size_t index = (size_t)(aPercentile * (double)(aSamples.size() - 1) + 0.5);
+    return aSamples[index];
+  }
+
+  double mean(const std::vector<double>& aSamples)
+  {
+    if(aSamples.empty() == true)
+    {
+      return 0.0;
+    }
+
+    double total = 0.0;
+    for(size_t i = 0; i < aSamples.size(); i++)
+    {
+      total += aSamples[i];
+    }
+    return total / (double)aSamples.size();
+  }
+
+  void printSamples(const char* aLabel, const std::vector<double>& aSamples)
+  {
+    printf("  %-14s mean %8.4f  p50 %8.4f  p99 %8.4f  max %8.4f\n", aLabel, mean(aSamples), percentile(aSamples, 0.5), percentile(aSamples, 0.99), percentile(aSamples, 1.0));
+  }
+
+  //Hash of every body transform, two runs of the same build must print the same value
+  unsigned int hashWorld(b2World* aWorld)
+  {
+    unsigned int hash = 2166136261u;
+    for(b2Body* body = aWorld->GetBodyList(); body != NULL; body = body->GetNext())
+    {
+      float values[3] = { body->GetPosition().x, body->GetPosition().y, body->GetAngle() };
+      const unsigned char* bytes = (const unsigned char*)values;
+      for(size_t i = 0; i < sizeof(values); i++)
+      {
+        hash = (hash ^ bytes[i]) * 16777619u;
+      }
+    }
+    return hash;
+  }
+
+  //Extra independent piles of small blocks left of the tower, each pile is its own island until they collapse into each other
+  void addPiles(Game* aGame, int aPiles, int aPileHeight)
+  {
+    if(aPiles <= 0 || aPileHeight <= 0)
+    {
+      return;
+    }
+
+    const float halfSize = RW2PW(6.0f);
+    b2PolygonShape box;
+    box.SetAsBox(halfSize, halfSize);
+    b2FixtureDef boxfd;
+    boxfd.shape = &box;
+    boxfd.density = 1.0f;
+    boxfd.restitution = 0.0f;
+
+    float left = RW2PW(0.05f * aGame->getScreenWidth());
+    float spacing = RW2PW(0.6f * aGame->getScreenWidth()) / (float)aPiles;
+    for(int i = 0; i < aPiles; i++)
+    {
+      for(int j = 0; j < aPileHeight; j++)
+      {
+        b2BodyDef bd;
+        bd.type = b2_dynamicBody;
+        bd.position.Set(left + spacing * i, halfSize + 2.0f * halfSize * j);
+        aGame->createPhysicsBody(&bd, &boxfd);
+      }
+    }
+  }
+
+  bool isWorldAsleep(b2World* aWorld)
+  {
+    for(b2Body* body = aWorld->GetBodyList(); body != NULL; body = body->GetNext())
+    {
+      if(body->GetType() != b2_staticBody && body->IsActive() == true && body->IsAwake() == true)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //Standalone pile scene in meters for the solver check, the ground is one long box. Dropped
+  //boxes start tilted above the ground so they land on a corner before settling flat
+  void buildSolverCheckWorld(b2World* aWorld, int aPiles, int aPileHeight, bool aDropped)
+  {
+    b2BodyDef groundDef;
+    b2Body* ground = aWorld->CreateBody(&groundDef);
+    b2PolygonShape groundBox;
+    groundBox.SetAsBox(aPiles * 1.5f + 10.0f, 0.5f, b2Vec2(0.0f, -0.5f), 0.0f);
+    ground->CreateFixture(&groundBox, 0.0f);
+
+    b2PolygonShape box;
+    box.SetAsBox(0.5f, 0.5f);
+    for(int i = 0; i < aPiles; i++)
+    {
+      for(int j = 0; j < aPileHeight; j++)
+      {
+        b2BodyDef bd;
+        bd.type = b2_dynamicBody;
+        bd.position.Set(i * 1.5f + 0.02f * (j % 3), 0.5f + 1.0f * j);
+        if(aDropped == true)
+        {
+          bd.position.y += 1.0f;
+          bd.angle = 0.1f * (i % 7);
+        }
+        aWorld->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+      }
+    }
+  }
+
+  //Largest body velocity and position difference between two worlds built the same way
+  void compareSolverCheckWorlds(b2World* aWorldA, b2World* aWorldB, float* aVelocityError, float* aPositionError)
+  {
+    *aVelocityError = 0.0f;
+    *aPositionError = 0.0f;
+    for(b2Body* a = aWorldA->GetBodyList(), *b = aWorldB->GetBodyList(); a != NULL && b != NULL; a = a->GetNext(), b = b->GetNext())
+    {
+      *aVelocityError = std::max(*aVelocityError, (a->GetLinearVelocity() - b->GetLinearVelocity()).Length());
+      *aVelocityError = std::max(*aVelocityError, fabsf(a->GetAngularVelocity() - b->GetAngularVelocity()));
+      *aPositionError = std::max(*aPositionError, (a->GetPosition() - b->GetPosition()).Length());
+    }
+  }
+
+  //Steps three identical worlds for a while, then takes one step with the SIMD solver, with the scalar
+  //code in the SIMD solver's batch order (b2World::SetSimdSolverReference) and with the plain scalar
+  //solver. The first two are compared against the tolerance, the island order difference is only printed
+  bool checkSolverScene(const char* aName, int aPiles, int aPileHeight, bool aDropped, float aTolerance)
+  {
+    const int checkpoints[] = { 1, 30, 90, 180 };
+    bool passed = true;
+
+    printf("  %s, %d piles of %d\n", aName, aPiles, aPileHeight);
+    for(size_t c = 0; c < sizeof(checkpoints) / sizeof(checkpoints[0]); c++)
+    {
+      b2World scalarWorld(b2Vec2(0.0f, -10.0f));
+      b2World referenceWorld(b2Vec2(0.0f, -10.0f));
+      b2World simdWorld(b2Vec2(0.0f, -10.0f));
+      buildSolverCheckWorld(&scalarWorld, aPiles, aPileHeight, aDropped);
+      buildSolverCheckWorld(&referenceWorld, aPiles, aPileHeight, aDropped);
+      buildSolverCheckWorld(&simdWorld, aPiles, aPileHeight, aDropped);
+
+      for(int frame = 0; frame < checkpoints[c]; frame++)
+      {
+        scalarWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+        referenceWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+        simdWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      }
+
+      referenceWorld.SetSimdSolver(true);
+      referenceWorld.SetSimdSolverReference(true);
+      simdWorld.SetSimdSolver(true);
+      scalarWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      referenceWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      simdWorld.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+
+      float velocityError, positionError, orderVelocity, orderPosition;
+      compareSolverCheckWorlds(&referenceWorld, &simdWorld, &velocityError, &positionError);
+      compareSolverCheckWorlds(&scalarWorld, &referenceWorld, &orderVelocity, &orderPosition);
+
+      bool ok = velocityError <= aTolerance && positionError <= aTolerance;
+      printf("    after %4d frames  velocity error %.7f  position error %.7f  %s  (island order %.6f m/s, %.6f m)\n", checkpoints[c], velocityError, positionError, ok == true ? "ok" : "FAILED", orderVelocity, orderPosition);
+      passed = passed && ok;
+    }
+    return passed;
+  }
+
+  //Piles for the solver check
+  const int BENCH_SOLVER_CHECK_PILES = 100;
+  const int BENCH_SOLVER_CHECK_PILE_HEIGHT = 10;
+
+  //In the same order the SIMD and scalar code run the same float operations, and with SSE2 and AVX2
+  //they agree to the bit. The tolerance only leaves room for a compiler that fuses a multiply-add
+  //on one side and not the other (NEON with -ffp-contract), a few ulps on values near 1
+  const float BENCH_SOLVER_TOLERANCE = 1.0e-5f;
+
+  //Boxes that only touch the ground have one contact each, so the coloring can't change the
+  //solve order and both solvers must agree exactly with the plain scalar solver too
+  bool checkSolver()
+  {
+    printf("Solver check: simd width %d\n", b2_simdWidth);
+    bool independent = checkSolverScene("Independent boxes", BENCH_SOLVER_CHECK_PILES, 1, true, BENCH_SOLVER_TOLERANCE);
+    bool stacked = checkSolverScene("Stacked boxes", BENCH_SOLVER_CHECK_PILES, BENCH_SOLVER_CHECK_PILE_HEIGHT, false, BENCH_SOLVER_TOLERANCE);
+    return independent == true && stacked == true;
+  }
+
+  float maxBodySpeed(b2World* aWorld)
+  {
+    float speed = 0.0f;
+    for(b2Body* body = aWorld->GetBodyList(); body != NULL; body = body->GetNext())
+    {
+      speed = std::max(speed, body->GetLinearVelocity().Length());
+    }
+    return speed;
+  }
+
+  //The game's 10 level tower on its own, each level dropped from aGap pixels above the one below,
+  //then the top block is pushed sideways. Returns the frames until the tower is settled, every
+  //block below BENCH_SETTLE_SPEED for BENCH_SETTLE_FRAMES frames, or -1
+  const float BENCH_SETTLE_SPEED = 0.05f;
+  const int BENCH_SETTLE_FRAMES = 30;
+
+  //Ground, side walls and the game's tower as in GameLoadStepWorld and GameLoadStepTower, with each level
+  //aGap pixels above the one below. Returns the top block
+  b2Body* buildTower(b2World* aWorld, float aGap)
+  {
+    float width = RW2PW(DeviceUtils::getScreenResolutionWidth());
+    float height = RW2PW(DeviceUtils::getScreenResolutionHeight());
+    b2BodyDef groundDef;
+    b2Body* ground = aWorld->CreateBody(&groundDef);
+    b2EdgeShape groundShape;
+    groundShape.Set(b2Vec2(0.0f, 0.0f), b2Vec2(width, 0.0f));
+    ground->CreateFixture(&groundShape, 0.0f);
+    groundShape.Set(b2Vec2(0.0f, 0.0f), b2Vec2(0.0f, height));
+    ground->CreateFixture(&groundShape, 0.0f);
+    groundShape.Set(b2Vec2(width, 0.0f), b2Vec2(width, height));
+    ground->CreateFixture(&groundShape, 0.0f);
+
+    b2PolygonShape box;
+    box.SetAsBox(RW2PW(26), RW2PW(32));
+    b2Body* top = NULL;
+    for(int i = 0; i < 10; i++)
+    {
+      float x = RW2PW(0.7f * DeviceUtils::getScreenResolutionWidth());
+      float y = RW2PW(32 + (64 + aGap) * i);
+      int count = (i & 1) ? 1 : 2;
+      for(int j = 0; j < count; j++)
+      {
+        b2BodyDef bd;
+        bd.type = b2_dynamicBody;
+        bd.position.Set((i & 1) ? x + RW2PW(30) : x + RW2PW(60) * j, y);
+        top = aWorld->CreateBody(&bd);
+        top->CreateFixture(&box, 1.0f);
+      }
+    }
+    return top;
+  }
+
+  int settleTower(bool aWarmStartCache, float aGap, float aNudge, int& aHits, float& aMotion)
+  {
+    const int maxFrames = 3000;
+    b2World world(b2Vec2(GAME_GRAVITY_X, GAME_GRAVITY_Y));
+    world.SetWarmStartCache(aWarmStartCache);
+
+    b2Body* top = buildTower(&world, aGap);
+    top->SetLinearVelocity(b2Vec2(aNudge, 0.0f));
+
+    aHits = 0;
+    aMotion = 0.0f;
+    int calmFrames = 0;
+    for(int frame = 0; frame < maxFrames; frame++)
+    {
+      world.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      aHits += world.GetProfile().warmStartCacheHits;
+
+      float speed = maxBodySpeed(&world);
+      aMotion += speed * BENCH_FRAME_DELTA;
+      calmFrames = speed < BENCH_SETTLE_SPEED ? calmFrames + 1 : 0;
+      if(calmFrames == BENCH_SETTLE_FRAMES)
+      {
+        return frame + 1 - BENCH_SETTLE_FRAMES;
+      }
+    }
+    return -1;
+  }
+
+  //Frames until the tower settles with and without the warm start cache
+  void settleCheck()
+  {
+    const float gaps[] = { 0.0f, 1.0f, 2.0f, 4.0f };
+    const float nudges[] = { 0.0f, 1.0f, 2.0f };
+
+    printf("Tower settle check (frames until every block is below %.2f m/s, %d velocity iterations per frame)\n", BENCH_SETTLE_SPEED, GAME_PHYSICS_VELOCITY_ITERATIONS);
+    for(size_t g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++)
+    {
+      for(size_t n = 0; n < sizeof(nudges) / sizeof(nudges[0]); n++)
+      {
+        int hitsOff = 0;
+        int hitsOn = 0;
+        float motionOff = 0.0f;
+        float motionOn = 0.0f;
+        int framesOff = settleTower(false, gaps[g], nudges[n], hitsOff, motionOff);
+        int framesOn = settleTower(true, gaps[g], nudges[n], hitsOn, motionOn);
+        printf("  gap %3.0fpx nudge %.1fm/s  cache off %5d frames %7.2fm  cache on %5d frames %7.2fm %4d hits\n", gaps[g], nudges[n], framesOff, motionOff, framesOn, motionOn, hitsOn);
+      }
+    }
+  }
+
+  bool parseThreadCounts(const char* aValue, std::vector<int>& aThreadCounts)
+  {
+    aThreadCounts.clear();
+    while(*aValue != '\0')
+    {
+      char* end = NULL;
+      long count = strtol(aValue, &end, 10);
+      if(end == aValue || count < 1)
+      {
+        return false;
+      }
+
+      aThreadCounts.push_back((int)count);
+      aValue = *end == ',' ? end + 1 : end;
+    }
+    return aThreadCounts.empty() == false;
+  }
+
+  bool parseOptions(int aArgc, char** aArgv, BenchOptions& aOptions)
+  {
+    for(int i = 1; i < aArgc; i++)
+    {
+      const char* argument = aArgv[i];
+      const char* value = i + 1 < aArgc ? aArgv[i + 1] : NULL;
+
+      if(strcmp(argument, "--volleys") == 0 && value != NULL)
+      {
+        aOptions.volleys = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--interval") == 0 && value != NULL)
+      {
+        aOptions.framesBetweenVolleys = std::max(1, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--settle") == 0 && value != NULL)
+      {
+        aOptions.settleFrames = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--piles") == 0 && value != NULL)
+      {
+        aOptions.piles = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--pile-height") == 0 && value != NULL)
+      {
+        aOptions.pileHeight = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--frame-rate") == 0 && value != NULL)
+      {
+        aOptions.frameRate = atof(value);
+        if(aOptions.frameRate <= 0.0)
+        {
+          return false;
+        }
+        i++;
+      }
+      else if(strcmp(argument, "--physics-rate") == 0 && value != NULL)
+      {
+        aOptions.physicsRate = atof(value);
+        if(aOptions.physicsRate <= 0.0)
+        {
+          return false;
+        }
+        i++;
+      }
+      else if(strcmp(argument, "--max-steps") == 0 && value != NULL)
+      {
+        aOptions.maxStepsPerFrame = std::max(1, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--stress") == 0 && value != NULL)
+      {
+        aOptions.stressBalls = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--bullets") == 0 && value != NULL)
+      {
+        aOptions.bullets = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--max-toi-events") == 0 && value != NULL)
+      {
+        aOptions.maxTOIEvents = std::max(0, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--tunneling") == 0 && value != NULL)
+      {
+        aOptions.tunnelingShots = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--sprites") == 0 && value != NULL)
+      {
+        aOptions.sprites = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--text") == 0 && value != NULL)
+      {
+        aOptions.texts = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--atlas") == 0 && value != NULL)
+      {
+        aOptions.atlasSprites = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--textures") == 0 && value != NULL)
+      {
+        aOptions.textures = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--decode-threads") == 0 && value != NULL)
+      {
+        aOptions.decodeThreads = std::max(0, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--tree") == 0 && value != NULL)
+      {
+        aOptions.treeProxies = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--pairs") == 0 && value != NULL)
+      {
+        aOptions.pairProxies = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--profile") == 0 && value != NULL)
+      {
+        aOptions.profilePath = value;
+        i++;
+      }
+      else if(strcmp(argument, "--stack-size") == 0 && value != NULL)
+      {
+        aOptions.stackSize = std::max(1, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--log") == 0 && value != NULL)
+      {
+        aOptions.logMessages = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--fixtures") == 0 && value != NULL)
+      {
+        aOptions.fixtures = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--rays") == 0 && value != NULL)
+      {
+        aOptions.rays = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--trajectory") == 0 && value != NULL)
+      {
+        aOptions.trajectory = atoi(value);
+        i++;
+      }
+      else if(strcmp(argument, "--broad-phase") == 0 && value != NULL)
+      {
+        aOptions.broadPhases.clear();
+        if(strcmp(value, "tree") == 0 || strcmp(value, "both") == 0)
+        {
+          aOptions.broadPhases.push_back(b2_dynamicTreeBroadPhase);
+        }
+        if(strcmp(value, "sap") == 0 || strcmp(value, "both") == 0)
+        {
+          aOptions.broadPhases.push_back(b2_sweepAndPruneBroadPhase);
+        }
+        if(aOptions.broadPhases.empty() == true)
+        {
+          return false;
+        }
+        i++;
+      }
+      else if(strcmp(argument, "--pool-size") == 0 && value != NULL)
+      {
+        aOptions.poolSize = std::max(1, atoi(value));
+        i++;
+      }
+      else if(strcmp(argument, "--threads") == 0 && value != NULL)
+      {
+        if(parseThreadCounts(value, aOptions.threadCounts) == false)
+        {
+          return false;
+        }
+        i++;
+      }
+      else if(strcmp(argument, "--simd-solver") == 0)
+      {
+        aOptions.simdSolver = true;
+      }
+      else if(strcmp(argument, "--no-warm-start-cache") == 0)
+      {
+        aOptions.warmStartCache = false;
+      }
+      else if(strcmp(argument, "--sort-free-pairs") == 0)
+      {
+        aOptions.sortFreePairs = true;
+      }
+      else if(strcmp(argument, "--speculative") == 0)
+      {
+        aOptions.speculativeContacts = true;
+      }
+      else if(strcmp(argument, "--settle-check") == 0)
+      {
+        aOptions.settleCheck = true;
+      }
+      else if(strcmp(argument, "--check-allocations") == 0)
+      {
+        aOptions.checkAllocations = true;
+      }
+      else if(strcmp(argument, "--record") == 0 && value != NULL)
+      {
+        aOptions.recordPath = value;
+        i++;
+      }
+      else if(strcmp(argument, "--replay") == 0 && value != NULL)
+      {
+        aOptions.replayPath = value;
+        i++;
+      }
+      else if(strcmp(argument, "--check-replay") == 0)
+      {
+        aOptions.checkReplay = true;
+      }
+      else if(strcmp(argument, "--check-snapshot") == 0)
+      {
+        aOptions.checkSnapshot = true;
+      }
+      else if(strcmp(argument, "--check-solver") == 0)
+      {
+        aOptions.checkSolver = true;
+      }
+      else if(strcmp(argument, "--screen") == 0 && value != NULL)
+      {
+        if(sscanf(value, "%fx%f", &aOptions.screenWidth, &aOptions.screenHeight) != 2)
+        {
+          return false;
+        }
+        i++;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+#if defined(B2_TRACK_ALLOCATIONS)
+  void printAllocSites()
+  {
+    b2AllocSite sites[16];
+    int count = b2GetAllocSites(sites, 16);
+    for(int i = 0; i < count; i++)
+    {
+      printf("  %6d x %8d bytes  %s:%d\n", sites[i].count, sites[i].bytes, sites[i].file, sites[i].line);
+    }
+  }
+#endif
+
+  //Plays the standard scene with piles until the world is at its working size, then checks that the frames
+  //that follow, volleys included, never call b2Alloc. Needs a build with BOX2D_TRACK_ALLOCATIONS
+  bool checkAllocations(const BenchOptions& aOptions)
+  {
+#if defined(B2_TRACK_ALLOCATIONS)
+    const int warmUpVolleys = 10;
+    const int checkedVolleys = 10;
+
+    Game* game = Game::getInstance();
+    game->setBroadPhaseType(aOptions.broadPhases[0]);
+    game->setPhysicsStackSize(aOptions.stackSize);
+    while(game->isLoading() == true)
+    {
+      game->update(BENCH_FRAME_DELTA);
+    }
+
+    b2World* world = game->getWorld();
+    world->SetThreadCount(aOptions.threadCounts[0]);
+    world->SetSimdSolver(aOptions.simdSolver);
+    world->SetWarmStartCache(aOptions.warmStartCache);
+    world->SetSortFreePairs(aOptions.sortFreePairs);
+    world->SetSpeculativeContacts(aOptions.speculativeContacts);
+    game->getCannon()->SetCannonBallPoolSize(aOptions.poolSize);
+    addPiles(game, std::max(aOptions.piles, 4), aOptions.pileHeight);
+
+    //Reserve room for everything the scene can grow to, a full pool of balls all touching the piles
+    int bodies = world->GetBodyCount() + aOptions.poolSize;
+    world->Reserve(bodies, 8 * bodies, world->GetProxyCount() + aOptions.poolSize);
+
+    b2AllocStats stats;
+    for(int pass = 0; pass < 2; pass++)
+    {
+      b2ResetAllocStats();
+      int volleys = pass == 0 ? warmUpVolleys : checkedVolleys;
+      for(int frame = 0; frame < volleys * aOptions.framesBetweenVolleys; frame++)
+      {
+        if(frame % aOptions.framesBetweenVolleys == 0)
+        {
+          game->getCannon()->reset();
+          game->fire();
+        }
+        game->update(BENCH_FRAME_DELTA);
+      }
+      b2GetAllocStats(&stats);
+      printf("%s: %d volleys, %d b2Alloc, %d b2Free, %d bytes in use\n", pass == 0 ? "Warm-up" : "Checked", volleys, stats.allocCount, stats.freeCount, stats.bytesInUse);
+      printAllocSites();
+    }
+
+    printf("World: %d bodies, %d contacts, %d proxies\n", world->GetBodyCount(), world->GetContactCount(), world->GetProxyCount());
+    Game::cleanupInstance();
+
+    bool isCorrect = stats.allocCount == 0;
+    printf("%s\n", isCorrect == true ? "Allocations: ok" : "Allocations: FAILED");
+    return isCorrect;
+#else
+    B2_NOT_USED(aOptions);
+    printf("--check-allocations needs a build with -DBOX2D_TRACK_ALLOCATIONS=ON\n");
+    return false;
+#endif
+  }
+
+  //Piles for --check-snapshot when none are given, about a thousand bodies with the tower
+  const int BENCH_SNAPSHOT_PILES = 20;
+  const int BENCH_SNAPSHOT_PILE_HEIGHT = 50;
+
+  //One frame of the --check-snapshot scene, volleys go on a fixed schedule so every replay fires the same shots
+  void updateSnapshotFrame(Game* aGame, int aFrame, int aFramesBetweenVolleys)
+  {
+    if(aFrame % aFramesBetweenVolleys == 0)
+    {
+      aGame->getCannon()->reset();
+      aGame->fire();
+    }
+    aGame->update(BENCH_FRAME_DELTA);
+  }
+
+  //Counts the frames whose world hash differs from the recorded run
+  int replaySnapshotFrames(Game* aGame, int aFirstFrame, int aLastFrame, int aRecordedFrame, const std::vector<unsigned int>& aHashes, int aFramesBetweenVolleys)
+  {
+    int mismatches = 0;
+    for(int frame = aFirstFrame; frame < aLastFrame; frame++)
+    {
+      updateSnapshotFrame(aGame, frame, aFramesBetweenVolleys);
+      if(hashWorld(aGame->getWorld()) != aHashes[frame - aRecordedFrame])
+      {
+        mismatches++;
+      }
+    }
+    return mismatches;
+  }
+
+  //Restores copies of a snapshot that are cut short or have an int overwritten with a huge value. A cut one has to be
+  //rejected, and a rejected one must leave the world as it was
+  bool checkBadSnapshots(b2World* aWorld, const b2Snapshot& aSnapshot)
+  {
+    const int cuts = 32;
+    const int corruptions = 64;
+    const int huge = 0x7fffffff;
+
+    int failures = 0;
+    int rejected = 0;
+    const char* data = (const char*)aSnapshot.GetData();
+    std::vector<char> bytes(data, data + aSnapshot.GetSize());
+    b2Snapshot bad;
+    for(int i = 0; i < cuts + corruptions; i++)
+    {
+      bool isCut = i < cuts;
+      if(isCut == true)
+      {
+        bad.Assign(data, (int)((long long)aSnapshot.GetSize() * i / cuts));
+      }
+      else
+      {
+        int position = (int)((long long)aSnapshot.GetSize() * (i - cuts) / corruptions) & ~3;
+        memcpy(&bytes[position], &huge, sizeof(huge));
+        bad.Assign(&bytes[0], (int)bytes.size());
+        memcpy(&bytes[position], data + position, sizeof(huge));
+      }
+
+      unsigned int hash = hashWorld(aWorld);
+      int bodyCount = aWorld->GetBodyCount();
+      int contactCount = aWorld->GetContactCount();
+      b2SnapshotReader reader(bad);
+      if(aWorld->RestoreState(&reader) == true)
+      {
+        if(isCut == true)
+        {
+          failures++;
+        }
+
+        //A corrupted value that is in range restores garbage, so start over from the real one
+        b2SnapshotReader goodReader(aSnapshot);
+        aWorld->RestoreState(&goodReader);
+        continue;
+      }
+
+      rejected++;
+      if(hashWorld(aWorld) != hash || aWorld->GetBodyCount() != bodyCount || aWorld->GetContactCount() != contactCount)
+      {
+        failures++;
+      }
+    }
+
+    printf("Bad snapshots: %d of %d rejected, %d cut short or changed the world\n", rejected, cuts + corruptions, failures);
+    return failures == 0;
+  }
+
+  //Records a run from a save state, then checks that restoring it reproduces every step bitwise: in place,
+  //through the rewind ring and rebuilt into a fresh world made with the other broad-phase. Also times save and restore
+  bool checkSnapshot(const BenchOptions& aOptions)
+  {
+    const int warmUpFrames = 120;
+    const int checkedFrames = 180;
+    const int rewindFrames = 60;
+    const int timedRuns = 100;
+
+    Game* game = Game::getInstance();
+    game->setBroadPhaseType(aOptions.broadPhases[0]);
+    game->setPhysicsStackSize(aOptions.stackSize);
+    game->setRewindFrames(rewindFrames + 1);
+    while(game->isLoading() == true)
+    {
+      game->update(BENCH_FRAME_DELTA);
+    }
+
+    b2World* world = game->getWorld();
+    world->SetThreadCount(aOptions.threadCounts[0]);
+    world->SetSimdSolver(aOptions.simdSolver);
+    world->SetWarmStartCache(aOptions.warmStartCache);
+    world->SetSortFreePairs(aOptions.sortFreePairs);
+    world->SetSpeculativeContacts(aOptions.speculativeContacts);
+    game->getCannon()->SetCannonBallPoolSize(aOptions.poolSize);
+    addPiles(game, aOptions.piles > 0 ? aOptions.piles : BENCH_SNAPSHOT_PILES, aOptions.piles > 0 ? aOptions.pileHeight : BENCH_SNAPSHOT_PILE_HEIGHT);
+
+    int interval = aOptions.framesBetweenVolleys;
+    for(int frame = 0; frame < warmUpFrames; frame++)
+    {
+      updateSnapshotFrame(game, frame, interval);
+    }
+
+    b2Snapshot start;
+    game->saveState(&start);
+    int lastFrame = warmUpFrames + checkedFrames;
+    std::vector<unsigned int> hashes;
+    for(int frame = warmUpFrames; frame < lastFrame; frame++)
+    {
+      updateSnapshotFrame(game, frame, interval);
+      hashes.push_back(hashWorld(world));
+    }
+
+    bool isRestored = game->restoreState(start);
+    int inPlaceMismatches = replaySnapshotFrames(game, warmUpFrames, lastFrame, warmUpFrames, hashes, interval);
+    printf("In place: %s, %d of %d steps differ\n", isRestored == true ? "restored" : "restore FAILED", inPlaceMismatches, checkedFrames);
+
+    bool isRewound = game->rewind(rewindFrames);
+    int rewindMismatches = replaySnapshotFrames(game, lastFrame - rewindFrames, lastFrame, warmUpFrames, hashes, interval);
+    printf("Rewind: %s %d frames, %d steps differ\n", isRewound == true ? "rewound" : "rewind FAILED", rewindFrames, rewindMismatches);
+
+    //The rebuilt world has no cannon to recycle its balls, so its reference is the game world stepped on its own
+    game->restoreState(start);
+    std::vector<unsigned int> worldHashes;
+    for(int i = 0; i < checkedFrames; i++)
+    {
+      world->Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      worldHashes.push_back(hashWorld(world));
+    }
+
+    b2BroadPhaseType otherBroadPhase = world->GetBroadPhaseType() == b2_dynamicTreeBroadPhase ? b2_sweepAndPruneBroadPhase : b2_dynamicTreeBroadPhase;
+    b2World* rebuilt = new b2World(b2Vec2(0.0f, 0.0f), otherBroadPhase, aOptions.stackSize);
+    rebuilt->SetThreadCount(aOptions.threadCounts[0]);
+    b2SnapshotReader reader(start);
+    bool isRebuilt = rebuilt->RestoreState(&reader);
+    int rebuiltMismatches = 0;
+    for(int i = 0; i < checkedFrames; i++)
+    {
+      rebuilt->Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+      if(hashWorld(rebuilt) != worldHashes[i])
+      {
+        rebuiltMismatches++;
+      }
+    }
+    printf("Rebuilt: %s on %s, %d of %d steps differ\n", isRebuilt == true ? "restored" : "restore FAILED", broadPhaseName(rebuilt->GetBroadPhaseType()), rebuiltMismatches, checkedFrames);
+    delete rebuilt;
+
+
+    //The snapshot keeps its buffer, so only the first save allocates
+    b2Snapshot snapshot;
+    std::vector<double> saveTimes, restoreTimes;
+    for(int i = 0; i < timedRuns; i++)
+    {
+      BenchClock::time_point saveStart = BenchClock::now();
+      snapshot.Clear();
+      game->saveState(&snapshot);
+      saveTimes.push_back(millisecondsSince(saveStart));
+
+      BenchClock::time_point restoreStart = BenchClock::now();
+      game->restoreState(snapshot);
+      restoreTimes.push_back(millisecondsSince(restoreStart));
+    }
+
+    printf("Snapshot: %d bodies, %d contacts, %d joints, %d bytes\n", world->GetBodyCount(), world->GetContactCount(), world->GetJointCount(), snapshot.GetSize());
+    printf("Snapshot (ms)\n");
+    printSamples("save", saveTimes);
+    printSamples("restore", restoreTimes);
+
+    bool isBadRejected = checkBadSnapshots(world, start);
+    Game::cleanupInstance();
+
+    bool isCorrect = isRestored == true && isRewound == true && isRebuilt == true && inPlaceMismatches == 0 && rewindMismatches == 0 && rebuiltMismatches == 0 && isBadRejected == true;
+    printf("%s\n", isCorrect == true ? "Snapshot: ok" : "Snapshot: FAILED");
+    return isCorrect;
+  }
+
+  //Frames of the scripted --record session that make one round of inputs
+  const int BENCH_SESSION_ROUND_FRAMES = 240;
+
+  //A scripted session for --record and --check-replay on the bench's frame rate. Each round fires twice, drags
+  //the barrel up, then drives the cannon right for a second, all through the same calls the UI makes
+  void playSession(Game* aGame, const BenchOptions& aOptions, int aFrames)
+  {
+    double frameDelta = 1.0 / aOptions.frameRate;
+    for(int frame = 0; frame < aFrames; frame++)
+    {
+      int phase = frame % BENCH_SESSION_ROUND_FRAMES;
+      float barrelX = PW2RW(aGame->getCannon()->getBarrelX());
+      float barrelY = PW2RW(aGame->getCannon()->getBarrelY());
+      if(phase == 0)
+      {
+        aGame->reset();
+        aGame->fire();
+      }
+      else if(phase == 90)
+      {
+        aGame->fire();
+      }
+      else if(phase == 30)
+      {
+        aGame->touchEvent(TouchEventBegan, barrelX, barrelY, barrelX, barrelY);
+      }
+      else if(phase > 30 && phase < 50)
+      {
+        aGame->touchEvent(TouchEventMoved, barrelX, barrelY + 0.5f, barrelX, barrelY);
+      }
+      else if(phase == 120)
+      {
+        aGame->touchEvent(TouchEventBegan, barrelX + 200.0f, barrelY, barrelX + 200.0f, barrelY);
+      }
+      else if(phase == 50 || phase == 180)
+      {
+        aGame->touchEvent(TouchEventEnded, barrelX, barrelY, barrelX, barrelY);
+      }
+      aGame->update(frameDelta);
+    }
+  }
+
+  bool recordSession(const BenchOptions& aOptions, const char* aPath)
+  {
+    Game* game = Game::getInstance();
+    game->setBroadPhaseType(aOptions.broadPhases[0]);
+    game->setPhysicsRate(aOptions.physicsRate);
+    game->setMaxPhysicsStepsPerFrame(aOptions.maxStepsPerFrame);
+    while(game->isLoading() == true)
+    {
+      game->update(1.0 / aOptions.frameRate);
+    }
+
+    b2World* world = game->getWorld();
+    world->SetSimdSolver(aOptions.simdSolver);
+    world->SetWarmStartCache(aOptions.warmStartCache);
+    world->SetSortFreePairs(aOptions.sortFreePairs);
+    world->SetSpeculativeContacts(aOptions.speculativeContacts);
+    game->getCannon()->SetCannonBallPoolSize(aOptions.poolSize);
+
+    if(game->startRecording(aPath, true) == false)
+    {
+      printf("Can't record to %s\n", aPath);
+      Game::cleanupInstance();
+      return false;
+    }
+
+    int frames = aOptions.volleys * aOptions.framesBetweenVolleys + aOptions.settleFrames;
+    BenchClock::time_point start = BenchClock::now();
+    playSession(game, aOptions, frames);
+    double time = millisecondsSince(start);
+    unsigned int ticks = game->getPhysicsTick();
+    game->stopRecording();
+    Game::cleanupInstance();
+
+    struct stat info;
+    long bytes = stat(aPath, &info) == 0 ? (long)info.st_size : 0;
+    printf("Recorded %d frames at %.1f Hz, %u ticks at %.1f Hz, %.2f ms: %ld bytes to %s\n", frames, aOptions.frameRate, ticks, aOptions.physicsRate, time, bytes, aPath);
+    return true;
+  }
+
+  //Replays a journal in a fresh game, the screen is set to the one it was recorded on
+  bool replaySession(const char* aPath, InputReplayResult& aResult)
+  {
+    InputJournalReader journal;
+    if(journal.open(aPath) == false)
+    {
+      printf("Can't read the journal %s\n", aPath);
+      return false;
+    }
+    DeviceUtils::setScreenResolution(journal.getHeader().screenWidth, journal.getHeader().screenHeight);
+
+    BenchClock::time_point start = BenchClock::now();
+    bool isReplayed = Game::getInstance()->replay(&journal, &aResult);
+    double time = millisecondsSince(start);
+    Game::cleanupInstance();
+
+    if(isReplayed == false)
+    {
+      printf("Replay: %s can't be replayed, it is cut short or was recorded on another setup\n", aPath);
+      return false;
+    }
+
+    printf("Replay: %u ticks, %u inputs, %.2f ms, %.4f ms per tick\n", aResult.ticks, aResult.inputs, time, aResult.ticks > 0 ? time / aResult.ticks : 0.0);
+    if(aResult.divergentTick < 0)
+    {
+      printf("Replay: every tick matches\n");
+    }
+    else
+    {
+      printf("Replay: diverged at tick %d, body %d, hash %08x instead of %08x\n", aResult.divergentTick, aResult.divergentBody, aResult.actualHash, aResult.expectedHash);
+    }
+    return true;
+  }
+
+  bool runReplay(const BenchOptions& aOptions)
+  {
+    InputReplayResult result;
+    return replaySession(aOptions.replayPath, result) == true && result.divergentTick < 0;
+  }
+
+  //Copies a journal with the barrel drag at the given touch record turned up, returns the tick it landed before or -1
+  int tamperJournal(const char* aPath, const char* aTamperedPath, int aTouch)
+  {
+    InputJournalReader journal;
+    InputJournalWriter tampered;
+    if(journal.open(aPath) == false || tampered.open(aTamperedPath, journal.getHeader()) == false)
+    {
+      return -1;
+    }
+
+    int tick = -1;
+    int touches = 0;
+    InputJournalRecord record;
+    while(journal.read(record) == true)
+    {
+      if(record.type == InputJournalTouch && record.touchEvent == TouchEventMoved && touches++ == aTouch)
+      {
+        record.previousY -= 4.0f;
+        tick = (int)record.tick;
+      }
+      tampered.writeRecord(record);
+    }
+    return tick;
+  }
+
+  //Records the scripted session, checks that replaying it matches every tick, then that a journal with one
+  //input changed reports the tick that input landed before
+  bool checkReplay(const BenchOptions& aOptions)
+  {
+    char path[] = "/tmp/cannon_bench_journal_XXXXXX";
+    char tamperedPath[] = "/tmp/cannon_bench_tampered_XXXXXX";
+    int descriptor = mkstemp(path);
+    int tamperedDescriptor = mkstemp(tamperedPath);
+    if(descriptor < 0 || tamperedDescriptor < 0)
+    {
+      printf("Can't create a journal in /tmp\n");
+      return false;
+    }
+    close(descriptor);
+    close(tamperedDescriptor);
+
+    InputReplayResult result;
+    bool isRecorded = recordSession(aOptions, path);
+    bool isMatching = isRecorded == true && replaySession(path, result) == true && result.divergentTick < 0 && result.inputs > 0;
+
+    InputReplayResult tamperedResult;
+    int tamperedTick = isRecorded == true ? tamperJournal(path, tamperedPath, 3) : -1;
+    bool isDetected = tamperedTick >= 0 && replaySession(tamperedPath, tamperedResult) == true;
+    isDetected = isDetected && tamperedResult.divergentTick == tamperedTick && tamperedResult.divergentBody >= 0;
+    printf("Tampered input at tick %d: %s\n", tamperedTick, isDetected == true ? "detected" : "NOT DETECTED");
+
+    remove(path);
+    remove(tamperedPath);
+
+    bool isCorrect = isMatching == true && isDetected == true;
+    printf("%s\n", isCorrect == true ? "Replay: ok" : "Replay: FAILED");
+    return isCorrect;
+  }
+
+  //Returns the broadphase time of every step, the moves and the pair update
+  //Zone percentiles over the last b2_profileWindow frames each zone ran in, then the trace
+  void printProfile(const char* aPath)
+  {
+    printf("Profiler zones (ms per frame, last %d frames)\n", b2_profileWindow);
+    for(int i = 0; i < b2Profiler::GetZoneCount(); i++)
+    {
+      b2ProfileZoneStats stats;
+      b2Profiler::GetZoneStats(i, &stats);
+      printf("  %-34s mean %8.4f  p50 %8.4f  p95 %8.4f  p99 %8.4f  max %8.4f  x%d\n", stats.name, stats.mean, stats.p50, stats.p95, stats.p99, stats.max, stats.calls);
+    }
+
+    if(Profiler::writeChromeTrace(aPath) == true)
+    {
+      printf("Trace: %d events over %d frames written to %s, %d dropped\n", b2Profiler::GetCaptureCount(), b2Profiler::GetFrameCount(), aPath, b2Profiler::GetDroppedCount());
+    }
+    else
+    {
+      printf("Can't write %s\n", aPath);
+    }
+  }
+
+  std::vector<double> runBenchmark(const BenchOptions& aOptions, int aThreadCount, b2BroadPhaseType aBroadPhase)
+  {
+    Game* game = Game::getInstance();
+    game->setBroadPhaseType(aBroadPhase);
+    game->setPhysicsStackSize(aOptions.stackSize);
+    game->setPhysicsRate(aOptions.physicsRate);
+    game->setMaxPhysicsStepsPerFrame(aOptions.maxStepsPerFrame);
+    double frameDelta = 1.0 / aOptions.frameRate;
+
+    //Run every load step, Game::update calls load() once per update while loading
+    printf("Load steps (ms)\n");
+    for(int loadStep = 0; game->isLoading() == true; loadStep++)
+    {
+      BenchClock::time_point start = BenchClock::now();
+      game->update(frameDelta);
+      printf("  %-14s %8.4f\n", BENCH_LOAD_STEP_NAMES[loadStep], millisecondsSince(start));
+    }
+
+    b2World* world = game->getWorld();
+    world->SetThreadCount(aThreadCount);
+    world->SetSimdSolver(aOptions.simdSolver);
+    world->SetWarmStartCache(aOptions.warmStartCache);
+    world->SetSortFreePairs(aOptions.sortFreePairs);
+    world->SetSpeculativeContacts(aOptions.speculativeContacts);
+    world->SetMaxTOIEvents(aOptions.maxTOIEvents);
+    game->getCannon()->SetCannonBallPoolSize(aOptions.poolSize);
+    addPiles(game, aOptions.piles, aOptions.pileHeight);
+
+    int frameCount = aOptions.volleys * aOptions.framesBetweenVolleys + aOptions.settleFrames;
+
+    std::vector<double> frameTimes, stepTimes, collideTimes, solveTimes, solveInitTimes;
+    std::vector<double> solveVelocityTimes, solvePositionTimes, broadphaseTimes, solveTOITimes;
+
+    //Frames from the last volley until every body is asleep, the measure of how fast the tower settles
+    int lastVolleyFrame = (aOptions.volleys - 1) * aOptions.framesBetweenVolleys;
+    int settleFrames = -1;
+    int warmStartCacheHits = 0;
+    int toiEvents = 0;
+    int toiCalls = 0;
+    int stackPeak = 0;
+    int stackGrowCount = 0;
+    int physicsSteps = 0;
+    int minStepsPerFrame = aOptions.maxStepsPerFrame;
+    int maxStepsPerFrame = 0;
+
+    if(aOptions.profilePath != NULL)
+    {
+      Profiler::start(BENCH_PROFILE_MAX_EVENTS);
+    }
+
+    BenchClock::time_point runStart = BenchClock::now();
+    for(int frame = 0; frame < frameCount; frame++)
+    {
+      if(frame < aOptions.volleys * aOptions.framesBetweenVolleys && frame % aOptions.framesBetweenVolleys == 0)
+      {
+        game->fire();
+      }
+
+      BenchClock::time_point start = BenchClock::now();
+      game->update(frameDelta);
+      frameTimes.push_back(millisecondsSince(start));
+
+      int steps = game->getPhysicsStepsLastFrame();
+      physicsSteps += steps;
+      minStepsPerFrame = std::min(minStepsPerFrame, steps);
+      maxStepsPerFrame = std::max(maxStepsPerFrame, steps);
+
+      //The profile only describes the last step, and is stale when no step ran
+      if(steps == 0)
+      {
+        continue;
+      }
+
+      const b2Profile& profile = world->GetProfile();
+      stepTimes.push_back(profile.step);
+      collideTimes.push_back(profile.collide);
+      solveTimes.push_back(profile.solve);
+      solveInitTimes.push_back(profile.solveInit);
+      solveVelocityTimes.push_back(profile.solveVelocity);
+      solvePositionTimes.push_back(profile.solvePosition);
+      broadphaseTimes.push_back(profile.broadphase);
+      solveTOITimes.push_back(profile.solveTOI);
+      warmStartCacheHits += profile.warmStartCacheHits;
+      toiEvents += profile.toiEvents;
+      toiCalls += profile.toiCalls;
+      stackPeak = std::max(stackPeak, profile.stackPeak);
+      stackGrowCount += profile.stackGrowCount;
+
+      if(settleFrames == -1 && frame >= lastVolleyFrame && isWorldAsleep(world) == true)
+      {
+        settleFrames = frame - lastVolleyFrame;
+      }
+    }
+    double runTime = millisecondsSince(runStart);
+
+    if(aOptions.profilePath != NULL)
+    {
+      Profiler::stop();
+    }
+
+    printf("Simulation: %s solver, %s broad-phase, %d threads, %d frames, %d balls fired, %d bodies, %d contacts, %.2f ms total\n", world->GetSimdSolver() == true ? "simd" : "scalar", broadPhaseName(world->GetBroadPhaseType()), world->GetThreadCount(), frameCount, game->getNumberOfBallsFired(), world->GetBodyCount(), world->GetContactCount(), runTime);
+    printf("Fixed step: %.1f Hz physics, %.1f Hz frames, %d steps, %d/%.2f/%d min/avg/max per frame, %.2f ms dropped\n", game->getPhysicsRate(), aOptions.frameRate, physicsSteps, minStepsPerFrame, (double)physicsSteps / frameCount, maxStepsPerFrame, game->getDroppedTimeTotal() * 1000.0);
+    printf("Game::update (ms)\n");
+    printSamples("frame", frameTimes);
+    printf("b2Profile (ms)\n");
+    printSamples("step", stepTimes);
+    printSamples("collide", collideTimes);
+    printSamples("solve", solveTimes);
+    printSamples("solveInit", solveInitTimes);
+    printSamples("solveVelocity", solveVelocityTimes);
+    printSamples("solvePosition", solvePositionTimes);
+    printSamples("broadphase", broadphaseTimes);
+    printSamples("solveTOI", solveTOITimes);
+    printf("Warm start cache: %s, %d hits\n", world->GetWarmStartCache() == true ? "on" : "off", warmStartCacheHits);
+    printf("Continuous collision: %s, %d TOI events, %d b2TimeOfImpact calls\n", world->GetSpeculativeContacts() == true ? "speculative contacts" : "TOI", toiEvents, toiCalls);
+    printf("Stack allocator: %d KB initial, %.1f KB peak, grew %d times\n", aOptions.stackSize / 1024, stackPeak / 1024.0, stackGrowCount);
+    if(settleFrames >= 0)
+    {
+      printf("Settled %d frames after the last volley\n", settleFrames);
+    }
+    else
+    {
+      printf("Not settled %d frames after the last volley\n", frameCount - lastVolleyFrame);
+    }
+    printf("Cannon balls: %d created, %d in play, pool of %d\n", game->getCannon()->CannonBallsCreated(), game->getCannon()->CannonBallsActive(), game->getCannon()->CannonBallPoolSize());
+    printf("World hash: %08x\n", hashWorld(world));
+
+    if(aOptions.profilePath != NULL)
+    {
+      printProfile(aOptions.profilePath);
+    }
+
+    Game::cleanupInstance();
+    return broadphaseTimes;
+  }
+
+  //Drops a wave of aOptions.bullets small bullet bodies at 60 m/s onto the level every second, so most steps
+  //have dozens of TOI events, and checks the continuous solver ends up the same on every thread count
+  bool runBullets(const BenchOptions& aOptions)
+  {
+    const int frameCount = 300;
+    const int framesBetweenWaves = 60;
+
+    b2CircleShape circle;
+    circle.m_radius = 0.1f;
+    b2FixtureDef bulletfd;
+    bulletfd.shape = &circle;
+    bulletfd.density = 1.0f;
+    bulletfd.restitution = 0.5f;
+
+    std::vector<unsigned int> hashes;
+    for(size_t t = 0; t < aOptions.threadCounts.size(); t++)
+    {
+      Game* game = Game::getInstance();
+      while(game->isLoading() == true)
+      {
+        game->update(BENCH_FRAME_DELTA);
+      }
+
+      b2World* world = game->getWorld();
+      world->SetThreadCount(aOptions.threadCounts[t]);
+      world->SetMaxTOIEvents(aOptions.maxTOIEvents);
+      world->SetSpeculativeContacts(aOptions.speculativeContacts);
+      addPiles(game, aOptions.piles, aOptions.pileHeight);
+
+      std::vector<double> stepTimes;
+      std::vector<double> solveTOITimes;
+      int toiEvents = 0;
+      int toiCalls = 0;
+      int toiIterations = 0;
+      int maxStepEvents = 0;
+      unsigned int seed = 12345u;
+      for(int frame = 0; frame < frameCount; frame++)
+      {
+        if(frame % framesBetweenWaves == 0)
+        {
+          for(int i = 0; i < aOptions.bullets; i++)
+          {
+            seed = seed * 1664525u + 1013904223u;
+            b2BodyDef bd;
+            bd.type = b2_dynamicBody;
+            bd.bullet = true;
+            bd.position.Set(RW2PW(((seed >> 8) % 1000) / 1000.0f * game->getScreenWidth()), RW2PW(0.9f * game->getScreenHeight()));
+            bd.linearVelocity.Set(((seed >> 4) % 41) - 20.0f, -60.0f);
+            game->createPhysicsBody(&bd, &bulletfd);
+          }
+        }
+
+        game->update(BENCH_FRAME_DELTA);
+        if(game->getPhysicsStepsLastFrame() > 0)
+        {
+          const b2Profile& profile = world->GetProfile();
+          stepTimes.push_back(profile.step);
+          solveTOITimes.push_back(profile.solveTOI);
+          toiEvents += profile.toiEvents;
+          toiCalls += profile.toiCalls;
+          toiIterations += profile.toiIterations;
+          maxStepEvents = std::max(maxStepEvents, profile.toiEvents);
+        }
+      }
+
+      hashes.push_back(hashWorld(world));
+      printf("Bullets: %d threads, %d a wave, %d bodies, %d contacts\n", world->GetThreadCount(), aOptions.bullets, world->GetBodyCount(), world->GetContactCount());
+      printf("  TOI events %d, b2TimeOfImpact calls %d, iterations %d, most in a step %d, cap %d (0 is none)\n", toiEvents, toiCalls, toiIterations, maxStepEvents, world->GetMaxTOIEvents());
+      printSamples("step", stepTimes);
+      printSamples("solveTOI", solveTOITimes);
+      printf("World hash: %08x\n", hashes.back());
+      Game::cleanupInstance();
+    }
+
+    bool isMatching = std::count(hashes.begin(), hashes.end(), hashes[0]) == (int)hashes.size();
+    printf("%s\n", isMatching == true ? "Same on every thread count: ok" : "Same on every thread count: FAILED");
+    return isMatching;
+  }
+
+  //Cannon balls fired at BENCH_TUNNELING_IMPULSE_SCALE times the Cannon::fire impulse. The balls aren't bullets
+  //in the game, so TOI sub-steps only keep them out of the walls and ground, not out of the tower blocks
+  const float BENCH_TUNNELING_IMPULSE_SCALE = 10.0f;
+
+  //A shot went deep when the ball ended up this far inside a block at some step, a quarter of its radius
+  const float BENCH_TUNNELING_DEEP_PENETRATION = RW2PW(4);
+
+  enum
+  {
+    TunnelingDiscrete = 0,
+    TunnelingTOI,
+    TunnelingTOIBullets,
+    TunnelingSpeculative,
+    TunnelingModeCount
+  };
+
+  const char* TUNNELING_MODE_NAMES[TunnelingModeCount] =
+  {
+    "no continuous",
+    "TOI",
+    "TOI, bullet balls",
+    "speculative"
+  };
+
+  //How deep a circle is inside a shape, from the closest points of the circle's center and the shape's core
+  float penetration(b2Fixture* aCircle, b2Fixture* aFixture)
+  {
+    b2DistanceInput input;
+    input.proxyA.Set(aCircle->GetShape(), 0);
+    input.proxyB.Set(aFixture->GetShape(), 0);
+    input.transformA = aCircle->GetBody()->GetTransform();
+    input.transformB = aFixture->GetBody()->GetTransform();
+    input.useRadii = false;
+
+    b2SimplexCache cache;
+    cache.count = 0;
+    b2DistanceOutput output;
+    b2Distance(&output, &cache, &input);
+    return aCircle->GetShape()->m_radius + aFixture->GetShape()->m_radius - output.distance;
+  }
+
+  //Fires aShots balls level at a fresh tower each, from the bottom level to the top one. A ball tunneled
+  //when its center passed the center of a block it was level with, which it can't do without going through it
+  void fireIntoTower(const BenchOptions& aOptions, int aMode, int aShots, int& aTunneled, int& aDeep, float& aMaxPenetration, int& aTOIEvents, std::vector<double>& aStepTimes)
+  {
+    const int framesPerShot = 60;
+
+    b2CircleShape circle;
+    circle.m_radius = RW2PW(16);
+    b2FixtureDef ballfd;
+    ballfd.shape = &circle;
+    ballfd.density = 0.5f;
+    ballfd.restitution = 0.3f;
+
+    aTunneled = 0;
+    aDeep = 0;
+    aMaxPenetration = 0.0f;
+    aTOIEvents = 0;
+    for(int shot = 0; shot < aShots; shot++)
+    {
+      b2World world(b2Vec2(GAME_GRAVITY_X, GAME_GRAVITY_Y));
+      world.SetThreadCount(aOptions.threadCounts[0]);
+      world.SetContinuousPhysics(aMode != TunnelingDiscrete);
+      world.SetSpeculativeContacts(aMode == TunnelingSpeculative);
+      buildTower(&world, 0.0f);
+
+      std::vector<b2Body*> blocks;
+      for(b2Body* body = world.GetBodyList(); body != NULL; body = body->GetNext())
+      {
+        if(body->GetType() == b2_dynamicBody)
+        {
+          blocks.push_back(body);
+        }
+      }
+
+      b2BodyDef bd;
+      bd.type = b2_dynamicBody;
+      bd.bullet = aMode == TunnelingTOIBullets;
+      bd.position.Set(RW2PW(0.3f * DeviceUtils::getScreenResolutionWidth()), RW2PW(32 + 576 * (shot + 0.5f) / aShots));
+      b2Body* ball = world.CreateBody(&bd);
+      b2Fixture* ballFixture = ball->CreateFixture(&ballfd);
+      ball->ApplyLinearImpulse(b2Vec2(50.0f * BENCH_TUNNELING_IMPULSE_SCALE, 0.0f), ball->GetWorldCenter());
+
+      const float halfHeight = RW2PW(32);
+      std::vector<float> along(blocks.size());
+      for(size_t i = 0; i < blocks.size(); i++)
+      {
+        along[i] = ball->GetPosition().x - blocks[i]->GetPosition().x;
+      }
+
+      bool tunneled = false;
+      float shotPenetration = 0.0f;
+      for(int frame = 0; frame < framesPerShot; frame++)
+      {
+        world.Step(BENCH_FRAME_DELTA, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+        aStepTimes.push_back(world.GetProfile().step);
+        aTOIEvents += world.GetProfile().toiEvents;
+
+        for(size_t i = 0; i < blocks.size(); i++)
+        {
+          b2Vec2 offset = ball->GetPosition() - blocks[i]->GetPosition();
+          if(along[i] < 0.0f && offset.x >= 0.0f && fabsf(offset.y) < halfHeight)
+          {
+            tunneled = true;
+          }
+          along[i] = offset.x;
+          shotPenetration = std::max(shotPenetration, penetration(ballFixture, blocks[i]->GetFixtureList()));
+        }
+      }
+
+      aTunneled += tunneled == true ? 1 : 0;
+      aDeep += shotPenetration > BENCH_TUNNELING_DEEP_PENETRATION ? 1 : 0;
+      aMaxPenetration = std::max(aMaxPenetration, shotPenetration);
+    }
+  }
+
+  //Compares the continuous collision modes on balls much faster than the cannon fires them. Speculative
+  //contacts must stop every ball at the surface of the tower
+  bool runTunneling(const BenchOptions& aOptions)
+  {
+    printf("Tunneling: %d shots at %.0fx the Cannon::fire impulse, %d threads, deep is over %.2f m\n", aOptions.tunnelingShots, BENCH_TUNNELING_IMPULSE_SCALE, aOptions.threadCounts[0], BENCH_TUNNELING_DEEP_PENETRATION);
+
+    bool isStopped = false;
+    for(int mode = 0; mode < TunnelingModeCount; mode++)
+    {
+      int tunneled = 0;
+      int deep = 0;
+      int toiEvents = 0;
+      float maxPenetration = 0.0f;
+      std::vector<double> stepTimes;
+      fireIntoTower(aOptions, mode, aOptions.tunnelingShots, tunneled, deep, maxPenetration, toiEvents, stepTimes);
+
+      printf("  %-18s tunneled %3d  deep %3d  max penetration %6.3f m  TOI events %6d\n", TUNNELING_MODE_NAMES[mode], tunneled, deep, maxPenetration, toiEvents);
+      printSamples("step", stepTimes);
+      if(mode == TunnelingSpeculative)
+      {
+        isStopped = tunneled == 0 && deep == 0;
+      }
+    }
+
+    printf("%s\n", isStopped == true ? "Speculative contacts stop every ball: ok" : "Speculative contacts stop every ball: FAILED");
+    return isStopped;
+  }
+
+  long maxResidentKilobytes()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+
+  //Fires aOptions.stressBalls balls, one every other frame, and reports the world size and step time every 1000 balls.
+  //The body count, proxy count and step time should stay flat, a large --pool-size keeps every ball in play for its whole lifetime
+  void runStress(const BenchOptions& aOptions)
+  {
+    const int framesBetweenBalls = 2;
+    const int ballsPerReport = 1000;
+
+    Game* game = Game::getInstance();
+    game->setBroadPhaseType(aOptions.broadPhases[0]);
+    game->setPhysicsStackSize(aOptions.stackSize);
+    game->setPhysicsRate(aOptions.physicsRate);
+    game->setMaxPhysicsStepsPerFrame(aOptions.maxStepsPerFrame);
+    double frameDelta = 1.0 / aOptions.frameRate;
+    while(game->isLoading() == true)
+    {
+      game->update(frameDelta);
+    }
+
+    b2World* world = game->getWorld();
+    Cannon* cannon = game->getCannon();
+    world->SetSimdSolver(aOptions.simdSolver);
+    world->SetWarmStartCache(aOptions.warmStartCache);
+    world->SetSortFreePairs(aOptions.sortFreePairs);
+    world->SetSpeculativeContacts(aOptions.speculativeContacts);
+    cannon->SetCannonBallPoolSize(aOptions.poolSize);
+    addPiles(game, aOptions.piles, aOptions.pileHeight);
+
+    printf("Stress: %d balls, one every %d frames, pool of %d\n", aOptions.stressBalls, framesBetweenBalls, cannon->CannonBallPoolSize());
+    printf("  %8s %8s %8s %8s %8s %10s %10s %10s %10s %6s\n", "balls", "bodies", "proxies", "created", "in play", "step p50", "step p99", "max rss kB", "stack kB", "grows");
+
+    std::vector<double> stepTimes;
+    int stackPeak = 0;
+    int stackGrowCount = 0;
+    int ballsFired = 0;
+    for(int frame = 0; ballsFired < aOptions.stressBalls; frame++)
+    {
+      if(frame % framesBetweenBalls == 0)
+      {
+        //Keep the cannon from overheating, the stress is on the pool and not the game rules
+        cannon->reset();
+        game->fire();
+        ballsFired++;
+      }
+
+      game->update(frameDelta);
+      if(game->getPhysicsStepsLastFrame() > 0)
+      {
+        stepTimes.push_back(world->GetProfile().step);
+        stackPeak = std::max(stackPeak, world->GetProfile().stackPeak);
+        stackGrowCount += world->GetProfile().stackGrowCount;
+      }
+
+      if(frame % framesBetweenBalls == 0 && (ballsFired % ballsPerReport == 0 || ballsFired == aOptions.stressBalls))
+      {
+        printf("  %8d %8d %8d %8d %8d %10.4f %10.4f %10ld %10.1f %6d\n", ballsFired, world->GetBodyCount(), world->GetProxyCount(), cannon->CannonBallsCreated(), cannon->CannonBallsActive(), percentile(stepTimes, 0.5), percentile(stepTimes, 0.99), maxResidentKilobytes(), stackPeak / 1024.0, stackGrowCount);
+        stepTimes.clear();
+        stackPeak = 0;
+        stackGrowCount = 0;
+      }
+    }
+
+    Game::cleanupInstance();
+  }
+
+  //Draws aOptions.sprites rotated sprites over 16 textures through the sprite batch and the recording
+  //backend, and compares the calls made with what one drawTexture per sprite would have made
+  bool runSprites(const BenchOptions& aOptions)
+  {
+    const int textureCount = 16;
+    const int frameCount = 100;
+
+    //Every other texture has alpha and needs blending, like a mix of RGB and RGBA images
+    std::vector<OpenGLSprite> sprites(aOptions.sprites);
+    unsigned int seed = 12345u;
+    for(int i = 0; i < aOptions.sprites; i++)
+    {
+      OpenGLSprite& sprite = sprites[i];
+      seed = seed * 1664525u + 1013904223u;
+      sprite.textureId = 1 + (seed >> 16) % textureCount;
+      sprite.uvX1 = 0.0f;
+      sprite.uvY1 = 0.0f;
+      sprite.uvX2 = 1.0f;
+      sprite.uvY2 = 1.0f;
+      sprite.x = (float)((seed >> 8) % (unsigned int)aOptions.screenWidth);
+      seed = seed * 1664525u + 1013904223u;
+      sprite.y = (float)((seed >> 8) % (unsigned int)aOptions.screenHeight);
+      sprite.width = 32.0f;
+      sprite.height = 32.0f;
+      sprite.angle = (float)((seed >> 4) % 360);
+      sprite.color = OpenGLColorWhite();
+      sprite.isBlended = (sprite.textureId & 1) == 1;
+      sprite.layer = 0;
+    }
+
+    OpenGLRecordingBackend backend;
+    OpenGLSpriteBatch batch(&backend);
+    std::vector<double> frameTimes;
+    for(int frame = 0; frame < frameCount; frame++)
+    {
+      backend.reset();
+      BenchClock::time_point start = BenchClock::now();
+      batch.begin();
+      for(int i = 0; i < aOptions.sprites; i++)
+      {
+        batch.submit(sprites[i]);
+      }
+      batch.end();
+      frameTimes.push_back(millisecondsSince(start));
+    }
+
+    //drawTexture binds and draws every sprite, and enables then disables blending around each blended one
+    int blendedSprites = 0;
+    for(int i = 0; i < aOptions.sprites; i++)
+    {
+      blendedSprites += sprites[i].isBlended == true ? 1 : 0;
+    }
+
+    //Each texture should be drawn by exactly one run
+    std::vector<unsigned int> drawTextures = backend.getDrawTextures();
+    std::sort(drawTextures.begin(), drawTextures.end());
+    bool isBatched = std::unique(drawTextures.begin(), drawTextures.end()) == drawTextures.end() && backend.getVertexCount() == aOptions.sprites * 6;
+
+    printf("Sprite batch: %d sprites, %d textures, %d frames\n", aOptions.sprites, textureCount, frameCount);
+    printf("  %-14s %10s %10s %10s\n", "", "draws", "binds", "blend");
+    printf("  %-14s %10d %10d %10d\n", "drawTexture", aOptions.sprites, aOptions.sprites, blendedSprites * 2);
+    printf("  %-14s %10d %10d %10d\n", "sprite batch", backend.getDrawCalls(), backend.getTextureBinds(), backend.getBlendChanges());
+    printf("Sprite batch (ms)\n");
+    printSamples("frame", frameTimes);
+    printf("%s\n", isBatched == true ? "One draw per texture: ok" : "One draw per texture: FAILED");
+    return isBatched;
+  }
+
+  //Writes the text of HUD label aLabel on aFrame, timers change every frame, the temperature every few and the ball count every second
+  void formatLabel(char* aText, int aSize, int aLabel, int aFrame)
+  {
+    switch(aLabel % 3)
+    {
+      case 0:
+        snprintf(aText, aSize, "Time: %.2f", aFrame / 60.0);
+        break;
+      case 1:
+        snprintf(aText, aSize, "Temperature: %i%%", (aFrame / 8 + aLabel) % 100);
+        break;
+      default:
+        snprintf(aText, aSize, "Balls fired: %i", aFrame / 60 + aLabel);
+        break;
+    }
+  }
+
+  //Sets and draws aOptions.texts HUD labels a frame, once the way OpenGLFont and drawFont used to with a glyph map
+  //lookup and a drawTexture per character, and once through OpenGLTextLayout with one draw per label
+  bool runText(const BenchOptions& aOptions)
+  {
+    const int frameCount = 600;
+    const unsigned int fontTextureId = 1;
+
+    //A monospaced-ish font of the printable characters in a 10 by 10 grid, digits are narrower
+    OpenGLGlyph glyphs[OPENGL_GLYPH_TABLE_SIZE];
+    memset(glyphs, 0, sizeof(glyphs));
+    std::map<std::string, OpenGLGlyph> glyphMap;
+    for(int character = 32; character < 127; character++)
+    {
+      int cell = character - 32;
+      OpenGLGlyph& glyph = glyphs[character];
+      glyph.uvX1 = (cell % 10) * 0.1f;
+      glyph.uvY1 = (cell / 10) * 0.1f;
+      glyph.uvX2 = glyph.uvX1 + 0.1f;
+      glyph.uvY2 = glyph.uvY1 + 0.1f;
+      glyph.width = character >= '0' && character <= '9' ? 10.0f : 12.0f;
+      glyph.height = 20.0f;
+      glyph.isValid = true;
+      glyphMap[std::string(1, (char)character)] = glyph;
+    }
+
+    char text[64];
+    OpenGLRecordingBackend backend;
+
+    //Before, setText measured the text through the map every time and drawFont drew every glyph on its own
+    std::vector<double> glyphFrameTimes;
+    std::vector<float> glyphWidths(aOptions.texts);
+    int glyphDraws = 0;
+    for(int frame = 0; frame < frameCount; frame++)
+    {
+      backend.reset();
+      BenchClock::time_point start = BenchClock::now();
+      for(int label = 0; label < aOptions.texts; label++)
+      {
+        formatLabel(text, sizeof(text), label, frame);
+        std::string labelText(text);
+        float width = 0.0f;
+        for(size_t index = 0; index < labelText.length(); index++)
+        {
+          width += glyphMap[std::string(1, labelText[index])].width;
+        }
+        glyphWidths[label] = width;
+
+        float penX = 0.0f;
+        int length = strlen(labelText.c_str());
+        for(int index = 0; index < length; index++)
+        {
+          //drawTexture, a quad drawn on its own with one bind and blending around it
+          const OpenGLGlyph& glyph = glyphMap[std::string(1, labelText[index])];
+          float y = label * 24.0f;
+          OpenGLSpriteVertex quad[4] =
+          {
+            { penX, y + glyph.height, glyph.uvX1, glyph.uvY1, 0.0f, 0.0f, 0.0f, 1.0f },
+            { penX + glyph.width, y + glyph.height, glyph.uvX2, glyph.uvY1, 0.0f, 0.0f, 0.0f, 1.0f },
+            { penX, y, glyph.uvX1, glyph.uvY2, 0.0f, 0.0f, 0.0f, 1.0f },
+            { penX + glyph.width, y, glyph.uvX2, glyph.uvY2, 0.0f, 0.0f, 0.0f, 1.0f }
+          };
+          backend.begin();
+          backend.setBlending(true);
+          backend.bindTexture(fontTextureId);
+          backend.drawTriangles(quad, 4);
+          backend.end();
+          penX += glyph.width;
+        }
+      }
+      glyphFrameTimes.push_back(millisecondsSince(start));
+      glyphDraws = backend.getDrawCalls();
+    }
+
+    //After, the layout is only rebuilt when a label's text changes and each label is one draw
+    std::vector<OpenGLTextLayout> layouts(aOptions.texts);
+    std::vector<double> layoutFrameTimes;
+    int layoutDraws = 0;
+    int layoutVertices = 0;
+    for(int frame = 0; frame < frameCount; frame++)
+    {
+      backend.reset();
+      BenchClock::time_point start = BenchClock::now();
+      for(int label = 0; label < aOptions.texts; label++)
+      {
+        formatLabel(text, sizeof(text), label, frame);
+        OpenGLTextLayout& layout = layouts[label];
+        layout.setText(glyphs, text);
+
+        backend.begin();
+        backend.setBlending(true);
+        backend.bindTexture(fontTextureId);
+        backend.drawTriangles(layout.getVertices(), layout.getVertexCount());
+        backend.end();
+      }
+      layoutFrameTimes.push_back(millisecondsSince(start));
+      layoutDraws = backend.getDrawCalls();
+      layoutVertices = backend.getVertexCount();
+    }
+
+    //Both ways should end up with the same text, the same widths and the same number of quads
+    int layoutCount = 0;
+    int glyphCount = 0;
+    bool isCorrect = layoutDraws == aOptions.texts;
+    for(int label = 0; label < aOptions.texts; label++)
+    {
+      formatLabel(text, sizeof(text), label, frameCount - 1);
+      isCorrect = isCorrect && strcmp(layouts[label].getText(), text) == 0 && layouts[label].getWidth() == glyphWidths[label];
+      layoutCount += layouts[label].getLayoutCount();
+      glyphCount += strlen(text);
+    }
+    isCorrect = isCorrect && glyphDraws == glyphCount && layoutVertices == glyphCount * 6;
+
+    printf("Text: %d labels, %d glyphs, %d frames\n", aOptions.texts, glyphCount, frameCount);
+    printf("  %-14s %10s %10s\n", "", "draws", "layouts");
+    printf("  %-14s %10d %10d\n", "per glyph", glyphDraws, aOptions.texts * frameCount);
+    printf("  %-14s %10d %10d\n", "text layout", layoutDraws, layoutCount);
+    printf("Text (ms)\n");
+    printSamples("per glyph", glyphFrameTimes);
+    printSamples("text layout", layoutFrameTimes);
+    printf("%s\n", isCorrect == true ? "One draw per label: ok" : "One draw per label: FAILED");
+    return isCorrect;
+  }
+
+  struct CompareSpriteNames
+  {
+    bool operator()(const char* aNameA, const char* aNameB) const
+    {
+      return strcmp(aNameA, aNameB) < 0;
+    }
+  };
+
+  //Writes an index of aOptions.atlasSprites sprites, reads it back and times finding sprites by
+  //name against the strcmp ordered std::map OpenGLTextureManager uses for its filenames
+  bool runAtlas(const BenchOptions& aOptions)
+  {
+    const int lookupCount = 1000000;
+
+    std::vector<std::string> names(aOptions.atlasSprites);
+    std::vector<OpenGLAtlasRegion> regions(aOptions.atlasSprites);
+    std::map<const char*, OpenGLAtlasRegion, CompareSpriteNames> regionMap;
+    for(int i = 0; i < aOptions.atlasSprites; i++)
+    {
+      char name[64];
+      snprintf(name, sizeof(name), "Images/Sprites/sprite_%05d", i);
+      names[i] = name;
+      regions[i].x = (uint16_t)((i % 64) * 32);
+      regions[i].y = (uint16_t)((i / 64) * 32);
+      regions[i].width = 32;
+      regions[i].height = 32;
+    }
+    for(int i = 0; i < aOptions.atlasSprites; i++)
+    {
+      regionMap[names[i].c_str()] = regions[i];
+    }
+
+    char path[] = "/tmp/cannon_bench_atlas_XXXXXX";
+    int descriptor = mkstemp(path);
+    if(descriptor == -1)
+    {
+      printf("Can't create a temporary file\n");
+      return false;
+    }
+    close(descriptor);
+
+    OpenGLAtlasIndex index;
+    bool isWritten = OpenGLAtlasIndex::write(path, 2048, 2048, names, regions);
+    bool isLoaded = isWritten == true && index.load(path) == true;
+    unlink(path);
+    if(isLoaded == false)
+    {
+      printf("Can't write and read back the atlas index\n");
+      return false;
+    }
+
+    //Every name must resolve to its own region, and unknown names to nothing
+    bool isCorrect = index.getRegionCount() == (unsigned int)aOptions.atlasSprites && index.findRegion("missing") == NULL;
+    for(int i = 0; i < aOptions.atlasSprites && isCorrect == true; i++)
+    {
+      const OpenGLAtlasRegion* region = index.findRegion(names[i].c_str());
+      isCorrect = region != NULL && region->x == regions[i].x && region->y == regions[i].y;
+    }
+
+    //Query the names in a scrambled order so neither container gets lucky with the cache
+    std::vector<const char*> queries(lookupCount);
+    unsigned int seed = 12345u;
+    for(int i = 0; i < lookupCount; i++)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      queries[i] = names[(seed >> 8) % aOptions.atlasSprites].c_str();
+    }
+
+    unsigned int checksum = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for(int i = 0; i < lookupCount; i++)
+    {
+      checksum += regionMap.find(queries[i])->second.x;
+    }
+    double mapTime = millisecondsSince(start);
+
+    start = BenchClock::now();
+    for(int i = 0; i < lookupCount; i++)
+    {
+      checksum -= index.findRegion(queries[i])->x;
+    }
+    double indexTime = millisecondsSince(start);
+
+    printf("Atlas index: %d sprites, %d lookups\n", aOptions.atlasSprites, lookupCount);
+    printf("  %-14s %8.1f ns per lookup\n", "std::map", mapTime * 1000000.0 / lookupCount);
+    printf("  %-14s %8.1f ns per lookup\n", "atlas index", indexTime * 1000000.0 / lookupCount);
+    printf("%s\n", isCorrect == true && checksum == 0 ? "Lookups: ok" : "Lookups: FAILED");
+    return isCorrect == true && checksum == 0;
+  }
+
+  //Writes a png with a few gradients and some noise, so it compresses about as well as a sprite
+  bool writeBenchPng(const char* aPath, int aWidth, int aHeight, unsigned int aSeed)
+  {
+    FILE* file = fopen(aPath, "wb");
+    if(file == NULL)
+    {
+      return false;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+    std::vector<unsigned char> pixels(aWidth * aHeight * 4);
+    std::vector<png_bytep> rows(aHeight);
+    if(info == NULL || setjmp(png_jmpbuf(png)))
+    {
+      png_destroy_write_struct(&png, &info);
+      fclose(file);
+      return false;
+    }
+
+    //Only touched after setjmp, so a longjmp can't leave it clobbered
+    unsigned int seed = aSeed;
+    for(int y = 0; y < aHeight; y++)
+    {
+      for(int x = 0; x < aWidth; x++)
+      {
+        seed = seed * 1664525u + 1013904223u;
+        unsigned char* pixel = &pixels[(y * aWidth + x) * 4];
+        pixel[0] = (unsigned char)(x * 255 / aWidth);
+        pixel[1] = (unsigned char)(y * 255 / aHeight);
+        pixel[2] = (unsigned char)((seed >> 24) & 0x0f);
+        pixel[3] = (unsigned char)((x + y) < aWidth ? 255 : (seed >> 16));
+      }
+      rows[y] = &pixels[y * aWidth * 4];
+    }
+
+    png_init_io(png, file);
+    png_set_IHDR(png, info, aWidth, aHeight, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    png_write_image(png, &rows[0]);
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return true;
+  }
+
+  //What UIImage initWithContentsOfFile costs on a retain map hit before anything is drawn: the whole
+  //file is read and its header parsed, the pixels themselves are only decoded by CGContextDrawImage
+  bool readPngHeader(const char* aPath, std::vector<unsigned char>& aBuffer, unsigned int& aWidth)
+  {
+    FILE* file = fopen(aPath, "rb");
+    if(file == NULL)
+    {
+      return false;
+    }
+    fseek(file, 0, SEEK_END);
+    aBuffer.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    bool isRead = fread(&aBuffer[0], 1, aBuffer.size(), file) == aBuffer.size();
+    fclose(file);
+
+    //The width is a big endian word in the IHDR chunk
+    aWidth = 0;
+    if(isRead == true && aBuffer.size() > 24 && png_sig_cmp(&aBuffer[0], 0, 8) == 0)
+    {
+      aWidth = (aBuffer[16] << 24) | (aBuffer[17] << 16) | (aBuffer[18] << 8) | aBuffer[19];
+    }
+    return aWidth != 0;
+  }
+
+  //CPU time used by the calling thread alone, the work the decoder threads take off it doesn't count
+  double threadMilliseconds()
+  {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+  }
+
+  //Stands in for glTexImage2D, which copies the pixels into memory the driver owns
+  unsigned int uploadBenchTexture(const OpenGLDecodedImage& aImage, std::vector<unsigned char>& aTextureMemory)
+  {
+    size_t size = aImage.textureWidth * aImage.textureHeight * 4;
+    aTextureMemory.resize(size);
+    memcpy(&aTextureMemory[0], aImage.pixels, size);
+
+    unsigned int checksum = 0;
+    for(size_t i = 0; i < size; i += 61)
+    {
+      checksum = checksum * 31u + aTextureMemory[i];
+    }
+    return checksum;
+  }
+
+  struct CompareTextureFilenames
+  {
+    bool operator()(const char* aFilenameA, const char* aFilenameB) const
+    {
+      return strcmp(aFilenameA, aFilenameB) < 0;
+    }
+  };
+
+  typedef struct
+  {
+    unsigned int textureId;
+    int retainCount;
+  } BenchTextureRetainInfo;
+
+  //Loads aOptions.textures sprites, a quarter of them unique pngs, through the old path (a strcmp
+  //ordered retain map, every png decoded on the calling thread and reread on every retain) and through
+  //OpenGLTextureCache with OpenGLTextureDecoder decoding ahead on its threads. Uploads are memcpys.
+  bool runTextures(const BenchOptions& aOptions)
+  {
+    char directory[] = "/tmp/cannon_bench_textures_XXXXXX";
+    if(mkdtemp(directory) == NULL)
+    {
+      printf("Can't create a temporary directory\n");
+      return false;
+    }
+
+    //Sprite sized pngs between 16 and 256 pixels a side
+    int uniqueCount = std::max(1, aOptions.textures / 4);
+    std::vector<std::string> paths(uniqueCount);
+    bool isWritten = true;
+    for(int i = 0; i < uniqueCount && isWritten == true; i++)
+    {
+      char path[128];
+      snprintf(path, sizeof(path), "%s/sprite_%04d.png", directory, i);
+      paths[i] = path;
+      isWritten = writeBenchPng(path, 16 + (i * 37) % 241, 16 + (i * 91) % 241, i + 1);
+    }
+
+    //The level's sprite list, every png used about four times in a scrambled order
+    std::vector<const char*> sprites(aOptions.textures);
+    unsigned int seed = 54321u;
+    for(int i = 0; i < aOptions.textures; i++)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      sprites[i] = paths[i < uniqueCount ? i : (seed >> 8) % uniqueCount].c_str();
+    }
+    for(int i = aOptions.textures - 1; i > 0; i--)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      std::swap(sprites[i], sprites[(seed >> 8) % (i + 1)]);
+    }
+
+    std::vector<unsigned char> textureMemory;
+    std::vector<unsigned char> fileBuffer;
+    double oldTime = 0.0;
+    double newTime = 0.0;
+    double oldThreadTime = 0.0;
+    double newThreadTime = 0.0;
+    unsigned int oldChecksum = 0;
+    unsigned int newChecksum = 0;
+    bool isCorrect = isWritten;
+
+    //Best of three, so both paths see a warm file cache
+    for(int run = 0; run < 3 && isCorrect == true; run++)
+    {
+      oldChecksum = 0;
+      BenchClock::time_point start = BenchClock::now();
+      double threadStart = threadMilliseconds();
+      std::map<const char*, BenchTextureRetainInfo, CompareTextureFilenames> retainMap;
+      for(int i = 0; i < aOptions.textures && isCorrect == true; i++)
+      {
+        std::map<const char*, BenchTextureRetainInfo, CompareTextureFilenames>::iterator retainIterator = retainMap.find(sprites[i]);
+        if(retainIterator != retainMap.end())
+        {
+          unsigned int width = 0;
+          isCorrect = readPngHeader(sprites[i], fileBuffer, width);
+          retainIterator->second.retainCount++;
+          oldChecksum += retainIterator->second.textureId;
+          continue;
+        }
+
+        OpenGLDecodedImage image;
+        isCorrect = OpenGLTextureDecoder::decodePng(sprites[i], image);
+        BenchTextureRetainInfo retainInfo;
+        retainInfo.textureId = isCorrect == true ? uploadBenchTexture(image, textureMemory) : 0;
+        retainInfo.retainCount = 1;
+        retainMap[sprites[i]] = retainInfo;
+        oldChecksum += retainInfo.textureId;
+        OpenGLTextureDecoder::freeImage(image);
+      }
+      double time = millisecondsSince(start);
+      double threadTime = threadMilliseconds() - threadStart;
+      oldTime = run == 0 ? time : std::min(oldTime, time);
+      oldThreadTime = run == 0 ? threadTime : std::min(oldThreadTime, threadTime);
+
+      newChecksum = 0;
+      start = BenchClock::now();
+      threadStart = threadMilliseconds();
+      {
+        OpenGLTextureCache cache;
+        OpenGLTextureDecoder decoder(aOptions.decodeThreads);
+        for(int i = 0; i < aOptions.textures; i++)
+        {
+          OpenGLTextureHandle handle = cache.intern(sprites[i]);
+          if(decoder.isQueued(handle) == false)
+          {
+            decoder.decode(handle, sprites[i]);
+          }
+        }
+        for(int i = 0; i < aOptions.textures && isCorrect == true; i++)
+        {
+          OpenGLTextureHandle handle = cache.intern(sprites[i]);
+          OpenGLTextureCacheEntry* entry = cache.retainTexture(handle);
+          if(entry == NULL)
+          {
+            OpenGLDecodedImage image;
+            isCorrect = decoder.waitForImage(handle, image);
+            OpenGLTextureCacheEntry newEntry;
+            memset(&newEntry, 0, sizeof(newEntry));
+            newEntry.textureId = isCorrect == true ? uploadBenchTexture(image, textureMemory) : 0;
+            entry = cache.insertTexture(handle, newEntry);
+            OpenGLTextureDecoder::freeImage(image);
+          }
+          newChecksum += entry->textureId;
+        }
+
+        //Unloading every sprite must empty the retain table
+        int unloadedCount = 0;
+        for(int i = 0; i < aOptions.textures; i++)
+        {
+          unloadedCount += cache.releaseTexture(cache.findHandle(sprites[i]), NULL) == true ? 1 : 0;
+        }
+        isCorrect = isCorrect && unloadedCount == uniqueCount && cache.getTextureCount() == 0 && cache.getHandleCount() == uniqueCount;
+      }
+      time = millisecondsSince(start);
+      threadTime = threadMilliseconds() - threadStart;
+      newTime = run == 0 ? time : std::min(newTime, time);
+      newThreadTime = run == 0 ? threadTime : std::min(newThreadTime, threadTime);
+      isCorrect = isCorrect && retainMap.size() == (size_t)uniqueCount && oldChecksum == newChecksum;
+    }
+
+    for(int i = 0; i < uniqueCount; i++)
+    {
+      unlink(paths[i].c_str());
+    }
+    rmdir(directory);
+
+    printf("Texture loading: %d sprites, %d pngs, %d decode threads\n", aOptions.textures, uniqueCount, aOptions.decodeThreads);
+    printf("  %-22s %10s %14s\n", "", "wall (ms)", "caller cpu (ms)");
+    printf("  %-22s %10.2f %14.2f\n", "std::map, sync decode", oldTime, oldThreadTime);
+    printf("  %-22s %10.2f %14.2f\n", "cache, async decode", newTime, newThreadTime);
+    printf("%s\n", isCorrect == true ? "Textures: ok" : "Textures: FAILED");
+    return isCorrect;
+  }
+
+  //Sums the proxies each query box hits, in a form that doesn't depend on the order of the callbacks
+  struct BenchTreeQuery
+  {
+    bool QueryCallback(int32 aProxyId)
+    {
+      QueryCallback(queryIndex, aProxyId);
+      return true;
+    }
+
+    void QueryCallback(int32 aQueryIndex, int32 aProxyId)
+    {
+      unsigned int box = (unsigned int)(size_t)tree->GetUserData(aProxyId);
+      checksum += ((unsigned int)aQueryIndex * 2654435761u) ^ box;
+      hits++;
+    }
+
+    const b2DynamicTree* tree;
+    int32 queryIndex;
+    unsigned int checksum;
+    int hits;
+  };
+
+  bool compareBoxesLeftToRight(const b2AABB& aBoxA, const b2AABB& aBoxB)
+  {
+    return aBoxA.lowerBound.x < aBoxB.lowerBound.x;
+  }
+
+  void printTreeMetrics(const char* aLabel, const b2DynamicTree& aTree, double aBuildTime)
+  {
+    printf("  %-16s %10.2f %8d %8d %10.2f\n", aLabel, aBuildTime, aTree.GetHeight(), aTree.GetMaxBalance(), aTree.GetAreaRatio());
+  }
+
+  //Builds a tree over a wide level of boxes, one proxy at a time and in bulk, then queries each box's
+  //neighbourhood one box at a time and batched
+  bool runTree(const BenchOptions& aOptions)
+  {
+    const int queryRounds = 10;
+
+    //Boxes scattered over a strip thirty times wider than it is tall, with a few large pieces mixed in
+    std::vector<b2AABB> boxes(aOptions.treeProxies);
+    unsigned int seed = 24680u;
+    float width = 16.5f * sqrtf((float)aOptions.treeProxies);
+    for(int i = 0; i < aOptions.treeProxies; i++)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      float x = width * (float)((seed >> 8) & 0xffff) / 65535.0f;
+      seed = seed * 1664525u + 1013904223u;
+      float y = width / 30.0f * (float)((seed >> 8) & 0xffff) / 65535.0f;
+      seed = seed * 1664525u + 1013904223u;
+      float halfSize = (seed >> 8) % 50 == 0 ? 4.0f : 0.25f + 0.5f * (float)((seed >> 8) & 0xff) / 255.0f;
+      boxes[i].lowerBound.Set(x - halfSize, y - halfSize);
+      boxes[i].upperBound.Set(x + halfSize, y + halfSize);
+    }
+
+    b2DynamicTree incrementalTree;
+    BenchClock::time_point start = BenchClock::now();
+    for(int i = 0; i < aOptions.treeProxies; i++)
+    {
+      incrementalTree.CreateProxy(boxes[i], (void*)(size_t)i);
+    }
+    double incrementalTime = millisecondsSince(start);
+
+    b2DynamicTree bulkTree;
+    start = BenchClock::now();
+    bulkTree.BeginBulkInsert();
+    for(int i = 0; i < aOptions.treeProxies; i++)
+    {
+      bulkTree.CreateProxy(boxes[i], (void*)(size_t)i);
+    }
+    bulkTree.EndBulkInsert();
+    double bulkTime = millisecondsSince(start);
+
+    //Query with the fat boxes, like b2BroadPhase::UpdatePairs does when everything moves. The boxes go
+    //left to right, the order a level's bodies are usually created in, so neighbouring queries share a batch
+    std::vector<b2AABB> queries(aOptions.treeProxies);
+    for(int i = 0; i < aOptions.treeProxies; i++)
+    {
+      queries[i] = bulkTree.GetFatAABB(i);
+    }
+    std::sort(queries.begin(), queries.end(), compareBoxesLeftToRight);
+
+    BenchTreeQuery results[3];
+    double queryTimes[3] = { 0.0, 0.0, 0.0 };
+    for(int method = 0; method < 3; method++)
+    {
+      const b2DynamicTree* tree = method == 0 ? &incrementalTree : &bulkTree;
+      for(int round = 0; round < queryRounds; round++)
+      {
+        BenchTreeQuery query;
+        query.tree = tree;
+        query.queryIndex = 0;
+        query.checksum = 0;
+        query.hits = 0;
+
+        start = BenchClock::now();
+        if(method < 2)
+        {
+          for(int i = 0; i < aOptions.treeProxies; i++)
+          {
+            query.queryIndex = i;
+            tree->Query(&query, queries[i]);
+          }
+        }
+        else
+        {
+          tree->QueryBatch(&query, &queries[0], aOptions.treeProxies);
+        }
+        double time = millisecondsSince(start);
+        queryTimes[method] = round == 0 ? time : std::min(queryTimes[method], time);
+        results[method] = query;
+      }
+    }
+
+    bool isCorrect = results[0].checksum == results[1].checksum && results[0].checksum == results[2].checksum;
+    isCorrect = isCorrect && results[0].hits == results[1].hits && results[0].hits == results[2].hits;
+
+    printf("Dynamic tree: %d proxies, %d lanes per batched query\n", aOptions.treeProxies, b2_simdWidth);
+    printf("  %-16s %10s %8s %8s %10s\n", "", "build (ms)", "height", "balance", "area ratio");
+    printTreeMetrics("incremental", incrementalTree, incrementalTime);
+    printTreeMetrics("bulk SAH", bulkTree, bulkTime);
+    printf("  %-28s %10s %14s\n", "", "query (ms)", "queries per ms");
+    const char* labels[3] = { "incremental tree, Query", "bulk tree, Query", "bulk tree, QueryBatch" };
+    for(int method = 0; method < 3; method++)
+    {
+      printf("  %-28s %10.2f %14.0f\n", labels[method], queryTimes[method], aOptions.treeProxies / std::max(queryTimes[method], 0.001));
+    }
+    printf("  %d overlaps\n", results[0].hits);
+    printf("%s\n", isCorrect == true ? "Queries: ok" : "Queries: FAILED");
+    return isCorrect;
+  }
+
+  //Records the pairs b2BroadPhase::UpdatePairs reports, as box indices
+  struct BenchPairCollector
+  {
+    void AddPair(void* aUserDataA, void* aUserDataB)
+    {
+      int boxA = (int)(size_t)aUserDataA;
+      int boxB = (int)(size_t)aUserDataB;
+      pairs.push_back(std::make_pair(std::min(boxA, boxB), std::max(boxA, boxB)));
+    }
+
+    std::vector<std::pair<int, int> > pairs;
+  };
+
+  //Wakes every box of a broad-phase filled with piles of touching boxes, the move buffer a cannon ball
+  //leaves behind when it knocks a whole level over, and times the pair update
+  double timePairUpdates(const std::vector<b2AABB>& aBoxes, bool aSortFree, b2ThreadPool* aThreadPool, std::vector<std::pair<int, int> >& aPairs)
+  {
+    const int rounds = 10;
+
+    b2BroadPhase broadPhase;
+    broadPhase.SetSortFreePairs(aSortFree);
+    broadPhase.SetThreadPool(aThreadPool);
+    std::vector<int32> proxies(aBoxes.size());
+    for(size_t i = 0; i < aBoxes.size(); i++)
+    {
+      proxies[i] = broadPhase.CreateProxy(aBoxes[i], (void*)i);
+    }
+
+    double bestTime = 0.0;
+    for(int round = 0; round < rounds; round++)
+    {
+      //Everything is buffered twice on the first round, once by CreateProxy and once here
+      for(size_t i = 0; i < proxies.size(); i++)
+      {
+        broadPhase.TouchProxy(proxies[i]);
+      }
+
+      BenchPairCollector collector;
+      BenchClock::time_point start = BenchClock::now();
+      broadPhase.UpdatePairs(&collector);
+      double time = millisecondsSince(start);
+      bestTime = round == 0 ? time : std::min(bestTime, time);
+      aPairs.swap(collector.pairs);
+    }
+    return bestTime;
+  }
+
+  bool runPairs(const BenchOptions& aOptions)
+  {
+    const int threadCount = 4;
+
+    //Piles ten boxes high, side by side so every box touches the ones around it
+    std::vector<b2AABB> boxes(aOptions.pairProxies);
+    for(int i = 0; i < aOptions.pairProxies; i++)
+    {
+      float x = 1.05f * (i / 10);
+      float y = 1.0f * (i % 10);
+      boxes[i].lowerBound.Set(x, y);
+      boxes[i].upperBound.Set(x + 1.0f, y + 1.0f);
+    }
+
+    b2ThreadPool threadPool(threadCount);
+    std::vector<std::pair<int, int> > sortedPairs, sortFreePairs, parallelPairs;
+    double sortedTime = timePairUpdates(boxes, false, NULL, sortedPairs);
+    double sortFreeTime = timePairUpdates(boxes, true, NULL, sortFreePairs);
+    double parallelTime = timePairUpdates(boxes, true, &threadPool, parallelPairs);
+
+    //The parallel pairs must come out in the same order, the sort-free ones as the same set without duplicates
+    bool isCorrect = parallelPairs == sortFreePairs;
+    std::sort(sortFreePairs.begin(), sortFreePairs.end());
+    isCorrect = isCorrect && sortFreePairs == sortedPairs;
+    isCorrect = isCorrect && std::adjacent_find(sortFreePairs.begin(), sortFreePairs.end()) == sortFreePairs.end();
+
+    printf("Pair update: %d moved proxies, %d pairs\n", aOptions.pairProxies, (int)sortedPairs.size());
+    printf("  %-28s %10.3f ms\n", "sorted", sortedTime);
+    printf("  %-28s %10.3f ms\n", "sort-free", sortFreeTime);
+    printf("  %-28s %10.3f ms  (%d threads)\n", "sort-free, parallel queries", parallelTime, threadCount);
+    printf("%s\n", isCorrect == true ? "Pairs: ok" : "Pairs: FAILED");
+    return isCorrect;
+  }
+
+  void printBlockStats(const char* aLabel, const b2BlockStats& aStats)
+  {
+    printf("  %-28s %8.1f KB in use, %8.1f KB high water, %5d chunks\n", aLabel, aStats.totalBytesInUse / 1024.0,
+           aStats.highWaterBytes / 1024.0, aStats.chunkCount);
+  }
+
+  //Fills a world with static bodies of four small boxes each, spaced so nothing touches
+  void createFixtures(b2World* aWorld, int aFixtures)
+  {
+    b2PolygonShape shape;
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape = &shape;
+
+    aWorld->BeginBulkInsert();
+    for(int i = 0; i < aFixtures; i += 4)
+    {
+      b2BodyDef bodyDef;
+      bodyDef.position.Set(3.0f * (i / 4 % 256), 3.0f * (i / 4 / 256));
+      b2Body* body = aWorld->CreateBody(&bodyDef);
+      for(int j = 0; j < 4 && i + j < aFixtures; j++)
+      {
+        shape.SetAsBox(0.25f, 0.25f, b2Vec2(0.5f * (j % 2), 0.5f * (j / 2)), 0.0f);
+        body->CreateFixture(&fixtureDef);
+      }
+    }
+    aWorld->EndBulkInsert();
+
+    //A level that has been played has an empty move buffer, destroying a proxy still in it is a linear search
+    aWorld->Step(1.0f / 60.0f, 8, 3);
+  }
+
+  //Every worker allocates its share of the blocks through its own cache, the frees happen on whichever
+  //worker picks up the item, so blocks move between the caches through the shared pool
+  class BenchBlockTask : public b2ThreadTask
+  {
+  public:
+    BenchBlockTask(std::vector<b2BlockAllocator*>& aCaches, std::vector<void*>& aBlocks, bool aAllocate) :
+      m_Caches(&aCaches),
+      m_Blocks(&aBlocks),
+      m_Allocate(aAllocate)
+    {
+    }
+
+    void Execute(int32 aBegin, int32 aEnd, int32 aWorkerIndex)
+    {
+      b2BlockAllocator* cache = (*m_Caches)[aWorkerIndex];
+      for(int32 i = aBegin; i < aEnd; i++)
+      {
+        int32 size = 16 + (i * 37) % (b2_maxBlockSize - 16);
+        if(m_Allocate == true)
+        {
+          (*m_Blocks)[i] = cache->Allocate(size);
+          memset((*m_Blocks)[i], 0, size);
+        }
+        else
+        {
+          cache->Free((*m_Blocks)[i], size);
+        }
+      }
+    }
+
+  private:
+    std::vector<b2BlockAllocator*>* m_Caches;
+    std::vector<void*>* m_Blocks;
+    bool m_Allocate;
+  };
+
+  double timeBlockCaches(int aThreadCount, int aBlocks, b2BlockStats& aStats)
+  {
+    b2BlockPool pool;
+    b2ThreadPool threadPool(aThreadCount);
+    std::vector<b2BlockAllocator*> caches;
+    for(int i = 0; i < aThreadCount; i++)
+    {
+      caches.push_back(new b2BlockAllocator(&pool));
+    }
+
+    std::vector<void*> blocks(aBlocks);
+    BenchBlockTask allocateTask(caches, blocks, true);
+    BenchBlockTask freeTask(caches, blocks, false);
+    BenchClock::time_point start = BenchClock::now();
+    threadPool.Run(&allocateTask, aBlocks, 256);
+    threadPool.Run(&freeTask, aBlocks, 256);
+    double time = millisecondsSince(start);
+
+    pool.GetStats(&aStats);
+    for(int i = 0; i < aThreadCount; i++)
+    {
+      delete caches[i];
+    }
+    return time;
+  }
+
+  //The closest hit of one ray through b2World::RayCast, the way the aim-assist would cast without RayCastBatch
+  class ClosestRayCallback : public b2RayCastCallback
+  {
+  public:
+    ClosestRayCallback()
+    {
+      fixture = NULL;
+      fraction = 1.0f;
+    }
+
+    float32 ReportFixture(b2Fixture* aFixture, const b2Vec2& aPoint, const b2Vec2& aNormal, float32 aFraction)
+    {
+      if(aFixture->IsSensor() == true)
+      {
+        return -1.0f;
+      }
+
+      fixture = aFixture;
+      point = aPoint;
+      normal = aNormal;
+      fraction = aFraction;
+      return aFraction;
+    }
+
+    b2Fixture* fixture;
+    b2Vec2 point;
+    b2Vec2 normal;
+    float32 fraction;
+  };
+
+  class FixtureListCallback : public b2QueryCallback
+  {
+  public:
+    bool ReportFixture(b2Fixture* aFixture)
+    {
+      fixtures.push_back(aFixture);
+      return true;
+    }
+
+    std::vector<b2Fixture*> fixtures;
+  };
+
+  //Each query is timed this many times and the best time is kept
+  const int BENCH_QUERY_ROUNDS = 20;
+
+  double bestTime(double aBest, int aRound, BenchClock::time_point aStart)
+  {
+    double time = millisecondsSince(aStart);
+    return aRound == 0 ? time : std::min(aBest, time);
+  }
+
+  //Fans aOptions.rays rays across 90 degrees around the barrel of the loaded level, plus a 2 m box at a point
+  //along each ray, and times a loop of single RayCast and QueryAABB calls against the batched versions on
+  //each thread count. The batches have to find the same fixtures as the loops
+  bool runRays(const BenchOptions& aOptions)
+  {
+    const int maxFixtures = 64;
+
+    Game* game = Game::getInstance();
+    while(game->isLoading() == true)
+    {
+      game->update(BENCH_FRAME_DELTA);
+    }
+    addPiles(game, aOptions.piles, aOptions.pileHeight);
+    game->update(BENCH_FRAME_DELTA);
+
+    b2World* world = game->getWorld();
+    Cannon* cannon = game->getCannon();
+    b2Vec2 origin(cannon->getBarrelX(), cannon->getBarrelY());
+    float length = RW2PW(game->getScreenWidth());
+    int count = aOptions.rays;
+
+    std::vector<b2RayCastInput> inputs(count);
+    std::vector<b2AABB> aabbs(count);
+    for(int i = 0; i < count; i++)
+    {
+      float angle = b2_pi * (0.5f * i / std::max(count - 1, 1) - 0.25f);
+      b2Vec2 direction(cosf(angle), sinf(angle));
+      inputs[i].p1 = origin;
+      inputs[i].p2 = origin + length * direction;
+      inputs[i].maxFraction = 1.0f;
+
+      b2Vec2 center = origin + (length * ((i % 16) + 1) / 16.0f) * direction;
+      aabbs[i].lowerBound = center - b2Vec2(1.0f, 1.0f);
+      aabbs[i].upperBound = center + b2Vec2(1.0f, 1.0f);
+    }
+
+    printf("Rays: %d rays and boxes from the barrel, %d bodies, %d proxies\n", count, world->GetBodyCount(), world->GetProxyCount());
+
+    std::vector<ClosestRayCallback> rayResults(count);
+    std::vector<FixtureListCallback> queryResults(count);
+    double rayLoopTime = 0.0;
+    double queryLoopTime = 0.0;
+    for(int round = 0; round < BENCH_QUERY_ROUNDS; round++)
+    {
+      BenchClock::time_point start = BenchClock::now();
+      for(int i = 0; i < count; i++)
+      {
+        rayResults[i] = ClosestRayCallback();
+        world->RayCast(&rayResults[i], inputs[i].p1, inputs[i].p2);
+      }
+      rayLoopTime = bestTime(rayLoopTime, round, start);
+
+      start = BenchClock::now();
+      for(int i = 0; i < count; i++)
+      {
+        queryResults[i].fixtures.clear();
+        world->QueryAABB(&queryResults[i], aabbs[i]);
+      }
+      queryLoopTime = bestTime(queryLoopTime, round, start);
+    }
+
+    int hitCount = 0;
+    for(int i = 0; i < count; i++)
+    {
+      hitCount += rayResults[i].fixture != NULL ? 1 : 0;
+    }
+    printf("  %-28s %10.4f ms, %d hit\n", "RayCast loop", rayLoopTime, hitCount);
+    printf("  %-28s %10.4f ms\n", "QueryAABB loop", queryLoopTime);
+
+    bool isCorrect = true;
+    std::vector<b2RayCastHit> hits(count);
+    std::vector<b2Fixture*> fixtures(count * maxFixtures);
+    std::vector<int32> fixtureCounts(count);
+    for(size_t t = 0; t < aOptions.threadCounts.size(); t++)
+    {
+      world->SetThreadCount(aOptions.threadCounts[t]);
+      double rayBatchTime = 0.0;
+      double queryBatchTime = 0.0;
+      for(int round = 0; round < BENCH_QUERY_ROUNDS; round++)
+      {
+        BenchClock::time_point start = BenchClock::now();
+        world->RayCastBatch(&inputs[0], &hits[0], count);
+        rayBatchTime = bestTime(rayBatchTime, round, start);
+
+        start = BenchClock::now();
+        world->QueryAABBBatch(&aabbs[0], count, &fixtures[0], maxFixtures, &fixtureCounts[0]);
+        queryBatchTime = bestTime(queryBatchTime, round, start);
+      }
+
+      bool isMatching = true;
+      for(int i = 0; i < count; i++)
+      {
+        isMatching = isMatching && hits[i].fixture == rayResults[i].fixture;
+        isMatching = isMatching && (hits[i].fixture == NULL || hits[i].fraction == rayResults[i].fraction);
+
+        std::vector<b2Fixture*> expected = queryResults[i].fixtures;
+        std::vector<b2Fixture*> found(fixtures.begin() + i * maxFixtures, fixtures.begin() + i * maxFixtures + std::min(fixtureCounts[i], maxFixtures));
+        std::sort(expected.begin(), expected.end());
+        std::sort(found.begin(), found.end());
+        isMatching = isMatching && fixtureCounts[i] == (int32)expected.size() && (fixtureCounts[i] > maxFixtures || found == expected);
+      }
+
+      printf("  %d threads\n", world->GetThreadCount());
+      printf("    %-26s %10.4f ms, %.1fx\n", "RayCastBatch", rayBatchTime, rayLoopTime / rayBatchTime);
+      printf("    %-26s %10.4f ms, %.1fx\n", "QueryAABBBatch", queryBatchTime, queryLoopTime / queryBatchTime);
+      printf("    %s\n", isMatching == true ? "Same fixtures as the loops: ok" : "Same fixtures as the loops: FAILED");
+      isCorrect = isCorrect && isMatching;
+    }
+
+    Game::cleanupInstance();
+    return isCorrect;
+  }
+
+  const int BENCH_TRAJECTORY_SETTLE_FRAMES = 600;
+  const int BENCH_TRAJECTORY_SHOTS = 8;
+
+  //Steps a fired ball keeps going past the end of its predicted path, it may touch something a little later
+  const int BENCH_TRAJECTORY_EXTRA_STEPS = 30;
+
+  //How far in meters a fired ball may stray from its predicted path before it touches anything
+  const float BENCH_TRAJECTORY_FLIGHT_TOLERANCE = 0.001f;
+
+  //Barrel angle for aim aIndex of aCount, stepping through the barrel's range out of order so
+  //no two aims in a row are close enough for the predictor to reuse its path
+  float trajectoryAim(int aIndex, int aCount)
+  {
+    return 0.25f * b2_pi * (float)((aIndex * 37) % aCount) / (float)aCount;
+  }
+
+  void aimBarrel(Cannon* aCannon, float aAngle)
+  {
+    aCannon->BarrelUp(aAngle - aCannon->getBarrelAngle());
+  }
+
+  //Times the cannon's trajectory preview from aims across the barrel's range, with no budget, with the game's
+  //budget and from the cache. Then fires real shots and compares their paths with the predictions
+  bool runTrajectory(const BenchOptions& aOptions)
+  {
+    Game* game = Game::getInstance();
+    while(game->isLoading() == true)
+    {
+      game->update(BENCH_FRAME_DELTA);
+    }
+    addPiles(game, aOptions.piles, aOptions.pileHeight);
+
+    //Blocks are only predicted against once they sleep
+    b2World* world = game->getWorld();
+    int settleFrames = 0;
+    while(settleFrames < BENCH_TRAJECTORY_SETTLE_FRAMES && isWorldAsleep(world) == false)
+    {
+      game->update(BENCH_FRAME_DELTA);
+      settleFrames++;
+    }
+    bool isSettled = isWorldAsleep(world);
+
+    Cannon* cannon = game->getCannon();
+    TrajectoryPredictor* predictor = game->getTrajectoryPredictor();
+    float timeStep = (float)(1.0 / game->getPhysicsRate());
+    int aims = aOptions.trajectory;
+    printf("Trajectory: %d aims, %d bodies, %d proxies, %d steps ahead, settled after %d frames\n", aims, world->GetBodyCount(), world->GetProxyCount(), predictor->getMaxSteps(), settleFrames);
+
+    //Whole predictions, however long they take
+    std::vector<double> fullTimes;
+    int steps = 0;
+    int hits = 0;
+    predictor->setTimeBudget(FLT_MAX);
+    for(int i = 0; i < aims; i++)
+    {
+      aimBarrel(cannon, trajectoryAim(i, aims));
+      BenchClock::time_point start = BenchClock::now();
+      predictor->update(world, cannon, timeStep, BENCH_FRAME_DELTA);
+      fullTimes.push_back(millisecondsSince(start));
+      steps += (int)predictor->getPoints().size() - 1;
+      hits += predictor->getHitFixture() != NULL ? 1 : 0;
+    }
+
+    //The same aims under the game's budget, a path that doesn't fit carries on next update
+    std::vector<double> budgetTimes;
+    int unfinished = 0;
+    predictor->setTimeBudget(CANNON_TRAJECTORY_TIME_BUDGET);
+    for(int i = 0; i < aims; i++)
+    {
+      aimBarrel(cannon, trajectoryAim(i, aims));
+      BenchClock::time_point start = BenchClock::now();
+      predictor->update(world, cannon, timeStep, BENCH_FRAME_DELTA);
+      budgetTimes.push_back(millisecondsSince(start));
+      unfinished += predictor->isComplete() == true ? 0 : 1;
+    }
+
+    //And with the barrel still, the path is reused
+    std::vector<double> cachedTimes;
+    int cached = 0;
+    for(int i = 0; i < aims; i++)
+    {
+      BenchClock::time_point start = BenchClock::now();
+      predictor->update(world, cannon, timeStep, 0.0);
+      cachedTimes.push_back(millisecondsSince(start));
+      cached += predictor->wasLastUpdateCached() == true ? 1 : 0;
+    }
+
+    //With no budget at all each update checks one chunk, carrying on must end with the same path
+    aimBarrel(cannon, trajectoryAim(1, aims));
+    predictor->setTimeBudget(FLT_MAX);
+    predictor->update(world, cannon, timeStep, 0.0);
+    std::vector<b2Vec2> fullPath = predictor->getPoints();
+    predictor->invalidate();
+    predictor->setTimeBudget(0.0f);
+    int resumedUpdates = 0;
+    do
+    {
+      predictor->update(world, cannon, timeStep, 0.0);
+      resumedUpdates++;
+    }
+    while(predictor->isComplete() == false);
+    bool isResumedSame = predictor->getPoints() == fullPath;
+
+    printf("  %d steps per aim, %d of %d aims hit something\n", steps / aims, hits, aims);
+    printSamples("Full", fullTimes);
+    printSamples("Budgeted", budgetTimes);
+    printSamples("Cached", cachedTimes);
+    printf("  %d of %d budgeted aims needed another update, %d of %d still aims were cached\n", unfinished, aims, cached, aims);
+    printf("  No budget: path finished over %d updates, %s\n", resumedUpdates, isResumedSame == true ? "same path: ok" : "same path: FAILED");
+
+    //Fire along a few predictions and step the world, the ball should follow the path until it touches
+    //something. The world goes back to the same state for every shot
+    b2Snapshot snapshot;
+    game->saveState(&snapshot);
+    predictor->setTimeBudget(FLT_MAX);
+
+    float maxDeviation = 0.0f;
+    float maxHitDistance = 0.0f;
+    int sameFixture = 0;
+    int shots = 0;
+    for(int shot = 0; shot < BENCH_TRAJECTORY_SHOTS; shot++)
+    {
+      game->restoreState(snapshot);
+      aimBarrel(cannon, trajectoryAim(shot, BENCH_TRAJECTORY_SHOTS));
+      predictor->update(world, cannon, timeStep, BENCH_FRAME_DELTA);
+      std::vector<b2Vec2> points = predictor->getPoints();
+      b2Fixture* predictedFixture = predictor->getHitFixture();
+
+      //The fired ball is the one moved to the muzzle
+      b2Vec2 muzzle = cannon->getMuzzlePosition();
+      cannon->fire();
+      b2Body* ball = NULL;
+      for(b2Body* body = world->GetBodyList(); body != NULL && ball == NULL; body = body->GetNext())
+      {
+        if(body->GetType() == b2_dynamicBody && body->GetPosition() == muzzle && cannon->isCannonBody(body) == false)
+        {
+          ball = body;
+        }
+      }
+      if(ball == NULL)
+      {
+        printf("  Shot %d: no ball at the muzzle\n", shot);
+        Game::cleanupInstance();
+        return false;
+      }
+
+      //Step until the ball touches something other than the cannon, or a while after the predicted path ends.
+      //A path that hits something ends at the time of impact, the world's TOI sub-step then moves the ball
+      //on, so that point is only compared once the ball touches
+      size_t flightPoints = predictedFixture != NULL ? points.size() - 1 : points.size();
+      b2Fixture* touched = NULL;
+      for(size_t step = 1; step < points.size() + BENCH_TRAJECTORY_EXTRA_STEPS && touched == NULL; step++)
+      {
+        //A ball that lands on the seam between two blocks touches both in the same step, either counts
+        world->Step(timeStep, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+        for(b2ContactEdge* edge = ball->GetContactList(); edge != NULL && touched != predictedFixture; edge = edge->next)
+        {
+          if(edge->contact->IsTouching() == true && cannon->isCannonBody(edge->other) == false)
+          {
+            b2Fixture* fixture = edge->contact->GetFixtureA()->GetBody() == ball ? edge->contact->GetFixtureB() : edge->contact->GetFixtureA();
+            touched = touched == NULL || fixture == predictedFixture ? fixture : touched;
+          }
+        }
+
+        if(touched == NULL && step < flightPoints)
+        {
+          maxDeviation = std::max(maxDeviation, (ball->GetPosition() - points[step]).Length());
+        }
+        else if(touched != NULL && touched == predictedFixture)
+        {
+          maxHitDistance = std::max(maxHitDistance, (ball->GetPosition() - points.back()).Length());
+        }
+      }
+
+      sameFixture += touched == predictedFixture ? 1 : 0;
+      shots++;
+    }
+
+    printf("  Fired shots: %d of %d first touched the predicted fixture\n", sameFixture, shots);
+    printf("  Fired shots: %.4f m max from the path in flight, %.4f m max from the predicted hit when they touched it\n", maxDeviation, maxHitDistance);
+
+    //Awake blocks are left out of the prediction, so shots only have to match once everything sleeps
+    bool isShotMatching = sameFixture == shots && maxDeviation <= BENCH_TRAJECTORY_FLIGHT_TOLERANCE;
+    if(isSettled == false)
+    {
+      printf("  Shots follow the preview: not checked, the piles were still awake\n");
+      isShotMatching = true;
+    }
+    else
+    {
+      printf("  %s\n", isShotMatching == true ? "Shots follow the preview: ok" : "Shots follow the preview: FAILED");
+    }
+
+    //A block pressed against the end of the barrel moves the spawn back inside the barrel, clear of the block
+    b2Vec2 clearMuzzle = cannon->getMuzzlePosition();
+    b2BodyDef blockDef;
+    blockDef.position = clearMuzzle;
+    b2Body* block = world->CreateBody(&blockDef);
+    b2PolygonShape blockShape;
+    blockShape.SetAsBox(cannon->getCannonBallRadius(), cannon->getCannonBallRadius());
+    block->CreateFixture(&blockShape, 1.0f);
+    b2CircleShape ballShape;
+    ballShape.m_radius = cannon->getCannonBallRadius();
+    b2Transform ballTransform(cannon->getMuzzlePosition(), b2Rot(0.0f));
+    bool isBlockedClear = b2TestOverlap(&ballShape, 0, &blockShape, 0, ballTransform, block->GetTransform()) == false;
+    world->DestroyBody(block);
+    bool isMuzzleRestored = cannon->getMuzzlePosition() == clearMuzzle;
+    printf("  Blocked muzzle: %s\n", isBlockedClear == true && isMuzzleRestored == true ? "ok" : "FAILED");
+
+    Game::cleanupInstance();
+    return isResumedSame == true && isShotMatching == true && isBlockedClear == true && isMuzzleRestored == true;
+  }
+
+  //Creates a level's worth of fixtures, tears it down the way Game used to, one fixture and body at a
+  //time, then builds it again and tears it down with DestroyAllBodies
+  bool runFixtures(const BenchOptions& aOptions)
+  {
+    const int threadCount = 4;
+
+    b2World* world = new b2World(b2Vec2(0.0f, -10.0f));
+    b2BlockStats stats;
+    bool isCorrect = true;
+
+    printf("Block allocator: %d fixtures\n", aOptions.fixtures);
+    BenchClock::time_point start = BenchClock::now();
+    createFixtures(world, aOptions.fixtures);
+    double createTime = millisecondsSince(start);
+    world->GetBlockStats(&stats);
+    printf("  %-28s %10.3f ms\n", "create", createTime);
+    printBlockStats("after create", stats);
+
+    start = BenchClock::now();
+    b2Body* body = world->GetBodyList();
+    while(body != NULL)
+    {
+      b2Body* nextBody = body->GetNext();
+      b2Fixture* fixture = body->GetFixtureList();
+      while(fixture != NULL)
+      {
+        b2Fixture* nextFixture = fixture->GetNext();
+        body->DestroyFixture(fixture);
+        fixture = nextFixture;
+      }
+      world->DestroyBody(body);
+      body = nextBody;
+    }
+    double destroyTime = millisecondsSince(start);
+    world->GetBlockStats(&stats);
+    printf("  %-28s %10.3f ms\n", "destroy one at a time", destroyTime);
+    printBlockStats("after destroy", stats);
+    isCorrect = isCorrect && stats.totalBytesInUse == 0 && world->GetProxyCount() == 0;
+
+    //The chunks are still there, so this round never asks the system for memory
+    start = BenchClock::now();
+    createFixtures(world, aOptions.fixtures);
+    double recreateTime = millisecondsSince(start);
+    printf("  %-28s %10.3f ms\n", "create again", recreateTime);
+
+    start = BenchClock::now();
+    world->DestroyAllBodies();
+    double resetTime = millisecondsSince(start);
+    world->GetBlockStats(&stats);
+    printf("  %-28s %10.3f ms\n", "DestroyAllBodies", resetTime);
+    printBlockStats("after DestroyAllBodies", stats);
+    isCorrect = isCorrect && stats.totalBytesInUse == 0 && stats.chunkCount == 0;
+    isCorrect = isCorrect && world->GetBodyCount() == 0 && world->GetProxyCount() == 0 && world->GetContactCount() == 0;
+
+    //The world has to be usable again afterwards
+    createFixtures(world, 64);
+    b2BodyDef ballDef;
+    ballDef.type = b2_dynamicBody;
+    ballDef.position.Set(0.25f, 2.0f);
+    b2CircleShape ball;
+    ball.m_radius = 0.25f;
+    world->CreateBody(&ballDef)->CreateFixture(&ball, 1.0f);
+    for(int i = 0; i < 60; i++)
+    {
+      world->Step(1.0f / 60.0f, 8, 3);
+    }
+    isCorrect = isCorrect && world->GetBodyCount() == 17 && world->GetContactCount() > 0;
+    delete world;
+
+    //Allocations from several threads through per-thread caches sharing one pool
+    b2BlockStats singleStats;
+    b2BlockStats threadedStats;
+    double singleTime = timeBlockCaches(1, aOptions.fixtures, singleStats);
+    double threadedTime = timeBlockCaches(threadCount, aOptions.fixtures, threadedStats);
+    printf("  %-28s %10.3f ms\n", "one cache", singleTime);
+    printf("  %-28s %10.3f ms  (%d threads)\n", "per-thread caches", threadedTime, threadCount);
+    printBlockStats("after freeing on any thread", threadedStats);
+    isCorrect = isCorrect && singleStats.totalBytesInUse == 0 && threadedStats.totalBytesInUse == 0;
+
+    printf("%s\n", isCorrect == true ? "Block allocator: ok" : "Block allocator: FAILED");
+    return isCorrect;
+  }
+
+  //What Log::output used to do, three printf calls per message on the calling thread
+  void logSynchronously(FILE* aFile, const char* aLabel, const char* aOutput, ...)
+  {
+    va_list arguments;
+    va_start(arguments, aOutput);
+    fprintf(aFile, "[%s] - ", aLabel);
+    vfprintf(aFile, aOutput, arguments);
+    fprintf(aFile, "\n");
+    va_end(arguments);
+  }
+
+  //Only the formatting of a message, the least any logger that formats on the caller can cost
+  int formatMessage(char* aBuffer, size_t aSize, const char* aOutput, ...)
+  {
+    va_list arguments;
+    va_start(arguments, aOutput);
+    int length = vsnprintf(aBuffer, aSize, aOutput, arguments);
+    va_end(arguments);
+    return length;
+  }
+
+  void logMessages(int aFirst, int aCount)
+  {
+    for(int i = aFirst; i < aFirst + aCount; i++)
+    {
+      LOG_DEBUG("message %d of the log benchmark, step %.4f", i, i * BENCH_FRAME_DELTA);
+    }
+  }
+
+  //Counts the messages in the file, false if any line isn't a whole message
+  bool countLogLines(const char* aPath, int& aMessages)
+  {
+    FILE* file = fopen(aPath, "rb");
+    if(file == NULL)
+    {
+      return false;
+    }
+
+    const char* messagePrefix = "[DEBUG] - message ";
+    const char* dropPrefix = "[LOG] - ";
+    char line[512];
+    bool isWhole = true;
+    aMessages = 0;
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+      size_t length = strlen(line);
+      if(length == 0 || line[length - 1] != '\n')
+      {
+        isWhole = false;
+      }
+      else if(strncmp(line, messagePrefix, strlen(messagePrefix)) == 0)
+      {
+        aMessages++;
+      }
+      else if(strncmp(line, dropPrefix, strlen(dropPrefix)) != 0)
+      {
+        isWhole = false;
+      }
+    }
+    fclose(file);
+    return isWhole;
+  }
+
+  bool runLog(const BenchOptions& aOptions)
+  {
+    const int threadCounts[] = { 1, 4 };
+    const long rotateBytes = 64 * 1024;
+    const int rotateFiles = 3;
+    const int burstSize = 500;
+
+    char path[] = "/tmp/cannon_bench_log_XXXXXX";
+    int descriptor = mkstemp(path);
+    if(descriptor < 0)
+    {
+      printf("Can't create a log file in /tmp\n");
+      return false;
+    }
+    close(descriptor);
+
+    int messages = aOptions.logMessages;
+    printf("Log: %d messages to %s\n", messages, path);
+
+    char buffer[256];
+    int formatted = 0;
+    double cpuStart = threadMilliseconds();
+    for(int i = 0; i < messages; i++)
+    {
+      formatted += formatMessage(buffer, sizeof(buffer), "message %d of the log benchmark, step %.4f", i, i * BENCH_FRAME_DELTA);
+    }
+    double formatTime = threadMilliseconds() - cpuStart;
+    printf("  %-24s %10.3f ms  %8.1f ns per call  (%d bytes)\n", "vsnprintf only", formatTime, formatTime * 1000000.0 / messages, formatted);
+
+    FILE* file = fopen(path, "wb");
+    BenchClock::time_point start = BenchClock::now();
+    cpuStart = threadMilliseconds();
+    for(int i = 0; i < messages; i++)
+    {
+      logSynchronously(file, "DEBUG", "message %d of the log benchmark, step %.4f", i, i * BENCH_FRAME_DELTA);
+    }
+    fclose(file);
+    double syncTime = millisecondsSince(start);
+    double syncCpuTime = threadMilliseconds() - cpuStart;
+    printf("  %-24s %10.3f ms  %8.1f ns per call, %.1f ns of caller CPU\n", "synchronous printf", syncTime, syncTime * 1000000.0 / messages, syncCpuTime * 1000000.0 / messages);
+
+    bool isCorrect = true;
+    for(size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+    {
+      int threadCount = threadCounts[i];
+      remove(path);
+      Log::setOutputFile(path, 0, 0);
+      unsigned long written = Log::getWrittenCount();
+      unsigned long dropped = Log::getDroppedCount();
+
+      //The calling thread logs its share as well
+      int share = messages / threadCount;
+      start = BenchClock::now();
+      std::vector<std::thread> threads;
+      for(int j = 1; j < threadCount; j++)
+      {
+        threads.push_back(std::thread(logMessages, j * share, share));
+      }
+      logMessages(0, messages - (threadCount - 1) * share);
+      for(size_t j = 0; j < threads.size(); j++)
+      {
+        threads[j].join();
+      }
+      double callTime = millisecondsSince(start);
+      Log::flush();
+      double flushTime = millisecondsSince(start);
+
+      written = Log::getWrittenCount() - written;
+      dropped = Log::getDroppedCount() - dropped;
+      int lines = 0;
+      bool isWhole = countLogLines(path, lines);
+      isCorrect = isCorrect && isWhole && (unsigned long)lines == written && written + dropped == (unsigned long)messages;
+
+      char label[64];
+      snprintf(label, sizeof(label), "async, %d thread%s", threadCount, threadCount > 1 ? "s" : "");
+      printf("  %-24s %10.3f ms  %8.1f ns per call, %.3f ms until flushed, %lu written, %lu dropped%s\n", label, callTime, callTime * 1000000.0 / messages, flushTime, written, dropped, isWhole == true ? "" : ", broken lines");
+    }
+
+    //Bursts that fit in a thread's buffer, what a frame that logs a few hundred lines pays
+    remove(path);
+    Log::setOutputFile(path, 0, 0);
+    double burstTime = 0.0;
+    double burstCpuTime = 0.0;
+    int burstCount = 0;
+    for(int i = 0; i + burstSize <= messages; i += burstSize)
+    {
+      start = BenchClock::now();
+      cpuStart = threadMilliseconds();
+      logMessages(i, burstSize);
+      burstCpuTime += threadMilliseconds() - cpuStart;
+      burstTime += millisecondsSince(start);
+      burstCount += burstSize;
+      Log::flush();
+    }
+    printf("  %-24s %10.3f ms  %8.1f ns per call, %.1f ns of caller CPU\n", "async, bursts of 500", burstTime, burstTime * 1000000.0 / std::max(burstCount, 1), burstCpuTime * 1000000.0 / std::max(burstCount, 1));
+
+    //Rotation keeps the newest file and rotateFiles older ones, none much over rotateBytes
+    remove(path);
+    Log::setOutputFile(path, rotateBytes, rotateFiles);
+    logMessages(0, std::min(messages, 20000));
+    Log::flush();
+    Log::setOutputStdout();
+    for(int i = 0; i <= rotateFiles + 1; i++)
+    {
+      std::string rotatedPath = i == 0 ? std::string(path) : std::string(path) + "." + std::to_string(i);
+      struct stat status;
+      bool exists = stat(rotatedPath.c_str(), &status) == 0;
+      if(i > rotateFiles)
+      {
+        isCorrect = isCorrect && exists == false;
+      }
+      else if(exists == true)
+      {
+        isCorrect = isCorrect && status.st_size < rotateBytes + 64 * 1024;
+      }
+      remove(rotatedPath.c_str());
+    }
+
+    printf("%s\n", isCorrect == true ? "Log: ok" : "Log: FAILED");
+    return isCorrect;
+  }
+}
+
+int main(int aArgc, char** aArgv)
+{
+  BenchOptions options;
+  options.volleys = 20;
+  options.framesBetweenVolleys = 60;
+  options.settleFrames = 300;
+  options.screenWidth = 1024.0f;
+  options.screenHeight = 768.0f;
+  options.piles = 0;
+  options.pileHeight = 10;
+  options.frameRate = 60.0;
+  options.physicsRate = GAME_PHYSICS_STEPS_PER_SECOND;
+  options.maxStepsPerFrame = GAME_PHYSICS_MAX_STEPS_PER_FRAME;
+  options.stressBalls = 0;
+  options.bullets = 0;
+  options.maxTOIEvents = 0;
+  options.tunnelingShots = 0;
+  options.poolSize = CANNON_BALL_POOL_SIZE;
+  options.sprites = 0;
+  options.texts = 0;
+  options.atlasSprites = 0;
+  options.textures = 0;
+  options.decodeThreads = 2;
+  options.treeProxies = 0;
+  options.pairProxies = 0;
+  options.fixtures = 0;
+  options.rays = 0;
+  options.trajectory = 0;
+  options.logMessages = 0;
+  options.stackSize = GAME_PHYSICS_STACK_SIZE;
+  options.simdSolver = false;
+  options.warmStartCache = true;
+  options.sortFreePairs = false;
+  options.speculativeContacts = false;
+  options.checkSolver = false;
+  options.settleCheck = false;
+  options.checkAllocations = false;
+  options.checkSnapshot = false;
+  options.checkReplay = false;
+  options.recordPath = NULL;
+  options.replayPath = NULL;
+  options.profilePath = NULL;
+  options.threadCounts.push_back(1);
+  options.broadPhases.push_back(b2_dynamicTreeBroadPhase);
+
+  if(parseOptions(aArgc, aArgv, options) == false)
+  {
+    printf("usage: %s [--volleys N] [--interval FRAMES] [--settle FRAMES] [--screen WxH]\n", aArgv[0]);
+    printf("          [--piles N] [--pile-height N] [--threads N[,N...]] [--simd-solver] [--check-solver]\n");
+    printf("          [--no-warm-start-cache] [--settle-check] [--frame-rate HZ] [--physics-rate HZ] [--max-steps N]\n");
+    printf("          [--bullets N] [--max-toi-events N] [--speculative] [--tunneling SHOTS]\n");
+    printf("          [--stress BALLS] [--pool-size N] [--sprites N] [--text N] [--atlas N] [--textures N] [--decode-threads N]\n");
+    printf("          [--tree PROXIES] [--pairs PROXIES] [--sort-free-pairs] [--broad-phase tree|sap|both]\n");
+    printf("          [--fixtures N] [--rays N] [--trajectory AIMS] [--stack-size BYTES] [--check-allocations] [--profile TRACE.json]\n");
+    printf("          [--log MESSAGES] [--check-snapshot] [--record JOURNAL] [--replay JOURNAL] [--check-replay]\n");
+    return 1;
+  }
+
+  DeviceUtils::setScreenResolution(options.screenWidth, options.screenHeight);
+
+  if(options.settleCheck == true)
+  {
+    settleCheck();
+    return 0;
+  }
+
+  if(options.checkAllocations == true)
+  {
+    return checkAllocations(options) == true ? 0 : 1;
+  }
+
+  //Input journals, a replay fails when a tick doesn't match the recording
+  if(options.recordPath != NULL)
+  {
+    return recordSession(options, options.recordPath) == true ? 0 : 1;
+  }
+
+  if(options.replayPath != NULL)
+  {
+    return runReplay(options) == true ? 0 : 1;
+  }
+
+  if(options.checkReplay == true)
+  {
+    return checkReplay(options) == true ? 0 : 1;
+  }
+
+  if(options.checkSnapshot == true)
+  {
+    return checkSnapshot(options) == true ? 0 : 1;
+  }
+
+  //Compares the SIMD contact solver against the scalar one instead of running the game
+  if(options.checkSolver == true)
+  {
+    return checkSolver() == true ? 0 : 1;
+  }
+
+  //Renderer benchmark, no physics involved
+  if(options.sprites > 0)
+  {
+    return runSprites(options) == true ? 0 : 1;
+  }
+
+  if(options.texts > 0)
+  {
+    return runText(options) == true ? 0 : 1;
+  }
+
+  if(options.atlasSprites > 0)
+  {
+    return runAtlas(options) == true ? 0 : 1;
+  }
+
+  if(options.textures > 0)
+  {
+    return runTextures(options) == true ? 0 : 1;
+  }
+
+  if(options.treeProxies > 0)
+  {
+    return runTree(options) == true ? 0 : 1;
+  }
+
+  if(options.pairProxies > 0)
+  {
+    return runPairs(options) == true ? 0 : 1;
+  }
+
+  if(options.fixtures > 0)
+  {
+    return runFixtures(options) == true ? 0 : 1;
+  }
+
+  if(options.rays > 0)
+  {
+    return runRays(options) == true ? 0 : 1;
+  }
+
+  if(options.trajectory > 0)
+  {
+    return runTrajectory(options) == true ? 0 : 1;
+  }
+
+  if(options.logMessages > 0)
+  {
+    return runLog(options) == true ? 0 : 1;
+  }
+
+  if(options.bullets > 0)
+  {
+    return runBullets(options) == true ? 0 : 1;
+  }
+
+  if(options.tunnelingShots > 0)
+  {
+    return runTunneling(options) == true ? 0 : 1;
+  }
+
+  if(options.stressBalls > 0)
+  {
+    runStress(options);
+    return 0;
+  }
+
+  //The same scene is run once per broad-phase and thread count, the world hashes should match for every thread count
+  std::vector<std::vector<double> > broadphaseTimes;
+  for(size_t i = 0; i < options.broadPhases.size(); i++)
+  {
+    for(size_t j = 0; j < options.threadCounts.size(); j++)
+    {
+      if(i > 0 || j > 0)
+      {
+        printf("\n");
+      }
+      broadphaseTimes.push_back(runBenchmark(options, options.threadCounts[j], options.broadPhases[i]));
+    }
+  }
+
+  //Side by side broadphase times when the scene ran on both
+  if(options.broadPhases.size() > 1)
+  {
+    printf("\nBroadphase per step (ms)\n");
+    for(size_t i = 0; i < broadphaseTimes.size(); i++)
+    {
+      char label[64];
+      snprintf(label, sizeof(label), "%s, %d threads", broadPhaseName(options.broadPhases[i / options.threadCounts.size()]), options.threadCounts[i % options.threadCounts.size()]);
+      printf("  %-28s mean %8.4f  p50 %8.4f  p99 %8.4f  max %8.4f\n", label, mean(broadphaseTimes[i]), percentile(broadphaseTimes[i], 0.5), percentile(broadphaseTimes[i], 0.99), percentile(broadphaseTimes[i], 1.0));
+    }
+  }
+  return 0;
+}
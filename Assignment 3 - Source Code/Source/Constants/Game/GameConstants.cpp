@@ -13,9 +13,21 @@ const float GAME_GRAVITY_X = 0.0f;
 const float GAME_GRAVITY_Y = -10.0f;
 
 const float CANNONOVERHEAT = 100.0f;
+const int CANNON_BALL_POOL_SIZE = 32;
+const float CANNON_BALL_LIFETIME = 10.0f;
+const bool CANNON_TRAJECTORY_PREVIEW = true;
+const int CANNON_TRAJECTORY_MAX_STEPS = 180; //Physics steps the preview looks ahead
+const float CANNON_TRAJECTORY_TIME_BUDGET = 0.5f; //Milliseconds per frame, a longer prediction carries on next frame
+const float CANNON_TRAJECTORY_REFRESH_INTERVAL = 0.25f; //Seconds before a cached path is predicted again, for blocks that settled across it
 
 const char* GAME_PHYSICS_EDITOR_FILENAME = "shapedefs.plist";
 const float GAME_PHYSICS_PIXELS_TO_METERS_RATIO = 16;
 const bool GAME_PHYSICS_CONTINUOUS_SIMULATION = true;
+const int GAME_PHYSICS_MAX_TOI_EVENTS = 0; //Continuous collision sub-steps per physics step, 0 is no limit
+const bool GAME_PHYSICS_SPECULATIVE_CONTACTS = false; //Speculative contacts instead of continuous collision sub-steps
 const int GAME_PHYSICS_VELOCITY_ITERATIONS = 4;
-const int GAME_PHYSICS_POSITION_ITERATIONS = 1;
\ No newline at end of file
+const int GAME_PHYSICS_POSITION_ITERATIONS = 1;
+const double GAME_PHYSICS_STEPS_PER_SECOND = 60.0;
+const int GAME_PHYSICS_MAX_STEPS_PER_FRAME = 5;
+const int GAME_PHYSICS_STACK_SIZE = 100 * 1024;
+const int GAME_REWIND_FRAMES = 0;
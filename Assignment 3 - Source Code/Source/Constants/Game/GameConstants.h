@@ -22,6 +22,12 @@ enum
 typedef unsigned int GameLoadSteps;
 
 extern const float CANNONOVERHEAT;
+extern const int CANNON_BALL_POOL_SIZE;
+extern const float CANNON_BALL_LIFETIME;
+extern const bool CANNON_TRAJECTORY_PREVIEW;
+extern const int CANNON_TRAJECTORY_MAX_STEPS;
+extern const float CANNON_TRAJECTORY_TIME_BUDGET;
+extern const float CANNON_TRAJECTORY_REFRESH_INTERVAL;
 
 extern const float GAME_GRAVITY_X;
 extern const float GAME_GRAVITY_Y;
@@ -29,7 +35,13 @@ extern const float GAME_GRAVITY_Y;
 extern const char* GAME_PHYSICS_EDITOR_FILENAME;
 extern const float GAME_PHYSICS_PIXELS_TO_METERS_RATIO;
 extern const bool GAME_PHYSICS_CONTINUOUS_SIMULATION;
+extern const int GAME_PHYSICS_MAX_TOI_EVENTS;
+extern const bool GAME_PHYSICS_SPECULATIVE_CONTACTS;
 extern const int GAME_PHYSICS_VELOCITY_ITERATIONS;
 extern const int GAME_PHYSICS_POSITION_ITERATIONS;
+extern const double GAME_PHYSICS_STEPS_PER_SECOND;
+extern const int GAME_PHYSICS_MAX_STEPS_PER_FRAME;
+extern const int GAME_PHYSICS_STACK_SIZE;
+extern const int GAME_REWIND_FRAMES;
 
 #endif
@@ -14,5 +14,6 @@ extern const char* OPENGL_FONT_DEFAULT_CHARACTER_SET;
 extern const char* OPENGL_FONT_EXTENDED_CHARACTER_SET;
 extern const char* OPENGL_FONT_DEFAULT_FONT;
 extern const float OPENGL_FONT_DEFAULT_SIZE;
+extern const int OPENGL_TEXTURE_DECODER_THREAD_COUNT;
 
 #endif
@@ -14,3 +14,4 @@ const char* OPENGL_FONT_DEFAULT_CHARACTER_SET = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcd
 const char* OPENGL_FONT_EXTENDED_CHARACTER_SET = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!?@#$%&*.,'\";:+=-_()\\/|{}[]";
 const char* OPENGL_FONT_DEFAULT_FONT = "HelveticaNeue-Bold";
 const float OPENGL_FONT_DEFAULT_SIZE = 32.0f;
+const int OPENGL_TEXTURE_DECODER_THREAD_COUNT = 2;
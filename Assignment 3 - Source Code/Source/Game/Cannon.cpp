@@ -10,16 +10,70 @@
 #include "DeviceUtils.h"
 #include "Game.h"
 #include "Constants.h"
+#include <algorithm>
 
 
-Cannon::Cannon()
+namespace
+{
+    //Barrel half extents in pixels
+    const float CANNON_BARREL_HALF_LENGTH = 70.0f;
+    const float CANNON_BARREL_HALF_WIDTH = 16.0f;
+    
+    //Cannon ball shape in pixels and the impulse fire() gives it
+    const float CANNON_BALL_RADIUS = 16.0f;
+    const float CANNON_BALL_DENSITY = 0.5f;
+    const float CANNON_FIRE_IMPULSE = 50.0f;
+    
+    //How far along the barrel a ball starts. It starts just past the end so it leaves with exactly the
+    //impulse, a ball that starts inside gets pushed out sideways and strays from the predicted path
+    const float CANNON_MUZZLE_OFFSET = CANNON_BARREL_HALF_LENGTH + CANNON_BALL_RADIUS + 2.0f;
+    
+    //Where a ball starts when something is pressed against the end of the barrel, a ball started in a block
+    //would throw it or tunnel through it. The barrel pushes the ball out instead, off the predicted path
+    const float CANNON_BLOCKED_MUZZLE_OFFSET = 45.0f;
+    
+    //The world's bodies or joints in list order, a snapshot refers to them by position
+    template <typename T>
+    void listItems(T* first, std::vector<T*>& items)
+    {
+        items.clear();
+        for(T* item = first; item != NULL; item = item->GetNext())
+        {
+            items.push_back(item);
+        }
+    }
+    
+    //-1 for NULL
+    template <typename T>
+    int indexOf(const std::vector<T*>& items, T* item)
+    {
+        typename std::vector<T*>::const_iterator found = std::find(items.begin(), items.end(), item);
+        return found != items.end() ? (int)(found - items.begin()) : -1;
+    }
+    
+    template <typename T>
+    T* itemAt(const std::vector<T*>& items, int index)
+    {
+        return index >= 0 && index < (int)items.size() ? items[index] : NULL;
+    }
+}
+
+
+Cannon::Cannon() :
+    m_CannonBallPoolSize(CANNON_BALL_POOL_SIZE)
 {
     m_CannonBarrel = m_CannonBase = NULL;
     m_Wheel1 = m_Wheel2 = NULL;
     m_CannonWheelJoint1 = m_CannonWheelJoint2 = NULL;
+    m_CannonBarrelJoint = NULL;
     reset();
 }
 
+Cannon::~Cannon()
+{
+    
+}
+
 b2Body* Cannon::CreateCannonMount(int x, int y, int Index)
 {
     RW2PW(x);
@@ -54,7 +108,7 @@ b2Body* Cannon::CreateCannonBarrel(int x, int y, int Index)
     y = RW2PW(y);
     
     b2PolygonShape shape;
-    shape.SetAsBox(RW2PW(70), RW2PW(16));
+    shape.SetAsBox(RW2PW(CANNON_BARREL_HALF_LENGTH), RW2PW(CANNON_BARREL_HALF_WIDTH));
     
     b2FixtureDef fixtureDef;
     fixtureDef.shape = &shape;
@@ -177,25 +231,11 @@ bool Cannon::fire()
     {
         m_CannonTemp += 20.0f;
         
-        b2CircleShape ball;
-        ball.m_radius = RW2PW(16);
-        
-        b2FixtureDef ballFixtureDef;
-        ballFixtureDef.shape = &ball;
-        ballFixtureDef.density = 0.5f;
-        ballFixtureDef.restitution = 0.3f;
-        
-        b2BodyDef bodyDef;
-        bodyDef.type = b2_dynamicBody;
-        
-        b2Vec2 v = m_CannonBarrel->GetPosition() + b2Mul(b2Rot(m_CannonBarrel->GetAngle()), b2Vec2(RW2PW(45.0f),0.0f));
-        
-        bodyDef.position.Set(v.x,v.y);
-        b2Body* cannonBall = Game::getInstance()->createPhysicsBody(&bodyDef);
-        cannonBall->CreateFixture(&ballFixtureDef);
+        b2Vec2 v = getMuzzlePosition();
+        b2Body* cannonBall = NextCannonBall(v);
         
         StopMoving();
-        b2Vec2 impulse = b2Mul(b2Rot(m_CannonBarrel->GetAngle()), b2Vec2(50.0f,0.0f));
+        b2Vec2 impulse = b2Mul(b2Rot(m_CannonBarrel->GetAngle()), b2Vec2(CANNON_FIRE_IMPULSE,0.0f));
         
         Impulse(cannonBall,impulse,b2Vec2(0.0f,0.0f));
         
@@ -261,6 +301,70 @@ float Cannon::getBarrelY()
 {
     return m_CannonBarrel->GetPosition().y;
 }
+float Cannon::getBarrelAngle()
+{
+    return m_CannonBarrel->GetAngle();
+}
+b2Vec2 Cannon::getMuzzlePosition()
+{
+    b2Rot rotation(m_CannonBarrel->GetAngle());
+    b2Vec2 position = m_CannonBarrel->GetPosition() + b2Mul(rotation, b2Vec2(RW2PW(CANNON_MUZZLE_OFFSET),0.0f));
+    if(isMuzzleBlocked(position) == true)
+    {
+        return m_CannonBarrel->GetPosition() + b2Mul(rotation, b2Vec2(RW2PW(CANNON_BLOCKED_MUZZLE_OFFSET),0.0f));
+    }
+    return position;
+}
+b2Vec2 Cannon::getMuzzleVelocity()
+{
+    //The same sum the ball's body makes, its mass from the fixture then the impulse over it
+    b2CircleShape shape;
+    shape.m_radius = getCannonBallRadius();
+    b2MassData massData;
+    shape.ComputeMass(&massData, CANNON_BALL_DENSITY);
+    
+    b2Vec2 impulse = b2Mul(b2Rot(m_CannonBarrel->GetAngle()), b2Vec2(CANNON_FIRE_IMPULSE,0.0f));
+    return (1.0f / massData.mass) * impulse;
+}
+float Cannon::getCannonBallRadius()
+{
+    return RW2PW(CANNON_BALL_RADIUS);
+}
+bool Cannon::isCannonBody(b2Body* body)
+{
+    return body == m_CannonBarrel || body == m_CannonBase || body == m_Wheel1 || body == m_Wheel2;
+}
+bool Cannon::isMuzzleBlocked(const b2Vec2& position)
+{
+    MuzzleQuery query;
+    query.cannon = this;
+    query.ball.m_radius = getCannonBallRadius();
+    query.transform.Set(position, 0.0f);
+    query.isBlocked = false;
+    
+    b2AABB aabb;
+    query.ball.ComputeAABB(&aabb, query.transform, 0);
+    m_CannonBarrel->GetWorld()->QueryAABB(&query, aabb);
+    return query.isBlocked;
+}
+bool Cannon::MuzzleQuery::ReportFixture(b2Fixture* fixture)
+{
+    if(fixture->IsSensor() == true || cannon->isCannonBody(fixture->GetBody()) == true)
+    {
+        return true;
+    }
+    
+    b2Shape* shape = fixture->GetShape();
+    for(int i = 0; i < shape->GetChildCount(); i++)
+    {
+        if(b2TestOverlap(&ball, 0, shape, i, transform, fixture->GetBody()->GetTransform()) == true)
+        {
+            isBlocked = true;
+            return false;
+        }
+    }
+    return true;
+}
 bool Cannon::checkLocation(float x, float y)
 {
     b2Fixture* fixture = m_CannonBarrel->GetFixtureList();
@@ -290,6 +394,127 @@ void Cannon::reset()
     m_CannonBallsFired = 0;
     m_CannonExploded = false;
 }
+void Cannon::UpdateCannonBalls(float delta)
+{
+    for(size_t i = 0; i < m_CannonBalls.size(); i++)
+    {
+        CannonBall& ball = m_CannonBalls[i];
+        if(ball.body->IsActive() == true)
+        {
+            ball.age += delta;
+            if(IsCannonBallSpent(ball) == true)
+            {
+                RecycleCannonBall(ball);
+            }
+        }
+    }
+}
+void Cannon::SetCannonBallPoolSize(int size)
+{
+    //Balls already created stay in the pool, the cap only stops it growing
+    m_CannonBallPoolSize = size > 1 ? size : 1;
+}
+int Cannon::CannonBallPoolSize()
+{
+    return m_CannonBallPoolSize;
+}
+int Cannon::CannonBallsCreated()
+{
+    return (int)m_CannonBalls.size();
+}
+int Cannon::CannonBallsActive()
+{
+    int active = 0;
+    for(size_t i = 0; i < m_CannonBalls.size(); i++)
+    {
+        if(m_CannonBalls[i].body->IsActive() == true)
+        {
+            active++;
+        }
+    }
+    return active;
+}
+b2Body* Cannon::NextCannonBall(const b2Vec2& position)
+{
+    //Reuse a spent ball if there is one
+    CannonBall* ball = NULL;
+    for(size_t i = 0; i < m_CannonBalls.size() && ball == NULL; i++)
+    {
+        if(m_CannonBalls[i].body->IsActive() == false)
+        {
+            ball = &m_CannonBalls[i];
+        }
+    }
+    
+    //Otherwise grow the pool, this is the only place a ball is allocated
+    if(ball == NULL && (int)m_CannonBalls.size() < m_CannonBallPoolSize)
+    {
+        b2CircleShape shape;
+        shape.m_radius = getCannonBallRadius();
+        
+        b2FixtureDef ballFixtureDef;
+        ballFixtureDef.shape = &shape;
+        ballFixtureDef.density = CANNON_BALL_DENSITY;
+        ballFixtureDef.restitution = 0.3f;
+        
+        b2BodyDef bodyDef;
+        bodyDef.type = b2_dynamicBody;
+        bodyDef.position = position;
+        
+        CannonBall newBall;
+        newBall.body = Game::getInstance()->createPhysicsBody(&bodyDef, &ballFixtureDef);
+        newBall.age = 0.0f;
+        m_CannonBalls.push_back(newBall);
+        return newBall.body;
+    }
+    
+    //The pool is full and every ball is in play, take the oldest one
+    if(ball == NULL)
+    {
+        ball = &m_CannonBalls[0];
+        for(size_t i = 1; i < m_CannonBalls.size(); i++)
+        {
+            if(m_CannonBalls[i].age > ball->age)
+            {
+                ball = &m_CannonBalls[i];
+            }
+        }
+        RecycleCannonBall(*ball);
+    }
+    
+    //Move the ball to the barrel before its proxy goes back into the broad-phase
+    ball->age = 0.0f;
+    ball->body->SetTransform(position, 0.0f);
+    ball->body->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+    ball->body->SetAngularVelocity(0.0f);
+    ball->body->SetActive(true);
+    ball->body->SetAwake(true);
+    return ball->body;
+}
+bool Cannon::IsCannonBallSpent(const CannonBall& ball)
+{
+    if(ball.body->IsAwake() == false || ball.age > CANNON_BALL_LIFETIME)
+    {
+        return true;
+    }
+    
+    //Off the sides or through the ground
+    b2Vec2 position = ball.body->GetPosition();
+    float width = RW2PW(DeviceUtils::getScreenResolutionWidth());
+    return position.x < 0.0f || position.x > width || position.y < 0.0f;
+}
+void Cannon::RecycleCannonBall(CannonBall& ball)
+{
+    //Wake whatever the ball is holding up, deactivating it destroys its contacts without waking anything
+    for(b2ContactEdge* edge = ball.body->GetContactList(); edge != NULL; edge = edge->next)
+    {
+        if(edge->contact->IsTouching() == true)
+        {
+            edge->other->SetAwake(true);
+        }
+    }
+    ball.body->SetActive(false);
+}
 void Cannon::Impulse(b2Body* body, b2Vec2 velocity, b2Vec2 point)
 {
     body->ApplyLinearImpulse(velocity, body->GetPosition() + point);
@@ -300,10 +525,71 @@ void Cannon::ResetCollisionGroupIndex(b2Body* body)
     filter.groupIndex = 0;
     body->GetFixtureList()->SetFilterData(filter);
 }
-
-
-
-
-
-
-
+void Cannon::SaveState(b2Snapshot* snapshot)
+{
+    b2World* world = Game::getInstance()->getWorld();
+    listItems(world->GetBodyList(), m_StateBodies);
+    listItems(world->GetJointList(), m_StateJoints);
+    
+    snapshot->Write(m_CannonTemp);
+    snapshot->Write(m_CannonMaxTemp);
+    snapshot->Write(m_CannonBallsFired);
+    snapshot->Write(m_CannonExploded);
+    snapshot->Write(m_CannonBallPoolSize);
+    
+    snapshot->Write(indexOf(m_StateBodies, m_CannonBarrel));
+    snapshot->Write(indexOf(m_StateBodies, m_CannonBase));
+    snapshot->Write(indexOf(m_StateBodies, m_Wheel1));
+    snapshot->Write(indexOf(m_StateBodies, m_Wheel2));
+    snapshot->Write(indexOf(m_StateJoints, (b2Joint*)m_CannonWheelJoint1));
+    snapshot->Write(indexOf(m_StateJoints, (b2Joint*)m_CannonWheelJoint2));
+    snapshot->Write(indexOf(m_StateJoints, (b2Joint*)m_CannonBarrelJoint));
+    
+    snapshot->Write((int)m_CannonBalls.size());
+    for(size_t i = 0; i < m_CannonBalls.size(); i++)
+    {
+        snapshot->Write(indexOf(m_StateBodies, m_CannonBalls[i].body));
+        snapshot->Write(m_CannonBalls[i].age);
+    }
+}
+bool Cannon::RestoreState(b2SnapshotReader* reader)
+{
+    b2World* world = Game::getInstance()->getWorld();
+    listItems(world->GetBodyList(), m_StateBodies);
+    listItems(world->GetJointList(), m_StateJoints);
+    
+    m_CannonTemp = reader->Read<float>();
+    m_CannonMaxTemp = reader->Read<float>();
+    m_CannonBallsFired = reader->Read<int>();
+    m_CannonExploded = reader->Read<bool>();
+    m_CannonBallPoolSize = reader->Read<int>();
+    
+    m_CannonBarrel = itemAt(m_StateBodies, reader->Read<int>());
+    m_CannonBase = itemAt(m_StateBodies, reader->Read<int>());
+    m_Wheel1 = itemAt(m_StateBodies, reader->Read<int>());
+    m_Wheel2 = itemAt(m_StateBodies, reader->Read<int>());
+    m_CannonWheelJoint1 = (b2WheelJoint*)itemAt(m_StateJoints, reader->Read<int>());
+    m_CannonWheelJoint2 = (b2WheelJoint*)itemAt(m_StateJoints, reader->Read<int>());
+    m_CannonBarrelJoint = (b2RevoluteJoint*)itemAt(m_StateJoints, reader->Read<int>());
+    
+    int ballCount = reader->Read<int>();
+    m_CannonBalls.clear();
+    for(int i = 0; i < ballCount && reader->HasFailed() == false; i++)
+    {
+        CannonBall ball;
+        ball.body = itemAt(m_StateBodies, reader->Read<int>());
+        ball.age = reader->Read<float>();
+        if(ball.body == NULL)
+        {
+            reader->Fail();
+            break;
+        }
+        m_CannonBalls.push_back(ball);
+    }
+    
+    if(m_CannonBarrel == NULL || m_CannonBase == NULL || m_Wheel1 == NULL || m_Wheel2 == NULL)
+    {
+        reader->Fail();
+    }
+    return reader->HasFailed() == false;
+}
@@ -10,8 +10,16 @@
 #define __GameDevFramework__Cannon__
 
 #include <iostream>
+#include <vector>
 #include "Box2D.h"
 
+//A pooled cannon ball, age is the time in seconds since it was fired
+struct CannonBall
+{
+    b2Body* body;
+    float age;
+};
+
 class Cannon
 {
 public:
@@ -27,6 +35,16 @@ public:
     void StopMoving();
     float getBarrelX();
     float getBarrelY();
+    float getBarrelAngle();
+    
+    //Where the next ball fire() makes starts and how fast it leaves the barrel, for aiming previews. The ball
+    //starts past the end of the barrel, or inside it when something is in the way there
+    b2Vec2 getMuzzlePosition();
+    b2Vec2 getMuzzleVelocity();
+    float getCannonBallRadius();
+    
+    //True for the barrel, base and wheels
+    bool isCannonBody(b2Body* body);
     
     int BallsFired();
     bool checkLocation(float x, float y);
@@ -35,13 +53,42 @@ public:
     void CoolDown();
     void reset();
     
+    //Cannon ball pool, spent balls are deactivated and reused by fire()
+    void UpdateCannonBalls(float delta);
+    void SetCannonBallPoolSize(int size);
+    int CannonBallPoolSize();
+    int CannonBallsCreated();
+    int CannonBallsActive();
+    
+    //Cannon state for world snapshots, bodies and joints are written as indices into the world lists
+    //so the pointers can be looked up again after the world has been rebuilt from a snapshot
+    void SaveState(b2Snapshot* snapshot);
+    bool RestoreState(b2SnapshotReader* reader);
+    
 private:
     b2Body* CreateCannonMount(int x, int y, int Index);
     b2Body* CreateCannonBarrel(int x, int y, int Index);
     b2Body* CreateWheel(int x, int y, int Index);
     
+    //Finds anything but the cannon overlapping a ball at a spot
+    class MuzzleQuery : public b2QueryCallback
+    {
+    public:
+        bool ReportFixture(b2Fixture* fixture);
+        Cannon* cannon;
+        b2CircleShape ball;
+        b2Transform transform;
+        bool isBlocked;
+    };
+    
+    bool isMuzzleBlocked(const b2Vec2& position);
+    
     void Impulse(b2Body* body, b2Vec2 velocity, b2Vec2 point);
     void ResetCollisionGroupIndex(b2Body* body);
+    
+    b2Body* NextCannonBall(const b2Vec2& position);
+    bool IsCannonBallSpent(const CannonBall& ball);
+    void RecycleCannonBall(CannonBall& ball);
 
     
     b2Body* m_CannonBarrel;
@@ -58,6 +105,13 @@ private:
     int m_CannonBallsFired;
     bool m_CannonExploded;
     
+    std::vector<CannonBall> m_CannonBalls;
+    int m_CannonBallPoolSize;
+    
+    //Scratch lists for SaveState and RestoreState, kept so saving every step doesn't allocate
+    std::vector<b2Body*> m_StateBodies;
+    std::vector<b2Joint*> m_StateJoints;
+    
 };
 
 
@@ -7,10 +7,13 @@
 //
 
 #include "Game.h"
+#if !GAME_HEADLESS
 #include "GameObject.h"
+#endif
 #include "DeviceUtils.h"
 #include "MathUtils.h"
 #include "PhysicsEditorWrapper.h"
+#include <algorithm>
 #include <vector>
 
 
@@ -26,16 +29,48 @@ Game* Game::getInstance()
     return m_Instance;
 }
 
+void Game::cleanupInstance()
+{
+    if(m_Instance != NULL)
+    {
+        delete m_Instance;
+        m_Instance = NULL;
+    }
+}
+
 Game::Game() :
     m_LoadStep(0),
+    m_PhysicsTimeStep(1.0 / GAME_PHYSICS_STEPS_PER_SECOND),
+    m_PhysicsAccumulator(0.0),
+    m_MaxPhysicsStepsPerFrame(GAME_PHYSICS_MAX_STEPS_PER_FRAME),
+    m_PhysicsStepsLastFrame(0),
+    m_DroppedTimeLastFrame(0.0),
+    m_DroppedTimeTotal(0.0),
+    m_PhysicsTick(0),
+    m_InputJournal(NULL),
     m_World(NULL),
-    m_DebugDraw(NULL)
+    m_DebugDraw(NULL),
+    m_BroadPhaseType(b2_dynamicTreeBroadPhase),
+    m_PhysicsStackSize(GAME_PHYSICS_STACK_SIZE),
+    m_RewindHead(0),
+    m_RewindCount(0),
+    m_Cannon(NULL)
 {
-    
+    setRewindFrames(GAME_REWIND_FRAMES);
 }
 
 Game::~Game()
 {
+    //Delete the rewind snapshots and finish the journal
+    setRewindFrames(0);
+    stopRecording();
+    
+    //Delete the cannon, its bodies and joints are owned by the world
+    if(m_Cannon != NULL)
+    {
+        delete m_Cannon;
+        m_Cannon = NULL;
+    }
     //Delete the debug draw instance
     if(m_DebugDraw != NULL)
     {
@@ -45,15 +80,9 @@ Game::~Game()
     //Delete the Box2D world instance, MAKES SURE this is the last object deleted
     if(m_World != NULL)
     {
-        //Destroy all the bodies in the world
-        b2Body* body = m_World->GetBodyList();
-        while(body != NULL)
-        {
-            //Destroy the body and get the next body (if there is one)
-            b2Body* nextBody = body->GetNext();
-            destroyPhysicsBody(body);
-            body = nextBody;
-        }
+        //Destroy all the bodies in the world at once, this frees the allocator's chunks
+        //instead of unlinking every fixture, contact and proxy one at a time
+        m_World->DestroyAllBodies();
         
         //Finally delete the world
         delete m_World;
@@ -79,8 +108,14 @@ void Game::load()
             
             //Construct the Box2d world object, which will
             //holds and simulates the rigid bodies
-            m_World = new b2World(gravity);
+            m_World = new b2World(gravity, m_BroadPhaseType, m_PhysicsStackSize);
             m_World->SetContinuousPhysics(GAME_PHYSICS_CONTINUOUS_SIMULATION);
+            m_World->SetMaxTOIEvents(GAME_PHYSICS_MAX_TOI_EVENTS);
+            m_World->SetSpeculativeContacts(GAME_PHYSICS_SPECULATIVE_CONTACTS);
+            
+            //Hold the level's proxies back from the broad-phase tree until the
+            //final load step, where the whole tree is built in one pass
+            m_World->BeginBulkInsert();
             
             #if DEBUG
             //Create the debug draw for Box2d
@@ -162,6 +197,7 @@ void Game::load()
             
         case GameLoadStepFinal:
         {
+            m_World->EndBulkInsert();
             reset();
         }
         break;
@@ -176,6 +212,13 @@ void Game::load()
 
 void Game::update(double aDelta)
 {
+    //A profiler frame runs from one update to the next, so it holds the paint in between
+    if(b2Profiler::IsEnabled() == true)
+    {
+        b2Profiler::EndFrame();
+    }
+    B2_PROFILE_ZONE("Game::update");
+    
     //While the game is loading, the load method will be called once per update
     if(isLoading() == true)
     {
@@ -183,16 +226,66 @@ void Game::update(double aDelta)
         return;
 
     }
-    //Step the Box2D world this update cycle
+    
+    //Step the Box2D world in fixed steps, the leftover time carries into the next update
+    m_PhysicsAccumulator += aDelta;
+    m_PhysicsStepsLastFrame = 0;
+    m_DroppedTimeLastFrame = 0.0;
+    while(m_PhysicsAccumulator >= m_PhysicsTimeStep)
+    {
+        //Cap the steps per update, otherwise a slow frame makes the next one slower still
+        if(m_PhysicsStepsLastFrame == m_MaxPhysicsStepsPerFrame)
+        {
+            //Drop the whole steps that didn't fit, keep the remainder for interpolation
+            m_DroppedTimeLastFrame = m_PhysicsAccumulator - fmod(m_PhysicsAccumulator, m_PhysicsTimeStep);
+            m_DroppedTimeTotal += m_DroppedTimeLastFrame;
+            m_PhysicsAccumulator -= m_DroppedTimeLastFrame;
+            break;
+        }
+        
+        stepPhysics();
+        m_PhysicsAccumulator -= m_PhysicsTimeStep;
+        m_PhysicsStepsLastFrame++;
+    }
+    
+    //Aim preview for the next shot, it only reads the world so it doesn't change the simulation
+    if(CANNON_TRAJECTORY_PREVIEW == true && m_Cannon->IsDead() == false)
+    {
+        B2_PROFILE_ZONE("TrajectoryPredictor::update");
+        m_TrajectoryPredictor.update(m_World, m_Cannon, (float)m_PhysicsTimeStep, aDelta);
+    }
+}
+
+void Game::stepPhysics()
+{
     if(m_World != NULL)
     {
-        m_World->Step(aDelta, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
+        m_World->Step((float)m_PhysicsTimeStep, GAME_PHYSICS_VELOCITY_ITERATIONS, GAME_PHYSICS_POSITION_ITERATIONS);
     }
     m_Cannon->CoolDown();
+    m_Cannon->UpdateCannonBalls((float)m_PhysicsTimeStep);
+    
+    if(m_RewindSnapshots.empty() == false)
+    {
+        b2Snapshot* snapshot = m_RewindSnapshots[m_RewindHead];
+        snapshot->Clear();
+        saveState(snapshot);
+        m_RewindHead = (m_RewindHead + 1) % (int)m_RewindSnapshots.size();
+        m_RewindCount = std::min(m_RewindCount + 1, (int)m_RewindSnapshots.size());
+    }
+    
+    if(m_InputJournal != NULL)
+    {
+        m_InputJournal->writeTick(m_PhysicsTick, m_World);
+    }
+    m_PhysicsTick++;
 }
 
 void Game::paint()
 {
+    B2_PROFILE_ZONE("Game::paint");
+    
+#if !GAME_HEADLESS
     //While the game is loading, the load method will be called once per update
     if(isLoading() == true)
     {
@@ -203,13 +296,50 @@ void Game::paint()
 #if DEBUG
     if(m_World != NULL)
     {
-        m_World->DrawDebugData();
+        m_World->DrawDebugData(getInterpolationAlpha());
+    }
+#endif
+    
+    paintTrajectory();
+#endif
+}
+
+void Game::paintTrajectory()
+{
+#if !GAME_HEADLESS
+    if(CANNON_TRAJECTORY_PREVIEW == false || m_Cannon->IsDead() == true)
+    {
+        return;
+    }
+    
+    //The predicted path in pixels as one line strip
+    const std::vector<b2Vec2>& points = m_TrajectoryPredictor.getPoints();
+    if(points.size() < 2)
+    {
+        return;
+    }
+    m_TrajectoryVertices.resize(points.size() * 2);
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        m_TrajectoryVertices[i * 2] = PW2RW(points[i].x);
+        m_TrajectoryVertices[i * 2 + 1] = PW2RW(points[i].y);
+    }
+    
+    OpenGLRenderer::getInstance()->setForegroundColor(OpenGLColorRGBA(1.0f, 1.0f, 1.0f, 0.5f));
+    OpenGLRenderer::getInstance()->drawPolygon(GL_LINE_STRIP, &m_TrajectoryVertices[0], 2, (int)points.size());
+    
+    //Where the ball first lands
+    if(m_TrajectoryPredictor.getHitFixture() != NULL)
+    {
+        b2Vec2 hit = points.back();
+        OpenGLRenderer::getInstance()->drawCircle(PW2RW(hit.x), PW2RW(hit.y), PW2RW(m_Cannon->getCannonBallRadius()), false);
     }
 #endif
 }
 
 void Game::paintLoading()
 {
+#if !GAME_HEADLESS
     //Cache the screen width and height
     float screenWidth = getScreenWidth();
     float screenHeight = getScreenHeight();
@@ -232,10 +362,16 @@ void Game::paintLoading()
     
     OpenGLRenderer::getInstance()->setForegroundColor(OpenGLColorWhite());
     OpenGLRenderer::getInstance()->drawRectangle(barX, barY, barWidth, barHeight, false);
+#endif
 }
 
 void Game::touchEvent(TouchEvent touchEvent, float locationX, float locationY, float previousX, float previousY)
 {
+    if(m_InputJournal != NULL)
+    {
+        m_InputJournal->writeTouch(m_PhysicsTick, touchEvent, locationX, locationY, previousX, previousY);
+    }
+    
     if(touchEvent == TouchEventBegan || touchEvent == TouchEventMoved)
     {
         if(m_Cannon->checkLocation(locationX, locationY) == true)
@@ -265,11 +401,19 @@ void Game::touchEvent(TouchEvent touchEvent, float locationX, float locationY, f
 
 void Game::reset()
 {
+    if(m_InputJournal != NULL)
+    {
+        m_InputJournal->writeReset(m_PhysicsTick);
+    }
     m_Cannon->reset();
 }
 
 void Game::fire()
 {
+    if(m_InputJournal != NULL)
+    {
+        m_InputJournal->writeFire(m_PhysicsTick);
+    }
     m_Cannon->fire();
 }
 
@@ -292,6 +436,284 @@ bool Game::isGameOver()
     return m_Cannon->IsDead();
 }
 
+void Game::setPhysicsRate(double aStepsPerSecond)
+{
+    if(aStepsPerSecond > 0.0)
+    {
+        m_PhysicsTimeStep = 1.0 / aStepsPerSecond;
+    }
+}
+
+double Game::getPhysicsRate()
+{
+    return 1.0 / m_PhysicsTimeStep;
+}
+
+void Game::setMaxPhysicsStepsPerFrame(int aMaxSteps)
+{
+    m_MaxPhysicsStepsPerFrame = aMaxSteps > 1 ? aMaxSteps : 1;
+}
+
+int Game::getMaxPhysicsStepsPerFrame()
+{
+    return m_MaxPhysicsStepsPerFrame;
+}
+
+float Game::getInterpolationAlpha()
+{
+    return (float)(m_PhysicsAccumulator / m_PhysicsTimeStep);
+}
+
+int Game::getPhysicsStepsLastFrame()
+{
+    return m_PhysicsStepsLastFrame;
+}
+
+double Game::getDroppedTimeLastFrame()
+{
+    return m_DroppedTimeLastFrame;
+}
+
+double Game::getDroppedTimeTotal()
+{
+    return m_DroppedTimeTotal;
+}
+
+b2World* Game::getWorld()
+{
+    return m_World;
+}
+
+void Game::setBroadPhaseType(b2BroadPhaseType aBroadPhaseType)
+{
+    m_BroadPhaseType = aBroadPhaseType;
+}
+
+b2BroadPhaseType Game::getBroadPhaseType()
+{
+    return m_BroadPhaseType;
+}
+
+void Game::setPhysicsStackSize(int aStackSize)
+{
+    m_PhysicsStackSize = aStackSize;
+}
+
+int Game::getPhysicsStackSize()
+{
+    return m_PhysicsStackSize;
+}
+
+void Game::saveState(b2Snapshot* aSnapshot)
+{
+    m_World->SaveState(aSnapshot);
+    m_Cannon->SaveState(aSnapshot);
+}
+
+bool Game::restoreState(const b2Snapshot& aSnapshot)
+{
+    //A restore can rebuild the world, which would leave the predicted path pointing at destroyed bodies
+    m_TrajectoryPredictor.invalidate();
+    
+    b2SnapshotReader reader(aSnapshot);
+    if(m_World->RestoreState(&reader) == false)
+    {
+        return false;
+    }
+    return m_Cannon->RestoreState(&reader) == true && reader.IsAtEnd() == true;
+}
+
+void Game::setRewindFrames(int aFrames)
+{
+    for(size_t i = 0; i < m_RewindSnapshots.size(); i++)
+    {
+        delete m_RewindSnapshots[i];
+    }
+    m_RewindSnapshots.clear();
+    m_RewindHead = 0;
+    m_RewindCount = 0;
+    
+    //The snapshots keep their buffers, after the first lap the ring no longer allocates
+    for(int i = 0; i < aFrames; i++)
+    {
+        m_RewindSnapshots.push_back(new b2Snapshot());
+    }
+}
+
+int Game::getRewindFrames()
+{
+    return (int)m_RewindSnapshots.size();
+}
+
+int Game::getRewindFramesAvailable()
+{
+    //The newest snapshot is the current state, it can't be rewound to
+    return m_RewindCount > 0 ? m_RewindCount - 1 : 0;
+}
+
+bool Game::rewind(int aFrames)
+{
+    if(aFrames <= 0 || aFrames > getRewindFramesAvailable())
+    {
+        return false;
+    }
+    
+    int size = (int)m_RewindSnapshots.size();
+    int index = (m_RewindHead - 1 - aFrames + 2 * size) % size;
+    if(restoreState(*m_RewindSnapshots[index]) == false)
+    {
+        return false;
+    }
+    
+    //The frames after the one restored are gone, the next step saves over them
+    m_RewindHead = (index + 1) % size;
+    m_RewindCount -= aFrames;
+    m_PhysicsAccumulator = 0.0;
+    return true;
+}
+
+unsigned int Game::getPhysicsTick()
+{
+    return m_PhysicsTick;
+}
+
+bool Game::startRecording(const char* aPath, bool aBodyHashes)
+{
+    //A replay starts from a freshly loaded game, so the journal has to as well
+    if(isLoading() == true || m_PhysicsTick > 0)
+    {
+        return false;
+    }
+    
+    InputJournalHeader header;
+    header.physicsRate = getPhysicsRate();
+    header.screenWidth = getScreenWidth();
+    header.screenHeight = getScreenHeight();
+    header.broadPhaseType = m_World->GetBroadPhaseType();
+    header.cannonBallPoolSize = m_Cannon->CannonBallPoolSize();
+    header.maxTOIEvents = m_World->GetMaxTOIEvents();
+    header.simdSolver = m_World->GetSimdSolver();
+    header.warmStartCache = m_World->GetWarmStartCache();
+    header.sortFreePairs = m_World->GetSortFreePairs();
+    header.speculativeContacts = m_World->GetSpeculativeContacts();
+    header.hasBodyHashes = aBodyHashes;
+    
+    stopRecording();
+    m_InputJournal = new InputJournalWriter();
+    if(m_InputJournal->open(aPath, header) == false)
+    {
+        stopRecording();
+        return false;
+    }
+    return true;
+}
+
+void Game::stopRecording()
+{
+    if(m_InputJournal != NULL)
+    {
+        delete m_InputJournal;
+        m_InputJournal = NULL;
+    }
+}
+
+bool Game::isRecording()
+{
+    return m_InputJournal != NULL;
+}
+
+bool Game::replay(InputJournalReader* aJournal, InputReplayResult* aResult)
+{
+    const InputJournalHeader& header = aJournal->getHeader();
+    if(m_LoadStep != 0 || header.screenWidth != getScreenWidth() || header.screenHeight != getScreenHeight())
+    {
+        return false;
+    }
+    
+    //Load with the recorded settings, the same way update does
+    setBroadPhaseType((b2BroadPhaseType)header.broadPhaseType);
+    setPhysicsRate(header.physicsRate);
+    while(isLoading() == true)
+    {
+        load();
+    }
+    m_World->SetSimdSolver(header.simdSolver);
+    m_World->SetWarmStartCache(header.warmStartCache);
+    m_World->SetSortFreePairs(header.sortFreePairs);
+    m_World->SetSpeculativeContacts(header.speculativeContacts);
+    m_World->SetMaxTOIEvents(header.maxTOIEvents);
+    m_Cannon->SetCannonBallPoolSize(header.cannonBallPoolSize);
+    
+    aResult->ticks = 0;
+    aResult->inputs = 0;
+    aResult->divergentTick = -1;
+    aResult->divergentBody = -1;
+    aResult->expectedHash = 0;
+    aResult->actualHash = 0;
+    
+    //Inputs go in at the tick they were recorded before, then each tick record steps once and checks the hash
+    InputJournalRecord record;
+    std::vector<unsigned int> bodyHashes;
+    while(aJournal->read(record) == true)
+    {
+        if(record.tick != m_PhysicsTick)
+        {
+            return false;
+        }
+        
+        if(record.type == InputJournalTouch)
+        {
+            touchEvent(record.touchEvent, record.locationX, record.locationY, record.previousX, record.previousY);
+            aResult->inputs++;
+        }
+        else if(record.type == InputJournalFire)
+        {
+            fire();
+            aResult->inputs++;
+        }
+        else if(record.type == InputJournalReset)
+        {
+            reset();
+            aResult->inputs++;
+        }
+        else if(record.type == InputJournalTick)
+        {
+            stepPhysics();
+            aResult->ticks++;
+            
+            unsigned int hash = hashWorldTransforms(m_World, header.hasBodyHashes == true ? &bodyHashes : NULL);
+            if(hash != record.worldHash)
+            {
+                aResult->divergentTick = (int)record.tick;
+                aResult->expectedHash = record.worldHash;
+                aResult->actualHash = hash;
+                
+                //The first body that differs, or the first one past the end of the shorter list
+                for(size_t i = 0; i < bodyHashes.size() || i < record.bodyHashes.size(); i++)
+                {
+                    if(i >= bodyHashes.size() || i >= record.bodyHashes.size() || bodyHashes[i] != record.bodyHashes[i])
+                    {
+                        aResult->divergentBody = (int)i;
+                        break;
+                    }
+                }
+                return true;
+            }
+        }
+    }
+    return aJournal->isCorrupt() == false;
+}
+
+Cannon* Game::getCannon()
+{
+    return m_Cannon;
+}
+
+TrajectoryPredictor* Game::getTrajectoryPredictor()
+{
+    return &m_TrajectoryPredictor;
+}
+
 b2Body* Game::createPhysicsBody(const b2BodyDef* bodyDef, const b2FixtureDef* fixtureDef)
 {
     if(bodyDef != NULL)
@@ -10,9 +10,13 @@
 #define GAME_H
 
 #include "Constants.h"
+#if !GAME_HEADLESS
 #include "OpenGL.h"
+#endif
 #include "Box2D.h"
 #include "Cannon.h"
+#include "InputJournal.h"
+#include "TrajectoryPredictor.h"
 
 class GameObject;
 class Game
@@ -20,6 +24,7 @@ class Game
 public:
     //Singleton instance methods
     static Game* getInstance();
+    static void cleanupInstance();
     
     //Update, paint and touch event (lifecycle) methods
     void update(double delta);
@@ -43,12 +48,61 @@ public:
     //Loading methods
     bool isLoading();
     
+    //Fixed timestep methods, the world is stepped at a fixed rate no matter the frame rate
+    void setPhysicsRate(double stepsPerSecond);
+    double getPhysicsRate();
+    void setMaxPhysicsStepsPerFrame(int maxSteps);
+    int getMaxPhysicsStepsPerFrame();
+    
+    //How far the render state is between the previous and current physics step (0 to 1)
+    float getInterpolationAlpha();
+    
+    //Fixed timestep stats, time is dropped when a frame needs more than the max steps
+    int getPhysicsStepsLastFrame();
+    double getDroppedTimeLastFrame();
+    double getDroppedTimeTotal();
+    
     //Box2D helper methods
+    b2World* getWorld();
+    Cannon* getCannon();
+    TrajectoryPredictor* getTrajectoryPredictor();
     b2Body* createPhysicsBody(const b2BodyDef* bodyDef, const b2FixtureDef* fixtureDef = NULL);
     void destroyPhysicsBody(b2Body* body);
     
     b2Joint* createJoint(const b2JointDef* jointDef);
     void destroyJoint(b2Joint* joint);
+    
+    //The broad-phase the world is built with, only takes effect if set before the world load step
+    void setBroadPhaseType(b2BroadPhaseType broadPhaseType);
+    b2BroadPhaseType getBroadPhaseType();
+    
+    //The initial size of the world's per step stack allocators, only takes effect if set before the world load step
+    void setPhysicsStackSize(int stackSize);
+    int getPhysicsStackSize();
+    
+    //Save states hold the world and the cannon, restoring one made from a world with the same
+    //bodies, fixtures and joints updates them in place, anything else rebuilds the world
+    void saveState(b2Snapshot* snapshot);
+    bool restoreState(const b2Snapshot& snapshot);
+    
+    //Rewind keeps a save state of each of the last frames physics steps, 0 turns it off
+    void setRewindFrames(int frames);
+    int getRewindFrames();
+    int getRewindFramesAvailable();
+    bool rewind(int frames);
+    
+    //Physics steps taken since loading finished, inputs are journaled against it
+    unsigned int getPhysicsTick();
+    
+    //Input journal methods, recording writes every touch, fire and reset with the tick it lands before and hashes
+    //the bodies after every tick. It has to start once loading is done and before the first physics step
+    bool startRecording(const char* path, bool bodyHashes = false);
+    void stopRecording();
+    bool isRecording();
+    
+    //Loads the game with a journal's settings and plays it back one fixed step at a time, stopping at the
+    //first tick whose hash differs. Returns false if the game was already loading or the journal can't be replayed
+    bool replay(InputJournalReader* journal, InputReplayResult* result);
 
 private:
     //Private constructor and destructor ensures the singleton instance
@@ -58,20 +112,45 @@ private:
     //Load method, called once every load step
     void load();
     void paintLoading();
+    void paintTrajectory();
     void PlaceBlock(float x, float y, const b2FixtureDef& fd);
     
+    //One fixed physics step and everything that runs with it
+    void stepPhysics();
+    
     //Singleton instance static member variable
     static Game* m_Instance;
     
     //Load step member variable
     int m_LoadStep;
     
+    //Fixed timestep members
+    double m_PhysicsTimeStep;
+    double m_PhysicsAccumulator;
+    int m_MaxPhysicsStepsPerFrame;
+    int m_PhysicsStepsLastFrame;
+    double m_DroppedTimeLastFrame;
+    double m_DroppedTimeTotal;
+    unsigned int m_PhysicsTick;
+    
+    //Input journal being recorded, NULL when not recording
+    InputJournalWriter* m_InputJournal;
+    
     //Box2D members
     b2World* m_World;
     b2DebugDraw* m_DebugDraw;
+    b2BroadPhaseType m_BroadPhaseType;
+    int m_PhysicsStackSize;
+    
+    //Rewind ring, m_RewindHead is where the next step is saved
+    std::vector<b2Snapshot*> m_RewindSnapshots;
+    int m_RewindHead;
+    int m_RewindCount;
     
     //cannon
     Cannon* m_Cannon;
+    TrajectoryPredictor m_TrajectoryPredictor;
+    std::vector<float> m_TrajectoryVertices;
     std::vector<GameObject*> m_cubes;
 };
 
@@ -0,0 +1,436 @@
+//
+//  InputJournal.cpp
+//  GameDevFramework
+//
+
+#include "InputJournal.h"
+#include "Box2D.h"
+#include <string.h>
+
+
+namespace
+{
+    //"CJNL", then the version. Version 2 added the TOI event cap
+    const unsigned int INPUT_JOURNAL_MAGIC = 0x4c4e4a43;
+    const unsigned int INPUT_JOURNAL_VERSION = 2;
+
+    //Header flags
+    const unsigned int INPUT_JOURNAL_BODY_HASHES = 1 << 0;
+    const unsigned int INPUT_JOURNAL_SIMD_SOLVER = 1 << 1;
+    const unsigned int INPUT_JOURNAL_WARM_START_CACHE = 1 << 2;
+    const unsigned int INPUT_JOURNAL_SORT_FREE_PAIRS = 1 << 3;
+    const unsigned int INPUT_JOURNAL_SPECULATIVE_CONTACTS = 1 << 4;
+
+    const unsigned int FNV_OFFSET_BASIS = 2166136261u;
+    const unsigned int FNV_PRIME = 16777619u;
+
+    unsigned int hashBytes(unsigned int hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    //Values are written little-endian whatever the platform, a journal from a device replays on a desktop
+    unsigned int floatBits(float value)
+    {
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsFloat(unsigned int bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+
+unsigned int hashWorldTransforms(b2World* aWorld, std::vector<unsigned int>* aBodyHashes)
+{
+    if(aBodyHashes != NULL)
+    {
+        aBodyHashes->clear();
+    }
+
+    unsigned int hash = FNV_OFFSET_BASIS;
+    for(b2Body* body = aWorld->GetBodyList(); body != NULL; body = body->GetNext())
+    {
+        float values[3] = { body->GetPosition().x, body->GetPosition().y, body->GetAngle() };
+        unsigned int bodyHash = hashBytes(FNV_OFFSET_BASIS, values, sizeof(values));
+        hash = hashBytes(hash, &bodyHash, sizeof(bodyHash));
+        if(aBodyHashes != NULL)
+        {
+            aBodyHashes->push_back(bodyHash);
+        }
+    }
+    return hash;
+}
+
+InputJournalWriter::InputJournalWriter() :
+    m_File(NULL),
+    m_LastTick(0),
+    m_HasBodyHashes(false),
+    m_BytesWritten(0)
+{
+
+}
+
+InputJournalWriter::~InputJournalWriter()
+{
+    close();
+}
+
+bool InputJournalWriter::open(const char* aPath, const InputJournalHeader& aHeader)
+{
+    close();
+    m_File = fopen(aPath, "wb");
+    if(m_File == NULL)
+    {
+        return false;
+    }
+
+    m_LastTick = 0;
+    m_HasBodyHashes = aHeader.hasBodyHashes;
+    m_BytesWritten = 0;
+
+    unsigned int flags = 0;
+    flags |= aHeader.hasBodyHashes == true ? INPUT_JOURNAL_BODY_HASHES : 0;
+    flags |= aHeader.simdSolver == true ? INPUT_JOURNAL_SIMD_SOLVER : 0;
+    flags |= aHeader.warmStartCache == true ? INPUT_JOURNAL_WARM_START_CACHE : 0;
+    flags |= aHeader.sortFreePairs == true ? INPUT_JOURNAL_SORT_FREE_PAIRS : 0;
+    flags |= aHeader.speculativeContacts == true ? INPUT_JOURNAL_SPECULATIVE_CONTACTS : 0;
+
+    //The physics rate keeps all of its bits, the step length has to come out the same
+    unsigned long long rateBits;
+    memcpy(&rateBits, &aHeader.physicsRate, sizeof(rateBits));
+    writeUint32(INPUT_JOURNAL_MAGIC);
+    writeVarint(INPUT_JOURNAL_VERSION);
+    writeVarint(flags);
+    writeUint32((unsigned int)rateBits);
+    writeUint32((unsigned int)(rateBits >> 32));
+    writeFloat(aHeader.screenWidth);
+    writeFloat(aHeader.screenHeight);
+    writeVarint(aHeader.broadPhaseType);
+    writeVarint(aHeader.cannonBallPoolSize);
+    writeVarint(aHeader.maxTOIEvents);
+    return ferror(m_File) == 0;
+}
+
+void InputJournalWriter::close()
+{
+    if(m_File != NULL)
+    {
+        writeByte(InputJournalEnd);
+        fclose(m_File);
+        m_File = NULL;
+    }
+}
+
+bool InputJournalWriter::isOpen()
+{
+    return m_File != NULL;
+}
+
+void InputJournalWriter::writeTouch(unsigned int aTick, TouchEvent aTouchEvent, float aLocationX, float aLocationY, float aPreviousX, float aPreviousY)
+{
+    writeRecordStart(InputJournalTouch, aTick);
+    writeByte((unsigned char)aTouchEvent);
+    writeFloat(aLocationX);
+    writeFloat(aLocationY);
+    writeFloat(aPreviousX);
+    writeFloat(aPreviousY);
+}
+
+void InputJournalWriter::writeFire(unsigned int aTick)
+{
+    writeRecordStart(InputJournalFire, aTick);
+}
+
+void InputJournalWriter::writeReset(unsigned int aTick)
+{
+    writeRecordStart(InputJournalReset, aTick);
+}
+
+void InputJournalWriter::writeTick(unsigned int aTick, b2World* aWorld)
+{
+    unsigned int hash = hashWorldTransforms(aWorld, m_HasBodyHashes == true ? &m_BodyHashes : NULL);
+    writeRecordStart(InputJournalTick, aTick);
+    writeUint32(hash);
+    if(m_HasBodyHashes == true)
+    {
+        writeVarint((unsigned int)m_BodyHashes.size());
+        for(size_t i = 0; i < m_BodyHashes.size(); i++)
+        {
+            writeUint32(m_BodyHashes[i]);
+        }
+    }
+}
+
+void InputJournalWriter::writeRecord(const InputJournalRecord& aRecord)
+{
+    switch(aRecord.type)
+    {
+        case InputJournalTouch:
+            writeTouch(aRecord.tick, aRecord.touchEvent, aRecord.locationX, aRecord.locationY, aRecord.previousX, aRecord.previousY);
+            break;
+
+        case InputJournalFire:
+            writeFire(aRecord.tick);
+            break;
+
+        case InputJournalReset:
+            writeReset(aRecord.tick);
+            break;
+
+        case InputJournalTick:
+            writeRecordStart(InputJournalTick, aRecord.tick);
+            writeUint32(aRecord.worldHash);
+            if(m_HasBodyHashes == true)
+            {
+                writeVarint((unsigned int)aRecord.bodyHashes.size());
+                for(size_t i = 0; i < aRecord.bodyHashes.size(); i++)
+                {
+                    writeUint32(aRecord.bodyHashes[i]);
+                }
+            }
+            break;
+    }
+}
+
+long InputJournalWriter::getBytesWritten()
+{
+    return m_BytesWritten;
+}
+
+//A record is its type then the ticks since the last record, usually 0 or 1, so most cost two bytes before their data
+void InputJournalWriter::writeRecordStart(InputJournalRecordType aType, unsigned int aTick)
+{
+    writeByte((unsigned char)aType);
+    writeVarint(aTick - m_LastTick);
+    m_LastTick = aTick;
+}
+
+void InputJournalWriter::writeByte(unsigned char aValue)
+{
+    if(m_File != NULL)
+    {
+        fputc(aValue, m_File);
+        m_BytesWritten++;
+    }
+}
+
+void InputJournalWriter::writeVarint(unsigned int aValue)
+{
+    while(aValue >= 0x80)
+    {
+        writeByte((unsigned char)(aValue | 0x80));
+        aValue >>= 7;
+    }
+    writeByte((unsigned char)aValue);
+}
+
+void InputJournalWriter::writeUint32(unsigned int aValue)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        writeByte((unsigned char)(aValue >> (8 * i)));
+    }
+}
+
+void InputJournalWriter::writeFloat(float aValue)
+{
+    writeUint32(floatBits(aValue));
+}
+
+InputJournalReader::InputJournalReader() :
+    m_File(NULL),
+    m_LastTick(0),
+    m_IsCorrupt(false)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+InputJournalReader::~InputJournalReader()
+{
+    close();
+}
+
+bool InputJournalReader::open(const char* aPath)
+{
+    close();
+    m_File = fopen(aPath, "rb");
+    if(m_File == NULL)
+    {
+        return false;
+    }
+
+    m_LastTick = 0;
+    m_IsCorrupt = false;
+
+    unsigned int magic = 0;
+    unsigned int version = 0;
+    unsigned int flags = 0;
+    unsigned int broadPhaseType = 0;
+    unsigned int poolSize = 0;
+    unsigned int maxTOIEvents = 0;
+    unsigned int rateLow = 0;
+    unsigned int rateHigh = 0;
+    bool isRead = readUint32(magic) && readVarint(version) && readVarint(flags) && readUint32(rateLow) && readUint32(rateHigh);
+    isRead = isRead && readFloat(m_Header.screenWidth) && readFloat(m_Header.screenHeight);
+    isRead = isRead && readVarint(broadPhaseType) && readVarint(poolSize) && readVarint(maxTOIEvents);
+    unsigned long long rateBits = ((unsigned long long)rateHigh << 32) | rateLow;
+    memcpy(&m_Header.physicsRate, &rateBits, sizeof(rateBits));
+    if(isRead == false || magic != INPUT_JOURNAL_MAGIC || version != INPUT_JOURNAL_VERSION || m_Header.physicsRate <= 0.0)
+    {
+        close();
+        return false;
+    }
+
+    m_Header.broadPhaseType = (int)broadPhaseType;
+    m_Header.cannonBallPoolSize = (int)poolSize;
+    m_Header.maxTOIEvents = (int)maxTOIEvents;
+    m_Header.hasBodyHashes = (flags & INPUT_JOURNAL_BODY_HASHES) != 0;
+    m_Header.simdSolver = (flags & INPUT_JOURNAL_SIMD_SOLVER) != 0;
+    m_Header.warmStartCache = (flags & INPUT_JOURNAL_WARM_START_CACHE) != 0;
+    m_Header.sortFreePairs = (flags & INPUT_JOURNAL_SORT_FREE_PAIRS) != 0;
+    m_Header.speculativeContacts = (flags & INPUT_JOURNAL_SPECULATIVE_CONTACTS) != 0;
+    return true;
+}
+
+void InputJournalReader::close()
+{
+    if(m_File != NULL)
+    {
+        fclose(m_File);
+        m_File = NULL;
+    }
+}
+
+const InputJournalHeader& InputJournalReader::getHeader()
+{
+    return m_Header;
+}
+
+bool InputJournalReader::read(InputJournalRecord& aRecord)
+{
+    unsigned char type = InputJournalEnd;
+    if(m_File == NULL || m_IsCorrupt == true || readByte(type) == false || type == InputJournalEnd)
+    {
+        return false;
+    }
+
+    unsigned int delta = 0;
+    bool isRead = readVarint(delta);
+    aRecord.type = type;
+    aRecord.tick = m_LastTick + delta;
+    m_LastTick = aRecord.tick;
+
+    switch(type)
+    {
+        case InputJournalTouch:
+        {
+            unsigned char touchEvent = 0;
+            isRead = isRead && readByte(touchEvent);
+            isRead = isRead && readFloat(aRecord.locationX) && readFloat(aRecord.locationY);
+            isRead = isRead && readFloat(aRecord.previousX) && readFloat(aRecord.previousY);
+            aRecord.touchEvent = touchEvent;
+            break;
+        }
+
+        case InputJournalFire:
+        case InputJournalReset:
+            break;
+
+        case InputJournalTick:
+        {
+            isRead = isRead && readUint32(aRecord.worldHash);
+            aRecord.bodyHashes.clear();
+            unsigned int bodyCount = 0;
+            if(m_Header.hasBodyHashes == true)
+            {
+                isRead = isRead && readVarint(bodyCount);
+            }
+            for(unsigned int i = 0; i < bodyCount && isRead == true; i++)
+            {
+                unsigned int bodyHash = 0;
+                isRead = readUint32(bodyHash);
+                aRecord.bodyHashes.push_back(bodyHash);
+            }
+            break;
+        }
+
+        default:
+            isRead = false;
+            break;
+    }
+
+    m_IsCorrupt = isRead == false;
+    return isRead;
+}
+
+bool InputJournalReader::isCorrupt()
+{
+    return m_IsCorrupt;
+}
+
+bool InputJournalReader::readByte(unsigned char& aValue)
+{
+    int value = fgetc(m_File);
+    if(value == EOF)
+    {
+        return false;
+    }
+    aValue = (unsigned char)value;
+    return true;
+}
+
+bool InputJournalReader::readVarint(unsigned int& aValue)
+{
+    aValue = 0;
+    for(int shift = 0; shift < 35; shift += 7)
+    {
+        unsigned char byte = 0;
+        if(readByte(byte) == false)
+        {
+            return false;
+        }
+        aValue |= (unsigned int)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool InputJournalReader::readUint32(unsigned int& aValue)
+{
+    aValue = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        unsigned char byte = 0;
+        if(readByte(byte) == false)
+        {
+            return false;
+        }
+        aValue |= (unsigned int)byte << (8 * i);
+    }
+    return true;
+}
+
+bool InputJournalReader::readFloat(float& aValue)
+{
+    unsigned int bits = 0;
+    if(readUint32(bits) == false)
+    {
+        return false;
+    }
+    aValue = bitsFloat(bits);
+    return true;
+}
@@ -0,0 +1,142 @@
+//
+//  InputJournal.h
+//  GameDevFramework
+//
+//  A streaming file of every input the game got, stamped with the physics
+//  tick it landed before, plus a hash of the body transforms after every
+//  tick. Game::startRecording writes one, Game::replay plays one back.
+//
+
+#ifndef INPUT_JOURNAL_H
+#define INPUT_JOURNAL_H
+
+#include "Constants.h"
+#include <stdio.h>
+#include <vector>
+
+class b2World;
+
+enum
+{
+    InputJournalEnd = 0,
+    InputJournalTouch,
+    InputJournalFire,
+    InputJournalReset,
+    InputJournalTick
+};
+typedef unsigned int InputJournalRecordType;
+
+//The settings a journal was recorded with, a replay has to start from the same ones
+struct InputJournalHeader
+{
+    double physicsRate;
+    float screenWidth;
+    float screenHeight;
+    int broadPhaseType;
+    int cannonBallPoolSize;
+    int maxTOIEvents;
+    bool simdSolver;
+    bool warmStartCache;
+    bool sortFreePairs;
+    bool speculativeContacts;
+
+    //Tick records also hold the hash of each body, so a replay can tell which body diverged first
+    bool hasBodyHashes;
+};
+
+//One record, the fields used depend on the type
+struct InputJournalRecord
+{
+    InputJournalRecordType type;
+    unsigned int tick;
+
+    TouchEvent touchEvent;
+    float locationX;
+    float locationY;
+    float previousX;
+    float previousY;
+
+    unsigned int worldHash;
+    std::vector<unsigned int> bodyHashes;
+};
+
+//What Game::replay found, the divergent tick and body are -1 when every tick matched
+struct InputReplayResult
+{
+    unsigned int ticks;
+    unsigned int inputs;
+    int divergentTick;
+    int divergentBody;
+    unsigned int expectedHash;
+    unsigned int actualHash;
+};
+
+//Hash of every body's position and angle in world list order, the hash of each body goes into bodyHashes if it isn't NULL
+unsigned int hashWorldTransforms(b2World* world, std::vector<unsigned int>* bodyHashes = NULL);
+
+class InputJournalWriter
+{
+public:
+    InputJournalWriter();
+    ~InputJournalWriter();
+
+    bool open(const char* path, const InputJournalHeader& header);
+    void close();
+    bool isOpen();
+
+    void writeTouch(unsigned int tick, TouchEvent touchEvent, float locationX, float locationY, float previousX, float previousY);
+    void writeFire(unsigned int tick);
+    void writeReset(unsigned int tick);
+
+    //Hashes the world after the tick was stepped
+    void writeTick(unsigned int tick, b2World* world);
+
+    long getBytesWritten();
+
+    //Writes a record read from another journal as it is, for tools that edit journals
+    void writeRecord(const InputJournalRecord& record);
+
+private:
+    void writeRecordStart(InputJournalRecordType type, unsigned int tick);
+    void writeByte(unsigned char value);
+    void writeVarint(unsigned int value);
+    void writeUint32(unsigned int value);
+    void writeFloat(float value);
+
+    FILE* m_File;
+    unsigned int m_LastTick;
+    bool m_HasBodyHashes;
+    long m_BytesWritten;
+    std::vector<unsigned int> m_BodyHashes;
+};
+
+class InputJournalReader
+{
+public:
+    InputJournalReader();
+    ~InputJournalReader();
+
+    bool open(const char* path);
+    void close();
+
+    const InputJournalHeader& getHeader();
+
+    //Reads the next record, false at the end of the journal or when the rest of it can't be read
+    bool read(InputJournalRecord& record);
+
+    //True once a read hit a journal that was cut short or isn't one, a journal that just stops without its end record still reads up to there
+    bool isCorrupt();
+
+private:
+    bool readByte(unsigned char& value);
+    bool readVarint(unsigned int& value);
+    bool readUint32(unsigned int& value);
+    bool readFloat(float& value);
+
+    FILE* m_File;
+    InputJournalHeader m_Header;
+    unsigned int m_LastTick;
+    bool m_IsCorrupt;
+};
+
+#endif
@@ -0,0 +1,310 @@
+//
+//  TrajectoryPredictor.cpp
+//  GameDevFramework
+//
+
+#include "TrajectoryPredictor.h"
+#include "Cannon.h"
+#include "Constants.h"
+#include "DeviceUtils.h"
+#include <algorithm>
+
+
+namespace
+{
+    //Steps per broad-phase query, and how many fixtures each query keeps before it is run again on its own
+    const int TRAJECTORY_CHUNK_STEPS = 8;
+    const int TRAJECTORY_CHUNK_FIXTURES = 32;
+
+    //How far the barrel can move before the path is predicted again
+    const float TRAJECTORY_POSITION_TOLERANCE = 0.01f;
+    const float TRAJECTORY_ANGLE_TOLERANCE = 0.001f;
+}
+
+
+TrajectoryPredictor::TrajectoryPredictor() :
+    m_MaxSteps(CANNON_TRAJECTORY_MAX_STEPS),
+    m_TimeBudget(CANNON_TRAJECTORY_TIME_BUDGET),
+    m_IsValid(false),
+    m_BarrelAngle(0.0f),
+    m_TimeStep(0.0f),
+    m_Age(0.0),
+    m_NextChunk(0),
+    m_IsComplete(false),
+    m_HitFixture(NULL),
+    m_HitBody(NULL),
+    m_LastUpdateTime(0.0f),
+    m_LastUpdateCached(false)
+{
+    m_MuzzlePosition.SetZero();
+}
+
+void TrajectoryPredictor::update(b2World* aWorld, Cannon* aCannon, float aTimeStep, double aDelta)
+{
+    b2Timer timer;
+    m_Age += aDelta;
+    m_LastUpdateCached = isPathValid(aCannon, aTimeStep);
+    if(m_LastUpdateCached == false)
+    {
+        restart(aWorld, aCannon, aTimeStep);
+    }
+
+    //Check chunks until the path ends or the budget is spent
+    int chunkCount = (int)m_ChunkBoxes.size();
+    while(m_IsComplete == false && m_NextChunk < chunkCount)
+    {
+        checkChunk(aWorld, aCannon, m_NextChunk);
+        m_NextChunk++;
+
+        if(timer.GetMilliseconds() >= m_TimeBudget)
+        {
+            break;
+        }
+    }
+    m_IsComplete = m_IsComplete == true || m_NextChunk == chunkCount;
+    m_LastUpdateTime = timer.GetMilliseconds();
+}
+
+void TrajectoryPredictor::invalidate()
+{
+    m_IsValid = false;
+    m_HitFixture = NULL;
+    m_HitBody = NULL;
+}
+
+void TrajectoryPredictor::setMaxSteps(int aMaxSteps)
+{
+    m_MaxSteps = aMaxSteps > 1 ? aMaxSteps : 1;
+    invalidate();
+}
+
+int TrajectoryPredictor::getMaxSteps()
+{
+    return m_MaxSteps;
+}
+
+void TrajectoryPredictor::setTimeBudget(float aMilliseconds)
+{
+    m_TimeBudget = aMilliseconds;
+}
+
+float TrajectoryPredictor::getTimeBudget()
+{
+    return m_TimeBudget;
+}
+
+const std::vector<b2Vec2>& TrajectoryPredictor::getPoints()
+{
+    return m_Points;
+}
+
+bool TrajectoryPredictor::isComplete()
+{
+    return m_IsComplete;
+}
+
+b2Fixture* TrajectoryPredictor::getHitFixture()
+{
+    return m_HitFixture;
+}
+
+float TrajectoryPredictor::getLastUpdateTime()
+{
+    return m_LastUpdateTime;
+}
+
+bool TrajectoryPredictor::wasLastUpdateCached()
+{
+    return m_LastUpdateCached;
+}
+
+bool TrajectoryPredictor::FixtureQuery::ReportFixture(b2Fixture* aFixture)
+{
+    fixtures.push_back(aFixture);
+    return true;
+}
+
+bool TrajectoryPredictor::isPathValid(Cannon* aCannon, float aTimeStep)
+{
+    if(m_IsValid == false || aTimeStep != m_TimeStep || m_Age >= CANNON_TRAJECTORY_REFRESH_INTERVAL)
+    {
+        return false;
+    }
+
+    //Only sleeping or static bodies are predicted against, one that woke up may have moved off the path
+    if(m_HitBody != NULL && m_HitBody->GetType() != b2_staticBody && m_HitBody->IsAwake() == true)
+    {
+        return false;
+    }
+
+    b2Vec2 movement = aCannon->getMuzzlePosition() - m_MuzzlePosition;
+    float turn = aCannon->getBarrelAngle() - m_BarrelAngle;
+    return movement.LengthSquared() <= TRAJECTORY_POSITION_TOLERANCE * TRAJECTORY_POSITION_TOLERANCE && b2Abs(turn) <= TRAJECTORY_ANGLE_TOLERANCE;
+}
+
+void TrajectoryPredictor::restart(b2World* aWorld, Cannon* aCannon, float aTimeStep)
+{
+    m_IsValid = true;
+    m_MuzzlePosition = aCannon->getMuzzlePosition();
+    m_BarrelAngle = aCannon->getBarrelAngle();
+    m_TimeStep = aTimeStep;
+    m_Age = 0.0;
+    m_BallShape.m_radius = aCannon->getCannonBallRadius();
+
+    //Step the ball the way b2Island does, gravity into the velocity and then the velocity into the
+    //position. It stops once it is off the sides or through the ground, where Cannon recycles balls
+    b2Vec2 position = m_MuzzlePosition;
+    b2Vec2 velocity = aCannon->getMuzzleVelocity();
+    b2Vec2 gravity = aWorld->GetGravity();
+    float width = RW2PW(DeviceUtils::getScreenResolutionWidth());
+    m_FlightPath.clear();
+    m_FlightPath.push_back(position);
+    for(int i = 0; i < m_MaxSteps && position.x >= 0.0f && position.x <= width && position.y >= 0.0f; i++)
+    {
+        velocity += aTimeStep * gravity;
+
+        b2Vec2 translation = aTimeStep * velocity;
+        if(b2Dot(translation, translation) > b2_maxTranslationSquared)
+        {
+            velocity *= b2_maxTranslation / translation.Length();
+        }
+        position += aTimeStep * velocity;
+        m_FlightPath.push_back(position);
+    }
+
+    //One box around the ball's sweep over each chunk of steps, all queried in one batch
+    int stepCount = (int)m_FlightPath.size() - 1;
+    int chunkCount = (stepCount + TRAJECTORY_CHUNK_STEPS - 1) / TRAJECTORY_CHUNK_STEPS;
+    b2Vec2 extent(m_BallShape.m_radius, m_BallShape.m_radius);
+    m_ChunkBoxes.resize(chunkCount);
+    for(int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        int first = chunk * TRAJECTORY_CHUNK_STEPS;
+        int last = std::min(first + TRAJECTORY_CHUNK_STEPS, stepCount);
+        b2AABB& box = m_ChunkBoxes[chunk];
+        box.lowerBound = m_FlightPath[first];
+        box.upperBound = m_FlightPath[first];
+        for(int i = first + 1; i <= last; i++)
+        {
+            box.lowerBound = b2Min(box.lowerBound, m_FlightPath[i]);
+            box.upperBound = b2Max(box.upperBound, m_FlightPath[i]);
+        }
+        box.lowerBound -= extent;
+        box.upperBound += extent;
+    }
+
+    m_ChunkFixtures.resize(chunkCount * TRAJECTORY_CHUNK_FIXTURES);
+    m_ChunkFixtureCounts.resize(chunkCount);
+    if(chunkCount > 0)
+    {
+        aWorld->QueryAABBBatch(&m_ChunkBoxes[0], chunkCount, &m_ChunkFixtures[0], TRAJECTORY_CHUNK_FIXTURES, &m_ChunkFixtureCounts[0]);
+    }
+
+    m_NextChunk = 0;
+    m_Points.clear();
+    m_Points.push_back(m_MuzzlePosition);
+    m_IsComplete = false;
+    m_HitFixture = NULL;
+    m_HitBody = NULL;
+}
+
+void TrajectoryPredictor::checkChunk(b2World* aWorld, Cannon* aCannon, int aChunk)
+{
+    //The chunk's fixtures, queried again if there were more than the batch kept
+    m_Candidates.clear();
+    int fixtureCount = m_ChunkFixtureCounts[aChunk];
+    b2Fixture** fixtures = &m_ChunkFixtures[aChunk * TRAJECTORY_CHUNK_FIXTURES];
+    if(fixtureCount > TRAJECTORY_CHUNK_FIXTURES)
+    {
+        m_OverflowQuery.fixtures.clear();
+        aWorld->QueryAABB(&m_OverflowQuery, m_ChunkBoxes[aChunk]);
+        fixtureCount = (int)m_OverflowQuery.fixtures.size();
+        fixtures = &m_OverflowQuery.fixtures[0];
+    }
+
+    //A fixture is reported once per child proxy, keep each one once
+    for(int i = 0; i < fixtureCount; i++)
+    {
+        if(isObstacle(fixtures[i], aCannon) == true && std::find(m_Candidates.begin(), m_Candidates.end(), fixtures[i]) == m_Candidates.end())
+        {
+            m_Candidates.push_back(fixtures[i]);
+        }
+    }
+
+    int stepCount = (int)m_FlightPath.size() - 1;
+    int first = aChunk * TRAJECTORY_CHUNK_STEPS;
+    int last = std::min(first + TRAJECTORY_CHUNK_STEPS, stepCount);
+    for(int step = first; step < last; step++)
+    {
+        b2Vec2 start = m_FlightPath[step];
+        b2Vec2 end = m_FlightPath[step + 1];
+
+        b2AABB stepBox;
+        stepBox.lowerBound = b2Min(start, end) - b2Vec2(m_BallShape.m_radius, m_BallShape.m_radius);
+        stepBox.upperBound = b2Max(start, end) + b2Vec2(m_BallShape.m_radius, m_BallShape.m_radius);
+
+        //The earliest time of impact in this step against any candidate
+        b2TOIInput input;
+        input.proxyA.Set(&m_BallShape, 0);
+        input.sweepA.localCenter.SetZero();
+        input.sweepA.c0 = start;
+        input.sweepA.c = end;
+        input.sweepA.a0 = input.sweepA.a = 0.0f;
+        input.sweepA.alpha0 = 0.0f;
+        input.tMax = 1.0f;
+
+        float hitTime = 1.0f;
+        b2Fixture* hitFixture = NULL;
+        for(size_t i = 0; i < m_Candidates.size(); i++)
+        {
+            b2Fixture* fixture = m_Candidates[i];
+            b2Body* body = fixture->GetBody();
+            for(int32 child = 0; child < fixture->GetShape()->GetChildCount(); child++)
+            {
+                if(b2TestOverlap(stepBox, fixture->GetAABB(child)) == false)
+                {
+                    continue;
+                }
+
+                input.proxyB.Set(fixture->GetShape(), child);
+                input.sweepB.localCenter = body->GetLocalCenter();
+                input.sweepB.c0 = input.sweepB.c = body->GetWorldCenter();
+                input.sweepB.a0 = input.sweepB.a = body->GetAngle();
+                input.sweepB.alpha0 = 0.0f;
+
+                b2TOIOutput output;
+                b2TimeOfImpact(&output, &input);
+
+                //Overlapped means the ball starts inside the fixture, which stops it just the same
+                bool isHit = output.state == b2TOIOutput::e_touching || output.state == b2TOIOutput::e_overlapped;
+                float time = output.state == b2TOIOutput::e_overlapped ? 0.0f : output.t;
+                if(isHit == true && (hitFixture == NULL || time < hitTime))
+                {
+                    hitTime = time;
+                    hitFixture = fixture;
+                }
+            }
+        }
+
+        if(hitFixture != NULL)
+        {
+            m_Points.push_back(start + hitTime * (end - start));
+            m_HitFixture = hitFixture;
+            m_HitBody = hitFixture->GetBody();
+            m_IsComplete = true;
+            return;
+        }
+        m_Points.push_back(end);
+    }
+}
+
+bool TrajectoryPredictor::isObstacle(b2Fixture* aFixture, Cannon* aCannon)
+{
+    //Awake bodies will have moved by the time the ball gets there, and the cannon recoils away from the ball
+    b2Body* body = aFixture->GetBody();
+    if(aFixture->IsSensor() == true || aCannon->isCannonBody(body) == true)
+    {
+        return false;
+    }
+    return body->GetType() == b2_staticBody || body->IsAwake() == false;
+}
@@ -0,0 +1,96 @@
+//
+//  TrajectoryPredictor.h
+//  GameDevFramework
+//
+//  Predicts where the next cannon ball goes. The ball is stepped on its own
+//  the way b2World steps a body, and swept against the static bodies and
+//  sleeping blocks in the world's broad-phase, so the rest of the world is
+//  never copied or stepped.
+//
+
+#ifndef TRAJECTORY_PREDICTOR_H
+#define TRAJECTORY_PREDICTOR_H
+
+#include "Box2D.h"
+#include <vector>
+
+class Cannon;
+
+class TrajectoryPredictor
+{
+public:
+    TrajectoryPredictor();
+
+    //Predicts the path of the next ball aCannon fires, stepped at aTimeStep. The last path is kept while
+    //the barrel hasn't moved, and a prediction that runs out of time budget carries on next update
+    void update(b2World* aWorld, Cannon* aCannon, float aTimeStep, double aDelta);
+
+    //Forgets the last path, call it when bodies it hit may have been destroyed
+    void invalidate();
+
+    void setMaxSteps(int maxSteps);
+    int getMaxSteps();
+
+    //Milliseconds an update may spend predicting, at least one chunk of steps is checked per update
+    void setTimeBudget(float milliseconds);
+    float getTimeBudget();
+
+    //The ball's centre after each step in meters, starting at the muzzle. It ends where the ball
+    //first touches something, leaves the screen or runs out of steps
+    const std::vector<b2Vec2>& getPoints();
+
+    //False while the path is still being checked over several updates
+    bool isComplete();
+
+    //What the ball first touches, NULL if it touches nothing
+    b2Fixture* getHitFixture();
+
+    //How long the last update took in milliseconds and whether it reused the last path
+    float getLastUpdateTime();
+    bool wasLastUpdateCached();
+
+private:
+    class FixtureQuery : public b2QueryCallback
+    {
+    public:
+        bool ReportFixture(b2Fixture* fixture);
+        std::vector<b2Fixture*> fixtures;
+    };
+
+    bool isPathValid(Cannon* aCannon, float aTimeStep);
+    void restart(b2World* aWorld, Cannon* aCannon, float aTimeStep);
+    void checkChunk(b2World* aWorld, Cannon* aCannon, int aChunk);
+    bool isObstacle(b2Fixture* aFixture, Cannon* aCannon);
+
+    int m_MaxSteps;
+    float m_TimeBudget;
+
+    //What the path was predicted from
+    bool m_IsValid;
+    b2Vec2 m_MuzzlePosition;
+    float m_BarrelAngle;
+    float m_TimeStep;
+    double m_Age;
+
+    //The ball's path if it hits nothing, checked against the world a chunk of steps at a time
+    std::vector<b2Vec2> m_FlightPath;
+    std::vector<b2AABB> m_ChunkBoxes;
+    std::vector<b2Fixture*> m_ChunkFixtures;
+    std::vector<int32> m_ChunkFixtureCounts;
+    int m_NextChunk;
+    b2CircleShape m_BallShape;
+
+    std::vector<b2Vec2> m_Points;
+    bool m_IsComplete;
+    b2Fixture* m_HitFixture;
+    b2Body* m_HitBody;
+
+    float m_LastUpdateTime;
+    bool m_LastUpdateCached;
+
+    //Scratch lists, kept so predicting doesn't allocate once they have grown
+    FixtureQuery m_OverflowQuery;
+    std::vector<b2Fixture*> m_Candidates;
+};
+
+#endif
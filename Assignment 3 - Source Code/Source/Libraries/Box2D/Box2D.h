@@ -35,6 +35,8 @@ For discussion please visit http://box2d.org/forum
 #include "b2Draw.h"
 #include "b2DebugDraw.h"
 #include "b2Timer.h"
+#include "b2Profiler.h"
+#include "b2Snapshot.h"
 
 #include "b2Helper.h"
 
@@ -17,11 +17,18 @@
 */
 
 #include "b2BroadPhase.h"
+#include "b2Snapshot.h"
+#include "b2ThreadPool.h"
 #include <cstring>
 using namespace std;
 
+// Move buffer entries queried per parallel task. Fewer moved proxies than
+// two chunks are queried on the calling thread.
+static const int32 b2_pairQueryGrain = 64;
+
 b2BroadPhase::b2BroadPhase()
 {
+	m_type = b2_dynamicTreeBroadPhase;
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
@@ -31,17 +38,73 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	m_moveAABBs = (b2AABB*)b2Alloc(m_moveCapacity * sizeof(b2AABB));
+
+	m_sortFreePairs = false;
+
+	m_threadPool = NULL;
+	m_workerPairs = NULL;
+	m_workerCount = 0;
+	m_pairChunks = NULL;
+	m_pairChunkCapacity = 0;
+	m_reservedPairs = 16;
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
+	SetThreadPool(NULL);
+	b2Free(m_moveAABBs);
 	b2Free(m_moveBuffer);
 	b2Free(m_pairBuffer);
 }
 
+void b2BroadPhase::SetType(b2BroadPhaseType type)
+{
+	b2Assert(m_proxyCount == 0);
+	if (m_proxyCount == 0)
+	{
+		m_type = type;
+	}
+}
+
+void b2BroadPhase::SetThreadPool(b2ThreadPool* threadPool)
+{
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		b2Free(m_workerPairs[i].pairs);
+	}
+	b2Free(m_workerPairs);
+	b2Free(m_pairChunks);
+	m_workerPairs = NULL;
+	m_workerCount = 0;
+	m_pairChunks = NULL;
+	m_pairChunkCapacity = 0;
+
+	m_threadPool = threadPool;
+	if (m_threadPool)
+	{
+		m_workerCount = m_threadPool->GetThreadCount();
+		m_workerPairs = (b2PairBuffer*)b2Alloc(m_workerCount * sizeof(b2PairBuffer));
+		for (int32 i = 0; i < m_workerCount; ++i)
+		{
+			m_workerPairs[i].capacity = m_reservedPairs;
+			m_workerPairs[i].count = 0;
+			m_workerPairs[i].pairs = (b2Pair*)b2Alloc(m_workerPairs[i].capacity * sizeof(b2Pair));
+		}
+	}
+}
+
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	int32 proxyId;
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		proxyId = m_sap.CreateProxy(aabb, userData);
+	}
+	else
+	{
+		proxyId = m_tree.CreateProxy(aabb, userData);
+	}
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
@@ -51,12 +114,81 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.DestroyProxy(proxyId);
+	}
+	else
+	{
+		m_tree.DestroyProxy(proxyId);
+	}
+}
+
+void b2BroadPhase::Reset()
+{
+	m_tree.Reset();
+	m_sap.Reset();
+	m_proxyCount = 0;
+	m_moveCount = 0;
+	m_pairCount = 0;
+}
+
+void b2BroadPhase::Reserve(int32 proxyCount, int32 pairCount)
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.Reserve(proxyCount);
+	}
+	else
+	{
+		m_tree.Reserve(2 * proxyCount - 1);
+	}
+
+	// A proxy can be buffered twice in a step, by a touch and a move.
+	ReserveMoves(2 * proxyCount);
+
+	if (pairCount > m_pairCapacity)
+	{
+		b2Pair* oldPairs = m_pairBuffer;
+		m_pairCapacity = pairCount;
+		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+		memcpy(m_pairBuffer, oldPairs, m_pairCount * sizeof(b2Pair));
+		b2Free(oldPairs);
+	}
+
+	// Every pair could end up in one worker's buffer.
+	m_reservedPairs = b2Max(m_reservedPairs, pairCount);
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		b2PairBuffer* buffer = m_workerPairs + i;
+		if (m_reservedPairs > buffer->capacity)
+		{
+			b2Free(buffer->pairs);
+			buffer->capacity = m_reservedPairs;
+			buffer->pairs = (b2Pair*)b2Alloc(buffer->capacity * sizeof(b2Pair));
+		}
+	}
+
+	int32 chunkCount = (2 * proxyCount + b2_pairQueryGrain - 1) / b2_pairQueryGrain;
+	if (m_threadPool && chunkCount > m_pairChunkCapacity)
+	{
+		b2Free(m_pairChunks);
+		m_pairChunkCapacity = chunkCount;
+		m_pairChunks = (b2PairChunk*)b2Alloc(m_pairChunkCapacity * sizeof(b2PairChunk));
+	}
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer;
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		buffer = m_sap.MoveProxy(proxyId, aabb, displacement);
+	}
+	else
+	{
+		buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	}
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -72,17 +204,109 @@ void b2BroadPhase::BufferMove(int32 proxyId)
 {
 	if (m_moveCount == m_moveCapacity)
 	{
-		int32* oldBuffer = m_moveBuffer;
-		m_moveCapacity *= 2;
-		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
-		memcpy(m_moveBuffer, oldBuffer, m_moveCount * sizeof(int32));
-		b2Free(oldBuffer);
+		ReserveMoves(2 * m_moveCapacity);
 	}
 
 	m_moveBuffer[m_moveCount] = proxyId;
 	++m_moveCount;
 }
 
+void b2BroadPhase::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_type);
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.SaveState(snapshot);
+	}
+	else
+	{
+		m_tree.SaveState(snapshot);
+	}
+	snapshot->Write(m_proxyCount);
+	snapshot->Write(m_moveCount);
+	snapshot->Write(m_moveBuffer, m_moveCount * sizeof(int32));
+}
+
+void b2BroadPhase::RestoreState(b2SnapshotReader* reader)
+{
+	b2BroadPhaseType type = reader->Read<b2BroadPhaseType>();
+	if (type != m_type)
+	{
+		// Drop the proxies of the structure that goes unused.
+		m_tree.Reset();
+		m_sap.Reset();
+		m_type = type;
+	}
+
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.RestoreState(reader);
+	}
+	else
+	{
+		m_tree.RestoreState(reader);
+	}
+	m_proxyCount = reader->Read<int32>();
+
+	int32 moveCount = b2Max(reader->Read<int32>(), 0);
+	ReserveMoves(moveCount);
+	reader->Read(m_moveBuffer, moveCount * sizeof(int32));
+	m_moveCount = moveCount;
+}
+
+int32 b2BroadPhase::CheckState(b2SnapshotReader* reader)
+{
+	b2BroadPhaseType type = reader->Read<b2BroadPhaseType>();
+	int32 capacity = 0;
+	if (type == b2_sweepAndPruneBroadPhase)
+	{
+		capacity = b2SweepAndPrune::CheckState(reader);
+	}
+	else if (type == b2_dynamicTreeBroadPhase)
+	{
+		capacity = b2DynamicTree::CheckState(reader);
+	}
+	else
+	{
+		reader->Fail();
+	}
+
+	int32 proxyCount = reader->Read<int32>();
+	int32 moveCount = reader->Read<int32>();
+	if (proxyCount < 0 || proxyCount > capacity || moveCount < 0)
+	{
+		reader->Fail();
+	}
+	for (int32 i = 0; i < moveCount && reader->HasFailed() == false; ++i)
+	{
+		int32 proxyId = reader->Read<int32>();
+		if (proxyId < e_nullProxy || proxyId >= capacity)
+		{
+			reader->Fail();
+		}
+	}
+
+	return capacity;
+}
+
+void b2BroadPhase::ReserveMoves(int32 moveCount)
+{
+	if (moveCount <= m_moveCapacity)
+	{
+		return;
+	}
+
+	int32* oldBuffer = m_moveBuffer;
+	m_moveCapacity = moveCount;
+	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	memcpy(m_moveBuffer, oldBuffer, m_moveCount * sizeof(int32));
+	b2Free(oldBuffer);
+
+	// UpdatePairs fills these, so there is nothing to copy.
+	b2Free(m_moveAABBs);
+	m_moveAABBs = (b2AABB*)b2Alloc(m_moveCapacity * sizeof(b2AABB));
+}
+
 void b2BroadPhase::UnBufferMove(int32 proxyId)
 {
 	for (int32 i = 0; i < m_moveCount; ++i)
@@ -94,28 +318,206 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
-// This is called from b2DynamicTree::Query when we are gathering pairs.
-bool b2BroadPhase::QueryCallback(int32 proxyId)
+// Collects the pairs of a range of the compacted move buffer. This is
+// called from b2DynamicTree::QueryBatch, possibly on a worker thread, so it
+// only writes to its own buffer.
+class b2PairQuery
 {
-	// A proxy cannot form a pair with itself.
-	if (proxyId == m_queryProxyId)
+public:
+	void QueryCallback(int32 queryIndex, int32 proxyId)
 	{
-		return true;
+		int32 queryProxyId = m_queryProxyIds[queryIndex];
+
+		// A proxy cannot form a pair with itself.
+		if (proxyId == queryProxyId)
+		{
+			return;
+		}
+
+		// Both proxies moved, the query of the lower id reports the pair.
+		if (m_sortFreePairs && proxyId < queryProxyId && m_broadPhase->WasMoved(proxyId))
+		{
+			return;
+		}
+
+		// Grow the pair buffer as needed.
+		b2PairBuffer* buffer = m_buffer;
+		if (buffer->count == buffer->capacity)
+		{
+			b2Pair* oldPairs = buffer->pairs;
+			buffer->capacity *= 2;
+			buffer->pairs = (b2Pair*)b2Alloc(buffer->capacity * sizeof(b2Pair));
+			memcpy(buffer->pairs, oldPairs, buffer->count * sizeof(b2Pair));
+			b2Free(oldPairs);
+		}
+
+		buffer->pairs[buffer->count].proxyIdA = b2Min(proxyId, queryProxyId);
+		buffer->pairs[buffer->count].proxyIdB = b2Max(proxyId, queryProxyId);
+		++buffer->count;
 	}
 
-	// Grow the pair buffer as needed.
-	if (m_pairCount == m_pairCapacity)
+	const b2BroadPhase* m_broadPhase;
+	const int32* m_queryProxyIds;
+	b2PairBuffer* m_buffer;
+	bool m_sortFreePairs;
+};
+
+class b2PairQueryTask : public b2ThreadTask
+{
+public:
+	b2PairQueryTask(b2BroadPhase* broadPhase)
 	{
-		b2Pair* oldBuffer = m_pairBuffer;
-		m_pairCapacity *= 2;
-		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
-		memcpy(m_pairBuffer, oldBuffer, m_pairCount * sizeof(b2Pair));
-		b2Free(oldBuffer);
+		m_broadPhase = broadPhase;
 	}
 
-	m_pairBuffer[m_pairCount].proxyIdA = b2Min(proxyId, m_queryProxyId);
-	m_pairBuffer[m_pairCount].proxyIdB = b2Max(proxyId, m_queryProxyId);
-	++m_pairCount;
+	// The pool may hand out more than one grain at once, it runs the whole range
+	// on the caller with one thread, so each grain gets its own chunk.
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		b2PairBuffer* buffer = m_broadPhase->m_workerPairs + workerIndex;
+		for (int32 first = begin; first < end; first += b2_pairQueryGrain)
+		{
+			int32 last = b2Min(first + b2_pairQueryGrain, end);
+			b2PairChunk* chunk = m_broadPhase->m_pairChunks + first / b2_pairQueryGrain;
+			chunk->workerIndex = workerIndex;
+			chunk->start = buffer->count;
+			m_broadPhase->QueryPairs(buffer, first, last);
+			chunk->count = buffer->count - chunk->start;
+		}
+	}
+
+private:
+	b2BroadPhase* m_broadPhase;
+};
 
-	return true;
+void b2BroadPhase::FindPairs()
+{
+	// Compact the moving proxies, drop the ones buffered twice and gather
+	// their fat AABBs. We have to query the tree with the fat AABB so that
+	// we don't fail to create a pair that may touch later.
+	int32 queryCount = 0;
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		int32 proxyId = m_moveBuffer[i];
+		if (proxyId == e_nullProxy || WasMoved(proxyId))
+		{
+			continue;
+		}
+
+		SetMoved(proxyId, true);
+		m_moveBuffer[queryCount] = proxyId;
+		m_moveAABBs[queryCount] = GetFatAABB(proxyId);
+		++queryCount;
+	}
+
+	// Query the tree for all moving proxies, create pairs and add them pair buffer.
+	m_pairCount = 0;
+	if (m_threadPool && queryCount >= 2 * b2_pairQueryGrain)
+	{
+		QueryPairsParallel(queryCount);
+	}
+	else
+	{
+		b2PairBuffer buffer;
+		buffer.pairs = m_pairBuffer;
+		buffer.count = 0;
+		buffer.capacity = m_pairCapacity;
+		QueryPairs(&buffer, 0, queryCount);
+		m_pairBuffer = buffer.pairs;
+		m_pairCount = buffer.count;
+		m_pairCapacity = buffer.capacity;
+	}
+
+	// Reset move buffer
+	for (int32 i = 0; i < queryCount; ++i)
+	{
+		SetMoved(m_moveBuffer[i], false);
+	}
+	m_moveCount = 0;
+
+	if (m_sortFreePairs)
+	{
+		return;
+	}
+
+	// Sort the pair buffer to expose duplicates.
+	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
+
+	// Skip any duplicate pairs.
+	int32 uniqueCount = 0;
+	for (int32 i = 0; i < m_pairCount; ++i)
+	{
+		const b2Pair& pair = m_pairBuffer[i];
+		if (uniqueCount > 0)
+		{
+			const b2Pair& previous = m_pairBuffer[uniqueCount - 1];
+			if (pair.proxyIdA == previous.proxyIdA && pair.proxyIdB == previous.proxyIdB)
+			{
+				continue;
+			}
+		}
+		m_pairBuffer[uniqueCount++] = pair;
+	}
+	m_pairCount = uniqueCount;
+}
+
+void b2BroadPhase::QueryPairs(b2PairBuffer* buffer, int32 begin, int32 end) const
+{
+	b2PairQuery query;
+	query.m_broadPhase = this;
+	query.m_queryProxyIds = m_moveBuffer + begin;
+	query.m_buffer = buffer;
+	query.m_sortFreePairs = m_sortFreePairs;
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.QueryBatch(&query, m_moveAABBs + begin, end - begin);
+	}
+	else
+	{
+		m_tree.QueryBatch(&query, m_moveAABBs + begin, end - begin);
+	}
+}
+
+// Each worker appends to its own buffer. The chunks record where their pairs
+// went, so they can be copied out in move buffer order afterwards.
+void b2BroadPhase::QueryPairsParallel(int32 queryCount)
+{
+	int32 chunkCount = (queryCount + b2_pairQueryGrain - 1) / b2_pairQueryGrain;
+	if (chunkCount > m_pairChunkCapacity)
+	{
+		b2Free(m_pairChunks);
+		m_pairChunkCapacity = b2Max(chunkCount, 2 * m_pairChunkCapacity);
+		m_pairChunks = (b2PairChunk*)b2Alloc(m_pairChunkCapacity * sizeof(b2PairChunk));
+	}
+
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workerPairs[i].count = 0;
+	}
+
+	b2PairQueryTask task(this);
+	m_threadPool->Run(&task, queryCount, b2_pairQueryGrain);
+
+	int32 pairCount = 0;
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		pairCount += m_workerPairs[i].count;
+	}
+
+	if (pairCount > m_pairCapacity)
+	{
+		b2Free(m_pairBuffer);
+		while (m_pairCapacity < pairCount)
+		{
+			m_pairCapacity *= 2;
+		}
+		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	}
+
+	for (int32 i = 0; i < chunkCount; ++i)
+	{
+		const b2PairChunk& chunk = m_pairChunks[i];
+		memcpy(m_pairBuffer + m_pairCount, m_workerPairs[chunk.workerIndex].pairs + chunk.start, chunk.count * sizeof(b2Pair));
+		m_pairCount += chunk.count;
+	}
 }
@@ -22,8 +22,13 @@
 #include "b2Settings.h"
 #include "b2Collision.h"
 #include "b2DynamicTree.h"
+#include "b2SweepAndPrune.h"
 #include <algorithm>
 
+class b2Snapshot;
+class b2SnapshotReader;
+class b2ThreadPool;
+
 struct b2Pair
 {
 	int32 proxyIdA;
@@ -31,9 +36,33 @@ struct b2Pair
 	int32 next;
 };
 
+/// The structure b2BroadPhase keeps its proxies in.
+enum b2BroadPhaseType
+{
+	b2_dynamicTreeBroadPhase,
+	b2_sweepAndPruneBroadPhase
+};
+
+/// Pairs found by one worker during a parallel UpdatePairs.
+struct b2PairBuffer
+{
+	b2Pair* pairs;
+	int32 count;
+	int32 capacity;
+};
+
+/// Where a chunk of the move buffer left its pairs in the worker buffers.
+struct b2PairChunk
+{
+	int32 workerIndex;
+	int32 start;
+	int32 count;
+};
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+/// The proxies live in a b2DynamicTree by default, or in a b2SweepAndPrune.
 class b2BroadPhase
 {
 public:
@@ -46,6 +75,11 @@ public:
 	b2BroadPhase();
 	~b2BroadPhase();
 
+	/// Choose the structure the proxies are kept in. This can only be
+	/// changed while there are no proxies.
+	void SetType(b2BroadPhaseType type);
+	b2BroadPhaseType GetType() const { return m_type; }
+
 	/// Create a proxy with an initial AABB. Pairs are not reported until
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
@@ -65,6 +99,7 @@ public:
 
 	/// Get user data from a proxy. Returns NULL if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
+	void SetUserData(int32 proxyId, void* userData);
 
 	/// Test overlap of fat AABBs.
 	bool TestOverlap(int32 proxyIdA, int32 proxyIdB) const;
@@ -72,15 +107,53 @@ public:
 	/// Get the number of proxies.
 	int32 GetProxyCount() const;
 
+	/// Destroy every proxy at once and drop the buffered moves.
+	void Reset();
+
+	/// Grow the proxy storage, the move buffer and the pair buffers, the
+	/// ones of the thread pool workers included, so that a step with this
+	/// many proxies and new pairs doesn't allocate.
+	void Reserve(int32 proxyCount, int32 pairCount);
+
+	/// Write the proxies, the structure they are kept in and the buffered
+	/// moves. The user data is written as is.
+	void SaveState(b2Snapshot* snapshot) const;
+
+	/// Replace every proxy with the ones SaveState wrote, with the same ids.
+	/// The user data is what it was when saved, so the caller sets it again
+	/// if it doesn't live at the same addresses any more.
+	void RestoreState(b2SnapshotReader* reader);
+
+	/// Read past what SaveState wrote without touching a broad-phase, failing
+	/// the reader if RestoreState would be given a bad proxy id or count.
+	/// Returns how many proxy ids the saved structure has room for.
+	static int32 CheckState(b2SnapshotReader* reader);
+
 	/// Update the pairs. This results in pair callbacks. This can only add pairs.
 	template <typename T>
 	void UpdatePairs(T* callback);
 
+	/// Report each new pair once without sorting the pair buffer. A pair of
+	/// two moved proxies is only kept by the query of the lower proxy id, and
+	/// pairs come out in move buffer order instead of proxy id order.
+	void SetSortFreePairs(bool flag) { m_sortFreePairs = flag; }
+	bool GetSortFreePairs() const { return m_sortFreePairs; }
+
+	/// Query the tree for chunks of the move buffer on this pool. The pairs
+	/// are merged in chunk order, so the callbacks are the same as without
+	/// a pool. Pass NULL to query on the calling thread.
+	void SetThreadPool(b2ThreadPool* threadPool);
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query many AABBs. The callback class is called as
+	/// QueryCallback(queryIndex, proxyId) for each overlap, see b2DynamicTree::QueryBatch.
+	template <typename T>
+	void QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -91,29 +164,47 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
-	/// Get the height of the embedded tree.
+	/// Get the height of the embedded tree. Zero for sweep-and-prune.
 	int32 GetTreeHeight() const;
 
-	/// Get the balance of the embedded tree.
+	/// Get the balance of the embedded tree. Zero for sweep-and-prune.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the embedded tree.
+	/// Get the quality metric of the embedded tree. Zero for sweep-and-prune.
 	float32 GetTreeQuality() const;
 
+	/// Defer building the tree, or sorting the sweep-and-prune axis, for new
+	/// proxies until EndBulkInsert. Use this when loading a level. See
+	/// b2DynamicTree::BeginBulkInsert.
+	void BeginBulkInsert();
+	void EndBulkInsert();
+
 private:
 
 	friend class b2DynamicTree;
+	friend class b2PairQuery;
+	friend class b2PairQueryTask;
+
+	bool WasMoved(int32 proxyId) const;
+	void SetMoved(int32 proxyId, bool flag);
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
+	void ReserveMoves(int32 moveCount);
 
-	bool QueryCallback(int32 proxyId);
+	// Fill the pair buffer with the new pairs, each pair once.
+	void FindPairs();
+	void QueryPairs(b2PairBuffer* buffer, int32 begin, int32 end) const;
+	void QueryPairsParallel(int32 queryCount);
 
+	b2BroadPhaseType m_type;
 	b2DynamicTree m_tree;
+	b2SweepAndPrune m_sap;
 
 	int32 m_proxyCount;
 
 	int32* m_moveBuffer;
+	b2AABB* m_moveAABBs;
 	int32 m_moveCapacity;
 	int32 m_moveCount;
 
@@ -121,7 +212,14 @@ private:
 	int32 m_pairCapacity;
 	int32 m_pairCount;
 
-	int32 m_queryProxyId;
+	bool m_sortFreePairs;
+
+	b2ThreadPool* m_threadPool;
+	b2PairBuffer* m_workerPairs;
+	int32 m_workerCount;
+	b2PairChunk* m_pairChunks;
+	int32 m_pairChunkCapacity;
+	int32 m_reservedPairs;
 };
 
 /// This is used to sort pairs.
@@ -142,21 +240,62 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		return m_sap.GetUserData(proxyId);
+	}
 	return m_tree.GetUserData(proxyId);
 }
 
+inline void b2BroadPhase::SetUserData(int32 proxyId, void* userData)
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.SetUserData(proxyId, userData);
+	}
+	else
+	{
+		m_tree.SetUserData(proxyId, userData);
+	}
+}
+
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		return m_sap.GetFatAABB(proxyId);
+	}
 	return m_tree.GetFatAABB(proxyId);
 }
 
+inline bool b2BroadPhase::WasMoved(int32 proxyId) const
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		return m_sap.WasMoved(proxyId);
+	}
+	return m_tree.WasMoved(proxyId);
+}
+
+inline void b2BroadPhase::SetMoved(int32 proxyId, bool flag)
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.SetMoved(proxyId, flag);
+	}
+	else
+	{
+		m_tree.SetMoved(proxyId, flag);
+	}
+}
+
 inline int32 b2BroadPhase::GetProxyCount() const
 {
 	return m_proxyCount;
@@ -164,69 +303,56 @@ inline int32 b2BroadPhase::GetProxyCount() const
 
 inline int32 b2BroadPhase::GetTreeHeight() const
 {
-	return m_tree.GetHeight();
+	return m_type == b2_dynamicTreeBroadPhase ? m_tree.GetHeight() : 0;
 }
 
 inline int32 b2BroadPhase::GetTreeBalance() const
 {
-	return m_tree.GetMaxBalance();
+	return m_type == b2_dynamicTreeBroadPhase ? m_tree.GetMaxBalance() : 0;
 }
 
 inline float32 b2BroadPhase::GetTreeQuality() const
 {
-	return m_tree.GetAreaRatio();
+	return m_type == b2_dynamicTreeBroadPhase ? m_tree.GetAreaRatio() : 0.0f;
 }
 
-template <typename T>
-void b2BroadPhase::UpdatePairs(T* callback)
+inline void b2BroadPhase::BeginBulkInsert()
 {
-	// Reset pair buffer
-	m_pairCount = 0;
-
-	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
+	if (m_type == b2_sweepAndPruneBroadPhase)
 	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
-		{
-			continue;
-		}
-
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
-
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+		m_sap.BeginBulkInsert();
+	}
+	else
+	{
+		m_tree.BeginBulkInsert();
 	}
+}
 
-	// Reset move buffer
-	m_moveCount = 0;
+inline void b2BroadPhase::EndBulkInsert()
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.EndBulkInsert();
+	}
+	else
+	{
+		m_tree.EndBulkInsert();
+	}
+}
 
-	// Sort the pair buffer to expose duplicates.
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
+template <typename T>
+void b2BroadPhase::UpdatePairs(T* callback)
+{
+	FindPairs();
 
 	// Send the pairs back to the client.
-	int32 i = 0;
-	while (i < m_pairCount)
+	for (int32 i = 0; i < m_pairCount; ++i)
 	{
-		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		const b2Pair* pair = m_pairBuffer + i;
+		void* userDataA = GetUserData(pair->proxyIdA);
+		void* userDataB = GetUserData(pair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
-		++i;
-
-		// Skip any duplicate pairs.
-		while (i < m_pairCount)
-		{
-			b2Pair* pair = m_pairBuffer + i;
-			if (pair->proxyIdA != primaryPair->proxyIdA || pair->proxyIdB != primaryPair->proxyIdB)
-			{
-				break;
-			}
-			++i;
-		}
 	}
 
 	// Try to keep the tree balanced.
@@ -236,13 +362,40 @@ void b2BroadPhase::UpdatePairs(T* callback)
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
-	m_tree.Query(callback, aabb);
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.Query(callback, aabb);
+	}
+	else
+	{
+		m_tree.Query(callback, aabb);
+	}
+}
+
+template <typename T>
+inline void b2BroadPhase::QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const
+{
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.QueryBatch(callback, aabbs, count);
+	}
+	else
+	{
+		m_tree.QueryBatch(callback, aabbs, count);
+	}
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	m_tree.RayCast(callback, input);
+	if (m_type == b2_sweepAndPruneBroadPhase)
+	{
+		m_sap.RayCast(callback, input);
+	}
+	else
+	{
+		m_tree.RayCast(callback, input);
+	}
 }
 
 #endif
@@ -23,7 +23,8 @@
 #include "b2PolygonShape.h"
 
 // GJK using Voronoi regions (Christer Ericson) and Barycentric coordinates.
-int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
+// The iteration count is reported in b2DistanceOutput rather than global counters,
+// so b2Distance can be called from several threads at once.
 
 void b2DistanceProxy::Set(const b2Shape* shape, int32 index)
 {
@@ -444,8 +445,6 @@ void b2Distance(b2DistanceOutput* output,
 				b2SimplexCache* cache,
 				const b2DistanceInput* input)
 {
-	++b2_gjkCalls;
-
 	const b2DistanceProxy* proxyA = &input->proxyA;
 	const b2DistanceProxy* proxyB = &input->proxyB;
 
@@ -541,7 +540,6 @@ void b2Distance(b2DistanceOutput* output,
 
 		// Iteration count is equated to the number of support point calls.
 		++iter;
-		++b2_gjkIters;
 
 		// Check for duplicate support points. This is the main termination criteria.
 		bool duplicate = false;
@@ -564,8 +562,6 @@ void b2Distance(b2DistanceOutput* output,
 		++simplex.m_count;
 	}
 
-	b2_gjkMaxIters = b2Max(b2_gjkMaxIters, iter);
-
 	// Prepare output.
 	simplex.GetWitnessPoints(&output->pointA, &output->pointB);
 	output->distance = b2Distance(output->pointA, output->pointB);
@@ -17,6 +17,7 @@
 */
 
 #include "b2DynamicTree.h"
+#include "b2Snapshot.h"
 #include <cstring>
 #include <cfloat>
 using namespace std;
@@ -24,69 +25,210 @@ using namespace std;
 
 b2DynamicTree::b2DynamicTree()
 {
-	m_root = b2_nullNode;
-
 	m_nodeCapacity = 16;
-	m_nodeCount = 0;
 	m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
-	memset(m_nodes, 0, m_nodeCapacity * sizeof(b2TreeNode));
+	m_nodeInfo = (b2TreeNodeInfo*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNodeInfo));
+	Reset();
+
+	m_path = 0;
+
+	m_bulkInsert = false;
+}
+
+b2DynamicTree::~b2DynamicTree()
+{
+	// This frees the entire tree in one shot.
+	b2Free(m_nodes);
+	b2Free(m_nodeInfo);
+}
+
+void b2DynamicTree::Reset()
+{
+	m_root = b2_nullNode;
+	m_nodeCount = 0;
 
 	// Build a linked list for the free list.
-	for (int32 i = 0; i < m_nodeCapacity - 1; ++i)
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
-		m_nodes[i].next = i + 1;
-		m_nodes[i].height = -1;
+		m_nodes[i] = b2TreeNode();
+		m_nodeInfo[i] = b2TreeNodeInfo();
+		m_nodeInfo[i].next = i + 1;
+		m_nodeInfo[i].height = -1;
 	}
-	m_nodes[m_nodeCapacity-1].next = b2_nullNode;
-	m_nodes[m_nodeCapacity-1].height = -1;
+	m_nodeInfo[m_nodeCapacity-1].next = b2_nullNode;
 	m_freeList = 0;
 
-	m_path = 0;
-
 	m_insertionCount = 0;
 }
 
-b2DynamicTree::~b2DynamicTree()
+void b2DynamicTree::Reserve(int32 nodeCount)
 {
-	// This frees the entire tree in one shot.
-	b2Free(m_nodes);
+	if (nodeCount <= m_nodeCapacity)
+	{
+		return;
+	}
+
+	// Rebuild a bigger pool. Free nodes can be anywhere, so copy them all.
+	int32 oldCapacity = m_nodeCapacity;
+	b2TreeNode* oldNodes = m_nodes;
+	b2TreeNodeInfo* oldNodeInfo = m_nodeInfo;
+	m_nodeCapacity = nodeCount;
+	m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	memcpy(m_nodes, oldNodes, oldCapacity * sizeof(b2TreeNode));
+	b2Free(oldNodes);
+	m_nodeInfo = (b2TreeNodeInfo*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNodeInfo));
+	memcpy(m_nodeInfo, oldNodeInfo, oldCapacity * sizeof(b2TreeNodeInfo));
+	b2Free(oldNodeInfo);
+
+	// Put the new nodes in front of the free list. The parent
+	// pointer becomes the "next" pointer.
+	for (int32 i = oldCapacity; i < m_nodeCapacity - 1; ++i)
+	{
+		m_nodeInfo[i].next = i + 1;
+		m_nodeInfo[i].height = -1;
+	}
+	m_nodeInfo[m_nodeCapacity-1].next = m_freeList;
+	m_nodeInfo[m_nodeCapacity-1].height = -1;
+	m_freeList = oldCapacity;
 }
 
-// Allocate a node from the pool. Grow the pool if necessary.
-int32 b2DynamicTree::AllocateNode()
+void b2DynamicTree::SaveState(b2Snapshot* snapshot) const
 {
-	// Expand the node pool as needed.
+	snapshot->Write(m_nodeCapacity);
+	snapshot->Write(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+	snapshot->Write(m_nodeInfo, m_nodeCapacity * sizeof(b2TreeNodeInfo));
+	snapshot->Write(m_root);
+	snapshot->Write(m_nodeCount);
+	snapshot->Write(m_freeList);
+	snapshot->Write(m_path);
+	snapshot->Write(m_insertionCount);
+	snapshot->Write(m_bulkInsert);
+}
+
+void b2DynamicTree::RestoreState(b2SnapshotReader* reader)
+{
+	int32 capacity = reader->Read<int32>();
+	if (capacity <= 0)
+	{
+		reader->Fail();
+		return;
+	}
+
+	Reserve(capacity);
+	reader->Read(m_nodes, capacity * sizeof(b2TreeNode));
+	reader->Read(m_nodeInfo, capacity * sizeof(b2TreeNodeInfo));
+	m_root = reader->Read<int32>();
+	m_nodeCount = reader->Read<int32>();
+	m_freeList = reader->Read<int32>();
+	m_path = reader->Read<uint32>();
+	m_insertionCount = reader->Read<int32>();
+	m_bulkInsert = reader->Read<bool>();
+
+	if (capacity == m_nodeCapacity)
+	{
+		return;
+	}
+
+	// The saved tree grows by handing out the nodes past its capacity in
+	// order once its free list runs out, so they go after the free list.
+	for (int32 i = capacity; i < m_nodeCapacity; ++i)
+	{
+		m_nodeInfo[i].next = i + 1 < m_nodeCapacity ? i + 1 : b2_nullNode;
+		m_nodeInfo[i].height = -1;
+	}
+
 	if (m_freeList == b2_nullNode)
 	{
-		b2Assert(m_nodeCount == m_nodeCapacity);
+		m_freeList = capacity;
+		return;
+	}
 
-		// The free list is empty. Rebuild a bigger pool.
-		b2TreeNode* oldNodes = m_nodes;
-		m_nodeCapacity *= 2;
-		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
-		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(b2TreeNode));
-		b2Free(oldNodes);
+	int32 last = m_freeList;
+	while (m_nodeInfo[last].next != b2_nullNode)
+	{
+		last = m_nodeInfo[last].next;
+	}
+	m_nodeInfo[last].next = capacity;
+}
 
-		// Build a linked list for the free list. The parent
-		// pointer becomes the "next" pointer.
-		for (int32 i = m_nodeCount; i < m_nodeCapacity - 1; ++i)
+// Allocate a node from the pool. Grow the pool if necessary.
+static bool b2IsNodeIndex(int32 index, int32 capacity)
+{
+	return b2_nullNode <= index && index < capacity;
+}
+
+int32 b2DynamicTree::CheckState(b2SnapshotReader* reader)
+{
+	int32 capacity = reader->Read<int32>();
+	if (capacity <= 0 || capacity > INT_MAX / (int32)(sizeof(b2TreeNode) + sizeof(b2TreeNodeInfo)))
+	{
+		reader->Fail();
+		return 0;
+	}
+
+	// A node a pool grew by is never written before it is allocated, so the
+	// children of a free node are not looked at.
+	b2SnapshotReader nodes = *reader;
+	reader->Skip(capacity * (int32)sizeof(b2TreeNode));
+	int32 infoStart = reader->GetPosition();
+	for (int32 i = 0; i < capacity && reader->HasFailed() == false; ++i)
+	{
+		b2TreeNode node = nodes.Read<b2TreeNode>();
+		b2TreeNodeInfo info = reader->Read<b2TreeNodeInfo>();
+		if (b2IsNodeIndex(info.next, capacity) == false ||
+			(info.height >= 0 && (b2IsNodeIndex(node.child1, capacity) == false || b2IsNodeIndex(node.child2, capacity) == false)))
 		{
-			m_nodes[i].next = i + 1;
-			m_nodes[i].height = -1;
+			reader->Fail();
 		}
-		m_nodes[m_nodeCapacity-1].next = b2_nullNode;
-		m_nodes[m_nodeCapacity-1].height = -1;
-		m_freeList = m_nodeCount;
+	}
+
+	int32 root = reader->Read<int32>();
+	int32 nodeCount = reader->Read<int32>();
+	int32 freeList = reader->Read<int32>();
+	reader->Read<uint32>();
+	reader->Read<int32>();
+	reader->Read<bool>();
+	if (b2IsNodeIndex(root, capacity) == false || nodeCount < 0 || nodeCount > capacity || b2IsNodeIndex(freeList, capacity) == false)
+	{
+		reader->Fail();
+	}
+
+	// RestoreState walks the free list to its end.
+	b2SnapshotReader infos = *reader;
+	int32 freeCount = 0;
+	for (int32 i = freeList; i != b2_nullNode && reader->HasFailed() == false; ++freeCount)
+	{
+		if (freeCount == capacity)
+		{
+			reader->Fail();
+			break;
+		}
+
+		infos.SetPosition(infoStart + i * (int32)sizeof(b2TreeNodeInfo));
+		i = infos.Read<b2TreeNodeInfo>().next;
+	}
+
+	return capacity;
+}
+
+int32 b2DynamicTree::AllocateNode()
+{
+	// Expand the node pool as needed.
+	if (m_freeList == b2_nullNode)
+	{
+		b2Assert(m_nodeCount == m_nodeCapacity);
+		Reserve(2 * m_nodeCapacity);
 	}
 
 	// Peel a node off the free list.
 	int32 nodeId = m_freeList;
-	m_freeList = m_nodes[nodeId].next;
-	m_nodes[nodeId].parent = b2_nullNode;
+	m_freeList = m_nodeInfo[nodeId].next;
+	m_nodeInfo[nodeId].parent = b2_nullNode;
 	m_nodes[nodeId].child1 = b2_nullNode;
 	m_nodes[nodeId].child2 = b2_nullNode;
-	m_nodes[nodeId].height = 0;
-	m_nodes[nodeId].userData = NULL;
+	m_nodeInfo[nodeId].height = 0;
+	m_nodeInfo[nodeId].userData = NULL;
+	m_nodeInfo[nodeId].moved = false;
 	++m_nodeCount;
 	return nodeId;
 }
@@ -96,8 +238,8 @@ void b2DynamicTree::FreeNode(int32 nodeId)
 {
 	b2Assert(0 <= nodeId && nodeId < m_nodeCapacity);
 	b2Assert(0 < m_nodeCount);
-	m_nodes[nodeId].next = m_freeList;
-	m_nodes[nodeId].height = -1;
+	m_nodeInfo[nodeId].next = m_freeList;
+	m_nodeInfo[nodeId].height = -1;
 	m_freeList = nodeId;
 	--m_nodeCount;
 }
@@ -113,10 +255,14 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
 	m_nodes[proxyId].aabb.lowerBound = aabb.lowerBound - r;
 	m_nodes[proxyId].aabb.upperBound = aabb.upperBound + r;
-	m_nodes[proxyId].userData = userData;
-	m_nodes[proxyId].height = 0;
+	m_nodeInfo[proxyId].userData = userData;
+	m_nodeInfo[proxyId].height = 0;
 
-	InsertLeaf(proxyId);
+	// During a bulk insert the leaf stays detached until EndBulkInsert.
+	if (m_bulkInsert == false)
+	{
+		InsertLeaf(proxyId);
+	}
 
 	return proxyId;
 }
@@ -126,7 +272,12 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
 	b2Assert(m_nodes[proxyId].IsLeaf());
 
-	RemoveLeaf(proxyId);
+	// A leaf still pending from a bulk insert has no parent and isn't the root.
+	bool pending = m_nodeInfo[proxyId].parent == b2_nullNode && proxyId != m_root;
+	if (pending == false)
+	{
+		RemoveLeaf(proxyId);
+	}
 	FreeNode(proxyId);
 }
 
@@ -141,7 +292,11 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		return false;
 	}
 
-	RemoveLeaf(proxyId);
+	bool pending = m_nodeInfo[proxyId].parent == b2_nullNode && proxyId != m_root;
+	if (pending == false)
+	{
+		RemoveLeaf(proxyId);
+	}
 
 	// Extend AABB.
 	b2AABB b = aabb;
@@ -172,7 +327,10 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 
 	m_nodes[proxyId].aabb = b;
 
-	InsertLeaf(proxyId);
+	if (pending == false)
+	{
+		InsertLeaf(proxyId);
+	}
 	return true;
 }
 
@@ -183,7 +341,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	if (m_root == b2_nullNode)
 	{
 		m_root = leaf;
-		m_nodes[m_root].parent = b2_nullNode;
+		m_nodeInfo[m_root].parent = b2_nullNode;
 		return;
 	}
 
@@ -261,12 +419,12 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	int32 sibling = index;
 
 	// Create a new parent.
-	int32 oldParent = m_nodes[sibling].parent;
+	int32 oldParent = m_nodeInfo[sibling].parent;
 	int32 newParent = AllocateNode();
-	m_nodes[newParent].parent = oldParent;
-	m_nodes[newParent].userData = NULL;
+	m_nodeInfo[newParent].parent = oldParent;
+	m_nodeInfo[newParent].userData = NULL;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodeInfo[newParent].height = m_nodeInfo[sibling].height + 1;
 
 	if (oldParent != b2_nullNode)
 	{
@@ -282,21 +440,21 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 
 		m_nodes[newParent].child1 = sibling;
 		m_nodes[newParent].child2 = leaf;
-		m_nodes[sibling].parent = newParent;
-		m_nodes[leaf].parent = newParent;
+		m_nodeInfo[sibling].parent = newParent;
+		m_nodeInfo[leaf].parent = newParent;
 	}
 	else
 	{
 		// The sibling was the root.
 		m_nodes[newParent].child1 = sibling;
 		m_nodes[newParent].child2 = leaf;
-		m_nodes[sibling].parent = newParent;
-		m_nodes[leaf].parent = newParent;
+		m_nodeInfo[sibling].parent = newParent;
+		m_nodeInfo[leaf].parent = newParent;
 		m_root = newParent;
 	}
 
 	// Walk back up the tree fixing heights and AABBs
-	index = m_nodes[leaf].parent;
+	index = m_nodeInfo[leaf].parent;
 	while (index != b2_nullNode)
 	{
 		index = Balance(index);
@@ -307,10 +465,10 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 		b2Assert(child1 != b2_nullNode);
 		b2Assert(child2 != b2_nullNode);
 
-		m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+		m_nodeInfo[index].height = 1 + b2Max(m_nodeInfo[child1].height, m_nodeInfo[child2].height);
 		m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
 
-		index = m_nodes[index].parent;
+		index = m_nodeInfo[index].parent;
 	}
 
 	//Validate();
@@ -324,8 +482,8 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 		return;
 	}
 
-	int32 parent = m_nodes[leaf].parent;
-	int32 grandParent = m_nodes[parent].parent;
+	int32 parent = m_nodeInfo[leaf].parent;
+	int32 grandParent = m_nodeInfo[parent].parent;
 	int32 sibling;
 	if (m_nodes[parent].child1 == leaf)
 	{
@@ -347,7 +505,7 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 		{
 			m_nodes[grandParent].child2 = sibling;
 		}
-		m_nodes[sibling].parent = grandParent;
+		m_nodeInfo[sibling].parent = grandParent;
 		FreeNode(parent);
 
 		// Adjust ancestor bounds.
@@ -360,15 +518,15 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 			int32 child2 = m_nodes[index].child2;
 
 			m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
-			m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+			m_nodeInfo[index].height = 1 + b2Max(m_nodeInfo[child1].height, m_nodeInfo[child2].height);
 
-			index = m_nodes[index].parent;
+			index = m_nodeInfo[index].parent;
 		}
 	}
 	else
 	{
 		m_root = sibling;
-		m_nodes[sibling].parent = b2_nullNode;
+		m_nodeInfo[sibling].parent = b2_nullNode;
 		FreeNode(parent);
 	}
 
@@ -382,7 +540,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 	b2Assert(iA != b2_nullNode);
 
 	b2TreeNode* A = m_nodes + iA;
-	if (A->IsLeaf() || A->height < 2)
+	b2TreeNodeInfo* infoA = m_nodeInfo + iA;
+	if (A->IsLeaf() || infoA->height < 2)
 	{
 		return iA;
 	}
@@ -394,8 +553,10 @@ int32 b2DynamicTree::Balance(int32 iA)
 
 	b2TreeNode* B = m_nodes + iB;
 	b2TreeNode* C = m_nodes + iC;
+	b2TreeNodeInfo* infoB = m_nodeInfo + iB;
+	b2TreeNodeInfo* infoC = m_nodeInfo + iC;
 
-	int32 balance = C->height - B->height;
+	int32 balance = infoC->height - infoB->height;
 
 	// Rotate C up
 	if (balance > 1)
@@ -404,25 +565,27 @@ int32 b2DynamicTree::Balance(int32 iA)
 		int32 iG = C->child2;
 		b2TreeNode* F = m_nodes + iF;
 		b2TreeNode* G = m_nodes + iG;
+		b2TreeNodeInfo* infoF = m_nodeInfo + iF;
+		b2TreeNodeInfo* infoG = m_nodeInfo + iG;
 		b2Assert(0 <= iF && iF < m_nodeCapacity);
 		b2Assert(0 <= iG && iG < m_nodeCapacity);
 
 		// Swap A and C
 		C->child1 = iA;
-		C->parent = A->parent;
-		A->parent = iC;
+		infoC->parent = infoA->parent;
+		infoA->parent = iC;
 
 		// A's old parent should point to C
-		if (C->parent != b2_nullNode)
+		if (infoC->parent != b2_nullNode)
 		{
-			if (m_nodes[C->parent].child1 == iA)
+			if (m_nodes[infoC->parent].child1 == iA)
 			{
-				m_nodes[C->parent].child1 = iC;
+				m_nodes[infoC->parent].child1 = iC;
 			}
 			else
 			{
-				b2Assert(m_nodes[C->parent].child2 == iA);
-				m_nodes[C->parent].child2 = iC;
+				b2Assert(m_nodes[infoC->parent].child2 == iA);
+				m_nodes[infoC->parent].child2 = iC;
 			}
 		}
 		else
@@ -431,27 +594,27 @@ int32 b2DynamicTree::Balance(int32 iA)
 		}
 
 		// Rotate
-		if (F->height > G->height)
+		if (infoF->height > infoG->height)
 		{
 			C->child2 = iF;
 			A->child2 = iG;
-			G->parent = iA;
+			infoG->parent = iA;
 			A->aabb.Combine(B->aabb, G->aabb);
 			C->aabb.Combine(A->aabb, F->aabb);
 
-			A->height = 1 + b2Max(B->height, G->height);
-			C->height = 1 + b2Max(A->height, F->height);
+			infoA->height = 1 + b2Max(infoB->height, infoG->height);
+			infoC->height = 1 + b2Max(infoA->height, infoF->height);
 		}
 		else
 		{
 			C->child2 = iG;
 			A->child2 = iF;
-			F->parent = iA;
+			infoF->parent = iA;
 			A->aabb.Combine(B->aabb, F->aabb);
 			C->aabb.Combine(A->aabb, G->aabb);
 
-			A->height = 1 + b2Max(B->height, F->height);
-			C->height = 1 + b2Max(A->height, G->height);
+			infoA->height = 1 + b2Max(infoB->height, infoF->height);
+			infoC->height = 1 + b2Max(infoA->height, infoG->height);
 		}
 
 		return iC;
@@ -464,25 +627,27 @@ int32 b2DynamicTree::Balance(int32 iA)
 		int32 iE = B->child2;
 		b2TreeNode* D = m_nodes + iD;
 		b2TreeNode* E = m_nodes + iE;
+		b2TreeNodeInfo* infoD = m_nodeInfo + iD;
+		b2TreeNodeInfo* infoE = m_nodeInfo + iE;
 		b2Assert(0 <= iD && iD < m_nodeCapacity);
 		b2Assert(0 <= iE && iE < m_nodeCapacity);
 
 		// Swap A and B
 		B->child1 = iA;
-		B->parent = A->parent;
-		A->parent = iB;
+		infoB->parent = infoA->parent;
+		infoA->parent = iB;
 
 		// A's old parent should point to B
-		if (B->parent != b2_nullNode)
+		if (infoB->parent != b2_nullNode)
 		{
-			if (m_nodes[B->parent].child1 == iA)
+			if (m_nodes[infoB->parent].child1 == iA)
 			{
-				m_nodes[B->parent].child1 = iB;
+				m_nodes[infoB->parent].child1 = iB;
 			}
 			else
 			{
-				b2Assert(m_nodes[B->parent].child2 == iA);
-				m_nodes[B->parent].child2 = iB;
+				b2Assert(m_nodes[infoB->parent].child2 == iA);
+				m_nodes[infoB->parent].child2 = iB;
 			}
 		}
 		else
@@ -491,27 +656,27 @@ int32 b2DynamicTree::Balance(int32 iA)
 		}
 
 		// Rotate
-		if (D->height > E->height)
+		if (infoD->height > infoE->height)
 		{
 			B->child2 = iD;
 			A->child1 = iE;
-			E->parent = iA;
+			infoE->parent = iA;
 			A->aabb.Combine(C->aabb, E->aabb);
 			B->aabb.Combine(A->aabb, D->aabb);
 
-			A->height = 1 + b2Max(C->height, E->height);
-			B->height = 1 + b2Max(A->height, D->height);
+			infoA->height = 1 + b2Max(infoC->height, infoE->height);
+			infoB->height = 1 + b2Max(infoA->height, infoD->height);
 		}
 		else
 		{
 			B->child2 = iE;
 			A->child1 = iD;
-			D->parent = iA;
+			infoD->parent = iA;
 			A->aabb.Combine(C->aabb, D->aabb);
 			B->aabb.Combine(A->aabb, E->aabb);
 
-			A->height = 1 + b2Max(C->height, D->height);
-			B->height = 1 + b2Max(A->height, E->height);
+			infoA->height = 1 + b2Max(infoC->height, infoD->height);
+			infoB->height = 1 + b2Max(infoA->height, infoE->height);
 		}
 
 		return iB;
@@ -527,7 +692,7 @@ int32 b2DynamicTree::GetHeight() const
 		return 0;
 	}
 
-	return m_nodes[m_root].height;
+	return m_nodeInfo[m_root].height;
 }
 
 //
@@ -544,14 +709,13 @@ float32 b2DynamicTree::GetAreaRatio() const
 	float32 totalArea = 0.0f;
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
-		const b2TreeNode* node = m_nodes + i;
-		if (node->height < 0)
+		if (m_nodeInfo[i].height < 0)
 		{
 			// Free node in pool
 			continue;
 		}
 
-		totalArea += node->aabb.GetPerimeter();
+		totalArea += m_nodes[i].aabb.GetPerimeter();
 	}
 
 	return totalArea / rootArea;
@@ -588,7 +752,7 @@ void b2DynamicTree::ValidateStructure(int32 index) const
 
 	if (index == m_root)
 	{
-		b2Assert(m_nodes[index].parent == b2_nullNode);
+		b2Assert(m_nodeInfo[index].parent == b2_nullNode);
 	}
 
 	const b2TreeNode* node = m_nodes + index;
@@ -600,15 +764,15 @@ void b2DynamicTree::ValidateStructure(int32 index) const
 	{
 		b2Assert(child1 == b2_nullNode);
 		b2Assert(child2 == b2_nullNode);
-		b2Assert(node->height == 0);
+		b2Assert(m_nodeInfo[index].height == 0);
 		return;
 	}
 
 	b2Assert(0 <= child1 && child1 < m_nodeCapacity);
 	b2Assert(0 <= child2 && child2 < m_nodeCapacity);
 
-	b2Assert(m_nodes[child1].parent == index);
-	b2Assert(m_nodes[child2].parent == index);
+	b2Assert(m_nodeInfo[child1].parent == index);
+	b2Assert(m_nodeInfo[child2].parent == index);
 
 	ValidateStructure(child1);
 	ValidateStructure(child2);
@@ -630,18 +794,18 @@ void b2DynamicTree::ValidateMetrics(int32 index) const
 	{
 		b2Assert(child1 == b2_nullNode);
 		b2Assert(child2 == b2_nullNode);
-		b2Assert(node->height == 0);
+		b2Assert(m_nodeInfo[index].height == 0);
 		return;
 	}
 
 	b2Assert(0 <= child1 && child1 < m_nodeCapacity);
 	b2Assert(0 <= child2 && child2 < m_nodeCapacity);
 
-	int32 height1 = m_nodes[child1].height;
-	int32 height2 = m_nodes[child2].height;
+	int32 height1 = m_nodeInfo[child1].height;
+	int32 height2 = m_nodeInfo[child2].height;
 	int32 height;
 	height = 1 + b2Max(height1, height2);
-	b2Assert(node->height == height);
+	b2Assert(m_nodeInfo[index].height == height);
 
 	b2AABB aabb;
 	aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
@@ -663,7 +827,7 @@ void b2DynamicTree::Validate() const
 	while (freeIndex != b2_nullNode)
 	{
 		b2Assert(0 <= freeIndex && freeIndex < m_nodeCapacity);
-		freeIndex = m_nodes[freeIndex].next;
+		freeIndex = m_nodeInfo[freeIndex].next;
 		++freeCount;
 	}
 
@@ -678,7 +842,7 @@ int32 b2DynamicTree::GetMaxBalance() const
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
 		const b2TreeNode* node = m_nodes + i;
-		if (node->height <= 1)
+		if (m_nodeInfo[i].height <= 1)
 		{
 			continue;
 		}
@@ -687,7 +851,7 @@ int32 b2DynamicTree::GetMaxBalance() const
 
 		int32 child1 = node->child1;
 		int32 child2 = node->child2;
-		int32 balance = b2Abs(m_nodes[child2].height - m_nodes[child1].height);
+		int32 balance = b2Abs(m_nodeInfo[child2].height - m_nodeInfo[child1].height);
 		maxBalance = b2Max(maxBalance, balance);
 	}
 
@@ -702,7 +866,7 @@ void b2DynamicTree::RebuildBottomUp()
 	// Build array of leaves. Free the rest.
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
-		if (m_nodes[i].height < 0)
+		if (m_nodeInfo[i].height < 0)
 		{
 			// free node in pool
 			continue;
@@ -710,7 +874,7 @@ void b2DynamicTree::RebuildBottomUp()
 
 		if (m_nodes[i].IsLeaf())
 		{
-			m_nodes[i].parent = b2_nullNode;
+			m_nodeInfo[i].parent = b2_nullNode;
 			nodes[count] = i;
 			++count;
 		}
@@ -752,12 +916,12 @@ void b2DynamicTree::RebuildBottomUp()
 		b2TreeNode* parent = m_nodes + parentIndex;
 		parent->child1 = index1;
 		parent->child2 = index2;
-		parent->height = 1 + b2Max(child1->height, child2->height);
 		parent->aabb.Combine(child1->aabb, child2->aabb);
-		parent->parent = b2_nullNode;
+		m_nodeInfo[parentIndex].height = 1 + b2Max(m_nodeInfo[index1].height, m_nodeInfo[index2].height);
+		m_nodeInfo[parentIndex].parent = b2_nullNode;
 
-		child1->parent = parentIndex;
-		child2->parent = parentIndex;
+		m_nodeInfo[index1].parent = parentIndex;
+		m_nodeInfo[index2].parent = parentIndex;
 
 		nodes[jMin] = nodes[count-1];
 		nodes[iMin] = parentIndex;
@@ -769,3 +933,224 @@ void b2DynamicTree::RebuildBottomUp()
 
 	Validate();
 }
+
+void b2DynamicTree::BeginBulkInsert()
+{
+	m_bulkInsert = true;
+}
+
+void b2DynamicTree::EndBulkInsert()
+{
+	if (m_bulkInsert == false)
+	{
+		return;
+	}
+
+	m_bulkInsert = false;
+	RebuildTopDown();
+}
+
+void b2DynamicTree::RebuildTopDown()
+{
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Collect the leaves, including ones pending from a bulk insert. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodeInfo[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodeInfo[i].parent = b2_nullNode;
+			leaves[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count == 0)
+	{
+		m_root = b2_nullNode;
+		b2Free(leaves);
+		return;
+	}
+
+	b2Vec2* centers = (b2Vec2*)b2Alloc(count * sizeof(b2Vec2));
+	for (int32 i = 0; i < count; ++i)
+	{
+		centers[i] = m_nodes[leaves[i]].aabb.GetCenter();
+	}
+
+	m_root = BuildTopDown(leaves, centers, count);
+	m_nodeInfo[m_root].parent = b2_nullNode;
+
+	b2Free(centers);
+	b2Free(leaves);
+
+	Validate();
+}
+
+// Split the leaves on the axis where their centers spread the most. Centers
+// are binned and the split between bins with the lowest perimeter cost wins.
+// Returns the subtree root.
+int32 b2DynamicTree::BuildTopDown(int32* leaves, b2Vec2* centers, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	enum { e_binCount = 16 };
+
+	b2Vec2 lower = centers[0];
+	b2Vec2 upper = centers[0];
+	for (int32 i = 1; i < count; ++i)
+	{
+		lower = b2Min(lower, centers[i]);
+		upper = b2Max(upper, centers[i]);
+	}
+
+	b2Vec2 extent = upper - lower;
+	int32 axis = extent.x >= extent.y ? 0 : 1;
+	float32 axisLower = axis == 0 ? lower.x : lower.y;
+	float32 axisExtent = axis == 0 ? extent.x : extent.y;
+
+	int32 splitCount = count / 2;
+	if (axisExtent > b2_epsilon)
+	{
+		float32 scale = e_binCount / axisExtent;
+
+		b2AABB binAABBs[e_binCount];
+		int32 binCounts[e_binCount];
+		for (int32 i = 0; i < e_binCount; ++i)
+		{
+			binCounts[i] = 0;
+		}
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			float32 value = axis == 0 ? centers[i].x : centers[i].y;
+			int32 bin = b2Min(int32((value - axisLower) * scale), int32(e_binCount - 1));
+			const b2AABB& aabb = m_nodes[leaves[i]].aabb;
+			if (binCounts[bin] == 0)
+			{
+				binAABBs[bin] = aabb;
+			}
+			else
+			{
+				binAABBs[bin].Combine(aabb);
+			}
+			++binCounts[bin];
+		}
+
+		// Sweep from the right to get the cost of everything above each split.
+		float32 rightCosts[e_binCount];
+		b2AABB right;
+		right.lowerBound.SetZero();
+		right.upperBound.SetZero();
+		int32 rightCount = 0;
+		for (int32 i = e_binCount - 1; i > 0; --i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (rightCount == 0)
+				{
+					right = binAABBs[i];
+				}
+				else
+				{
+					right.Combine(binAABBs[i]);
+				}
+				rightCount += binCounts[i];
+			}
+			rightCosts[i] = rightCount > 0 ? rightCount * right.GetPerimeter() : 0.0f;
+		}
+
+		float32 bestCost = b2_maxFloat;
+		int32 bestBin = -1;
+		b2AABB left;
+		left.lowerBound.SetZero();
+		left.upperBound.SetZero();
+		int32 leftCount = 0;
+		for (int32 i = 0; i < e_binCount - 1; ++i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (leftCount == 0)
+				{
+					left = binAABBs[i];
+				}
+				else
+				{
+					left.Combine(binAABBs[i]);
+				}
+				leftCount += binCounts[i];
+			}
+
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+
+			float32 cost = leftCount * left.GetPerimeter() + rightCosts[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if (bestBin >= 0)
+		{
+			// Partition in place, leaves at or below the split bin go first.
+			int32 i = 0;
+			int32 j = count - 1;
+			while (i <= j)
+			{
+				float32 value = axis == 0 ? centers[i].x : centers[i].y;
+				int32 bin = b2Min(int32((value - axisLower) * scale), int32(e_binCount - 1));
+				if (bin <= bestBin)
+				{
+					++i;
+				}
+				else
+				{
+					b2Swap(leaves[i], leaves[j]);
+					b2Swap(centers[i], centers[j]);
+					--j;
+				}
+			}
+			splitCount = i;
+		}
+	}
+
+	// Every center is in one spot, any even split is as good as another.
+	if (splitCount == 0 || splitCount == count)
+	{
+		splitCount = count / 2;
+	}
+
+	int32 child1 = BuildTopDown(leaves, centers, splitCount);
+	int32 child2 = BuildTopDown(leaves + splitCount, centers + splitCount, count - splitCount);
+
+	int32 parentIndex = AllocateNode();
+	b2TreeNode* parent = m_nodes + parentIndex;
+	parent->child1 = child1;
+	parent->child2 = child2;
+	parent->aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodeInfo[parentIndex].height = 1 + b2Max(m_nodeInfo[child1].height, m_nodeInfo[child2].height);
+	m_nodeInfo[parentIndex].parent = b2_nullNode;
+
+	m_nodeInfo[child1].parent = parentIndex;
+	m_nodeInfo[child2].parent = parentIndex;
+
+	return parentIndex;
+}
@@ -21,10 +21,15 @@
 
 #include "b2Collision.h"
 #include "b2GrowableStack.h"
+#include "b2Simd.h"
+
+class b2Snapshot;
+class b2SnapshotReader;
 
 #define b2_nullNode (-1)
 
 /// A node in the dynamic tree. The client does not interact with this directly.
+/// Only what a query reads lives here, so traversals touch 24 bytes per node.
 struct b2TreeNode
 {
 	bool IsLeaf() const
@@ -35,6 +40,14 @@ struct b2TreeNode
 	/// Enlarged AABB
 	b2AABB aabb;
 
+	int32 child1;
+	int32 child2;
+};
+
+/// The rest of a node, stored in a parallel array and only touched by
+/// tree updates and by leaf callbacks.
+struct b2TreeNodeInfo
+{
 	void* userData;
 
 	union
@@ -43,11 +56,11 @@ struct b2TreeNode
 		int32 next;
 	};
 
-	int32 child1;
-	int32 child2;
-
 	// leaf = 0, free node = -1
 	int32 height;
+
+	// Set by b2BroadPhase while the proxy is in its move buffer.
+	bool moved;
 };
 
 /// A dynamic AABB tree broad-phase, inspired by Nathanael Presson's btDbvt.
@@ -67,6 +80,27 @@ public:
 	/// Destroy the tree, freeing the node pool.
 	~b2DynamicTree();
 
+	/// Remove every proxy at once. The node pool keeps its capacity.
+	void Reset();
+
+	/// Grow the node pool to hold at least this many nodes. A tree of n
+	/// proxies uses 2n - 1 nodes.
+	void Reserve(int32 nodeCount);
+
+	/// Write the whole node pool. The user data is written as is, see
+	/// b2World::SaveState.
+	void SaveState(b2Snapshot* snapshot) const;
+
+	/// Read a node pool written by SaveState. Proxy ids are kept, and the
+	/// proxies created afterwards get the ids they would have got in the
+	/// saved tree, even when this pool is bigger.
+	void RestoreState(b2SnapshotReader* reader);
+
+	/// Read past a node pool written by SaveState without touching a tree.
+	/// The reader fails if a node index is out of the pool or the free list
+	/// doesn't end, as RestoreState trusts both. Returns the saved capacity.
+	static int32 CheckState(b2SnapshotReader* reader);
+
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
@@ -82,15 +116,29 @@ public:
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
+	void SetUserData(int32 proxyId, void* userData);
 
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
+	/// Flag a proxy as moved. The broad-phase uses this to report each
+	/// pair between two moved proxies once. New proxies start unflagged.
+	bool WasMoved(int32 proxyId) const;
+	void SetMoved(int32 proxyId, bool flag);
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query many AABBs in one traversal. Each node is tested against
+	/// b2_simdWidth query boxes at once and subtrees are only skipped when
+	/// no box in the group overlaps them. The callback class is called as
+	/// QueryCallback(queryIndex, proxyId) for each overlap and cannot stop
+	/// the query early. The order of the calls differs from Query.
+	template <typename T>
+	void QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -118,6 +166,18 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build the tree top down from the current leaves using a binned surface
+	/// area heuristic. Proxy ids are kept. This is O(n log n) and gives a
+	/// tighter tree than inserting the leaves one at a time.
+	void RebuildTopDown();
+
+	/// Defer tree insertion of new proxies until EndBulkInsert, which builds
+	/// the whole tree at once with RebuildTopDown. Proxies can be moved and
+	/// destroyed while pending, but the tree cannot be queried.
+	void BeginBulkInsert();
+	void EndBulkInsert();
+	bool IsBulkInsert() const;
+
 private:
 
 	int32 AllocateNode();
@@ -131,12 +191,15 @@ private:
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
+	int32 BuildTopDown(int32* leaves, b2Vec2* centers, int32 count);
+
 	void ValidateStructure(int32 index) const;
 	void ValidateMetrics(int32 index) const;
 
 	int32 m_root;
 
 	b2TreeNode* m_nodes;
+	b2TreeNodeInfo* m_nodeInfo;
 	int32 m_nodeCount;
 	int32 m_nodeCapacity;
 
@@ -146,12 +209,20 @@ private:
 	uint32 m_path;
 
 	int32 m_insertionCount;
+
+	bool m_bulkInsert;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	return m_nodes[proxyId].userData;
+	return m_nodeInfo[proxyId].userData;
+}
+
+inline void b2DynamicTree::SetUserData(int32 proxyId, void* userData)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	m_nodeInfo[proxyId].userData = userData;
 }
 
 inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
@@ -160,9 +231,28 @@ inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 	return m_nodes[proxyId].aabb;
 }
 
+inline bool b2DynamicTree::WasMoved(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	return m_nodeInfo[proxyId].moved;
+}
+
+inline void b2DynamicTree::SetMoved(int32 proxyId, bool flag)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	m_nodeInfo[proxyId].moved = flag;
+}
+
+inline bool b2DynamicTree::IsBulkInsert() const
+{
+	return m_bulkInsert;
+}
+
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 {
+	b2Assert(m_bulkInsert == false);
+
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
 
@@ -195,9 +285,98 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 	}
 }
 
+template <typename T>
+inline void b2DynamicTree::QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const
+{
+	b2Assert(m_bulkInsert == false);
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Each stack entry carries the lanes whose query box overlaps the node's
+	// parent, so a subtree is only tested for the queries that reached it.
+	struct StackEntry
+	{
+		int32 nodeId;
+		int32 mask;
+	};
+
+	for (int32 base = 0; base < count; base += b2_simdWidth)
+	{
+		int32 laneCount = b2Min(count - base, b2_simdWidth);
+
+		// Transpose the group into lanes. Unused lanes get an inverted box
+		// that overlaps nothing.
+		float32 lowerX[b2_simdWidth], lowerY[b2_simdWidth];
+		float32 upperX[b2_simdWidth], upperY[b2_simdWidth];
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			if (lane < laneCount)
+			{
+				const b2AABB& aabb = aabbs[base + lane];
+				lowerX[lane] = aabb.lowerBound.x;
+				lowerY[lane] = aabb.lowerBound.y;
+				upperX[lane] = aabb.upperBound.x;
+				upperY[lane] = aabb.upperBound.y;
+			}
+			else
+			{
+				lowerX[lane] = lowerY[lane] = b2_maxFloat;
+				upperX[lane] = upperY[lane] = -b2_maxFloat;
+			}
+		}
+
+		b2FloatW qLowerX = b2LoadW(lowerX);
+		b2FloatW qLowerY = b2LoadW(lowerY);
+		b2FloatW qUpperX = b2LoadW(upperX);
+		b2FloatW qUpperY = b2LoadW(upperY);
+
+		b2GrowableStack<StackEntry, 256> stack;
+		StackEntry rootEntry = { m_root, (1 << laneCount) - 1 };
+		stack.Push(rootEntry);
+
+		while (stack.GetCount() > 0)
+		{
+			StackEntry entry = stack.Pop();
+			const b2TreeNode* node = m_nodes + entry.nodeId;
+
+			// Same test as b2TestOverlap, for every lane at once.
+			b2FloatW overlap = b2AndW(
+				b2AndW(b2GreaterEqualW(qUpperX, b2SplatW(node->aabb.lowerBound.x)), b2GreaterEqualW(qUpperY, b2SplatW(node->aabb.lowerBound.y))),
+				b2AndW(b2GreaterEqualW(b2SplatW(node->aabb.upperBound.x), qLowerX), b2GreaterEqualW(b2SplatW(node->aabb.upperBound.y), qLowerY)));
+			int32 mask = b2MoveMaskW(overlap) & entry.mask;
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			if (node->IsLeaf())
+			{
+				for (int32 lane = 0; lane < laneCount; ++lane)
+				{
+					if (mask & (1 << lane))
+					{
+						callback->QueryCallback(base + lane, entry.nodeId);
+					}
+				}
+			}
+			else
+			{
+				StackEntry child1 = { node->child1, mask };
+				StackEntry child2 = { node->child2, mask };
+				stack.Push(child1);
+				stack.Push(child2);
+			}
+		}
+	}
+}
+
 template <typename T>
 inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
 {
+	b2Assert(m_bulkInsert == false);
+
 	b2Vec2 p1 = input.p1;
 	b2Vec2 p2 = input.p2;
 	b2Vec2 r = p2 - p1;
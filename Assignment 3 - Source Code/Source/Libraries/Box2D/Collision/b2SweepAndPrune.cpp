@@ -0,0 +1,507 @@
+//
+//  b2SweepAndPrune.cpp
+//  GameDevFramework
+//
+
+#include "b2SweepAndPrune.h"
+#include "b2Snapshot.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+static bool b2SapEntryLessThan(const b2SapEntry& entryA, const b2SapEntry& entryB)
+{
+	return entryA.aabb.lowerBound.x < entryB.aabb.lowerBound.x;
+}
+
+b2SweepAndPrune::b2SweepAndPrune()
+{
+	m_proxyCapacity = 16;
+	m_proxies = (b2SapProxy*)b2Alloc(m_proxyCapacity * sizeof(b2SapProxy));
+
+	m_entryCapacity = 16;
+	m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+
+	m_largeCapacity = 4;
+	m_largeProxies = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+
+	Reset();
+	m_bulkInsert = false;
+}
+
+b2SweepAndPrune::~b2SweepAndPrune()
+{
+	b2Free(m_largeProxies);
+	b2Free(m_entries);
+	b2Free(m_proxies);
+}
+
+void b2SweepAndPrune::Reset()
+{
+	m_proxyCount = 0;
+
+	// Build a linked list for the free list.
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i] = b2SapProxy();
+		m_proxies[i].next = i + 1;
+		m_proxies[i].state = -1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullSapProxy;
+	m_freeList = 0;
+
+	m_entryCount = 0;
+	m_largeCount = 0;
+	m_maxExtent = 0.0f;
+}
+
+void b2SweepAndPrune::Reserve(int32 proxyCount)
+{
+	ReserveProxies(proxyCount);
+
+	if (proxyCount > m_entryCapacity)
+	{
+		b2SapEntry* oldEntries = m_entries;
+		m_entryCapacity = proxyCount;
+		m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+		memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2SapEntry));
+		b2Free(oldEntries);
+	}
+}
+
+void b2SweepAndPrune::ReserveProxies(int32 proxyCount)
+{
+	if (proxyCount <= m_proxyCapacity)
+	{
+		return;
+	}
+
+	int32 oldCapacity = m_proxyCapacity;
+	b2SapProxy* oldProxies = m_proxies;
+	m_proxyCapacity = proxyCount;
+	m_proxies = (b2SapProxy*)b2Alloc(m_proxyCapacity * sizeof(b2SapProxy));
+	memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b2SapProxy));
+	b2Free(oldProxies);
+
+	for (int32 i = oldCapacity; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+		m_proxies[i].state = -1;
+	}
+	m_proxies[m_proxyCapacity-1].next = m_freeList;
+	m_proxies[m_proxyCapacity-1].state = -1;
+	m_freeList = oldCapacity;
+}
+
+void b2SweepAndPrune::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_proxyCapacity);
+	snapshot->Write(m_proxies, m_proxyCapacity * sizeof(b2SapProxy));
+	snapshot->Write(m_proxyCount);
+	snapshot->Write(m_freeList);
+	snapshot->Write(m_entryCount);
+	snapshot->Write(m_entries, m_entryCount * sizeof(b2SapEntry));
+	snapshot->Write(m_largeCount);
+	snapshot->Write(m_largeProxies, m_largeCount * sizeof(int32));
+	snapshot->Write(m_maxExtent);
+	snapshot->Write(m_bulkInsert);
+}
+
+void b2SweepAndPrune::RestoreState(b2SnapshotReader* reader)
+{
+	int32 capacity = reader->Read<int32>();
+	if (capacity <= 0)
+	{
+		reader->Fail();
+		return;
+	}
+
+	ReserveProxies(capacity);
+	reader->Read(m_proxies, capacity * sizeof(b2SapProxy));
+	m_proxyCount = reader->Read<int32>();
+	m_freeList = reader->Read<int32>();
+
+	// Every proxy has an entry or a large slot, so the proxy capacity bounds both.
+	m_entryCount = b2Clamp(reader->Read<int32>(), 0, capacity);
+	if (m_entryCount > m_entryCapacity)
+	{
+		b2Free(m_entries);
+		m_entryCapacity = capacity;
+		m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+	}
+	reader->Read(m_entries, m_entryCount * sizeof(b2SapEntry));
+
+	m_largeCount = b2Clamp(reader->Read<int32>(), 0, capacity);
+	if (m_largeCount > m_largeCapacity)
+	{
+		b2Free(m_largeProxies);
+		m_largeCapacity = capacity;
+		m_largeProxies = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+	}
+	reader->Read(m_largeProxies, m_largeCount * sizeof(int32));
+
+	m_maxExtent = reader->Read<float32>();
+	m_bulkInsert = reader->Read<bool>();
+
+	if (capacity == m_proxyCapacity)
+	{
+		return;
+	}
+
+	// Proxies past the saved capacity go after the saved free list, see
+	// b2DynamicTree::RestoreState.
+	for (int32 i = capacity; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].next = i + 1 < m_proxyCapacity ? i + 1 : b2_nullSapProxy;
+		m_proxies[i].state = -1;
+	}
+
+	if (m_freeList == b2_nullSapProxy)
+	{
+		m_freeList = capacity;
+		return;
+	}
+
+	int32 last = m_freeList;
+	while (m_proxies[last].next != b2_nullSapProxy)
+	{
+		last = m_proxies[last].next;
+	}
+	m_proxies[last].next = capacity;
+}
+
+static bool b2IsSapIndex(int32 index, int32 capacity)
+{
+	return b2_nullSapProxy <= index && index < capacity;
+}
+
+int32 b2SweepAndPrune::CheckState(b2SnapshotReader* reader)
+{
+	int32 capacity = reader->Read<int32>();
+	if (capacity <= 0 || capacity > INT_MAX / (int32)sizeof(b2SapProxy))
+	{
+		reader->Fail();
+		return 0;
+	}
+
+	// Only the links of a free proxy are set, see b2DynamicTree::CheckState.
+	int32 proxyStart = reader->GetPosition();
+	for (int32 i = 0; i < capacity && reader->HasFailed() == false; ++i)
+	{
+		b2SapProxy proxy = reader->Read<b2SapProxy>();
+		if (b2IsSapIndex(proxy.next, capacity) == false || (proxy.state >= 0 && b2IsSapIndex(proxy.largeIndex, capacity) == false))
+		{
+			reader->Fail();
+		}
+	}
+
+	reader->Read<int32>();
+	int32 freeList = reader->Read<int32>();
+	int32 entryCount = reader->Read<int32>();
+	if (b2IsSapIndex(freeList, capacity) == false || entryCount < 0 || entryCount > capacity)
+	{
+		reader->Fail();
+	}
+	for (int32 i = 0; i < entryCount && reader->HasFailed() == false; ++i)
+	{
+		int32 proxyId = reader->Read<b2SapEntry>().proxyId;
+		if (proxyId < 0 || proxyId >= capacity)
+		{
+			reader->Fail();
+		}
+	}
+
+	int32 largeCount = reader->Read<int32>();
+	if (largeCount < 0 || largeCount > capacity)
+	{
+		reader->Fail();
+	}
+	for (int32 i = 0; i < largeCount && reader->HasFailed() == false; ++i)
+	{
+		int32 proxyId = reader->Read<int32>();
+		if (proxyId < 0 || proxyId >= capacity)
+		{
+			reader->Fail();
+		}
+	}
+
+	reader->Read<float32>();
+	reader->Read<bool>();
+
+	// RestoreState walks the free list to its end.
+	b2SnapshotReader proxies = *reader;
+	int32 freeCount = 0;
+	for (int32 i = freeList; i != b2_nullSapProxy && reader->HasFailed() == false; ++freeCount)
+	{
+		if (freeCount == capacity)
+		{
+			reader->Fail();
+			break;
+		}
+
+		proxies.SetPosition(proxyStart + i * (int32)sizeof(b2SapProxy));
+		i = proxies.Read<b2SapProxy>().next;
+	}
+
+	return capacity;
+}
+
+int32 b2SweepAndPrune::AllocateProxy()
+{
+	// Expand the proxy pool as needed.
+	if (m_freeList == b2_nullSapProxy)
+	{
+		b2Assert(m_proxyCount == m_proxyCapacity);
+		ReserveProxies(2 * m_proxyCapacity);
+	}
+
+	int32 proxyId = m_freeList;
+	m_freeList = m_proxies[proxyId].next;
+	m_proxies[proxyId].sortIndex = b2_nullSapProxy;
+	m_proxies[proxyId].largeIndex = b2_nullSapProxy;
+	m_proxies[proxyId].state = 0;
+	m_proxies[proxyId].userData = NULL;
+	m_proxies[proxyId].moved = false;
+	++m_proxyCount;
+	return proxyId;
+}
+
+void b2SweepAndPrune::FreeProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(0 < m_proxyCount);
+	m_proxies[proxyId].next = m_freeList;
+	m_proxies[proxyId].state = -1;
+	m_freeList = proxyId;
+	--m_proxyCount;
+}
+
+int32 b2SweepAndPrune::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	int32 proxyId = AllocateProxy();
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	m_proxies[proxyId].aabb.lowerBound = aabb.lowerBound - r;
+	m_proxies[proxyId].aabb.upperBound = aabb.upperBound + r;
+	m_proxies[proxyId].userData = userData;
+
+	InsertProxy(proxyId);
+
+	return proxyId;
+}
+
+void b2SweepAndPrune::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].state == 0);
+
+	RemoveProxy(proxyId);
+	FreeProxy(proxyId);
+}
+
+bool b2SweepAndPrune::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_proxies[proxyId].state == 0);
+
+	b2SapProxy* proxy = m_proxies + proxyId;
+	if (proxy->aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	// Extend AABB.
+	b2AABB b = aabb;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b.lowerBound = b.lowerBound - r;
+	b.upperBound = b.upperBound + r;
+
+	// Predict AABB displacement.
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+
+	if (d.x < 0.0f)
+	{
+		b.lowerBound.x += d.x;
+	}
+	else
+	{
+		b.upperBound.x += d.x;
+	}
+
+	if (d.y < 0.0f)
+	{
+		b.lowerBound.y += d.y;
+	}
+	else
+	{
+		b.upperBound.y += d.y;
+	}
+
+	bool wasLarge = proxy->largeIndex != b2_nullSapProxy;
+	float32 extent = b.upperBound.x - b.lowerBound.x;
+	bool isLarge = extent > b2_sapLargeExtent;
+	if (wasLarge != isLarge)
+	{
+		RemoveProxy(proxyId);
+		proxy->aabb = b;
+		InsertProxy(proxyId);
+		return true;
+	}
+
+	proxy->aabb = b;
+	if (isLarge == false)
+	{
+		m_maxExtent = b2Max(m_maxExtent, extent);
+		m_entries[proxy->sortIndex].aabb = b;
+		if (m_bulkInsert == false)
+		{
+			SortEntry(proxy->sortIndex);
+		}
+	}
+	return true;
+}
+
+void b2SweepAndPrune::InsertProxy(int32 proxyId)
+{
+	b2SapProxy* proxy = m_proxies + proxyId;
+	float32 extent = proxy->aabb.upperBound.x - proxy->aabb.lowerBound.x;
+	if (extent > b2_sapLargeExtent)
+	{
+		if (m_largeCount == m_largeCapacity)
+		{
+			int32* oldLarge = m_largeProxies;
+			m_largeCapacity *= 2;
+			m_largeProxies = (int32*)b2Alloc(m_largeCapacity * sizeof(int32));
+			memcpy(m_largeProxies, oldLarge, m_largeCount * sizeof(int32));
+			b2Free(oldLarge);
+		}
+
+		proxy->largeIndex = m_largeCount;
+		proxy->sortIndex = b2_nullSapProxy;
+		m_largeProxies[m_largeCount++] = proxyId;
+		return;
+	}
+
+	if (m_entryCount == m_entryCapacity)
+	{
+		b2SapEntry* oldEntries = m_entries;
+		m_entryCapacity *= 2;
+		m_entries = (b2SapEntry*)b2Alloc(m_entryCapacity * sizeof(b2SapEntry));
+		memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2SapEntry));
+		b2Free(oldEntries);
+	}
+
+	m_maxExtent = b2Max(m_maxExtent, extent);
+
+	int32 index = m_entryCount++;
+	m_entries[index].aabb = proxy->aabb;
+	m_entries[index].proxyId = proxyId;
+	proxy->largeIndex = b2_nullSapProxy;
+	proxy->sortIndex = index;
+
+	if (m_bulkInsert == false)
+	{
+		SortEntry(index);
+	}
+}
+
+void b2SweepAndPrune::RemoveProxy(int32 proxyId)
+{
+	b2SapProxy* proxy = m_proxies + proxyId;
+	if (proxy->largeIndex != b2_nullSapProxy)
+	{
+		// Order doesn't matter in the large list.
+		int32 last = m_largeProxies[--m_largeCount];
+		m_largeProxies[proxy->largeIndex] = last;
+		m_proxies[last].largeIndex = proxy->largeIndex;
+		proxy->largeIndex = b2_nullSapProxy;
+		return;
+	}
+
+	// Close the gap, keeping the rest of the axis in order.
+	for (int32 i = proxy->sortIndex + 1; i < m_entryCount; ++i)
+	{
+		m_entries[i - 1] = m_entries[i];
+		m_proxies[m_entries[i - 1].proxyId].sortIndex = i - 1;
+	}
+	--m_entryCount;
+	proxy->sortIndex = b2_nullSapProxy;
+}
+
+// One insertion sort step: slide the entry left or right until it is in order again.
+void b2SweepAndPrune::SortEntry(int32 index)
+{
+	b2SapEntry entry = m_entries[index];
+	float32 x = entry.aabb.lowerBound.x;
+
+	while (index > 0 && m_entries[index - 1].aabb.lowerBound.x > x)
+	{
+		m_entries[index] = m_entries[index - 1];
+		m_proxies[m_entries[index].proxyId].sortIndex = index;
+		--index;
+	}
+
+	while (index < m_entryCount - 1 && m_entries[index + 1].aabb.lowerBound.x < x)
+	{
+		m_entries[index] = m_entries[index + 1];
+		m_proxies[m_entries[index].proxyId].sortIndex = index;
+		++index;
+	}
+
+	m_entries[index] = entry;
+	m_proxies[entry.proxyId].sortIndex = index;
+}
+
+void b2SweepAndPrune::BeginBulkInsert()
+{
+	m_bulkInsert = true;
+}
+
+void b2SweepAndPrune::EndBulkInsert()
+{
+	if (m_bulkInsert == false)
+	{
+		return;
+	}
+
+	m_bulkInsert = false;
+
+	std::sort(m_entries, m_entries + m_entryCount, b2SapEntryLessThan);
+
+	// The widest proxy may have moved away or been destroyed, so tighten the bound.
+	m_maxExtent = 0.0f;
+	for (int32 i = 0; i < m_entryCount; ++i)
+	{
+		const b2AABB& aabb = m_entries[i].aabb;
+		m_maxExtent = b2Max(m_maxExtent, aabb.upperBound.x - aabb.lowerBound.x);
+		m_proxies[m_entries[i].proxyId].sortIndex = i;
+	}
+
+	Validate();
+}
+
+void b2SweepAndPrune::Validate() const
+{
+	int32 sortedCount = 0;
+	for (int32 i = 0; i < m_entryCount; ++i)
+	{
+		const b2SapEntry& entry = m_entries[i];
+		const b2SapProxy& proxy = m_proxies[entry.proxyId];
+		b2Assert(proxy.state == 0);
+		b2Assert(proxy.sortIndex == i);
+		b2Assert(proxy.largeIndex == b2_nullSapProxy);
+		b2Assert(entry.aabb.upperBound.x - entry.aabb.lowerBound.x <= m_maxExtent);
+		b2Assert(i == 0 || m_bulkInsert || m_entries[i - 1].aabb.lowerBound.x <= entry.aabb.lowerBound.x);
+		B2_NOT_USED(proxy);
+		++sortedCount;
+	}
+
+	for (int32 i = 0; i < m_largeCount; ++i)
+	{
+		b2Assert(m_proxies[m_largeProxies[i]].largeIndex == i);
+	}
+
+	b2Assert(sortedCount + m_largeCount == m_proxyCount);
+	B2_NOT_USED(sortedCount);
+}
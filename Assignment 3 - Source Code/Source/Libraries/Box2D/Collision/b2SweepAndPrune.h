@@ -0,0 +1,369 @@
+//
+//  b2SweepAndPrune.h
+//  GameDevFramework
+//
+
+#ifndef B2_SWEEP_AND_PRUNE_H
+#define B2_SWEEP_AND_PRUNE_H
+
+#include "b2Collision.h"
+
+class b2Snapshot;
+class b2SnapshotReader;
+
+#define b2_nullSapProxy (-1)
+
+/// A proxy in the sweep-and-prune broad-phase. The client does not interact with this directly.
+struct b2SapProxy
+{
+	/// Enlarged AABB
+	b2AABB aabb;
+
+	void* userData;
+
+	union
+	{
+		int32 sortIndex;
+		int32 next;
+	};
+
+	// index in the large proxy list, or b2_nullSapProxy when on the sorted axis
+	int32 largeIndex;
+
+	// allocated = 0, free proxy = -1
+	int32 state;
+
+	// Set by b2BroadPhase while the proxy is in its move buffer.
+	bool moved;
+};
+
+/// An entry of the sorted axis. The AABB is copied here so a query scan
+/// reads one contiguous array.
+struct b2SapEntry
+{
+	b2AABB aabb;
+	int32 proxyId;
+};
+
+/// A one axis sweep-and-prune broad-phase with the same interface as
+/// b2DynamicTree. Proxies are kept sorted by the lower x bound of their
+/// fat AABB, and a moved proxy is put back in order with an insertion sort
+/// step, which is cheap when most things stay put. A query scans the
+/// entries between its lower bound minus the widest proxy and its upper
+/// bound. Proxies wider than b2_sapLargeExtent, like ground edges, are kept
+/// in a separate list that every query tests.
+///
+/// This suits wide, mostly static scenes. Tall or crowded columns make the
+/// scan long, use b2DynamicTree there.
+class b2SweepAndPrune
+{
+public:
+	b2SweepAndPrune();
+	~b2SweepAndPrune();
+
+	/// Remove every proxy at once, keeping the capacity.
+	void Reset();
+
+	/// Grow the proxy pool and the sorted axis to hold this many proxies.
+	void Reserve(int32 proxyCount);
+
+	/// Write the proxies and the sorted axis, see b2DynamicTree::SaveState.
+	void SaveState(b2Snapshot* snapshot) const;
+	void RestoreState(b2SnapshotReader* reader);
+
+	/// Read past what SaveState wrote without touching a broad-phase, see
+	/// b2DynamicTree::CheckState.
+	static int32 CheckState(b2SnapshotReader* reader);
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy. This asserts if the id is invalid.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its
+	/// fattened AABB, then it is moved along the axis.
+	/// @return true if the fat AABB changed.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+	void SetUserData(int32 proxyId, void* userData);
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Flag a proxy as moved. See b2DynamicTree::SetMoved.
+	bool WasMoved(int32 proxyId) const;
+	void SetMoved(int32 proxyId, bool flag);
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Query many AABBs. The callback class is called as
+	/// QueryCallback(queryIndex, proxyId), like b2DynamicTree::QueryBatch.
+	template <typename T>
+	void QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const;
+
+	/// Ray-cast against the proxies. See b2DynamicTree::RayCast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Append new proxies unsorted until EndBulkInsert sorts the axis once.
+	void BeginBulkInsert();
+	void EndBulkInsert();
+
+	/// Validate the sort order and the back references. For testing.
+	void Validate() const;
+
+private:
+
+	int32 AllocateProxy();
+	void ReserveProxies(int32 proxyCount);
+	void FreeProxy(int32 proxyId);
+
+	void InsertProxy(int32 proxyId);
+	void RemoveProxy(int32 proxyId);
+	void SortEntry(int32 index);
+
+	// First entry whose lower x bound is at least x.
+	int32 FindEntry(float32 x) const;
+
+	b2SapProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+	int32 m_freeList;
+
+	b2SapEntry* m_entries;
+	int32 m_entryCount;
+	int32 m_entryCapacity;
+
+	int32* m_largeProxies;
+	int32 m_largeCount;
+	int32 m_largeCapacity;
+
+	// The widest proxy on the sorted axis. It only grows between bulk inserts.
+	float32 m_maxExtent;
+
+	bool m_bulkInsert;
+};
+
+inline void* b2SweepAndPrune::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline void b2SweepAndPrune::SetUserData(int32 proxyId, void* userData)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].userData = userData;
+}
+
+inline const b2AABB& b2SweepAndPrune::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline bool b2SweepAndPrune::WasMoved(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].moved;
+}
+
+inline void b2SweepAndPrune::SetMoved(int32 proxyId, bool flag)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].moved = flag;
+}
+
+inline int32 b2SweepAndPrune::FindEntry(float32 x) const
+{
+	int32 low = 0;
+	int32 high = m_entryCount;
+	while (low < high)
+	{
+		int32 mid = (low + high) >> 1;
+		if (m_entries[mid].aabb.lowerBound.x < x)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+template <typename T>
+inline void b2SweepAndPrune::Query(T* callback, const b2AABB& aabb) const
+{
+	b2Assert(m_bulkInsert == false);
+
+	for (int32 i = 0; i < m_largeCount; ++i)
+	{
+		int32 proxyId = m_largeProxies[i];
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			bool proceed = callback->QueryCallback(proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+
+	float32 upperX = aabb.upperBound.x;
+	for (int32 i = FindEntry(aabb.lowerBound.x - m_maxExtent); i < m_entryCount; ++i)
+	{
+		const b2SapEntry* entry = m_entries + i;
+		if (entry->aabb.lowerBound.x > upperX)
+		{
+			break;
+		}
+
+		if (b2TestOverlap(entry->aabb, aabb))
+		{
+			bool proceed = callback->QueryCallback(entry->proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2SweepAndPrune::QueryBatch(T* callback, const b2AABB* aabbs, int32 count) const
+{
+	b2Assert(m_bulkInsert == false);
+
+	for (int32 queryIndex = 0; queryIndex < count; ++queryIndex)
+	{
+		const b2AABB& aabb = aabbs[queryIndex];
+
+		for (int32 i = 0; i < m_largeCount; ++i)
+		{
+			int32 proxyId = m_largeProxies[i];
+			if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+			{
+				callback->QueryCallback(queryIndex, proxyId);
+			}
+		}
+
+		float32 upperX = aabb.upperBound.x;
+		for (int32 i = FindEntry(aabb.lowerBound.x - m_maxExtent); i < m_entryCount; ++i)
+		{
+			const b2SapEntry* entry = m_entries + i;
+			if (entry->aabb.lowerBound.x > upperX)
+			{
+				break;
+			}
+
+			if (b2TestOverlap(entry->aabb, aabb))
+			{
+				callback->QueryCallback(queryIndex, entry->proxyId);
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2SweepAndPrune::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	b2Assert(m_bulkInsert == false);
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	// The large proxies are tested first, then the sorted range. The range
+	// start is fixed, its end follows the segment as the callback clips it.
+	int32 sortedBegin = FindEntry(segmentAABB.lowerBound.x - m_maxExtent);
+	int32 index = m_largeCount > 0 ? -m_largeCount : sortedBegin;
+	while (index < m_entryCount)
+	{
+		int32 proxyId;
+		const b2AABB* aabb;
+		if (index < 0)
+		{
+			proxyId = m_largeProxies[index + m_largeCount];
+			aabb = &m_proxies[proxyId].aabb;
+			++index;
+			if (index == 0)
+			{
+				index = sortedBegin;
+			}
+		}
+		else
+		{
+			const b2SapEntry* entry = m_entries + index;
+			if (entry->aabb.lowerBound.x > segmentAABB.upperBound.x)
+			{
+				break;
+			}
+			proxyId = entry->proxyId;
+			aabb = &entry->aabb;
+			++index;
+		}
+
+		if (b2TestOverlap(*aabb, segmentAABB) == false)
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = aabb->GetCenter();
+		b2Vec2 h = aabb->GetExtents();
+		float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+		if (separation > 0.0f)
+		{
+			continue;
+		}
+
+		b2RayCastInput subInput;
+		subInput.p1 = input.p1;
+		subInput.p2 = input.p2;
+		subInput.maxFraction = maxFraction;
+
+		float32 value = callback->RayCastCallback(subInput, proxyId);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			maxFraction = value;
+			b2Vec2 t = p1 + maxFraction * (p2 - p1);
+			segmentAABB.lowerBound = b2Min(p1, t);
+			segmentAABB.upperBound = b2Max(p1, t);
+		}
+	}
+}
+
+#endif
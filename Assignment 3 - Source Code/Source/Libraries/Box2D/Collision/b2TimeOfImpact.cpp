@@ -25,9 +25,6 @@
 #include <cstdio>
 using namespace std;
 
-int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
-int32 b2_toiRootIters, b2_toiMaxRootIters;
-
 struct b2SeparationFunction
 {
 	enum Type
@@ -256,8 +253,6 @@ struct b2SeparationFunction
 // by computing the largest time at which separation is maintained.
 void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 {
-	++b2_toiCalls;
-
 	output->state = b2TOIOutput::e_unknown;
 	output->t = input->tMax;
 
@@ -444,7 +439,6 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 				}
 
 				++rootIterCount;
-				++b2_toiRootIters;
 
 				if (rootIterCount == 50)
 				{
@@ -452,8 +446,6 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 				}
 			}
 
-			b2_toiMaxRootIters = b2Max(b2_toiMaxRootIters, rootIterCount);
-
 			++pushBackIter;
 
 			if (pushBackIter == b2_maxPolygonVertices)
@@ -463,7 +455,6 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 		}
 
 		++iter;
-		++b2_toiIters;
 
 		if (done)
 		{
@@ -479,5 +470,5 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 		}
 	}
 
-	b2_toiMaxIters = b2Max(b2_toiMaxIters, iter);
+	output->iterations = iter;
 }
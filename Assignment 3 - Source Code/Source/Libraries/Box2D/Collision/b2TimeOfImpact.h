@@ -46,6 +46,7 @@ struct b2TOIOutput
 
 	State state;
 	float32 t;
+	int32 iterations;	///< number of separating axis iterations used
 };
 
 /// Compute the upper bound on time before two shapes penetrate. Time is represented as
@@ -53,6 +54,7 @@ struct b2TOIOutput
 /// non-tunneling collision. If you change the time interval, you should call this function
 /// again.
 /// Note: use b2Distance to compute the contact point and normal at the time of impact.
+/// This is safe to call from several threads at once.
 void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input);
 
 #endif
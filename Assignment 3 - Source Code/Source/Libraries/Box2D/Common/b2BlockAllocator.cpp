@@ -17,10 +17,13 @@
 */
 
 #include "b2BlockAllocator.h"
+#include "b2Math.h"
 #include <cstdlib>
 #include <climits>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <new>
 using namespace std;
 
 int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] = 
@@ -54,70 +57,109 @@ struct b2Block
 	b2Block* next;
 };
 
-b2BlockAllocator::b2BlockAllocator()
+struct b2BlockPoolLock
 {
-	b2Assert(b2_blockSizes < UCHAR_MAX);
+	std::mutex mutex;
+};
 
-	m_chunkSpace = b2_chunkArrayIncrement;
-	m_chunkCount = 0;
-	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
-	
-	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
-	memset(m_freeLists, 0, sizeof(m_freeLists));
+// Holds the pool lock for a scope, a private pool has none.
+class b2BlockPoolScopedLock
+{
+public:
+	b2BlockPoolScopedLock(b2BlockPoolLock* lock) : m_lock(lock)
+	{
+		if (m_lock)
+		{
+			m_lock->mutex.lock();
+		}
+	}
+
+	~b2BlockPoolScopedLock()
+	{
+		if (m_lock)
+		{
+			m_lock->mutex.unlock();
+		}
+	}
+
+private:
+	b2BlockPoolLock* m_lock;
+};
+
+b2BlockPool::b2BlockPool()
+{
+	Initialize(true);
+}
+
+b2BlockPool::b2BlockPool(bool threadSafe)
+{
+	Initialize(threadSafe);
+}
+
+void b2BlockPool::Initialize(bool threadSafe)
+{
+	b2Assert(b2_blockSizes < UCHAR_MAX);
 
-	if (s_blockSizeLookupInitialized == false)
+	// Done here rather than per cache, the caches of a shared pool may be
+	// constructed on different threads.
+	if (b2BlockAllocator::s_blockSizeLookupInitialized == false)
 	{
 		int32 j = 0;
 		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
 		{
 			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
+			if (i <= b2BlockAllocator::s_blockSizes[j])
 			{
-				s_blockSizeLookup[i] = (uint8)j;
+				b2BlockAllocator::s_blockSizeLookup[i] = (uint8)j;
 			}
 			else
 			{
 				++j;
-				s_blockSizeLookup[i] = (uint8)j;
+				b2BlockAllocator::s_blockSizeLookup[i] = (uint8)j;
 			}
 		}
 
-		s_blockSizeLookupInitialized = true;
+		b2BlockAllocator::s_blockSizeLookupInitialized = true;
+	}
+
+	m_chunkSpace = b2_chunkArrayIncrement;
+	m_chunkCount = 0;
+	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+
+	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
+	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	m_cacheList = NULL;
+	m_lock = NULL;
+	if (threadSafe)
+	{
+		m_lock = new (b2Alloc(sizeof(b2BlockPoolLock))) b2BlockPoolLock;
 	}
 }
 
-b2BlockAllocator::~b2BlockAllocator()
+b2BlockPool::~b2BlockPool()
 {
+	b2Assert(m_cacheList == NULL);
+
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
 		b2Free(m_chunks[i].blocks);
 	}
 
 	b2Free(m_chunks);
-}
 
-void* b2BlockAllocator::Allocate(int32 size)
-{
-	if (size == 0)
-		return NULL;
-
-	b2Assert(0 < size);
-
-	if (size > b2_maxBlockSize)
+	if (m_lock)
 	{
-		return b2Alloc(size);
+		m_lock->~b2BlockPoolLock();
+		b2Free(m_lock);
 	}
+}
 
-	int32 index = s_blockSizeLookup[size];
-	b2Assert(0 <= index && index < b2_blockSizes);
+b2Block* b2BlockPool::AllocateBatch(int32 index, int32 count, int32* blockCount)
+{
+	b2BlockPoolScopedLock lock(m_lock);
 
-	if (m_freeLists[index])
-	{
-		b2Block* block = m_freeLists[index];
-		m_freeLists[index] = block->next;
-		return block;
-	}
-	else
+	if (m_freeLists[index] == NULL)
 	{
 		if (m_chunkCount == m_chunkSpace)
 		{
@@ -134,55 +176,82 @@ void* b2BlockAllocator::Allocate(int32 size)
 #if defined(_DEBUG)
 		memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
-		int32 blockSize = s_blockSizes[index];
+		int32 blockSize = b2BlockAllocator::s_blockSizes[index];
 		chunk->blockSize = blockSize;
-		int32 blockCount = b2_chunkSize / blockSize;
-		b2Assert(blockCount * blockSize <= b2_chunkSize);
-		for (int32 i = 0; i < blockCount - 1; ++i)
+		int32 chunkBlockCount = b2_chunkSize / blockSize;
+		b2Assert(chunkBlockCount * blockSize <= b2_chunkSize);
+		for (int32 i = 0; i < chunkBlockCount - 1; ++i)
 		{
 			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
 			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
 			block->next = next;
 		}
-		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
+		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (chunkBlockCount - 1));
 		last->next = NULL;
 
-		m_freeLists[index] = chunk->blocks->next;
+		m_freeLists[index] = chunk->blocks;
 		++m_chunkCount;
+	}
 
-		return chunk->blocks;
+	b2Block* first = m_freeLists[index];
+	b2Block* last = first;
+	int32 n = 1;
+	while (n < count && last->next)
+	{
+		last = last->next;
+		++n;
 	}
+
+	m_freeLists[index] = last->next;
+	last->next = NULL;
+
+	*blockCount = n;
+	return first;
 }
 
-void b2BlockAllocator::Free(void* p, int32 size)
+void b2BlockPool::FreeBatch(int32 index, b2Block* first, b2Block* last)
 {
-	if (size == 0)
-	{
-		return;
-	}
+	b2BlockPoolScopedLock lock(m_lock);
+	last->next = m_freeLists[index];
+	m_freeLists[index] = first;
+}
 
-	b2Assert(0 < size);
+void b2BlockPool::Attach(b2BlockAllocator* cache)
+{
+	b2BlockPoolScopedLock lock(m_lock);
+	cache->m_next = m_cacheList;
+	m_cacheList = cache;
+}
 
-	if (size > b2_maxBlockSize)
+void b2BlockPool::Detach(b2BlockAllocator* cache)
+{
+	b2BlockPoolScopedLock lock(m_lock);
+	b2BlockAllocator** node = &m_cacheList;
+	while (*node != cache)
 	{
-		b2Free(p);
-		return;
+		b2Assert(*node != NULL);
+		node = &(*node)->m_next;
 	}
+	*node = cache->m_next;
+	cache->m_next = NULL;
+}
 
-	int32 index = s_blockSizeLookup[size];
-	b2Assert(0 <= index && index < b2_blockSizes);
+bool b2BlockPool::Owns(void* p, int32 blockSize) const
+{
+	b2BlockPoolScopedLock lock(m_lock);
 
-#ifdef _DEBUG
 	// Verify the memory address and size is valid.
-	int32 blockSize = s_blockSizes[index];
 	bool found = false;
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
 		b2Chunk* chunk = m_chunks + i;
 		if (chunk->blockSize != blockSize)
 		{
-			b2Assert(	(int8*)p + blockSize <= (int8*)chunk->blocks ||
-						(int8*)chunk->blocks + b2_chunkSize <= (int8*)p);
+			if ((int8*)p + blockSize > (int8*)chunk->blocks &&
+				(int8*)chunk->blocks + b2_chunkSize > (int8*)p)
+			{
+				return false;
+			}
 		}
 		else
 		{
@@ -193,25 +262,254 @@ void b2BlockAllocator::Free(void* p, int32 size)
 		}
 	}
 
-	b2Assert(found);
+	return found;
+}
+
+void b2BlockPool::Reset()
+{
+	b2BlockPoolScopedLock lock(m_lock);
+
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Free(m_chunks[i].blocks);
+	}
+
+	m_chunkCount = 0;
+	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
+
+	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	for (b2BlockAllocator* cache = m_cacheList; cache; cache = cache->m_next)
+	{
+		cache->ClearCache();
+	}
+}
+
+void b2BlockPool::GetStats(b2BlockStats* stats) const
+{
+	b2BlockPoolScopedLock lock(m_lock);
+
+	memset(stats, 0, sizeof(b2BlockStats));
+	for (b2BlockAllocator* cache = m_cacheList; cache; cache = cache->m_next)
+	{
+		for (int32 i = 0; i < b2_blockSizes; ++i)
+		{
+			stats->bytesInUse[i] += cache->m_blockCounts[i] * b2BlockAllocator::s_blockSizes[i];
+		}
+		stats->largeBytesInUse += cache->m_largeBytes;
+		stats->totalBytesInUse += cache->m_bytesInUse;
+		stats->highWaterBytes += cache->m_highWater;
+	}
+	stats->chunkCount = m_chunkCount;
+}
+
+void b2BlockPool::ResetStats()
+{
+	b2BlockPoolScopedLock lock(m_lock);
+
+	for (b2BlockAllocator* cache = m_cacheList; cache; cache = cache->m_next)
+	{
+		cache->ResetStats();
+	}
+}
+
+b2BlockAllocator::b2BlockAllocator()
+{
+	m_pool = new (b2Alloc(sizeof(b2BlockPool))) b2BlockPool(false);
+	m_privatePool = true;
+	m_next = NULL;
+	m_largeBytes = 0;
+	m_highWater = 0;
+
+	ClearCache();
+	m_pool->Attach(this);
+}
+
+b2BlockAllocator::b2BlockAllocator(b2BlockPool* pool)
+{
+	b2Assert(pool != NULL);
+	m_pool = pool;
+	m_privatePool = false;
+	m_next = NULL;
+	m_largeBytes = 0;
+	m_highWater = 0;
+
+	ClearCache();
+	m_pool->Attach(this);
+}
+
+b2BlockAllocator::~b2BlockAllocator()
+{
+	m_pool->Detach(this);
+
+	if (m_privatePool)
+	{
+		m_pool->~b2BlockPool();
+		b2Free(m_pool);
+		return;
+	}
+
+	// Leave the cached blocks to the other threads.
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		b2Block* first = m_freeLists[i];
+		if (first == NULL)
+		{
+			continue;
+		}
+
+		b2Block* last = first;
+		while (last->next)
+		{
+			last = last->next;
+		}
+		m_pool->FreeBatch(i, first, last);
+	}
+}
+
+void b2BlockAllocator::ClearCache()
+{
+	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_freeCounts, 0, sizeof(m_freeCounts));
+	memset(m_blockCounts, 0, sizeof(m_blockCounts));
+
+	// Large allocations are not owned by the pool and outlive a reset. The
+	// high-water mark is kept, see ResetStats.
+	m_bytesInUse = m_largeBytes;
+}
+
+void* b2BlockAllocator::Allocate(int32 size)
+{
+	if (size == 0)
+		return NULL;
+
+	b2Assert(0 < size);
+
+	if (size > b2_maxBlockSize)
+	{
+		m_largeBytes += size;
+		m_bytesInUse += size;
+		m_highWater = b2Max(m_highWater, m_bytesInUse);
+		return b2Alloc(size);
+	}
+
+	int32 index = s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+	if (m_freeLists[index] == NULL)
+	{
+		// A private pool hands over a whole chunk at a time, like the
+		// allocator did before it had a pool.
+		int32 count = m_privatePool ? b2_chunkSize / s_blockSizes[index] : b2_blockBatchSize;
+		m_freeLists[index] = m_pool->AllocateBatch(index, count, m_freeCounts + index);
+	}
+
+	b2Block* block = m_freeLists[index];
+	m_freeLists[index] = block->next;
+	--m_freeCounts[index];
 
+	++m_blockCounts[index];
+	m_bytesInUse += s_blockSizes[index];
+	m_highWater = b2Max(m_highWater, m_bytesInUse);
+
+	return block;
+}
+
+void b2BlockAllocator::Free(void* p, int32 size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	b2Assert(0 < size);
+
+	if (size > b2_maxBlockSize)
+	{
+		m_largeBytes -= size;
+		m_bytesInUse -= size;
+		b2Free(p);
+		return;
+	}
+
+	int32 index = s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+	int32 blockSize = s_blockSizes[index];
+
+#ifdef _DEBUG
+	b2Assert(m_pool->Owns(p, blockSize));
 	memset(p, 0xfd, blockSize);
 #endif
 
 	b2Block* block = (b2Block*)p;
 	block->next = m_freeLists[index];
 	m_freeLists[index] = block;
+	++m_freeCounts[index];
+
+	--m_blockCounts[index];
+	m_bytesInUse -= blockSize;
+
+	// Give a batch back once the cache holds two, so the blocks a thread
+	// frees can be reused by the others.
+	if (m_privatePool == false && m_freeCounts[index] > 2 * b2_blockBatchSize)
+	{
+		b2Block* first = m_freeLists[index];
+		b2Block* last = first;
+		for (int32 i = 1; i < b2_blockBatchSize; ++i)
+		{
+			last = last->next;
+		}
+
+		m_freeLists[index] = last->next;
+		m_freeCounts[index] -= b2_blockBatchSize;
+		m_pool->FreeBatch(index, first, last);
+	}
 }
 
-void b2BlockAllocator::Clear()
+void b2BlockAllocator::Reserve(int32 size, int32 count)
 {
-	for (int32 i = 0; i < m_chunkCount; ++i)
+	if (size <= 0 || size > b2_maxBlockSize)
 	{
-		b2Free(m_chunks[i].blocks);
+		return;
 	}
 
-	m_chunkCount = 0;
-	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
+	int32 index = s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
 
-	memset(m_freeLists, 0, sizeof(m_freeLists));
+	while (m_freeCounts[index] < count)
+	{
+		int32 blockCount = 0;
+		b2Block* first = m_pool->AllocateBatch(index, count - m_freeCounts[index], &blockCount);
+		b2Block* last = first;
+		while (last->next)
+		{
+			last = last->next;
+		}
+
+		last->next = m_freeLists[index];
+		m_freeLists[index] = first;
+		m_freeCounts[index] += blockCount;
+	}
+}
+
+void b2BlockAllocator::Reset()
+{
+	m_pool->Reset();
+}
+
+void b2BlockAllocator::GetStats(b2BlockStats* stats) const
+{
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		stats->bytesInUse[i] = m_blockCounts[i] * s_blockSizes[i];
+	}
+	stats->largeBytesInUse = m_largeBytes;
+	stats->totalBytesInUse = m_bytesInUse;
+	stats->highWaterBytes = m_highWater;
+	stats->chunkCount = m_pool->m_chunkCount;
+}
+
+void b2BlockAllocator::ResetStats()
+{
+	m_highWater = m_bytesInUse;
 }
@@ -25,17 +25,87 @@ const int32 b2_chunkSize = 16 * 1024;
 const int32 b2_maxBlockSize = 640;
 const int32 b2_blockSizes = 14;
 const int32 b2_chunkArrayIncrement = 128;
+const int32 b2_blockBatchSize = 32;
 
 struct b2Block;
 struct b2Chunk;
+struct b2BlockPoolLock;
+class b2BlockAllocator;
+
+/// Memory usage of a block allocator or of a whole pool.
+struct b2BlockStats
+{
+	int32 bytesInUse[b2_blockSizes];	///< bytes handed out, per size class
+	int32 largeBytesInUse;	///< bytes larger than b2_maxBlockSize, passed to b2Alloc
+	int32 totalBytesInUse;	///< sum of the above
+	int32 highWaterBytes;	///< the peak of totalBytesInUse since construction or ResetStats, kept across Reset
+	int32 chunkCount;		///< chunks owned by the pool
+};
+
+/// The chunks shared by the b2BlockAllocator caches of several threads.
+/// Caches move blocks in and out of the pool in batches, so the pool lock
+/// is only taken once every b2_blockBatchSize allocations or so.
+class b2BlockPool
+{
+public:
+	b2BlockPool();
+
+	/// The caches must be destroyed first.
+	~b2BlockPool();
+
+	/// Free every chunk in O(chunks), including the blocks the caches hold
+	/// or have handed out. Nothing allocated from the pool may be used
+	/// afterwards. Not safe while other threads allocate.
+	void Reset();
+
+	/// Sum the usage of every cache. For a pool the high-water mark is the sum
+	/// of the caches' marks, an upper bound. Not safe while other threads allocate.
+	void GetStats(b2BlockStats* stats) const;
+
+	/// Start the caches' high-water marks again from what they have in use.
+	void ResetStats();
+
+private:
+	friend class b2BlockAllocator;
+
+	// A pool private to one allocator skips the lock.
+	explicit b2BlockPool(bool threadSafe);
+	void Initialize(bool threadSafe);
+
+	// Pop up to count blocks of a size class, carving a new chunk when the
+	// pool has none. Returns the list and its length in blockCount.
+	b2Block* AllocateBatch(int32 index, int32 count, int32* blockCount);
+
+	// Push a list of blocks of a size class back.
+	void FreeBatch(int32 index, b2Block* first, b2Block* last);
+
+	void Attach(b2BlockAllocator* cache);
+	void Detach(b2BlockAllocator* cache);
+
+	bool Owns(void* p, int32 blockSize) const;
+
+	b2Chunk* m_chunks;
+	int32 m_chunkCount;
+	int32 m_chunkSpace;
+
+	b2Block* m_freeLists[b2_blockSizes];
+
+	b2BlockAllocator* m_cacheList;
+	b2BlockPoolLock* m_lock;
+};
 
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
+/// An allocator is a cache for one thread. Constructed over a shared
+/// b2BlockPool, the caches of several threads can allocate concurrently;
+/// a block may be freed through any cache of the same pool. By default an
+/// allocator has a private pool and behaves like a single threaded allocator.
 class b2BlockAllocator
 {
 public:
 	b2BlockAllocator();
+	explicit b2BlockAllocator(b2BlockPool* pool);
 	~b2BlockAllocator();
 
 	/// Allocate memory. This will use b2Alloc if the size is larger than b2_maxBlockSize.
@@ -44,15 +114,40 @@ public:
 	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
-	void Clear();
+	/// Make sure this cache holds at least count free blocks of this size, so
+	/// that many allocations don't go to the pool or to b2Alloc.
+	void Reserve(int32 size, int32 count);
+
+	/// Free every block of the pool in O(chunks), see b2BlockPool::Reset.
+	/// Allocations larger than b2_maxBlockSize are not tracked, free those first.
+	void Reset();
+
+	/// Get the usage of this cache. Blocks are counted by the cache that
+	/// allocated them, so a cache freeing another cache's blocks may go negative.
+	void GetStats(b2BlockStats* stats) const;
+
+	/// Start the high-water mark again from the bytes in use.
+	void ResetStats();
+
+	b2BlockPool* GetPool() const { return m_pool; }
 
 private:
+	friend class b2BlockPool;
 
-	b2Chunk* m_chunks;
-	int32 m_chunkCount;
-	int32 m_chunkSpace;
+	void ClearCache();
+
+	b2BlockPool* m_pool;
+	bool m_privatePool;
 
 	b2Block* m_freeLists[b2_blockSizes];
+	int32 m_freeCounts[b2_blockSizes];
+
+	int32 m_blockCounts[b2_blockSizes];
+	int32 m_largeBytes;
+	int32 m_bytesInUse;
+	int32 m_highWater;
+
+	b2BlockAllocator* m_next;
 
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
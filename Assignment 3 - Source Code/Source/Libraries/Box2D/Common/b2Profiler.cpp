@@ -0,0 +1,346 @@
+//
+//  b2Profiler.cpp
+//  GameDevFramework
+//
+
+#include "b2Profiler.h"
+#include "b2Math.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string.h>
+
+struct b2ProfileRecord
+{
+	const char* name;
+	uint64 start;
+	uint64 end;
+	int32 depth;
+};
+
+// The zones of one thread. Only the owner writes records and head, only
+// EndFrame reads them, so the ring needs no lock. A ring outlives its
+// thread and is handed to the next thread that opens a zone.
+struct b2ProfileRing
+{
+	b2ProfileRecord records[b2_profileRingSize];
+	std::atomic<uint32> head;
+	uint32 tail;
+	std::atomic<bool> owned;
+	int32 thread;
+
+	int32 depth;
+	const char* names[b2_profileMaxDepth];
+	uint64 starts[b2_profileMaxDepth];
+
+	b2ProfileRing* next;
+};
+
+struct b2ProfileZone
+{
+	const char* name;
+	float64 frameTime;
+	int32 frameCalls;
+	int32 lastCalls;
+	float64 window[b2_profileWindow];
+	int32 windowCount;
+	int32 windowNext;
+};
+
+// Gives the ring back when its thread exits.
+struct b2ProfileRingOwner
+{
+	b2ProfileRingOwner() : ring(NULL) {}
+	~b2ProfileRingOwner()
+	{
+		if (ring)
+		{
+			ring->owned.store(false, std::memory_order_release);
+		}
+	}
+
+	b2ProfileRing* ring;
+};
+
+static const uint32 b2_profileRingMask = b2_profileRingSize - 1;
+
+std::atomic<bool> b2_profileEnabled(false);
+static std::atomic<b2ProfileRing*> s_rings(NULL);
+static std::atomic<int32> s_ringCount(0);
+static thread_local b2ProfileRingOwner s_owner;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+// Touched by EndFrame and the getters only, which run on one thread.
+static b2ProfileZone s_zones[b2_profileMaxZones];
+static int32 s_zoneCount = 0;
+static int32 s_frameCount = 0;
+static int32 s_droppedCount = 0;
+static b2ProfileEvent* s_capture = NULL;
+static int32 s_captureCount = 0;
+static int32 s_captureCapacity = 0;
+static bool s_capturing = false;
+static b2ProfileRecord s_scratch[b2_profileRingSize];
+
+static uint64 b2ProfileNow()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+static b2ProfileRing* b2AcquireRing()
+{
+	for (b2ProfileRing* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+	{
+		bool owned = false;
+		if (ring->owned.load(std::memory_order_relaxed) == false &&
+			ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+		{
+			ring->depth = 0;
+			return ring;
+		}
+	}
+
+	b2ProfileRing* ring = new (b2Alloc(sizeof(b2ProfileRing))) b2ProfileRing;
+	ring->head.store(0, std::memory_order_relaxed);
+	ring->tail = 0;
+	ring->owned.store(true, std::memory_order_relaxed);
+	ring->thread = s_ringCount.fetch_add(1, std::memory_order_relaxed);
+	ring->depth = 0;
+
+	ring->next = s_rings.load(std::memory_order_relaxed);
+	while (s_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed) == false)
+	{
+	}
+	return ring;
+}
+
+static b2ProfileZone* b2FindZone(const char* name)
+{
+	for (int32 i = 0; i < s_zoneCount; ++i)
+	{
+		if (s_zones[i].name == name || strcmp(s_zones[i].name, name) == 0)
+		{
+			return s_zones + i;
+		}
+	}
+
+	if (s_zoneCount == b2_profileMaxZones)
+	{
+		return NULL;
+	}
+
+	b2ProfileZone* zone = s_zones + s_zoneCount++;
+	memset(zone, 0, sizeof(b2ProfileZone));
+	zone->name = name;
+	return zone;
+}
+
+void b2Profiler::SetEnabled(bool flag)
+{
+	b2_profileEnabled.store(flag, std::memory_order_relaxed);
+}
+
+void b2Profiler::BeginZone(const char* name)
+{
+	b2ProfileRing* ring = s_owner.ring;
+	if (ring == NULL)
+	{
+		ring = s_owner.ring = b2AcquireRing();
+	}
+
+	// Zones nested deeper than the stack are counted but not recorded.
+	if (ring->depth < b2_profileMaxDepth)
+	{
+		ring->names[ring->depth] = name;
+		ring->starts[ring->depth] = b2ProfileNow();
+	}
+	++ring->depth;
+}
+
+void b2Profiler::EndZone()
+{
+	b2ProfileRing* ring = s_owner.ring;
+	b2Assert(ring && ring->depth > 0);
+	--ring->depth;
+	if (ring->depth >= b2_profileMaxDepth)
+	{
+		return;
+	}
+
+	uint32 head = ring->head.load(std::memory_order_relaxed);
+	b2ProfileRecord* record = ring->records + (head & b2_profileRingMask);
+	record->name = ring->names[ring->depth];
+	record->start = ring->starts[ring->depth];
+	record->end = b2ProfileNow();
+	record->depth = ring->depth;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void b2Profiler::EndFrame()
+{
+	for (b2ProfileRing* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+	{
+		uint32 head = ring->head.load(std::memory_order_acquire);
+		uint32 begin = ring->tail;
+		if (head - begin > (uint32)b2_profileRingSize)
+		{
+			s_droppedCount += head - begin - b2_profileRingSize;
+			begin = head - b2_profileRingSize;
+		}
+
+		int32 count = head - begin;
+		for (int32 i = 0; i < count; ++i)
+		{
+			s_scratch[i] = ring->records[(begin + i) & b2_profileRingMask];
+		}
+
+		// The owner may have lapped the ring while it was copied, the
+		// records it could have written over are dropped.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint32 newHead = ring->head.load(std::memory_order_relaxed);
+		int32 first = 0;
+		if (newHead - begin > (uint32)b2_profileRingSize)
+		{
+			first = b2Min((int32)(newHead - begin - b2_profileRingSize), count);
+			s_droppedCount += first;
+		}
+		ring->tail = head;
+
+		for (int32 i = first; i < count; ++i)
+		{
+			const b2ProfileRecord& record = s_scratch[i];
+			float64 duration = (record.end - record.start) * 0.001;
+
+			b2ProfileZone* zone = b2FindZone(record.name);
+			if (zone)
+			{
+				zone->frameTime += duration * 0.001;
+				++zone->frameCalls;
+			}
+
+			if (s_capturing == false)
+			{
+				continue;
+			}
+
+			if (s_captureCount == s_captureCapacity)
+			{
+				++s_droppedCount;
+				continue;
+			}
+
+			b2ProfileEvent* event = s_capture + s_captureCount++;
+			event->name = record.name;
+			event->start = record.start * 0.001;
+			event->duration = duration;
+			event->thread = ring->thread;
+			event->depth = record.depth;
+		}
+	}
+
+	for (int32 i = 0; i < s_zoneCount; ++i)
+	{
+		b2ProfileZone* zone = s_zones + i;
+		if (zone->frameCalls == 0)
+		{
+			continue;
+		}
+
+		zone->window[zone->windowNext] = zone->frameTime;
+		zone->windowNext = (zone->windowNext + 1) % b2_profileWindow;
+		zone->windowCount = b2Min(zone->windowCount + 1, b2_profileWindow);
+		zone->lastCalls = zone->frameCalls;
+		zone->frameTime = 0.0;
+		zone->frameCalls = 0;
+	}
+
+	++s_frameCount;
+}
+
+int32 b2Profiler::GetFrameCount()
+{
+	return s_frameCount;
+}
+
+void b2Profiler::StartCapture(int32 maxEvents)
+{
+	b2Free(s_capture);
+	s_captureCapacity = b2Max(maxEvents, 0);
+	s_capture = (b2ProfileEvent*)b2Alloc(b2Max(s_captureCapacity, 1) * sizeof(b2ProfileEvent));
+	s_captureCount = 0;
+	s_capturing = true;
+}
+
+void b2Profiler::StopCapture()
+{
+	s_capturing = false;
+}
+
+bool b2Profiler::IsCapturing()
+{
+	return s_capturing;
+}
+
+const b2ProfileEvent* b2Profiler::GetCapture()
+{
+	return s_capture;
+}
+
+int32 b2Profiler::GetCaptureCount()
+{
+	return s_captureCount;
+}
+
+int32 b2Profiler::GetDroppedCount()
+{
+	return s_droppedCount;
+}
+
+int32 b2Profiler::GetZoneCount()
+{
+	return s_zoneCount;
+}
+
+void b2Profiler::GetZoneStats(int32 index, b2ProfileZoneStats* stats)
+{
+	b2Assert(0 <= index && index < s_zoneCount);
+	const b2ProfileZone* zone = s_zones + index;
+
+	float64 samples[b2_profileWindow];
+	int32 count = zone->windowCount;
+	float64 sum = 0.0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		samples[i] = zone->window[i];
+		sum += samples[i];
+	}
+	std::sort(samples, samples + count);
+
+	stats->name = zone->name;
+	stats->frameCount = count;
+	stats->calls = zone->lastCalls;
+	stats->mean = count > 0 ? sum / count : 0.0;
+
+	// Nearest rank percentiles.
+	float64 ranks[3] = {0.5, 0.95, 0.99};
+	float64* values[3] = {&stats->p50, &stats->p95, &stats->p99};
+	for (int32 i = 0; i < 3; ++i)
+	{
+		int32 rank = (int32)ceil(ranks[i] * count);
+		*values[i] = count > 0 ? samples[b2Clamp(rank - 1, 0, count - 1)] : 0.0;
+	}
+	stats->max = count > 0 ? samples[count - 1] : 0.0;
+}
+
+void b2Profiler::Reset()
+{
+	for (b2ProfileRing* ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+	{
+		ring->tail = ring->head.load(std::memory_order_acquire);
+	}
+
+	s_zoneCount = 0;
+	s_frameCount = 0;
+	s_droppedCount = 0;
+	s_captureCount = 0;
+}
@@ -0,0 +1,114 @@
+//
+//  b2Profiler.h
+//  GameDevFramework
+//
+
+#ifndef B2_PROFILER_H
+#define B2_PROFILER_H
+
+#include "b2Settings.h"
+#include <atomic>
+
+const int32 b2_profileRingSize = 4096;	// zones a thread may close between two frames, a power of two
+const int32 b2_profileMaxDepth = 32;
+const int32 b2_profileMaxZones = 64;
+const int32 b2_profileWindow = 128;		// frames the zone statistics are taken over
+
+/// A closed zone. Times are in microseconds since the profiler started.
+struct b2ProfileEvent
+{
+	const char* name;
+	float64 start;
+	float64 duration;
+	int32 thread;	///< in the order the threads first opened a zone
+	int32 depth;	///< zones open on the thread when this one opened
+};
+
+/// Read inline by every zone, see b2Profiler::SetEnabled.
+extern std::atomic<bool> b2_profileEnabled;
+
+/// Statistics of one zone over the last b2_profileWindow frames it ran in.
+/// The time of a zone in a frame is the sum of its calls, over every thread.
+struct b2ProfileZoneStats
+{
+	const char* name;
+	int32 frameCount;	///< frames in the window
+	int32 calls;		///< calls in the last frame the zone ran in
+	float64 mean;		///< milliseconds per frame
+	float64 p50;
+	float64 p95;
+	float64 p99;
+	float64 max;
+};
+
+/// A scoped-zone profiler shared by every thread. Each thread closes its
+/// zones into a ring of its own without locking, and EndFrame drains the
+/// rings into rolling per zone statistics and, while capturing, into an
+/// event list that can be exported as a trace. Zone names must be string
+/// literals or otherwise outlive the profiler. Disabled, a zone costs a load
+/// and a branch.
+class b2Profiler
+{
+public:
+	static void SetEnabled(bool flag);
+	static bool IsEnabled() { return b2_profileEnabled.load(std::memory_order_relaxed); }
+
+	/// Open and close a zone on the calling thread. Prefer B2_PROFILE_ZONE.
+	static void BeginZone(const char* name);
+	static void EndZone();
+
+	/// Close the frame. Call this from one thread, while no other thread
+	/// is expected to close zones that belong to the frame.
+	static void EndFrame();
+	static int32 GetFrameCount();
+
+	/// Keep the events drained by EndFrame, up to maxEvents. Starting a
+	/// capture discards the previous one.
+	static void StartCapture(int32 maxEvents);
+	static void StopCapture();
+	static bool IsCapturing();
+	static const b2ProfileEvent* GetCapture();
+	static int32 GetCaptureCount();
+
+	/// Events lost because a ring was full or the capture was.
+	static int32 GetDroppedCount();
+
+	static int32 GetZoneCount();
+	static void GetZoneStats(int32 index, b2ProfileZoneStats* stats);
+
+	/// Forget the zone statistics, the capture and the frame count.
+	static void Reset();
+};
+
+/// Opens a zone for its lifetime, if the profiler was enabled when it opened.
+class b2ProfileScope
+{
+public:
+	explicit b2ProfileScope(const char* name)
+	{
+		m_active = b2Profiler::IsEnabled();
+		if (m_active)
+		{
+			b2Profiler::BeginZone(name);
+		}
+	}
+
+	~b2ProfileScope()
+	{
+		if (m_active)
+		{
+			b2Profiler::EndZone();
+		}
+	}
+
+private:
+	bool m_active;
+};
+
+#define B2_PROFILE_JOIN2(a, b) a##b
+#define B2_PROFILE_JOIN(a, b) B2_PROFILE_JOIN2(a, b)
+
+/// Profile the rest of the enclosing scope as a zone.
+#define B2_PROFILE_ZONE(name) b2ProfileScope B2_PROFILE_JOIN(b2_profileScope, __LINE__)(name)
+
+#endif
@@ -17,12 +17,124 @@
 */
 
 #include "b2Settings.h"
+#include "b2Math.h"
 #include <cstdlib>
 #include <cstdio>
 #include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#if defined(B2_TRACK_ALLOCATIONS)
+#include <mutex>
+#endif
 
 b2Version b2_version = {2, 3, 0};
 
+#if defined(B2_TRACK_ALLOCATIONS)
+
+const int32 b2_maxAllocSites = 256;
+
+// Put in front of every tracked allocation, padded to keep malloc's alignment.
+union b2AllocHeader
+{
+	int32 size;
+	double align[2];
+};
+
+static std::mutex s_allocMutex;
+static b2AllocStats s_allocStats;
+static b2AllocSite s_allocSites[b2_maxAllocSites];
+static int32 s_allocSiteCount;
+
+void* b2AllocTagged(int32 size, const char* file, int32 line)
+{
+	{
+		std::lock_guard<std::mutex> lock(s_allocMutex);
+
+		++s_allocStats.allocCount;
+		s_allocStats.bytesInUse += size;
+		s_allocStats.peakBytes = b2Max(s_allocStats.peakBytes, s_allocStats.bytesInUse);
+
+		// A header inlined into several files has one __FILE__ string per file.
+		int32 i = 0;
+		while (i < s_allocSiteCount && (s_allocSites[i].line != line || strcmp(s_allocSites[i].file, file) != 0))
+		{
+			++i;
+		}
+
+		if (i == s_allocSiteCount && s_allocSiteCount < b2_maxAllocSites)
+		{
+			s_allocSites[i].file = file;
+			s_allocSites[i].line = line;
+			s_allocSites[i].count = 0;
+			s_allocSites[i].bytes = 0;
+			++s_allocSiteCount;
+		}
+
+		if (i < s_allocSiteCount)
+		{
+			++s_allocSites[i].count;
+			s_allocSites[i].bytes += size;
+		}
+	}
+
+	b2AllocHeader* header = (b2AllocHeader*)malloc(sizeof(b2AllocHeader) + size);
+	header->size = size;
+	return header + 1;
+}
+
+// The parentheses keep the b2Alloc macro from expanding.
+void* (b2Alloc)(int32 size)
+{
+	return b2AllocTagged(size, "unknown", 0);
+}
+
+void b2Free(void* mem)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	b2AllocHeader* header = (b2AllocHeader*)mem - 1;
+	{
+		std::lock_guard<std::mutex> lock(s_allocMutex);
+		++s_allocStats.freeCount;
+		s_allocStats.bytesInUse -= header->size;
+	}
+
+	free(header);
+}
+
+void b2GetAllocStats(b2AllocStats* stats)
+{
+	std::lock_guard<std::mutex> lock(s_allocMutex);
+	*stats = s_allocStats;
+}
+
+void b2ResetAllocStats()
+{
+	std::lock_guard<std::mutex> lock(s_allocMutex);
+	s_allocStats.allocCount = 0;
+	s_allocStats.freeCount = 0;
+	s_allocStats.peakBytes = s_allocStats.bytesInUse;
+	s_allocSiteCount = 0;
+}
+
+static bool b2CompareAllocSites(const b2AllocSite& a, const b2AllocSite& b)
+{
+	return a.count > b.count;
+}
+
+int32 b2GetAllocSites(b2AllocSite* sites, int32 capacity)
+{
+	std::lock_guard<std::mutex> lock(s_allocMutex);
+	int32 count = b2Min(capacity, s_allocSiteCount);
+	std::partial_sort_copy(s_allocSites, s_allocSites + s_allocSiteCount, sites, sites + count, b2CompareAllocSites);
+	return count;
+}
+
+#else
+
 // Memory allocators. Modify these to use your own allocator.
 void* b2Alloc(int32 size)
 {
@@ -34,6 +146,24 @@ void b2Free(void* mem)
 	free(mem);
 }
 
+void b2GetAllocStats(b2AllocStats* stats)
+{
+	memset(stats, 0, sizeof(b2AllocStats));
+}
+
+void b2ResetAllocStats()
+{
+}
+
+int32 b2GetAllocSites(b2AllocSite* sites, int32 capacity)
+{
+	B2_NOT_USED(sites);
+	B2_NOT_USED(capacity);
+	return 0;
+}
+
+#endif
+
 // You can modify this to use your logging facility.
 void b2Log(const char* string, ...)
 {
@@ -31,6 +31,7 @@ typedef signed int int32;
 typedef unsigned char uint8;
 typedef unsigned short uint16;
 typedef unsigned int uint32;
+typedef unsigned long long uint64;
 typedef float float32;
 typedef double float64;
 
@@ -62,6 +63,11 @@ typedef double float64;
 /// This is a dimensionless multiplier.
 #define b2_aabbMultiplier		2.0f
 
+/// Proxies wider than this are kept out of the sweep-and-prune axis and
+/// tested against every query, so one long ground edge doesn't widen the
+/// range every query has to scan. This is in meters.
+#define b2_sapLargeExtent		8.0f
+
 /// A small length used as a collision and constraint tolerance. Usually it is
 /// chosen to be numerically significant, but visually insignificant.
 #define b2_linearSlop			0.005f
@@ -84,6 +90,10 @@ typedef double float64;
 /// Maximum number of contacts to be handled to solve a TOI impact.
 #define b2_maxTOIContacts			32
 
+/// The number of steps the impulses of a contact destroyed by the broad-phase are kept
+/// to warm start a new contact between the same fixtures.
+#define b2_warmStartCacheSteps		4
+
 /// A velocity threshold for elastic collisions. Any collision with a relative linear
 /// velocity below this threshold will be treated as inelastic.
 #define b2_velocityThreshold		1.0f
@@ -132,6 +142,41 @@ void* b2Alloc(int32 size);
 /// If you implement b2Alloc, you should also implement this function.
 void b2Free(void* mem);
 
+/// Heap counters of the allocation tracking build. Define B2_TRACK_ALLOCATIONS
+/// to count every b2Alloc and b2Free and tag each allocation with its call
+/// site. Without it the counters stay zero.
+struct b2AllocStats
+{
+	int32 allocCount;	///< b2Alloc calls since b2ResetAllocStats
+	int32 freeCount;	///< b2Free calls since b2ResetAllocStats
+	int32 bytesInUse;	///< bytes allocated and not freed yet
+	int32 peakBytes;	///< the peak of bytesInUse since b2ResetAllocStats
+};
+
+/// A call site of b2Alloc and what it allocated since b2ResetAllocStats.
+struct b2AllocSite
+{
+	const char* file;
+	int32 line;
+	int32 count;
+	int32 bytes;
+};
+
+#if defined(B2_TRACK_ALLOCATIONS)
+void* b2AllocTagged(int32 size, const char* file, int32 line);
+#define b2Alloc(size) b2AllocTagged(size, __FILE__, __LINE__)
+#endif
+
+/// Get the heap counters. Safe to call from any thread.
+void b2GetAllocStats(b2AllocStats* stats);
+
+/// Zero the call counts, the peak and the call sites. Bytes in use are kept.
+void b2ResetAllocStats();
+
+/// Copy out the call sites that allocated since b2ResetAllocStats, most
+/// allocations first. Returns the number of sites copied.
+int32 b2GetAllocSites(b2AllocSite* sites, int32 capacity);
+
 /// Logging function.
 void b2Log(const char* string, ...);
 
@@ -0,0 +1,224 @@
+//
+//  b2Simd.h
+//  GameDevFramework
+//
+
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include "b2Settings.h"
+
+// A b2FloatW holds b2_simdWidth floats, one per lane. AVX2 is used when the
+// compiler targets it, otherwise SSE2 or NEON, and plain arrays elsewhere.
+// Loads and stores are unaligned so lane data can live in stack allocations.
+// b2MoveMaskW packs a comparison mask into one bit per lane, lane 0 lowest.
+// b2LoadRowsW and b2StoreRowsW move lanes in and out of one row of three
+// floats per lane, such as a b2Velocity. NULL rows load zeros and are not
+// stored.
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+#define b2_simdWidth 8
+typedef __m256 b2FloatW;
+
+inline b2FloatW b2ZeroW() { return _mm256_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 a) { return _mm256_set1_ps(a); }
+inline b2FloatW b2LoadW(const float32* p) { return _mm256_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm256_storeu_ps(p, a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm256_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm256_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm256_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm256_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm256_max_ps(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm256_and_ps(a, b); }
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask) { return _mm256_blendv_ps(a, b, mask); }
+inline int32 b2MoveMaskW(b2FloatW mask) { return _mm256_movemask_ps(mask); }
+
+// Rows of three floats go through SSE registers four at a time.
+inline __m128 b2LoadRow4(const float32* row)
+{
+	return row ? _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)row), _mm_load_ss(row + 2)) : _mm_setzero_ps();
+}
+
+inline void b2StoreRow4(float32* row, __m128 a)
+{
+	if (row)
+	{
+		_mm_storel_pi((__m64*)row, a);
+		_mm_store_ss(row + 2, _mm_movehl_ps(a, a));
+	}
+}
+
+inline void b2LoadRowsW(const float32* const* rows, b2FloatW& x, b2FloatW& y, b2FloatW& z)
+{
+	__m128 r0 = b2LoadRow4(rows[0]), r1 = b2LoadRow4(rows[1]), r2 = b2LoadRow4(rows[2]), r3 = b2LoadRow4(rows[3]);
+	__m128 r4 = b2LoadRow4(rows[4]), r5 = b2LoadRow4(rows[5]), r6 = b2LoadRow4(rows[6]), r7 = b2LoadRow4(rows[7]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+	x = _mm256_insertf128_ps(_mm256_castps128_ps256(r0), r4, 1);
+	y = _mm256_insertf128_ps(_mm256_castps128_ps256(r1), r5, 1);
+	z = _mm256_insertf128_ps(_mm256_castps128_ps256(r2), r6, 1);
+}
+
+inline void b2StoreRowsW(float32* const* rows, b2FloatW x, b2FloatW y, b2FloatW z)
+{
+	__m128 r0 = _mm256_castps256_ps128(x), r1 = _mm256_castps256_ps128(y), r2 = _mm256_castps256_ps128(z), r3 = _mm_setzero_ps();
+	__m128 r4 = _mm256_extractf128_ps(x, 1), r5 = _mm256_extractf128_ps(y, 1), r6 = _mm256_extractf128_ps(z, 1), r7 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+	b2StoreRow4(rows[0], r0); b2StoreRow4(rows[1], r1); b2StoreRow4(rows[2], r2); b2StoreRow4(rows[3], r3);
+	b2StoreRow4(rows[4], r4); b2StoreRow4(rows[5], r5); b2StoreRow4(rows[6], r6); b2StoreRow4(rows[7], r7);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+#include <emmintrin.h>
+#define b2_simdWidth 4
+typedef __m128 b2FloatW;
+
+inline b2FloatW b2ZeroW() { return _mm_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 a) { return _mm_set1_ps(a); }
+inline b2FloatW b2LoadW(const float32* p) { return _mm_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm_storeu_ps(p, a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm_and_ps(a, b); }
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask) { return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b)); }
+inline int32 b2MoveMaskW(b2FloatW mask) { return _mm_movemask_ps(mask); }
+
+inline __m128 b2LoadRow4(const float32* row)
+{
+	return row ? _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)row), _mm_load_ss(row + 2)) : _mm_setzero_ps();
+}
+
+inline void b2StoreRow4(float32* row, __m128 a)
+{
+	if (row)
+	{
+		_mm_storel_pi((__m64*)row, a);
+		_mm_store_ss(row + 2, _mm_movehl_ps(a, a));
+	}
+}
+
+inline void b2LoadRowsW(const float32* const* rows, b2FloatW& x, b2FloatW& y, b2FloatW& z)
+{
+	__m128 r0 = b2LoadRow4(rows[0]), r1 = b2LoadRow4(rows[1]), r2 = b2LoadRow4(rows[2]), r3 = b2LoadRow4(rows[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	x = r0;
+	y = r1;
+	z = r2;
+}
+
+inline void b2StoreRowsW(float32* const* rows, b2FloatW x, b2FloatW y, b2FloatW z)
+{
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	b2StoreRow4(rows[0], x);
+	b2StoreRow4(rows[1], y);
+	b2StoreRow4(rows[2], z);
+	b2StoreRow4(rows[3], w);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+#define b2_simdWidth 4
+typedef float32x4_t b2FloatW;
+
+inline b2FloatW b2ZeroW() { return vdupq_n_f32(0.0f); }
+inline b2FloatW b2SplatW(float32 a) { return vdupq_n_f32(a); }
+inline b2FloatW b2LoadW(const float32* p) { return vld1q_f32(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { vst1q_f32(p, a); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return vaddq_f32(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return vsubq_f32(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return vmulq_f32(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return vminq_f32(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return vmaxq_f32(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask) { return vbslq_f32(vreinterpretq_u32_f32(mask), b, a); }
+inline int32 b2MoveMaskW(b2FloatW mask)
+{
+	uint32x4_t m = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31);
+	return (int32)(vgetq_lane_u32(m, 0) | (vgetq_lane_u32(m, 1) << 1) | (vgetq_lane_u32(m, 2) << 2) | (vgetq_lane_u32(m, 3) << 3));
+}
+
+#else
+
+#define b2_simdWidth 4
+
+// Scalar fallback, masks are stored as 0 or 1.
+struct b2FloatW
+{
+	float32 x[b2_simdWidth];
+};
+
+inline b2FloatW b2SplatW(float32 a) { b2FloatW r; for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = a; return r; }
+inline b2FloatW b2ZeroW() { return b2SplatW(0.0f); }
+inline b2FloatW b2LoadW(const float32* p) { b2FloatW r; for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = p[i]; return r; }
+inline void b2StoreW(float32* p, b2FloatW a) { for (int32 i = 0; i < b2_simdWidth; ++i) p[i] = a.x[i]; }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] += b.x[i]; return a; }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] -= b.x[i]; return a; }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] *= b.x[i]; return a; }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = a.x[i] < b.x[i] ? a.x[i] : b.x[i]; return a; }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = a.x[i] > b.x[i] ? a.x[i] : b.x[i]; return a; }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = a.x[i] >= b.x[i] ? 1.0f : 0.0f; return a; }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = a.x[i] != 0.0f && b.x[i] != 0.0f ? 1.0f : 0.0f; return a; }
+inline b2FloatW b2BlendW(b2FloatW a, b2FloatW b, b2FloatW mask) { for (int32 i = 0; i < b2_simdWidth; ++i) a.x[i] = mask.x[i] != 0.0f ? b.x[i] : a.x[i]; return a; }
+inline int32 b2MoveMaskW(b2FloatW mask) { int32 r = 0; for (int32 i = 0; i < b2_simdWidth; ++i) r |= (mask.x[i] != 0.0f ? 1 : 0) << i; return r; }
+
+#endif
+
+#if !defined(__AVX2__) && !defined(__SSE2__) && !defined(_M_X64)
+
+inline void b2LoadRowsW(const float32* const* rows, b2FloatW& x, b2FloatW& y, b2FloatW& z)
+{
+	float32 lanes[3][b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		lanes[0][i] = rows[i] ? rows[i][0] : 0.0f;
+		lanes[1][i] = rows[i] ? rows[i][1] : 0.0f;
+		lanes[2][i] = rows[i] ? rows[i][2] : 0.0f;
+	}
+	x = b2LoadW(lanes[0]);
+	y = b2LoadW(lanes[1]);
+	z = b2LoadW(lanes[2]);
+}
+
+inline void b2StoreRowsW(float32* const* rows, b2FloatW x, b2FloatW y, b2FloatW z)
+{
+	float32 lanes[3][b2_simdWidth];
+	b2StoreW(lanes[0], x);
+	b2StoreW(lanes[1], y);
+	b2StoreW(lanes[2], z);
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		if (rows[i])
+		{
+			rows[i][0] = lanes[0][i];
+			rows[i][1] = lanes[1][i];
+			rows[i][2] = lanes[2][i];
+		}
+	}
+}
+
+#endif
+
+/// Cross product of two vectors given by lanes, returns the scalar z.
+inline b2FloatW b2CrossW(b2FloatW ax, b2FloatW ay, b2FloatW bx, b2FloatW by)
+{
+	return b2SubW(b2MulW(ax, by), b2MulW(ay, bx));
+}
+
+/// Clamp a between low and high, lane by lane.
+inline b2FloatW b2ClampW(b2FloatW a, b2FloatW low, b2FloatW high)
+{
+	return b2MaxW(low, b2MinW(a, high));
+}
+
+#endif
@@ -0,0 +1,91 @@
+//
+//  b2Snapshot.cpp
+//  GameDevFramework
+//
+
+#include "b2Snapshot.h"
+#include "b2Math.h"
+
+b2Snapshot::b2Snapshot()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_capacity = 0;
+}
+
+b2Snapshot::~b2Snapshot()
+{
+	b2Free(m_data);
+}
+
+void b2Snapshot::Clear()
+{
+	m_size = 0;
+}
+
+void b2Snapshot::Reserve(int32 size)
+{
+	if (size <= m_capacity)
+	{
+		return;
+	}
+
+	char* oldData = m_data;
+	m_capacity = size;
+	m_data = (char*)b2Alloc(m_capacity);
+	if (oldData)
+	{
+		memcpy(m_data, oldData, m_size);
+		b2Free(oldData);
+	}
+}
+
+void b2Snapshot::Assign(const void* data, int32 size)
+{
+	Clear();
+	Write(data, size);
+}
+
+void b2Snapshot::WriteAt(int32 position, const void* data, int32 size)
+{
+	b2Assert(0 <= position && 0 <= size && size <= m_size - position);
+	memcpy(m_data + position, data, size);
+}
+
+void b2Snapshot::Grow(int32 size)
+{
+	Reserve(b2Max(size, 2 * m_capacity));
+}
+
+b2SnapshotReader::b2SnapshotReader(const b2Snapshot& snapshot)
+{
+	m_data = (const char*)snapshot.GetData();
+	m_size = snapshot.GetSize();
+	m_position = 0;
+	m_failed = false;
+}
+
+b2SnapshotReader::b2SnapshotReader(const b2SnapshotReader& reader, int32 size)
+{
+	m_data = reader.m_data + reader.m_position;
+	m_size = size;
+	m_position = 0;
+	m_failed = reader.m_failed;
+	if (size < 0 || size > reader.m_size - reader.m_position)
+	{
+		m_size = 0;
+		m_failed = true;
+	}
+}
+
+void b2SnapshotReader::ReadPastEnd(void* data, int32 size)
+{
+	m_failed = true;
+	memset(data, 0, size);
+}
+
+void b2SnapshotReader::SetPosition(int32 position)
+{
+	b2Assert(0 <= position && position <= m_size);
+	m_position = position;
+}
@@ -0,0 +1,151 @@
+//
+//  b2Snapshot.h
+//  GameDevFramework
+//
+
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "b2Settings.h"
+#include <string.h>
+
+/// A growable byte buffer that b2World::SaveState writes a world into. Values
+/// are stored the way they are laid out in memory, so a snapshot can only be
+/// read back by the same build on the same platform. Clear keeps the buffer,
+/// so a snapshot that is saved into every step stops allocating once it has
+/// grown to the size of the world.
+class b2Snapshot
+{
+public:
+	b2Snapshot();
+	~b2Snapshot();
+
+	/// Drop the contents, keeping the buffer.
+	void Clear();
+
+	/// Grow the buffer so this many bytes fit without reallocating.
+	void Reserve(int32 size);
+
+	/// Replace the contents, for example with a snapshot read from a file.
+	void Assign(const void* data, int32 size);
+
+	/// Append raw bytes.
+	inline void Write(const void* data, int32 size);
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+	/// Overwrite bytes written earlier, like a size that is only known once
+	/// what it covers has been written.
+	void WriteAt(int32 position, const void* data, int32 size);
+
+	template <typename T>
+	void WriteAt(int32 position, const T& value)
+	{
+		WriteAt(position, &value, sizeof(T));
+	}
+
+	const void* GetData() const { return m_data; }
+	int32 GetSize() const { return m_size; }
+
+private:
+	b2Snapshot(const b2Snapshot&);
+	b2Snapshot& operator=(const b2Snapshot&);
+
+	void Grow(int32 size);
+
+	char* m_data;
+	int32 m_size;
+	int32 m_capacity;
+};
+
+/// Reads a b2Snapshot back in the order it was written. Reading past the end
+/// yields zeros and flags the reader as failed instead of reading out of bounds.
+class b2SnapshotReader
+{
+public:
+	b2SnapshotReader(const b2Snapshot& snapshot);
+
+	/// Read the next size bytes of another reader on their own, so whoever
+	/// reads them gets zeros past them instead of what follows. The other
+	/// reader doesn't move.
+	b2SnapshotReader(const b2SnapshotReader& reader, int32 size);
+
+	inline void Read(void* data, int32 size);
+
+	template <typename T>
+	T Read()
+	{
+		T value;
+		Read(&value, sizeof(T));
+		return value;
+	}
+
+	/// Move past bytes without reading them. Failing is the same as Read.
+	inline void Skip(int32 size);
+
+	/// Flag the contents as invalid, for checks made by the caller.
+	void Fail() { m_failed = true; }
+	bool HasFailed() const { return m_failed; }
+
+	int32 GetPosition() const { return m_position; }
+	void SetPosition(int32 position);
+
+	bool IsAtEnd() const { return m_position == m_size; }
+
+private:
+	void ReadPastEnd(void* data, int32 size);
+
+	const char* m_data;
+	int32 m_size;
+	int32 m_position;
+	bool m_failed;
+};
+
+// A world is written a field at a time, so the common case is kept inline.
+inline void b2Snapshot::Write(const void* data, int32 size)
+{
+	b2Assert(size >= 0);
+	if (m_size + size > m_capacity)
+	{
+		Grow(m_size + size);
+	}
+
+	if (size > 0)
+	{
+		memcpy(m_data + m_size, data, size);
+		m_size += size;
+	}
+}
+
+inline void b2SnapshotReader::Read(void* data, int32 size)
+{
+	b2Assert(size >= 0);
+	if (m_failed || size > m_size - m_position)
+	{
+		ReadPastEnd(data, size);
+		return;
+	}
+
+	if (size > 0)
+	{
+		memcpy(data, m_data + m_position, size);
+		m_position += size;
+	}
+}
+
+inline void b2SnapshotReader::Skip(int32 size)
+{
+	if (m_failed || size < 0 || size > m_size - m_position)
+	{
+		m_failed = true;
+		return;
+	}
+
+	m_position += size;
+}
+
+#endif
@@ -19,40 +19,85 @@
 #include "b2StackAllocator.h"
 #include "b2Math.h"
 
-b2StackAllocator::b2StackAllocator()
+b2StackAllocator::b2StackAllocator(int32 initialSize)
 {
-	m_index = 0;
+	m_segmentCount = 0;
+	m_segment = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
 	m_entryCount = 0;
+
+	AddSegment(b2Max(initialSize, 1));
+	ResetCounters();
 }
 
 b2StackAllocator::~b2StackAllocator()
 {
-	b2Assert(m_index == 0);
+	b2Assert(m_allocation == 0);
 	b2Assert(m_entryCount == 0);
+
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		b2Free(m_segments[i].data);
+	}
 }
 
-void* b2StackAllocator::Allocate(int32 size)
+void b2StackAllocator::AddSegment(int32 size)
 {
-	b2Assert(m_entryCount < b2_maxStackEntries);
+	b2Assert(m_segmentCount < b2_maxStackSegments);
 
-	b2StackEntry* entry = m_entries + m_entryCount;
-	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	b2StackSegment* segment = m_segments + m_segmentCount;
+	segment->data = (char*)b2Alloc(size);
+	segment->size = size;
+	segment->index = 0;
+	++m_segmentCount;
+	++m_growCount;
+}
+
+void b2StackAllocator::MergeSegments()
+{
+	int32 capacity = GetCapacity();
+	for (int32 i = 0; i < m_segmentCount; ++i)
 	{
-		entry->data = (char*)b2Alloc(size);
-		entry->usedMalloc = true;
+		b2Free(m_segments[i].data);
 	}
-	else
+
+	m_segmentCount = 0;
+	m_segment = 0;
+	AddSegment(capacity);
+}
+
+void* b2StackAllocator::Allocate(int32 size)
+{
+	b2Assert(m_entryCount < b2_maxStackEntries);
+
+	// The segments after the current one are empty.
+	if (m_segments[m_segment].index + size > m_segments[m_segment].size)
 	{
-		entry->data = m_data + m_index;
-		entry->usedMalloc = false;
-		m_index += size;
+		int32 segment = m_segment + 1;
+		while (segment < m_segmentCount && m_segments[segment].size < size)
+		{
+			++segment;
+		}
+
+		if (segment == m_segmentCount)
+		{
+			AddSegment(b2Max(size, 2 * m_segments[m_segmentCount - 1].size));
+		}
+
+		m_segment = segment;
 	}
 
+	b2StackSegment* segment = m_segments + m_segment;
+	b2StackEntry* entry = m_entries + m_entryCount;
+	entry->data = segment->data + segment->index;
+	entry->size = size;
+	entry->segment = m_segment;
+	segment->index += size;
+
 	m_allocation += size;
 	m_maxAllocation = b2Max(m_maxAllocation, m_allocation);
+	m_peakAllocation = b2Max(m_peakAllocation, m_allocation);
 	++m_entryCount;
 
 	return entry->data;
@@ -63,16 +108,22 @@ void b2StackAllocator::Free(void* p)
 	b2Assert(m_entryCount > 0);
 	b2StackEntry* entry = m_entries + m_entryCount - 1;
 	b2Assert(p == entry->data);
-	if (entry->usedMalloc)
+	m_segments[entry->segment].index -= entry->size;
+	m_allocation -= entry->size;
+	--m_entryCount;
+
+	if (m_entryCount > 0)
 	{
-		b2Free(p);
+		m_segment = m_entries[m_entryCount - 1].segment;
 	}
 	else
 	{
-		m_index -= entry->size;
+		m_segment = 0;
+		if (m_segmentCount > 1)
+		{
+			MergeSegments();
+		}
 	}
-	m_allocation -= entry->size;
-	--m_entryCount;
 
 	p = NULL;
 }
@@ -81,3 +132,36 @@ int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	int32 capacity = 0;
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		capacity += m_segments[i].size;
+	}
+	return capacity;
+}
+
+void b2StackAllocator::Reserve(int32 size)
+{
+	if (m_entryCount > 0 || GetCapacity() >= size)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		b2Free(m_segments[i].data);
+	}
+
+	m_segmentCount = 0;
+	m_segment = 0;
+	AddSegment(size);
+}
+
+void b2StackAllocator::ResetCounters()
+{
+	m_peakAllocation = m_allocation;
+	m_growCount = 0;
+}
@@ -23,21 +23,33 @@
 
 const int32 b2_stackSize = 100 * 1024;	// 100k
 const int32 b2_maxStackEntries = 32;
+const int32 b2_maxStackSegments = 16;
 
 struct b2StackEntry
 {
 	char* data;
 	int32 size;
-	bool usedMalloc;
+	int32 segment;
+};
+
+struct b2StackSegment
+{
+	char* data;
+	int32 size;
+	int32 index;
 };
 
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// An allocation that doesn't fit grows the stack by a segment at least
+// twice the size of the last one. When the stack empties the segments are
+// merged into one, so after the first steps of a scene it stops growing
+// and never touches the heap.
 class b2StackAllocator
 {
 public:
-	b2StackAllocator();
+	b2StackAllocator(int32 initialSize = b2_stackSize);
 	~b2StackAllocator();
 
 	void* Allocate(int32 size);
@@ -45,14 +57,34 @@ public:
 
 	int32 GetMaxAllocation() const;
 
+	// Get the bytes reserved over all segments.
+	int32 GetCapacity() const;
+
+	// Replace the segments by one of at least this size. Only an empty
+	// stack can be reserved, otherwise this does nothing.
+	void Reserve(int32 size);
+
+	// Get the peak allocation and the number of heap allocations made to
+	// grow the stack since the last call to ResetCounters.
+	int32 GetPeakAllocation() const { return m_peakAllocation; }
+	int32 GetGrowCount() const { return m_growCount; }
+	void ResetCounters();
+
 private:
 
-	char m_data[b2_stackSize];
-	int32 m_index;
+	void AddSegment(int32 size);
+	void MergeSegments();
+
+	b2StackSegment m_segments[b2_maxStackSegments];
+	int32 m_segmentCount;
+	int32 m_segment;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
 
+	int32 m_peakAllocation;
+	int32 m_growCount;
+
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
 };
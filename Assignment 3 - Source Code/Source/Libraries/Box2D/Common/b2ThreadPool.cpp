@@ -0,0 +1,160 @@
+//
+//  b2ThreadPool.cpp
+//  GameDevFramework
+//
+
+#include "b2ThreadPool.h"
+#include "b2Math.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct b2ThreadPoolState
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// The job being run, guarded by mutex and published through generation.
+	b2ThreadTask* task;
+	int32 count;
+	int32 grainSize;
+	uint32 generation;
+	int32 activeWorkers;
+	bool quit;
+
+	std::atomic<int32> next;
+};
+
+b2ThreadPool::b2ThreadPool(int32 threadCount)
+{
+	m_threadCount = b2Max(threadCount, 1);
+
+	m_state = new (b2Alloc(sizeof(b2ThreadPoolState))) b2ThreadPoolState;
+	m_state->task = NULL;
+	m_state->count = 0;
+	m_state->grainSize = 1;
+	m_state->generation = 0;
+	m_state->activeWorkers = 0;
+	m_state->quit = false;
+	m_state->next = 0;
+
+	for (int32 i = 1; i < m_threadCount; ++i)
+	{
+		m_state->threads.push_back(std::thread(&b2ThreadPool::WorkerMain, this, i));
+	}
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->quit = true;
+	}
+	m_state->wake.notify_all();
+
+	for (size_t i = 0; i < m_state->threads.size(); ++i)
+	{
+		m_state->threads[i].join();
+	}
+
+	m_state->~b2ThreadPoolState();
+	b2Free(m_state);
+}
+
+void b2ThreadPool::Run(b2ThreadTask* task, int32 count, int32 grainSize)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	grainSize = b2Max(grainSize, 1);
+
+	// Not worth waking anybody up for a single chunk.
+	if (m_threadCount == 1 || count <= grainSize)
+	{
+		task->Execute(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->task = task;
+		m_state->count = count;
+		m_state->grainSize = grainSize;
+		m_state->next = 0;
+		m_state->activeWorkers = m_threadCount - 1;
+		++m_state->generation;
+	}
+	m_state->wake.notify_all();
+
+	Drain(0);
+
+	// The task must outlive every worker that may still be reading it.
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	while (m_state->activeWorkers > 0)
+	{
+		m_state->done.wait(lock);
+	}
+	m_state->task = NULL;
+}
+
+void b2ThreadPool::WorkerMain(int32 workerIndex)
+{
+	uint32 generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_state->mutex);
+			while (m_state->quit == false && m_state->generation == generation)
+			{
+				m_state->wake.wait(lock);
+			}
+
+			if (m_state->quit)
+			{
+				return;
+			}
+
+			generation = m_state->generation;
+		}
+
+		Drain(workerIndex);
+
+		bool last = false;
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			--m_state->activeWorkers;
+			last = m_state->activeWorkers == 0;
+		}
+
+		if (last)
+		{
+			m_state->done.notify_one();
+		}
+	}
+}
+
+void b2ThreadPool::Drain(int32 workerIndex)
+{
+	b2ThreadTask* task = m_state->task;
+	const int32 count = m_state->count;
+	const int32 grainSize = m_state->grainSize;
+
+	for (;;)
+	{
+		int32 begin = m_state->next.fetch_add(grainSize);
+		if (begin >= count)
+		{
+			break;
+		}
+
+		int32 end = b2Min(begin + grainSize, count);
+		task->Execute(begin, end, workerIndex);
+	}
+}
@@ -0,0 +1,48 @@
+//
+//  b2ThreadPool.h
+//  GameDevFramework
+//
+
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include "b2Settings.h"
+
+/// Implement this to run work on a b2ThreadPool. Execute is called
+/// concurrently from several threads, each call gets a disjoint range.
+class b2ThreadTask
+{
+public:
+	virtual ~b2ThreadTask() {}
+
+	/// Process the items in [begin, end).
+	/// @param workerIndex in [0, thread count), stable for the calling thread.
+	virtual void Execute(int32 begin, int32 end, int32 workerIndex) = 0;
+};
+
+struct b2ThreadPoolState;
+
+/// A fixed set of worker threads used to split per step work. The thread
+/// calling Run takes part as worker 0, so a pool of one thread spawns nothing.
+class b2ThreadPool
+{
+public:
+	b2ThreadPool(int32 threadCount);
+	~b2ThreadPool();
+
+	/// Get the number of workers, including the calling thread.
+	int32 GetThreadCount() const { return m_threadCount; }
+
+	/// Run the task over [0, count) in chunks of grainSize items and
+	/// block until every item is processed.
+	void Run(b2ThreadTask* task, int32 count, int32 grainSize);
+
+private:
+	void WorkerMain(int32 workerIndex);
+	void Drain(int32 workerIndex);
+
+	int32 m_threadCount;
+	b2ThreadPoolState* m_state;
+};
+
+#endif
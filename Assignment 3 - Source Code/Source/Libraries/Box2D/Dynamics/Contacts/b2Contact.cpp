@@ -98,6 +98,20 @@ b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtu
 	}
 }
 
+// Whether Create makes a contact of these shape types without swapping them.
+bool b2Contact::IsPrimary(b2Shape::Type typeA, b2Shape::Type typeB)
+{
+	if (s_initialized == false)
+	{
+		InitializeRegisters();
+		s_initialized = true;
+	}
+
+	b2Assert(0 <= typeA && typeA < b2Shape::e_typeCount);
+	b2Assert(0 <= typeB && typeB < b2Shape::e_typeCount);
+	return s_registers[typeA][typeB].createFcn && s_registers[typeA][typeB].primary;
+}
+
 void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 {
 	b2Assert(s_initialized == true);
@@ -129,6 +143,7 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_indexB = indexB;
 
 	m_manifold.pointCount = 0;
+	m_speculativeManifold.pointCount = 0;
 
 	m_prev = NULL;
 	m_next = NULL;
@@ -144,6 +159,7 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_nodeB.other = NULL;
 
 	m_toiCount = 0;
+	m_toiOrder = 0;
 
 	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
 	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
@@ -153,66 +169,109 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 
 // Update the contact manifold and touching status.
 // Note: do not assume the fixture AABBs are overlapping or are valid.
-void b2Contact::Update(b2ContactListener* listener)
+void b2Contact::Update(b2ContactListener* listener, b2WarmStartCache* cache)
 {
-	b2Manifold oldManifold = m_manifold;
-
-	// Re-enable this contact.
-	m_flags |= e_enabledFlag;
+	b2Manifold manifold;
+	bool touching = ComputeManifold(&manifold, cache);
+	Commit(manifold, touching, listener, cache);
+}
 
-	bool touching = false;
-	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+// Evaluate the new manifold without modifying the contact or its bodies. This only
+// reads the fixtures and body transforms, so contacts may be evaluated concurrently.
+bool b2Contact::ComputeManifold(b2Manifold* manifold, const b2WarmStartCache* cache)
+{
+	// Start from the current manifold so fields the collider leaves alone keep their values.
+	*manifold = m_manifold;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
 	bool sensor = sensorA || sensorB;
 
-	b2Body* bodyA = m_fixtureA->GetBody();
-	b2Body* bodyB = m_fixtureB->GetBody();
-	const b2Transform& xfA = bodyA->GetTransform();
-	const b2Transform& xfB = bodyB->GetTransform();
+	const b2Transform& xfA = m_fixtureA->GetBody()->GetTransform();
+	const b2Transform& xfB = m_fixtureB->GetBody()->GetTransform();
 
 	// Is this contact a sensor?
 	if (sensor)
 	{
 		const b2Shape* shapeA = m_fixtureA->GetShape();
 		const b2Shape* shapeB = m_fixtureB->GetShape();
-		touching = b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		manifold->pointCount = 0;
+		return b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 	}
-	else
+
+	Evaluate(manifold, xfA, xfB);
+
+	// A contact that starts touching matches against the cached impulses of its
+	// fixture pair, left by this contact or by one the broad-phase destroyed in
+	// the last few steps. The cache drops them when they expire.
+	const b2ManifoldPoint* oldPoints = m_manifold.points;
+	int32 oldPointCount = m_manifold.pointCount;
+	b2ManifoldPoint cachedPoints[b2_maxManifoldPoints];
+	if (oldPointCount == 0 && manifold->pointCount > 0 && cache)
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		oldPoints = cachedPoints;
+		oldPointCount = cache->GetPoints(this, cachedPoints);
+	}
 
-		// Match old contact ids to new contact ids and copy the
-		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+	// Match old contact ids to new contact ids and copy the
+	// stored impulses to warm start the solver.
+	for (int32 i = 0; i < manifold->pointCount; ++i)
+	{
+		b2ManifoldPoint* mp2 = manifold->points + i;
+		mp2->normalImpulse = 0.0f;
+		mp2->tangentImpulse = 0.0f;
+		b2ContactID id2 = mp2->id;
+
+		for (int32 j = 0; j < oldPointCount; ++j)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
-			mp2->normalImpulse = 0.0f;
-			mp2->tangentImpulse = 0.0f;
-			b2ContactID id2 = mp2->id;
+			const b2ManifoldPoint* mp1 = oldPoints + j;
 
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			if (mp1->id.key == id2.key)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
-
-				if (mp1->id.key == id2.key)
-				{
-					mp2->normalImpulse = mp1->normalImpulse;
-					mp2->tangentImpulse = mp1->tangentImpulse;
-					break;
-				}
+				mp2->normalImpulse = mp1->normalImpulse;
+				mp2->tangentImpulse = mp1->tangentImpulse;
+				break;
 			}
 		}
+	}
+
+	return manifold->pointCount > 0;
+}
 
-		if (touching != wasTouching)
+// Store a manifold from ComputeManifold, wake the bodies if the touching state
+// changed and report the change to the listener.
+void b2Contact::Commit(const b2Manifold& manifold, bool touching, b2ContactListener* listener, b2WarmStartCache* cache)
+{
+	b2Manifold oldManifold = m_manifold;
+	m_manifold = manifold;
+
+	// Re-enable this contact.
+	m_flags |= e_enabledFlag;
+
+	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+
+	bool sensorA = m_fixtureA->IsSensor();
+	bool sensorB = m_fixtureB->IsSensor();
+	bool sensor = sensorA || sensorB;
+
+	if (sensor == false && touching != wasTouching)
+	{
+		m_fixtureA->GetBody()->SetAwake(true);
+		m_fixtureB->GetBody()->SetAwake(true);
+	}
+
+	// Keep the impulses around in case the shapes touch again in the next few steps.
+	if (sensor == false && cache)
+	{
+		if (oldManifold.pointCount > 0 && manifold.pointCount == 0)
+		{
+			cache->Store(this, oldManifold);
+		}
+		else if (oldManifold.pointCount == 0 && manifold.pointCount > 0)
 		{
-			bodyA->SetAwake(true);
-			bodyB->SetAwake(true);
+			cache->Consume(this);
 		}
 	}
 
@@ -240,3 +299,72 @@ void b2Contact::Update(b2ContactListener* listener)
 		listener->PreSolve(this, &oldManifold);
 	}
 }
+
+// The closest points of the core shapes stand in for a contact point, with the
+// normal from A to B. The contact solver only lets the bodies close the gap
+// between them in the next step, so a fast body stops at the surface instead
+// of needing a TOI sub-step.
+void b2Contact::UpdateSpeculative(float32 dt)
+{
+	m_flags &= ~e_speculativeFlag;
+
+	if ((m_flags & (e_touchingFlag | e_enabledFlag)) != e_enabledFlag)
+	{
+		return;
+	}
+
+	if (m_fixtureA->IsSensor() || m_fixtureB->IsSensor())
+	{
+		return;
+	}
+
+	const b2Body* bodyA = m_fixtureA->GetBody();
+	const b2Body* bodyB = m_fixtureB->GetBody();
+
+	// How far the bodies could close the gap this step.
+	float32 margin = b2Distance(bodyA->GetLinearVelocity(), bodyB->GetLinearVelocity()) * dt;
+	if (margin < b2_linearSlop)
+	{
+		return;
+	}
+
+	const b2Shape* shapeA = m_fixtureA->GetShape();
+	const b2Shape* shapeB = m_fixtureB->GetShape();
+	const b2Transform& xfA = bodyA->GetTransform();
+	const b2Transform& xfB = bodyB->GetTransform();
+
+	b2DistanceInput input;
+	input.proxyA.Set(shapeA, m_indexA);
+	input.proxyB.Set(shapeB, m_indexB);
+	input.transformA = xfA;
+	input.transformB = xfB;
+	input.useRadii = false;
+
+	b2SimplexCache cache;
+	cache.count = 0;
+
+	b2DistanceOutput output;
+	b2Distance(&output, &cache, &input);
+
+	// Overlapping cores have no normal, the regular manifold handles those.
+	float32 separation = output.distance - shapeA->m_radius - shapeB->m_radius;
+	if (output.distance < b2_epsilon || separation > margin)
+	{
+		return;
+	}
+
+	b2Vec2 normal = (1.0f / output.distance) * (output.pointB - output.pointA);
+
+	m_speculativeManifold.type = b2Manifold::e_faceA;
+	m_speculativeManifold.pointCount = 1;
+	m_speculativeManifold.localNormal = b2MulT(xfA.q, normal);
+	m_speculativeManifold.localPoint = b2MulT(xfA, output.pointA);
+
+	b2ManifoldPoint* point = m_speculativeManifold.points + 0;
+	point->localPoint = b2MulT(xfB, output.pointB);
+	point->normalImpulse = 0.0f;
+	point->tangentImpulse = 0.0f;
+	point->id.key = 0;
+
+	m_flags |= e_speculativeFlag;
+}
@@ -31,6 +31,7 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+class b2WarmStartCache;
 
 /// Friction mixing law. The idea is to allow either fixture to drive the restitution to zero.
 /// For example, anything slides on ice.
@@ -89,6 +90,10 @@ public:
 	/// Is this contact touching?
 	bool IsTouching() const;
 
+	/// Is this contact close enough to be solved speculatively? Only set on contacts that
+	/// are not touching, see b2World::SetSpeculativeContacts.
+	bool IsSpeculative() const;
+
 	/// Enable/disable this contact. This can be used inside the pre-solve
 	/// contact listener. The contact is only disabled for the current
 	/// time step (or sub-step in continuous collisions).
@@ -170,7 +175,13 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// This contact is waiting in b2World::SolveTOI for its TOI to be computed
+		e_toiPendingFlag	= 0x0040,
+
+		// This contact is not touching but m_speculativeManifold holds its closest points
+		e_speculativeFlag	= 0x0080
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
@@ -180,6 +191,7 @@ protected:
 						b2Shape::Type typeA, b2Shape::Type typeB);
 	static void InitializeRegisters();
 	static b2Contact* Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator);
+	static bool IsPrimary(b2Shape::Type typeA, b2Shape::Type typeB);
 	static void Destroy(b2Contact* contact, b2Shape::Type typeA, b2Shape::Type typeB, b2BlockAllocator* allocator);
 	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
 
@@ -187,7 +199,19 @@ protected:
 	b2Contact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
 	virtual ~b2Contact() {}
 
-	void Update(b2ContactListener* listener);
+	void Update(b2ContactListener* listener, b2WarmStartCache* cache);
+
+	// Update split in two for the parallel narrow phase. ComputeManifold does not
+	// modify the contact and is safe to call concurrently on different contacts.
+	bool ComputeManifold(b2Manifold* manifold, const b2WarmStartCache* cache);
+	void Commit(const b2Manifold& manifold, bool touching, b2ContactListener* listener, b2WarmStartCache* cache);
+
+	// Build the speculative manifold if the shapes are not touching but are within reach
+	// of each other over the next dt. Like ComputeManifold it only writes this contact.
+	void UpdateSpeculative(float32 dt);
+
+	// The manifold the contact solver works on.
+	b2Manifold* GetSolverManifold();
 
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
@@ -209,9 +233,11 @@ protected:
 	int32 m_indexB;
 
 	b2Manifold m_manifold;
+	b2Manifold m_speculativeManifold;
 
 	int32 m_toiCount;
 	float32 m_toi;
+	int32 m_toiOrder;	// place in the contact list, numbered by b2World::SolveTOI
 
 	float32 m_friction;
 	float32 m_restitution;
@@ -261,6 +287,16 @@ inline bool b2Contact::IsTouching() const
 	return (m_flags & e_touchingFlag) == e_touchingFlag;
 }
 
+inline bool b2Contact::IsSpeculative() const
+{
+	return (m_flags & e_speculativeFlag) == e_speculativeFlag;
+}
+
+inline b2Manifold* b2Contact::GetSolverManifold()
+{
+	return (m_flags & e_speculativeFlag) ? &m_speculativeManifold : &m_manifold;
+}
+
 inline b2Contact* b2Contact::GetNext()
 {
 	return m_next;
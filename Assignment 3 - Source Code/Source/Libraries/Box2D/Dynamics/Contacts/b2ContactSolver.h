@@ -26,6 +26,7 @@
 class b2Contact;
 class b2Body;
 class b2StackAllocator;
+class b2SimdContactSolver;
 struct b2ContactPositionConstraint;
 
 struct b2VelocityConstraintPoint
@@ -54,6 +55,7 @@ struct b2ContactVelocityConstraint
 	float32 tangentSpeed;
 	int32 pointCount;
 	int32 contactIndex;
+	bool speculative;
 };
 
 struct b2ContactSolverDef
@@ -76,11 +78,15 @@ public:
 
 	void WarmStart();
 	void SolveVelocityConstraints();
+	void SolveVelocityConstraint(b2ContactVelocityConstraint* vc);
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
+	/// The stack allocator bytes the constraints of this many contacts take.
+	static int32 GetConstraintBytes(int32 count);
+
 	b2TimeStep m_step;
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
@@ -89,6 +95,7 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+	b2SimdContactSolver* m_simdSolver;
 };
 
 #endif
@@ -0,0 +1,464 @@
+//
+//  b2SimdContactSolver.cpp
+//  GameDevFramework
+//
+
+#include "b2SimdContactSolver.h"
+#include "b2ContactSolver.h"
+#include "b2StackAllocator.h"
+
+// Colors beyond this go to one constraint batches.
+#define b2_simdMaxColors 64
+
+struct b2SimdConstraintPoint
+{
+	float32 rAx[b2_simdWidth];
+	float32 rAy[b2_simdWidth];
+	float32 rBx[b2_simdWidth];
+	float32 rBy[b2_simdWidth];
+	float32 normalImpulse[b2_simdWidth];
+	float32 tangentImpulse[b2_simdWidth];
+	float32 normalMass[b2_simdWidth];
+	float32 tangentMass[b2_simdWidth];
+	float32 velocityBias[b2_simdWidth];
+};
+
+// b2_simdWidth contacts with the same point count and no body in common.
+// The velocities are rows of the solver's b2Velocity array. Unused lanes have
+// a constraint index of -1, NULL velocities and no mass.
+struct b2SimdConstraintBatch
+{
+	int32 constraintIndex[b2_simdWidth];
+	float32* velocityA[b2_simdWidth];
+	float32* velocityB[b2_simdWidth];
+	int32 pointCount;
+	float32 invMassA[b2_simdWidth];
+	float32 invIA[b2_simdWidth];
+	float32 invMassB[b2_simdWidth];
+	float32 invIB[b2_simdWidth];
+	float32 normalX[b2_simdWidth];
+	float32 normalY[b2_simdWidth];
+	float32 friction[b2_simdWidth];
+	float32 tangentSpeed[b2_simdWidth];
+	b2SimdConstraintPoint points[b2_maxManifoldPoints];
+
+	// Block solver, both matrices stored as ex.x, ex.y, ey.x, ey.y.
+	float32 K[4][b2_simdWidth];
+	float32 normalMass[4][b2_simdWidth];
+};
+
+// Velocities of the bodies on one side of a batch.
+struct b2SimdBodyVelocity
+{
+	b2FloatW vx, vy, w;
+};
+
+static void b2PackLane(b2SimdConstraintBatch* b, int32 lane, const b2ContactVelocityConstraint* vc, int32 constraintIndex,
+					   b2Velocity* velocities)
+{
+	b->constraintIndex[lane] = constraintIndex;
+	b->velocityA[lane] = &velocities[vc->indexA].v.x;
+	b->velocityB[lane] = &velocities[vc->indexB].v.x;
+	b->invMassA[lane] = vc->invMassA;
+	b->invIA[lane] = vc->invIA;
+	b->invMassB[lane] = vc->invMassB;
+	b->invIB[lane] = vc->invIB;
+	b->normalX[lane] = vc->normal.x;
+	b->normalY[lane] = vc->normal.y;
+	b->friction[lane] = vc->friction;
+	b->tangentSpeed[lane] = vc->tangentSpeed;
+
+	for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+	{
+		const b2VelocityConstraintPoint* vcp = vc->points + j;
+		b2SimdConstraintPoint* p = b->points + j;
+		bool used = j < vc->pointCount;
+		p->rAx[lane] = used ? vcp->rA.x : 0.0f;
+		p->rAy[lane] = used ? vcp->rA.y : 0.0f;
+		p->rBx[lane] = used ? vcp->rB.x : 0.0f;
+		p->rBy[lane] = used ? vcp->rB.y : 0.0f;
+		p->normalImpulse[lane] = used ? vcp->normalImpulse : 0.0f;
+		p->tangentImpulse[lane] = used ? vcp->tangentImpulse : 0.0f;
+		p->normalMass[lane] = used ? vcp->normalMass : 0.0f;
+		p->tangentMass[lane] = used ? vcp->tangentMass : 0.0f;
+		p->velocityBias[lane] = used ? vcp->velocityBias : 0.0f;
+	}
+
+	b->K[0][lane] = vc->K.ex.x;
+	b->K[1][lane] = vc->K.ex.y;
+	b->K[2][lane] = vc->K.ey.x;
+	b->K[3][lane] = vc->K.ey.y;
+	b->normalMass[0][lane] = vc->normalMass.ex.x;
+	b->normalMass[1][lane] = vc->normalMass.ex.y;
+	b->normalMass[2][lane] = vc->normalMass.ey.x;
+	b->normalMass[3][lane] = vc->normalMass.ey.y;
+}
+
+static void b2PackEmptyLane(b2SimdConstraintBatch* b, int32 lane)
+{
+	b->constraintIndex[lane] = -1;
+	b->velocityA[lane] = NULL;
+	b->velocityB[lane] = NULL;
+	b->invMassA[lane] = 0.0f;
+	b->invIA[lane] = 0.0f;
+	b->invMassB[lane] = 0.0f;
+	b->invIB[lane] = 0.0f;
+	b->normalX[lane] = 0.0f;
+	b->normalY[lane] = 0.0f;
+	b->friction[lane] = 0.0f;
+	b->tangentSpeed[lane] = 0.0f;
+
+	for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+	{
+		b2SimdConstraintPoint* p = b->points + j;
+		p->rAx[lane] = 0.0f;
+		p->rAy[lane] = 0.0f;
+		p->rBx[lane] = 0.0f;
+		p->rBy[lane] = 0.0f;
+		p->normalImpulse[lane] = 0.0f;
+		p->tangentImpulse[lane] = 0.0f;
+		p->normalMass[lane] = 0.0f;
+		p->tangentMass[lane] = 0.0f;
+		p->velocityBias[lane] = 0.0f;
+	}
+
+	// Identity keeps the block solver finite, every impulse stays zero.
+	b->K[0][lane] = 1.0f;
+	b->K[1][lane] = 0.0f;
+	b->K[2][lane] = 0.0f;
+	b->K[3][lane] = 1.0f;
+	b->normalMass[0][lane] = 1.0f;
+	b->normalMass[1][lane] = 0.0f;
+	b->normalMass[2][lane] = 0.0f;
+	b->normalMass[3][lane] = 1.0f;
+}
+
+static b2SimdBodyVelocity b2GatherVelocities(float32* const* rows)
+{
+	b2SimdBodyVelocity result;
+	b2LoadRowsW(rows, result.vx, result.vy, result.w);
+	return result;
+}
+
+// Lanes may share a body that has no mass, writing it back leaves it unchanged.
+static void b2ScatterVelocities(float32* const* rows, const b2SimdBodyVelocity& v)
+{
+	b2StoreRowsW(rows, v.vx, v.vy, v.w);
+}
+
+// Relative velocity at a contact point along the direction (dx, dy).
+static b2FloatW b2RelativeVelocityW(const b2SimdBodyVelocity& a, const b2SimdBodyVelocity& b,
+									b2FloatW rAx, b2FloatW rAy, b2FloatW rBx, b2FloatW rBy, b2FloatW dx, b2FloatW dy)
+{
+	// dv = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+	b2FloatW dvx = b2SubW(b2SubW(b2SubW(b.vx, b2MulW(b.w, rBy)), a.vx), b2MulW(b2SubW(b2ZeroW(), a.w), rAy));
+	b2FloatW dvy = b2SubW(b2SubW(b2AddW(b.vy, b2MulW(b.w, rBx)), a.vy), b2MulW(a.w, rAx));
+	return b2AddW(b2MulW(dvx, dx), b2MulW(dvy, dy));
+}
+
+// Apply the impulse (px, py) at rA on body A and at rB on body B.
+static void b2ApplyImpulseW(b2SimdBodyVelocity& a, b2SimdBodyVelocity& b, b2FloatW mA, b2FloatW iA, b2FloatW mB, b2FloatW iB,
+							b2FloatW rAx, b2FloatW rAy, b2FloatW rBx, b2FloatW rBy, b2FloatW px, b2FloatW py)
+{
+	a.vx = b2SubW(a.vx, b2MulW(mA, px));
+	a.vy = b2SubW(a.vy, b2MulW(mA, py));
+	a.w = b2SubW(a.w, b2MulW(iA, b2CrossW(rAx, rAy, px, py)));
+
+	b.vx = b2AddW(b.vx, b2MulW(mB, px));
+	b.vy = b2AddW(b.vy, b2MulW(mB, py));
+	b.w = b2AddW(b.w, b2MulW(iB, b2CrossW(rBx, rBy, px, py)));
+}
+
+// Same steps as b2ContactSolver::SolveVelocityConstraints, lane by lane.
+static void b2SolveBatch(b2SimdConstraintBatch* c)
+{
+	b2SimdBodyVelocity a = b2GatherVelocities(c->velocityA);
+	b2SimdBodyVelocity b = b2GatherVelocities(c->velocityB);
+
+	b2FloatW mA = b2LoadW(c->invMassA);
+	b2FloatW iA = b2LoadW(c->invIA);
+	b2FloatW mB = b2LoadW(c->invMassB);
+	b2FloatW iB = b2LoadW(c->invIB);
+
+	b2FloatW normalX = b2LoadW(c->normalX);
+	b2FloatW normalY = b2LoadW(c->normalY);
+
+	// tangent = b2Cross(normal, 1.0f)
+	b2FloatW tangentX = normalY;
+	b2FloatW tangentY = b2SubW(b2ZeroW(), normalX);
+	b2FloatW friction = b2LoadW(c->friction);
+	b2FloatW tangentSpeed = b2LoadW(c->tangentSpeed);
+	b2FloatW zero = b2ZeroW();
+
+	int32 pointCount = c->pointCount;
+
+	// Solve tangent constraints first because non-penetration is more important
+	// than friction.
+	for (int32 j = 0; j < pointCount; ++j)
+	{
+		b2SimdConstraintPoint* p = c->points + j;
+		b2FloatW rAx = b2LoadW(p->rAx), rAy = b2LoadW(p->rAy);
+		b2FloatW rBx = b2LoadW(p->rBx), rBy = b2LoadW(p->rBy);
+
+		b2FloatW vt = b2SubW(b2RelativeVelocityW(a, b, rAx, rAy, rBx, rBy, tangentX, tangentY), tangentSpeed);
+		b2FloatW lambda = b2MulW(b2LoadW(p->tangentMass), b2SubW(zero, vt));
+
+		b2FloatW maxFriction = b2MulW(friction, b2LoadW(p->normalImpulse));
+		b2FloatW oldImpulse = b2LoadW(p->tangentImpulse);
+		b2FloatW newImpulse = b2ClampW(b2AddW(oldImpulse, lambda), b2SubW(zero, maxFriction), maxFriction);
+		lambda = b2SubW(newImpulse, oldImpulse);
+		b2StoreW(p->tangentImpulse, newImpulse);
+
+		b2ApplyImpulseW(a, b, mA, iA, mB, iB, rAx, rAy, rBx, rBy, b2MulW(lambda, tangentX), b2MulW(lambda, tangentY));
+	}
+
+	if (pointCount == 1)
+	{
+		b2SimdConstraintPoint* p = c->points + 0;
+		b2FloatW rAx = b2LoadW(p->rAx), rAy = b2LoadW(p->rAy);
+		b2FloatW rBx = b2LoadW(p->rBx), rBy = b2LoadW(p->rBy);
+
+		b2FloatW vn = b2RelativeVelocityW(a, b, rAx, rAy, rBx, rBy, normalX, normalY);
+		b2FloatW lambda = b2MulW(b2SubW(zero, b2LoadW(p->normalMass)), b2SubW(vn, b2LoadW(p->velocityBias)));
+
+		b2FloatW oldImpulse = b2LoadW(p->normalImpulse);
+		b2FloatW newImpulse = b2MaxW(b2AddW(oldImpulse, lambda), zero);
+		lambda = b2SubW(newImpulse, oldImpulse);
+		b2StoreW(p->normalImpulse, newImpulse);
+
+		b2ApplyImpulseW(a, b, mA, iA, mB, iB, rAx, rAy, rBx, rBy, b2MulW(lambda, normalX), b2MulW(lambda, normalY));
+	}
+	else
+	{
+		// Block solver, see b2ContactSolver::SolveVelocityConstraints. Every case
+		// is evaluated and the first valid one is selected per lane. When no case
+		// is valid the impulse is left as it was.
+		b2SimdConstraintPoint* p1 = c->points + 0;
+		b2SimdConstraintPoint* p2 = c->points + 1;
+		b2FloatW r1Ax = b2LoadW(p1->rAx), r1Ay = b2LoadW(p1->rAy);
+		b2FloatW r1Bx = b2LoadW(p1->rBx), r1By = b2LoadW(p1->rBy);
+		b2FloatW r2Ax = b2LoadW(p2->rAx), r2Ay = b2LoadW(p2->rAy);
+		b2FloatW r2Bx = b2LoadW(p2->rBx), r2By = b2LoadW(p2->rBy);
+
+		b2FloatW ax = b2LoadW(p1->normalImpulse);
+		b2FloatW ay = b2LoadW(p2->normalImpulse);
+
+		b2FloatW vn1 = b2RelativeVelocityW(a, b, r1Ax, r1Ay, r1Bx, r1By, normalX, normalY);
+		b2FloatW vn2 = b2RelativeVelocityW(a, b, r2Ax, r2Ay, r2Bx, r2By, normalX, normalY);
+
+		b2FloatW kExX = b2LoadW(c->K[0]), kExY = b2LoadW(c->K[1]);
+		b2FloatW kEyX = b2LoadW(c->K[2]), kEyY = b2LoadW(c->K[3]);
+
+		// b = vn - velocityBias - K * a
+		b2FloatW bx = b2SubW(b2SubW(vn1, b2LoadW(p1->velocityBias)), b2AddW(b2MulW(kExX, ax), b2MulW(kEyX, ay)));
+		b2FloatW by = b2SubW(b2SubW(vn2, b2LoadW(p2->velocityBias)), b2AddW(b2MulW(kExY, ax), b2MulW(kEyY, ay)));
+
+		// Case 4: x1 = 0 and x2 = 0
+		b2FloatW xx = ax;
+		b2FloatW xy = ay;
+		b2FloatW valid = b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero));
+		xx = b2BlendW(xx, zero, valid);
+		xy = b2BlendW(xy, zero, valid);
+
+		// Case 3: vn2 = 0 and x1 = 0
+		b2FloatW x3y = b2SubW(zero, b2MulW(b2LoadW(p2->normalMass), by));
+		b2FloatW vn1Case3 = b2AddW(b2MulW(kEyX, x3y), bx);
+		valid = b2AndW(b2GreaterEqualW(x3y, zero), b2GreaterEqualW(vn1Case3, zero));
+		xx = b2BlendW(xx, zero, valid);
+		xy = b2BlendW(xy, x3y, valid);
+
+		// Case 2: vn1 = 0 and x2 = 0
+		b2FloatW x2x = b2SubW(zero, b2MulW(b2LoadW(p1->normalMass), bx));
+		b2FloatW vn2Case2 = b2AddW(b2MulW(kExY, x2x), by);
+		valid = b2AndW(b2GreaterEqualW(x2x, zero), b2GreaterEqualW(vn2Case2, zero));
+		xx = b2BlendW(xx, x2x, valid);
+		xy = b2BlendW(xy, zero, valid);
+
+		// Case 1: vn = 0
+		b2FloatW x1x = b2SubW(zero, b2AddW(b2MulW(b2LoadW(c->normalMass[0]), bx), b2MulW(b2LoadW(c->normalMass[2]), by)));
+		b2FloatW x1y = b2SubW(zero, b2AddW(b2MulW(b2LoadW(c->normalMass[1]), bx), b2MulW(b2LoadW(c->normalMass[3]), by)));
+		valid = b2AndW(b2GreaterEqualW(x1x, zero), b2GreaterEqualW(x1y, zero));
+		xx = b2BlendW(xx, x1x, valid);
+		xy = b2BlendW(xy, x1y, valid);
+
+		// Apply the incremental impulse
+		b2FloatW dx = b2SubW(xx, ax);
+		b2FloatW dy = b2SubW(xy, ay);
+		b2FloatW p1x = b2MulW(dx, normalX), p1y = b2MulW(dx, normalY);
+		b2FloatW p2x = b2MulW(dy, normalX), p2y = b2MulW(dy, normalY);
+		b2FloatW px = b2AddW(p1x, p2x), py = b2AddW(p1y, p2y);
+
+		a.vx = b2SubW(a.vx, b2MulW(mA, px));
+		a.vy = b2SubW(a.vy, b2MulW(mA, py));
+		a.w = b2SubW(a.w, b2MulW(iA, b2AddW(b2CrossW(r1Ax, r1Ay, p1x, p1y), b2CrossW(r2Ax, r2Ay, p2x, p2y))));
+
+		b.vx = b2AddW(b.vx, b2MulW(mB, px));
+		b.vy = b2AddW(b.vy, b2MulW(mB, py));
+		b.w = b2AddW(b.w, b2MulW(iB, b2AddW(b2CrossW(r1Bx, r1By, p1x, p1y), b2CrossW(r2Bx, r2By, p2x, p2y))));
+
+		b2StoreW(p1->normalImpulse, xx);
+		b2StoreW(p2->normalImpulse, xy);
+	}
+
+	b2ScatterVelocities(c->velocityA, a);
+	b2ScatterVelocities(c->velocityB, b);
+}
+
+b2SimdContactSolver::b2SimdContactSolver(b2StackAllocator* allocator, b2ContactVelocityConstraint* constraints,
+										 int32 count, b2Velocity* velocities)
+{
+	m_allocator = allocator;
+	m_constraints = constraints;
+	m_velocities = velocities;
+	m_colorCount = 0;
+
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bodyCount = b2Max(bodyCount, b2Max(constraints[i].indexA, constraints[i].indexB) + 1);
+	}
+
+	// Greedy coloring. Bodies without mass are never written by the solver,
+	// so only bodies that can move take part.
+	m_colors = (int32*)m_allocator->Allocate(count * sizeof(int32));
+	uint64* bodyColors = (uint64*)m_allocator->Allocate(bodyCount * sizeof(uint64));
+	memset(bodyColors, 0, bodyCount * sizeof(uint64));
+
+	int32 colorCounts[b2_simdMaxColors + 1][b2_maxManifoldPoints];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = constraints + i;
+		bool movesA = vc->invMassA > 0.0f || vc->invIA > 0.0f;
+		bool movesB = vc->invMassB > 0.0f || vc->invIB > 0.0f;
+		uint64 used = (movesA ? bodyColors[vc->indexA] : 0) | (movesB ? bodyColors[vc->indexB] : 0);
+
+		int32 color = 0;
+		while (color < b2_simdMaxColors && (used & ((uint64)1 << color)))
+		{
+			++color;
+		}
+
+		if (color < b2_simdMaxColors)
+		{
+			uint64 bit = (uint64)1 << color;
+			if (movesA)
+			{
+				bodyColors[vc->indexA] |= bit;
+			}
+			if (movesB)
+			{
+				bodyColors[vc->indexB] |= bit;
+			}
+			m_colorCount = b2Max(m_colorCount, color + 1);
+		}
+
+		m_colors[i] = color;
+		++colorCounts[color][vc->pointCount - 1];
+	}
+
+	m_allocator->Free(bodyColors);
+
+	// Overflow constraints get a batch each.
+	m_batchCount = colorCounts[b2_simdMaxColors][0] + colorCounts[b2_simdMaxColors][1];
+	for (int32 color = 0; color < b2_simdMaxColors; ++color)
+	{
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			m_batchCount += (colorCounts[color][j] + b2_simdWidth - 1) / b2_simdWidth;
+		}
+	}
+
+	m_batches = (b2SimdConstraintBatch*)m_allocator->Allocate(m_batchCount * sizeof(b2SimdConstraintBatch));
+
+	// Fill the batches color by color, two point manifolds first.
+	int32 batchIndex = 0;
+	for (int32 color = 0; color <= b2_simdMaxColors; ++color)
+	{
+		for (int32 pointCount = 2; pointCount >= 1; --pointCount)
+		{
+			if (colorCounts[color][pointCount - 1] == 0)
+			{
+				continue;
+			}
+
+			int32 batchSize = color == b2_simdMaxColors ? 1 : b2_simdWidth;
+			int32 lane = batchSize;
+			b2SimdConstraintBatch* batch = NULL;
+			for (int32 i = 0; i < count; ++i)
+			{
+				if (m_colors[i] != color || constraints[i].pointCount != pointCount)
+				{
+					continue;
+				}
+
+				if (lane == batchSize)
+				{
+					if (batch)
+					{
+						for (; lane < b2_simdWidth; ++lane)
+						{
+							b2PackEmptyLane(batch, lane);
+						}
+					}
+
+					batch = m_batches + batchIndex++;
+					batch->pointCount = pointCount;
+					lane = 0;
+				}
+
+				b2PackLane(batch, lane++, constraints + i, i, velocities);
+			}
+
+			for (; lane < b2_simdWidth; ++lane)
+			{
+				b2PackEmptyLane(batch, lane);
+			}
+		}
+	}
+	b2Assert(batchIndex == m_batchCount);
+}
+
+b2SimdContactSolver::~b2SimdContactSolver()
+{
+	m_allocator->Free(m_batches);
+	m_allocator->Free(m_colors);
+}
+
+void b2SimdContactSolver::SolveVelocityConstraints()
+{
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		b2SolveBatch(m_batches + i);
+	}
+}
+
+int32 b2SimdContactSolver::GetConstraintIndex(int32 batch, int32 lane) const
+{
+	b2Assert(0 <= batch && batch < m_batchCount && 0 <= lane && lane < b2_simdWidth);
+	return m_batches[batch].constraintIndex[lane];
+}
+
+void b2SimdContactSolver::StoreImpulses()
+{
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		const b2SimdConstraintBatch* batch = m_batches + i;
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			int32 index = batch->constraintIndex[lane];
+			if (index == -1)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_constraints + index;
+			for (int32 j = 0; j < vc->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = batch->points[j].normalImpulse[lane];
+				vc->points[j].tangentImpulse = batch->points[j].tangentImpulse[lane];
+			}
+		}
+	}
+}
@@ -0,0 +1,53 @@
+//
+//  b2SimdContactSolver.h
+//  GameDevFramework
+//
+
+#ifndef B2_SIMD_CONTACT_SOLVER_H
+#define B2_SIMD_CONTACT_SOLVER_H
+
+#include "b2Simd.h"
+#include "b2TimeStep.h"
+
+class b2StackAllocator;
+struct b2ContactVelocityConstraint;
+struct b2SimdConstraintBatch;
+
+/// Solves the velocity constraints of a b2ContactSolver b2_simdWidth contacts
+/// at a time. The constraints are graph colored so that the lanes of a batch
+/// never share a body that can move, then packed into structure of arrays
+/// batches. Colors are solved in order, so the result is close to but not the
+/// same as the scalar solver, which visits contacts in island order.
+class b2SimdContactSolver
+{
+public:
+	/// Pack the constraints, InitializeVelocityConstraints must have been called.
+	b2SimdContactSolver(b2StackAllocator* allocator, b2ContactVelocityConstraint* constraints,
+						int32 count, b2Velocity* velocities);
+	~b2SimdContactSolver();
+
+	/// One velocity iteration over every batch.
+	void SolveVelocityConstraints();
+
+	/// Copy the accumulated impulses back into the velocity constraints.
+	void StoreImpulses();
+
+	/// Number of colors used, for profiling.
+	int32 GetColorCount() const { return m_colorCount; }
+
+	/// The batches in solve order and the constraint in each lane, -1 for an
+	/// empty lane. See b2World::SetSimdSolverReference.
+	int32 GetBatchCount() const { return m_batchCount; }
+	int32 GetConstraintIndex(int32 batch, int32 lane) const;
+
+private:
+	b2StackAllocator* m_allocator;
+	b2ContactVelocityConstraint* m_constraints;
+	b2Velocity* m_velocities;
+	int32* m_colors;
+	b2SimdConstraintBatch* m_batches;
+	int32 m_batchCount;
+	int32 m_colorCount;
+};
+
+#endif
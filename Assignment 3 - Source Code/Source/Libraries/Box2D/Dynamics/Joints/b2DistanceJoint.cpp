@@ -17,6 +17,7 @@
 */
 
 #include "b2DistanceJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -242,6 +243,26 @@ float32 b2DistanceJoint::GetReactionTorque(float32 inv_dt) const
 	return 0.0f;
 }
 
+void b2DistanceJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_length);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_impulse);
+}
+
+void b2DistanceJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_length = reader->Read<float32>();
+	m_frequencyHz = reader->Read<float32>();
+	m_dampingRatio = reader->Read<float32>();
+	m_impulse = reader->Read<float32>();
+}
+
 void b2DistanceJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -17,6 +17,7 @@
 */
 
 #include "b2FrictionJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -234,6 +235,26 @@ float32 b2FrictionJoint::GetMaxTorque() const
 	return m_maxTorque;
 }
 
+void b2FrictionJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_maxForce);
+	snapshot->Write(m_maxTorque);
+	snapshot->Write(m_linearImpulse);
+	snapshot->Write(m_angularImpulse);
+}
+
+void b2FrictionJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_maxForce = reader->Read<float32>();
+	m_maxTorque = reader->Read<float32>();
+	m_linearImpulse = reader->Read<b2Vec2>();
+	m_angularImpulse = reader->Read<float32>();
+}
+
 void b2FrictionJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
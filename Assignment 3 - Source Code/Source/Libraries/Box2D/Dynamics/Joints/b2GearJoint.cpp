@@ -17,6 +17,7 @@
 */
 
 #include "b2GearJoint.h"
+#include "b2Snapshot.h"
 #include "b2RevoluteJoint.h"
 #include "b2PrismaticJoint.h"
 #include "b2Body.h"
@@ -404,6 +405,20 @@ float32 b2GearJoint::GetRatio() const
 	return m_ratio;
 }
 
+void b2GearJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_ratio);
+	snapshot->Write(m_constant);
+	snapshot->Write(m_impulse);
+}
+
+void b2GearJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_ratio = reader->Read<float32>();
+	m_constant = reader->Read<float32>();
+	m_impulse = reader->Read<float32>();
+}
+
 void b2GearJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
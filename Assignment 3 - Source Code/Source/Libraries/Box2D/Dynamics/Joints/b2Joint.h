@@ -25,6 +25,8 @@ class b2Body;
 class b2Joint;
 struct b2SolverData;
 class b2BlockAllocator;
+class b2Snapshot;
+class b2SnapshotReader;
 
 enum b2JointType
 {
@@ -163,6 +165,11 @@ protected:
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// What b2World::SaveState keeps of a joint besides its bodies: the
+	// definition, as changed since, and the accumulated impulses.
+	virtual void SaveState(b2Snapshot* snapshot) const = 0;
+	virtual void RestoreState(b2SnapshotReader* reader) = 0;
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
@@ -17,6 +17,7 @@
 */
 
 #include "b2MouseJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -215,3 +216,23 @@ float32 b2MouseJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * 0.0f;
 }
+
+void b2MouseJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_targetA);
+	snapshot->Write(m_maxForce);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_impulse);
+}
+
+void b2MouseJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_targetA = reader->Read<b2Vec2>();
+	m_maxForce = reader->Read<float32>();
+	m_frequencyHz = reader->Read<float32>();
+	m_dampingRatio = reader->Read<float32>();
+	m_impulse = reader->Read<b2Vec2>();
+}
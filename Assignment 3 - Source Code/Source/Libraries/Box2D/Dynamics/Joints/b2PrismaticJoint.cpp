@@ -17,6 +17,7 @@
 */
 
 #include "b2PrismaticJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -614,6 +615,42 @@ float32 b2PrismaticJoint::GetMotorForce(float32 inv_dt) const
 	return inv_dt * m_motorImpulse;
 }
 
+void b2PrismaticJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_localXAxisA);
+	snapshot->Write(m_localYAxisA);
+	snapshot->Write(m_referenceAngle);
+	snapshot->Write(m_enableLimit);
+	snapshot->Write(m_lowerTranslation);
+	snapshot->Write(m_upperTranslation);
+	snapshot->Write(m_enableMotor);
+	snapshot->Write(m_maxMotorForce);
+	snapshot->Write(m_motorSpeed);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_motorImpulse);
+	snapshot->Write(m_limitState);
+}
+
+void b2PrismaticJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_localXAxisA = reader->Read<b2Vec2>();
+	m_localYAxisA = reader->Read<b2Vec2>();
+	m_referenceAngle = reader->Read<float32>();
+	m_enableLimit = reader->Read<bool>();
+	m_lowerTranslation = reader->Read<float32>();
+	m_upperTranslation = reader->Read<float32>();
+	m_enableMotor = reader->Read<bool>();
+	m_maxMotorForce = reader->Read<float32>();
+	m_motorSpeed = reader->Read<float32>();
+	m_impulse = reader->Read<b2Vec3>();
+	m_motorImpulse = reader->Read<float32>();
+	m_limitState = reader->Read<b2LimitState>();
+}
+
 void b2PrismaticJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
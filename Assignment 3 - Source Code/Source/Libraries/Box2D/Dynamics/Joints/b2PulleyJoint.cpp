@@ -17,6 +17,7 @@
 */
 
 #include "b2PulleyJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -322,6 +323,32 @@ float32 b2PulleyJoint::GetCurrentLengthB() const
 	return d.Length();
 }
 
+void b2PulleyJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_groundAnchorA);
+	snapshot->Write(m_groundAnchorB);
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_lengthA);
+	snapshot->Write(m_lengthB);
+	snapshot->Write(m_ratio);
+	snapshot->Write(m_constant);
+	snapshot->Write(m_impulse);
+}
+
+void b2PulleyJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_groundAnchorA = reader->Read<b2Vec2>();
+	m_groundAnchorB = reader->Read<b2Vec2>();
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_lengthA = reader->Read<float32>();
+	m_lengthB = reader->Read<float32>();
+	m_ratio = reader->Read<float32>();
+	m_constant = reader->Read<float32>();
+	m_impulse = reader->Read<float32>();
+}
+
 void b2PulleyJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -118,6 +118,9 @@ protected:
 	void SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
+	void SaveState(b2Snapshot* snapshot) const;
+	void RestoreState(b2SnapshotReader* reader);
+
 	b2Vec2 m_groundAnchorA;
 	b2Vec2 m_groundAnchorB;
 	float32 m_lengthA;
@@ -17,6 +17,7 @@
 */
 
 #include "b2RevoluteJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -482,6 +483,38 @@ void b2RevoluteJoint::SetLimits(float32 lower, float32 upper)
 	}
 }
 
+void b2RevoluteJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_referenceAngle);
+	snapshot->Write(m_enableLimit);
+	snapshot->Write(m_lowerAngle);
+	snapshot->Write(m_upperAngle);
+	snapshot->Write(m_enableMotor);
+	snapshot->Write(m_maxMotorTorque);
+	snapshot->Write(m_motorSpeed);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_motorImpulse);
+	snapshot->Write(m_limitState);
+}
+
+void b2RevoluteJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_referenceAngle = reader->Read<float32>();
+	m_enableLimit = reader->Read<bool>();
+	m_lowerAngle = reader->Read<float32>();
+	m_upperAngle = reader->Read<float32>();
+	m_enableMotor = reader->Read<bool>();
+	m_maxMotorTorque = reader->Read<float32>();
+	m_motorSpeed = reader->Read<float32>();
+	m_impulse = reader->Read<b2Vec3>();
+	m_motorImpulse = reader->Read<float32>();
+	m_limitState = reader->Read<b2LimitState>();
+}
+
 void b2RevoluteJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
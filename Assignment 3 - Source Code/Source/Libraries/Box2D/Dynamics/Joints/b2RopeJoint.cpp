@@ -17,6 +17,7 @@
 */
 
 #include "b2RopeJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -225,6 +226,26 @@ b2LimitState b2RopeJoint::GetLimitState() const
 	return m_state;
 }
 
+void b2RopeJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_maxLength);
+	snapshot->Write(m_length);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_state);
+}
+
+void b2RopeJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_maxLength = reader->Read<float32>();
+	m_length = reader->Read<float32>();
+	m_impulse = reader->Read<float32>();
+	m_state = reader->Read<b2LimitState>();
+}
+
 void b2RopeJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -17,6 +17,7 @@
 */
 
 #include "b2WeldJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -312,6 +313,26 @@ float32 b2WeldJoint::GetReactionTorque(float32 inv_dt) const
 	return inv_dt * m_impulse.z;
 }
 
+void b2WeldJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_referenceAngle);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_impulse);
+}
+
+void b2WeldJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_referenceAngle = reader->Read<float32>();
+	m_frequencyHz = reader->Read<float32>();
+	m_dampingRatio = reader->Read<float32>();
+	m_impulse = reader->Read<b2Vec3>();
+}
+
 void b2WeldJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
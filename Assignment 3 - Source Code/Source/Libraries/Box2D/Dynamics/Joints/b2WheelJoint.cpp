@@ -17,6 +17,7 @@
 */
 
 #include "b2WheelJoint.h"
+#include "b2Snapshot.h"
 #include "b2Body.h"
 #include "b2TimeStep.h"
 
@@ -398,6 +399,38 @@ float32 b2WheelJoint::GetMotorTorque(float32 inv_dt) const
 	return inv_dt * m_motorImpulse;
 }
 
+void b2WheelJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_localAnchorA);
+	snapshot->Write(m_localAnchorB);
+	snapshot->Write(m_localXAxisA);
+	snapshot->Write(m_localYAxisA);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_enableMotor);
+	snapshot->Write(m_maxMotorTorque);
+	snapshot->Write(m_motorSpeed);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_motorImpulse);
+	snapshot->Write(m_springImpulse);
+}
+
+void b2WheelJoint::RestoreState(b2SnapshotReader* reader)
+{
+	m_localAnchorA = reader->Read<b2Vec2>();
+	m_localAnchorB = reader->Read<b2Vec2>();
+	m_localXAxisA = reader->Read<b2Vec2>();
+	m_localYAxisA = reader->Read<b2Vec2>();
+	m_frequencyHz = reader->Read<float32>();
+	m_dampingRatio = reader->Read<float32>();
+	m_enableMotor = reader->Read<bool>();
+	m_maxMotorTorque = reader->Read<float32>();
+	m_motorSpeed = reader->Read<float32>();
+	m_impulse = reader->Read<float32>();
+	m_motorImpulse = reader->Read<float32>();
+	m_springImpulse = reader->Read<float32>();
+}
+
 void b2WheelJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -58,6 +58,7 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 
 	m_xf.p = bd->position;
 	m_xf.q.Set(bd->angle);
+	m_xf0 = m_xf;
 
 	m_sweep.localCenter.SetZero();
 	m_sweep.c0 = m_xf.p;
@@ -176,6 +177,7 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 	void* memory = allocator->Allocate(sizeof(b2Fixture));
 	b2Fixture* fixture = new (memory) b2Fixture;
 	fixture->Create(allocator, this, def);
+	fixture->m_serial = ++m_world->m_fixtureSerial;
 
 	if (m_flags & e_activeFlag)
 	{
@@ -414,6 +416,28 @@ bool b2Body::ShouldCollide(const b2Body* other) const
 	return true;
 }
 
+b2Transform b2Body::GetInterpolatedTransform(float32 alpha) const
+{
+	b2Transform xf;
+	xf.p = (1.0f - alpha) * m_xf0.p + alpha * m_xf.p;
+
+	// Normalized lerp of the rotation, good enough for the small angles covered by one step.
+	float32 s = (1.0f - alpha) * m_xf0.q.s + alpha * m_xf.q.s;
+	float32 c = (1.0f - alpha) * m_xf0.q.c + alpha * m_xf.q.c;
+	float32 length = b2Sqrt(s * s + c * c);
+	if (length < b2_epsilon)
+	{
+		xf.q = m_xf.q;
+	}
+	else
+	{
+		float32 invLength = 1.0f / length;
+		xf.q.s = s * invLength;
+		xf.q.c = c * invLength;
+	}
+	return xf;
+}
+
 void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 {
 	b2Assert(m_world->IsLocked() == false);
@@ -425,6 +449,9 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 	m_xf.q.Set(angle);
 	m_xf.p = position;
 
+	// Teleports are not interpolated.
+	m_xf0 = m_xf;
+
 	m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
 	m_sweep.a = angle;
 
@@ -453,6 +480,19 @@ void b2Body::SynchronizeFixtures()
 	}
 }
 
+void b2Body::SynchronizeFixtures(float32 dt)
+{
+	b2Transform xf2;
+	xf2.q.Set(m_sweep.a + dt * m_angularVelocity);
+	xf2.p = m_sweep.c + dt * m_linearVelocity - b2Mul(xf2.q, m_sweep.localCenter);
+
+	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+	{
+		f->Synchronize(broadPhase, m_xf, xf2);
+	}
+}
+
 void b2Body::SetActive(bool flag)
 {
 	b2Assert(m_world->IsLocked() == false);
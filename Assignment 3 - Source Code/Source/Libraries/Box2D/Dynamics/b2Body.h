@@ -164,6 +164,14 @@ public:
 	/// @return the world transform of the body's origin.
 	const b2Transform& GetTransform() const;
 
+	/// Get the body transform at the start of the last time step.
+	/// @return the world transform of the body's origin before the last step.
+	const b2Transform& GetPreviousTransform() const;
+
+	/// Blend the previous and current transforms, for rendering between fixed steps.
+	/// @param alpha 0 gives the previous transform and 1 the current transform.
+	b2Transform GetInterpolatedTransform(float32 alpha) const;
+
 	/// Get the world body origin position.
 	/// @return the world position of the body's origin.
 	const b2Vec2& GetPosition() const;
@@ -415,6 +423,10 @@ private:
 	void SynchronizeFixtures();
 	void SynchronizeTransform();
 
+	// Sweep the proxies from the current transform to where the body will be
+	// after dt at its current velocity, so speculative contacts are found ahead.
+	void SynchronizeFixtures(float32 dt);
+
 	// This is used to prevent connected bodies from colliding.
 	// It may lie, depending on the collideConnected flag.
 	bool ShouldCollide(const b2Body* other) const;
@@ -428,6 +440,7 @@ private:
 	int32 m_islandIndex;
 
 	b2Transform m_xf;		// the body origin transform
+	b2Transform m_xf0;		// the body origin transform at the start of the last step
 	b2Sweep m_sweep;		// the swept motion for CCD
 
 	b2Vec2 m_linearVelocity;
@@ -470,6 +483,11 @@ inline const b2Transform& b2Body::GetTransform() const
 	return m_xf;
 }
 
+inline const b2Transform& b2Body::GetPreviousTransform() const
+{
+	return m_xf0;
+}
+
 inline const b2Vec2& b2Body::GetPosition() const
 {
 	return m_xf.p;
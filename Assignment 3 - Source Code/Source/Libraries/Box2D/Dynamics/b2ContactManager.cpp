@@ -21,6 +21,9 @@
 #include "b2Fixture.h"
 #include "b2WorldCallbacks.h"
 #include "b2Contact.h"
+#include "b2StackAllocator.h"
+#include "b2ThreadPool.h"
+#include "b2Profiler.h"
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
@@ -32,6 +35,9 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+	m_stackAllocator = NULL;
+	m_threadPool = NULL;
+	m_warmStartCacheEnabled = true;
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -104,6 +110,15 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	B2_PROFILE_ZONE("b2ContactManager::Collide");
+	m_warmStartCache.Step();
+
+	if (m_threadPool && m_stackAllocator)
+	{
+		CollideParallel();
+		return;
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
@@ -158,19 +173,266 @@ void b2ContactManager::Collide()
 		if (overlap == false)
 		{
 			b2Contact* cNuke = c;
+			if (m_warmStartCacheEnabled)
+			{
+				m_warmStartCache.Store(cNuke, *cNuke->GetManifold());
+			}
 			c = cNuke->GetNext();
 			Destroy(cNuke);
 			continue;
 		}
 
 		// The contact persists.
-		c->Update(m_contactListener);
+		c->Update(m_contactListener, GetWarmStartCache());
 		c = c->GetNext();
 	}
 }
 
+class b2ContactUpdateTask : public b2ThreadTask
+{
+public:
+	b2ContactUpdateTask(b2ContactManager* manager, b2ContactUpdate* updates)
+	{
+		m_manager = manager;
+		m_updates = updates;
+	}
+
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		m_manager->ComputeUpdates(m_updates, begin, end);
+	}
+
+private:
+	b2ContactManager* m_manager;
+	b2ContactUpdate* m_updates;
+};
+
+// Evaluates the broad-phase overlap and the new manifold of each contact.
+// Nothing outside of the b2ContactUpdate array is written.
+void b2ContactManager::ComputeUpdates(b2ContactUpdate* updates, int32 begin, int32 end)
+{
+	B2_PROFILE_ZONE("b2ContactManager::ComputeUpdates");
+	const b2WarmStartCache* cache = GetWarmStartCache();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactUpdate* u = updates + i;
+		b2Contact* c = u->contact;
+		int32 proxyIdA = c->GetFixtureA()->m_proxies[c->GetChildIndexA()].proxyId;
+		int32 proxyIdB = c->GetFixtureB()->m_proxies[c->GetChildIndexB()].proxyId;
+
+		u->overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		u->touching = u->overlap && c->ComputeManifold(&u->manifold, cache);
+	}
+}
+
+// Same result as the serial Collide. The contacts that look like they will be
+// updated are collected and evaluated on the pool first. The contact list is then
+// walked again exactly as the serial version does: filtering, destruction, waking
+// and the listener callbacks all happen here, in list order, and the precomputed
+// result is only used if the contact is still updated. Contacts that a callback
+// changes the fate of (a body woken by an earlier contact, say) fall back to the
+// serial path, so listeners see the same event sequence as before.
+void b2ContactManager::CollideParallel()
+{
+	b2ContactUpdate* updates = (b2ContactUpdate*)m_stackAllocator->Allocate(m_contactCount * sizeof(b2ContactUpdate));
+	int32 updateCount = 0;
+
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
+	{
+		// Contacts flagged for filtering call user code, leave them to the serial pass.
+		if (c->m_flags & b2Contact::e_filterFlag)
+		{
+			continue;
+		}
+
+		b2Body* bodyA = c->GetFixtureA()->GetBody();
+		b2Body* bodyB = c->GetFixtureB()->GetBody();
+		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+		if (activeA == false && activeB == false)
+		{
+			continue;
+		}
+
+		updates[updateCount++].contact = c;
+	}
+
+	b2ContactUpdateTask task(this, updates);
+	m_threadPool->Run(&task, updateCount, 32);
+
+	int32 next = 0;
+	b2Contact* c = m_contactList;
+	while (c)
+	{
+		b2Fixture* fixtureA = c->GetFixtureA();
+		b2Fixture* fixtureB = c->GetFixtureB();
+		b2Body* bodyA = fixtureA->GetBody();
+		b2Body* bodyB = fixtureB->GetBody();
+
+		// Contacts are only removed during the walk, so the updates stay in list order.
+		b2ContactUpdate* u = NULL;
+		if (next < updateCount && updates[next].contact == c)
+		{
+			u = updates + next;
+			++next;
+		}
+
+		// Is this contact flagged for filtering?
+		if (c->m_flags & b2Contact::e_filterFlag)
+		{
+			// Should these bodies collide?
+			if (bodyB->ShouldCollide(bodyA) == false)
+			{
+				b2Contact* cNuke = c;
+				c = cNuke->GetNext();
+				Destroy(cNuke);
+				continue;
+			}
+
+			// Check user filtering.
+			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+			{
+				b2Contact* cNuke = c;
+				c = cNuke->GetNext();
+				Destroy(cNuke);
+				continue;
+			}
+
+			// Clear the filtering flag.
+			c->m_flags &= ~b2Contact::e_filterFlag;
+		}
+
+		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+		// At least one body must be awake and it must be dynamic or kinematic.
+		if (activeA == false && activeB == false)
+		{
+			c = c->GetNext();
+			continue;
+		}
+
+		bool overlap;
+		if (u)
+		{
+			overlap = u->overlap;
+		}
+		else
+		{
+			int32 proxyIdA = fixtureA->m_proxies[c->GetChildIndexA()].proxyId;
+			int32 proxyIdB = fixtureB->m_proxies[c->GetChildIndexB()].proxyId;
+			overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		}
+
+		// Here we destroy contacts that cease to overlap in the broad-phase.
+		if (overlap == false)
+		{
+			b2Contact* cNuke = c;
+			if (m_warmStartCacheEnabled)
+			{
+				m_warmStartCache.Store(cNuke, *cNuke->GetManifold());
+			}
+			c = cNuke->GetNext();
+			Destroy(cNuke);
+			continue;
+		}
+
+		// The contact persists.
+		if (u)
+		{
+			c->Commit(u->manifold, u->touching, m_contactListener, GetWarmStartCache());
+		}
+		else
+		{
+			c->Update(m_contactListener, GetWarmStartCache());
+		}
+		c = c->GetNext();
+	}
+
+	m_stackAllocator->Free(updates);
+}
+
+class b2SpeculativeTask : public b2ThreadTask
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		manager->ComputeSpeculative(contacts, begin, end, dt);
+	}
+
+	b2ContactManager* manager;
+	b2Contact** contacts;
+	float32 dt;
+};
+
+void b2ContactManager::ComputeSpeculative(b2Contact** contacts, int32 begin, int32 end, float32 dt)
+{
+	B2_PROFILE_ZONE("b2ContactManager::ComputeSpeculative");
+	for (int32 i = begin; i < end; ++i)
+	{
+		contacts[i]->UpdateSpeculative(dt);
+	}
+}
+
+// Flag the contacts that are not touching yet but could be by the end of the
+// step. Run after Collide, the manifolds of the other contacts are current.
+void b2ContactManager::FindSpeculativeContacts(float32 dt)
+{
+	B2_PROFILE_ZONE("b2ContactManager::FindSpeculativeContacts");
+	b2Contact** contacts = (b2Contact**)m_stackAllocator->Allocate(m_contactCount * sizeof(b2Contact*));
+	int32 count = 0;
+
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
+	{
+		c->m_flags &= ~b2Contact::e_speculativeFlag;
+
+		if (c->IsTouching())
+		{
+			continue;
+		}
+
+		b2Body* bodyA = c->GetFixtureA()->GetBody();
+		b2Body* bodyB = c->GetFixtureB()->GetBody();
+		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+		if (activeA == false && activeB == false)
+		{
+			continue;
+		}
+
+		contacts[count++] = c;
+	}
+
+	if (m_threadPool)
+	{
+		b2SpeculativeTask task;
+		task.manager = this;
+		task.contacts = contacts;
+		task.dt = dt;
+		m_threadPool->Run(&task, count, 32);
+	}
+	else
+	{
+		ComputeSpeculative(contacts, 0, count, dt);
+	}
+
+	m_stackAllocator->Free(contacts);
+}
+
+void b2ContactManager::ClearSpeculativeContacts()
+{
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
+	{
+		c->m_flags &= ~b2Contact::e_speculativeFlag;
+	}
+}
+
 void b2ContactManager::FindNewContacts()
 {
+	B2_PROFILE_ZONE("b2BroadPhase::UpdatePairs");
 	m_broadPhase.UpdatePairs(this);
 }
 
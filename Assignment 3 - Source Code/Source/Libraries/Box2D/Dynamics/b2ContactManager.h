@@ -20,11 +20,23 @@
 #define B2_CONTACT_MANAGER_H
 
 #include "b2BroadPhase.h"
+#include "b2WarmStartCache.h"
 
 class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2StackAllocator;
+class b2ThreadPool;
+
+// A contact predicted to be updated this step, with its narrow phase result.
+struct b2ContactUpdate
+{
+	b2Contact* contact;
+	b2Manifold manifold;
+	bool overlap;
+	bool touching;
+};
 
 // Delegate of b2World.
 class b2ContactManager
@@ -40,6 +52,21 @@ public:
 	void Destroy(b2Contact* c);
 
 	void Collide();
+
+	// Collide with the manifolds evaluated on m_threadPool. Listener
+	// callbacks are still made serially, in contact list order.
+	void CollideParallel();
+
+	// Narrow phase for updates[begin, end), called from the pool workers.
+	void ComputeUpdates(b2ContactUpdate* updates, int32 begin, int32 end);
+
+	// Build the speculative manifolds of the contacts that are not touching but
+	// could be within dt. ClearSpeculativeContacts drops them all.
+	void FindSpeculativeContacts(float32 dt);
+	void ClearSpeculativeContacts();
+
+	// b2Contact::UpdateSpeculative for contacts[begin, end), called from the pool workers.
+	void ComputeSpeculative(b2Contact** contacts, int32 begin, int32 end, float32 dt);
             
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
@@ -47,6 +74,15 @@ public:
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+	b2StackAllocator* m_stackAllocator;
+	b2ThreadPool* m_threadPool;
+
+	// Impulses of contacts that stopped touching or overlapping in the broad-phase.
+	b2WarmStartCache m_warmStartCache;
+	bool m_warmStartCacheEnabled;
+
+	// The cache to pass to b2Contact::Update, NULL when disabled.
+	b2WarmStartCache* GetWarmStartCache() { return m_warmStartCacheEnabled ? &m_warmStartCache : NULL; }
 };
 
 #endif
@@ -30,6 +30,7 @@
 b2Fixture::b2Fixture()
 {
 	m_userData = NULL;
+	m_serial = 0;
 	m_body = NULL;
 	m_next = NULL;
 	m_proxies = NULL;
@@ -201,6 +201,7 @@ protected:
 	friend class b2World;
 	friend class b2Contact;
 	friend class b2ContactManager;
+	friend class b2WarmStartCache;
 
 	b2Fixture();
 
@@ -233,6 +234,10 @@ protected:
 	bool m_isSensor;
 
 	void* m_userData;
+
+	// Set by the world when the fixture is created. Tells apart fixtures that the
+	// block allocator put at the same address, see b2WarmStartCache.
+	uint32 m_serial;
 };
 
 inline b2Shape::Type b2Fixture::GetType() const
@@ -26,6 +26,7 @@
 #include "b2Joint.h"
 #include "b2StackAllocator.h"
 #include "b2Timer.h"
+#include "b2Profiler.h"
 
 /*
 Position Correction Notes
@@ -156,6 +157,9 @@ b2Island::b2Island(
 	m_contactCapacity = contactCapacity;
 	m_jointCapacity	 = jointCapacity;
 	m_bodyCount = 0;
+	m_sharedCount = 0;
+	m_sharedBodies = NULL;
+	m_sharedBodyCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
 
@@ -182,12 +186,25 @@ b2Island::~b2Island()
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
 {
+	B2_PROFILE_ZONE("b2Island::Solve");
 	b2Timer timer;
 
 	float32 h = step.dt;
 
+	// Shared static bodies only fill the slots of the ones this island reaches.
+	for (int32 j = 0; j < m_sharedBodyCount; ++j)
+	{
+		const b2Body* b = m_sharedBodies[j];
+		int32 i = b->m_islandIndex;
+		b2Assert(0 <= i && i < m_sharedCount);
+		m_positions[i].c = b->m_sweep.c;
+		m_positions[i].a = b->m_sweep.a;
+		m_velocities[i].v = b->m_linearVelocity;
+		m_velocities[i].w = b->m_angularVelocity;
+	}
+
 	// Integrate velocities and apply damping. Initialize the body state.
-	for (int32 i = 0; i < m_bodyCount; ++i)
+	for (int32 i = m_sharedCount; i < m_bodyCount; ++i)
 	{
 		b2Body* b = m_bodies[i];
 
@@ -326,8 +343,9 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		}
 	}
 
-	// Copy state buffers back to the bodies
-	for (int32 i = 0; i < m_bodyCount; ++i)
+	// Copy state buffers back to the bodies. Shared bodies are static, so
+	// their state is unchanged.
+	for (int32 i = m_sharedCount; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
 		body->m_sweep.c = m_positions[i].c;
@@ -348,7 +366,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
 		const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
 
-		for (int32 i = 0; i < m_bodyCount; ++i)
+		for (int32 i = m_sharedCount; i < m_bodyCount; ++i)
 		{
 			b2Body* b = m_bodies[i];
 			if (b->GetType() == b2_staticBody)
@@ -372,7 +390,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 		if (minSleepTime >= b2_timeToSleep && positionSolved)
 		{
-			for (int32 i = 0; i < m_bodyCount; ++i)
+			for (int32 i = m_sharedCount; i < m_bodyCount; ++i)
 			{
 				b2Body* b = m_bodies[i];
 				b->SetAwake(false);
@@ -524,6 +542,12 @@ void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 	{
 		b2Contact* c = m_contacts[i];
 
+		// Speculative contacts are not touching, the listener never began them.
+		if (c->IsTouching() == false)
+		{
+			continue;
+		}
+
 		const b2ContactVelocityConstraint* vc = constraints + i;
 		
 		b2ContactImpulse impulse;
@@ -41,6 +41,9 @@ public:
 	void Clear()
 	{
 		m_bodyCount = 0;
+		m_sharedCount = 0;
+		m_sharedBodies = NULL;
+		m_sharedBodyCount = 0;
 		m_contactCount = 0;
 		m_jointCount = 0;
 	}
@@ -57,6 +60,21 @@ public:
 		++m_bodyCount;
 	}
 
+	/// Reserve the first slotCount solver slots for static bodies that other
+	/// islands may be solving at the same time. Their island index is a slot
+	/// assigned by the caller and they are only ever read by the solver. Only
+	/// the slots of the bodies given here are filled, so an island pays for
+	/// the static bodies it reaches and not for every shared one. Call this
+	/// before adding anything, the array must outlive Solve.
+	void SetShared(b2Body** bodies, int32 count, int32 slotCount)
+	{
+		b2Assert(m_bodyCount == 0 && slotCount <= m_bodyCapacity);
+		m_sharedBodies = bodies;
+		m_sharedBodyCount = count;
+		m_sharedCount = slotCount;
+		m_bodyCount = slotCount;
+	}
+
 	void Add(b2Contact* contact)
 	{
 		b2Assert(m_contactCount < m_contactCapacity);
@@ -81,7 +99,11 @@ public:
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
 
+	b2Body** m_sharedBodies;
+	int32 m_sharedBodyCount;
+
 	int32 m_bodyCount;
+	int32 m_sharedCount;
 	int32 m_jointCount;
 	int32 m_contactCount;
 
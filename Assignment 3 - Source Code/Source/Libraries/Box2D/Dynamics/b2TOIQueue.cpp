@@ -0,0 +1,137 @@
+//
+//  b2TOIQueue.cpp
+//  GameDevFramework
+//
+
+#include "b2TOIQueue.h"
+#include "b2Math.h"
+#include <string.h>
+
+b2TOIQueue::b2TOIQueue()
+{
+	m_candidates = NULL;
+	m_count = 0;
+	m_capacity = 0;
+
+	m_pending = NULL;
+	m_pendingCount = 0;
+	m_pendingCapacity = 0;
+}
+
+b2TOIQueue::~b2TOIQueue()
+{
+	b2Free(m_candidates);
+	b2Free(m_pending);
+}
+
+void b2TOIQueue::Clear()
+{
+	m_count = 0;
+	m_pendingCount = 0;
+}
+
+void b2TOIQueue::Reserve(int32 contactCount)
+{
+	if (contactCount > m_pendingCapacity)
+	{
+		GrowPending(contactCount);
+	}
+	if (2 * contactCount > m_capacity)
+	{
+		GrowCandidates(2 * contactCount);
+	}
+}
+
+void b2TOIQueue::GrowPending(int32 capacity)
+{
+	b2TOIUpdate* old = m_pending;
+	m_pendingCapacity = capacity;
+	m_pending = (b2TOIUpdate*)b2Alloc(m_pendingCapacity * sizeof(b2TOIUpdate));
+	if (old)
+	{
+		memcpy(m_pending, old, m_pendingCount * sizeof(b2TOIUpdate));
+		b2Free(old);
+	}
+}
+
+void b2TOIQueue::GrowCandidates(int32 capacity)
+{
+	b2TOICandidate* old = m_candidates;
+	m_capacity = capacity;
+	m_candidates = (b2TOICandidate*)b2Alloc(m_capacity * sizeof(b2TOICandidate));
+	if (old)
+	{
+		memcpy(m_candidates, old, m_count * sizeof(b2TOICandidate));
+		b2Free(old);
+	}
+}
+
+void b2TOIQueue::AddPending(b2Contact* contact)
+{
+	if (m_pendingCount == m_pendingCapacity)
+	{
+		GrowPending(b2Max(64, 2 * m_pendingCapacity));
+	}
+
+	m_pending[m_pendingCount++].contact = contact;
+}
+
+void b2TOIQueue::Push(const b2TOICandidate& candidate)
+{
+	if (m_count == m_capacity)
+	{
+		GrowCandidates(b2Max(64, 2 * m_capacity));
+	}
+
+	// Sift up.
+	int32 i = m_count++;
+	while (i > 0)
+	{
+		int32 parent = (i - 1) / 2;
+		if (IsBefore(candidate, m_candidates[parent]) == false)
+		{
+			break;
+		}
+		m_candidates[i] = m_candidates[parent];
+		i = parent;
+	}
+	m_candidates[i] = candidate;
+}
+
+const b2TOICandidate& b2TOIQueue::Top() const
+{
+	b2Assert(m_count > 0);
+	return m_candidates[0];
+}
+
+void b2TOIQueue::Pop()
+{
+	b2Assert(m_count > 0);
+	b2TOICandidate last = m_candidates[--m_count];
+
+	// Sift the last candidate down from the root.
+	int32 i = 0;
+	for (;;)
+	{
+		int32 child = 2 * i + 1;
+		if (child >= m_count)
+		{
+			break;
+		}
+		if (child + 1 < m_count && IsBefore(m_candidates[child + 1], m_candidates[child]))
+		{
+			++child;
+		}
+		if (IsBefore(m_candidates[child], last) == false)
+		{
+			break;
+		}
+		m_candidates[i] = m_candidates[child];
+		i = child;
+	}
+
+	if (m_count > 0)
+	{
+		m_candidates[i] = last;
+	}
+}
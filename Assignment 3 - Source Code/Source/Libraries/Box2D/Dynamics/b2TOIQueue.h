@@ -0,0 +1,81 @@
+//
+//  b2TOIQueue.h
+//  GameDevFramework
+//
+
+#ifndef B2_TOI_QUEUE_H
+#define B2_TOI_QUEUE_H
+
+#include "b2Settings.h"
+
+class b2Contact;
+
+/// A contact whose time of impact b2World::SolveTOI has to find. The result
+/// is written here first so contacts can be computed on several threads.
+struct b2TOIUpdate
+{
+	b2Contact* contact;
+	float32 alpha;
+	int32 iterations;
+	bool computed;		// false if the contact doesn't need continuous collision
+};
+
+/// A time of impact found by b2World::SolveTOI. Ties are broken by the
+/// contact's place in the contact list, which is the contact the serial
+/// scan over the list would have picked.
+struct b2TOICandidate
+{
+	float32 alpha;
+	int32 order;
+	b2Contact* contact;
+};
+
+/// The contacts waiting for a time of impact and a binary min-heap of the
+/// ones found. Candidates are not removed when a sub-step invalidates their
+/// contact, the world skips the stale ones as they reach the top. The
+/// buffers are kept between steps.
+class b2TOIQueue
+{
+public:
+	b2TOIQueue();
+	~b2TOIQueue();
+
+	/// Drop the pending contacts and the candidates.
+	void Clear();
+
+	/// Grow the buffers for a world of this many contacts. A contact is
+	/// pending at most once, stale candidates can take up to as many again.
+	void Reserve(int32 contactCount);
+
+	void AddPending(b2Contact* contact);
+	b2TOIUpdate* GetPending() { return m_pending; }
+	int32 GetPendingCount() const { return m_pendingCount; }
+	void ClearPending() { m_pendingCount = 0; }
+
+	void Push(const b2TOICandidate& candidate);
+	const b2TOICandidate& Top() const;
+	void Pop();
+	bool IsEmpty() const { return m_count == 0; }
+
+private:
+	b2TOIQueue(const b2TOIQueue&);
+	b2TOIQueue& operator=(const b2TOIQueue&);
+
+	void GrowPending(int32 capacity);
+	void GrowCandidates(int32 capacity);
+
+	static bool IsBefore(const b2TOICandidate& a, const b2TOICandidate& b)
+	{
+		return a.alpha < b.alpha || (a.alpha == b.alpha && a.order < b.order);
+	}
+
+	b2TOICandidate* m_candidates;
+	int32 m_count;
+	int32 m_capacity;
+
+	b2TOIUpdate* m_pending;
+	int32 m_pendingCount;
+	int32 m_pendingCapacity;
+};
+
+#endif
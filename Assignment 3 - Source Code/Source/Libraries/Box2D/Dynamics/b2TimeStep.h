@@ -32,6 +32,12 @@ struct b2Profile
 	float32 solvePosition;
 	float32 broadphase;
 	float32 solveTOI;
+	int32 warmStartCacheHits;	// touching contacts warm started from b2WarmStartCache
+	int32 stackPeak;			// most bytes in use on one stack allocator
+	int32 stackGrowCount;		// heap allocations made by the stack allocators
+	int32 toiEvents;			// sub-steps taken by the continuous solver
+	int32 toiCalls;				// b2TimeOfImpact calls
+	int32 toiIterations;		// b2TimeOfImpact separating axis iterations
 };
 
 /// This is an internal structure.
@@ -43,6 +49,8 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool simdSolver;	// solve contact velocities with b2SimdContactSolver
+	bool simdSolverReference;	// solve b2SimdContactSolver's batch order with the scalar code
 };
 
 /// This is an internal structure.
@@ -0,0 +1,287 @@
+//
+//  b2WarmStartCache.cpp
+//  GameDevFramework
+//
+
+#include "b2WarmStartCache.h"
+#include "b2Contact.h"
+#include "b2Fixture.h"
+
+static uint32 b2HashFixturePair(const b2Fixture* fixtureA, int32 childA, const b2Fixture* fixtureB, int32 childB)
+{
+	uint64 a = (uint64)(size_t)fixtureA + (uint64)childA;
+	uint64 b = (uint64)(size_t)fixtureB + (uint64)childB;
+	uint64 h = a * 0x9E3779B97F4A7C15ULL ^ (b + 0x632BE59BD9B4E019ULL + (a << 6) + (a >> 2));
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+	return (uint32)h;
+}
+
+b2WarmStartCache::b2WarmStartCache()
+{
+	m_entries = NULL;
+	m_capacity = 0;
+	m_count = 0;
+	m_stamp = 0;
+	m_hitCount = 0;
+	for (int32 i = 0; i < e_bucketCount; ++i)
+	{
+		m_buckets[i].keys = NULL;
+		m_buckets[i].count = 0;
+		m_buckets[i].capacity = 0;
+	}
+}
+
+b2WarmStartCache::~b2WarmStartCache()
+{
+	for (int32 i = 0; i < e_bucketCount; ++i)
+	{
+		b2Free(m_buckets[i].keys);
+	}
+	b2Free(m_entries);
+}
+
+b2WarmStartCache::b2WarmStartKey b2WarmStartCache::MakeKey(const b2Fixture* fixtureA, int32 childA, const b2Fixture* fixtureB, int32 childB)
+{
+	b2WarmStartKey key;
+	key.fixtureA = fixtureA;
+	key.fixtureB = fixtureB;
+	key.serialA = fixtureA->m_serial;
+	key.serialB = fixtureB->m_serial;
+	key.childA = childA;
+	key.childB = childB;
+	return key;
+}
+
+b2WarmStartCache::b2WarmStartKey b2WarmStartCache::MakeKey(const b2Contact* contact)
+{
+	return MakeKey(contact->GetFixtureA(), contact->GetChildIndexA(), contact->GetFixtureB(), contact->GetChildIndexB());
+}
+
+int32 b2WarmStartCache::Find(const b2WarmStartKey& key) const
+{
+	if (m_capacity == 0)
+	{
+		return -1;
+	}
+
+	// Only the addresses are compared here, never followed, the fixture of an
+	// expiring entry may be gone.
+	int32 mask = m_capacity - 1;
+	int32 index = b2HashFixturePair(key.fixtureA, key.childA, key.fixtureB, key.childB) & mask;
+	while (m_entries[index].key.fixtureA)
+	{
+		const b2WarmStartKey* k = &m_entries[index].key;
+		if (k->fixtureA == key.fixtureA && k->fixtureB == key.fixtureB && k->childA == key.childA && k->childB == key.childB &&
+			k->serialA == key.serialA && k->serialB == key.serialB)
+		{
+			return index;
+		}
+		index = (index + 1) & mask;
+	}
+	return -1;
+}
+
+// Linear probing with backward shift deletion, so no tombstones are needed.
+void b2WarmStartCache::RemoveAt(int32 index)
+{
+	int32 mask = m_capacity - 1;
+	int32 hole = index;
+	int32 next = (hole + 1) & mask;
+	while (m_entries[next].key.fixtureA)
+	{
+		const b2WarmStartKey* k = &m_entries[next].key;
+		int32 home = b2HashFixturePair(k->fixtureA, k->childA, k->fixtureB, k->childB) & mask;
+
+		// Move the entry into the hole unless its home lies cyclically in (hole, next].
+		bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+		if (stays == false)
+		{
+			m_entries[hole] = m_entries[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	m_entries[hole].key.fixtureA = NULL;
+	--m_count;
+}
+
+void b2WarmStartCache::Reserve(int32 count)
+{
+	while (2 * count > m_capacity)
+	{
+		Grow();
+	}
+}
+
+void b2WarmStartCache::Grow()
+{
+	b2WarmStartEntry* oldEntries = m_entries;
+	int32 oldCapacity = m_capacity;
+
+	m_capacity = oldCapacity ? 2 * oldCapacity : 64;
+	m_entries = (b2WarmStartEntry*)b2Alloc(m_capacity * sizeof(b2WarmStartEntry));
+	for (int32 i = 0; i < m_capacity; ++i)
+	{
+		m_entries[i] = b2WarmStartEntry();
+	}
+
+	int32 mask = m_capacity - 1;
+	for (int32 i = 0; i < oldCapacity; ++i)
+	{
+		const b2WarmStartEntry* e = oldEntries + i;
+		if (e->key.fixtureA == NULL)
+		{
+			continue;
+		}
+
+		int32 index = b2HashFixturePair(e->key.fixtureA, e->key.childA, e->key.fixtureB, e->key.childB) & mask;
+		while (m_entries[index].key.fixtureA)
+		{
+			index = (index + 1) & mask;
+		}
+		m_entries[index] = *e;
+	}
+
+	b2Free(oldEntries);
+}
+
+b2WarmStartCache::b2WarmStartEntry* b2WarmStartCache::Insert(const b2WarmStartKey& key, int32 stamp)
+{
+	int32 index = Find(key);
+	if (index == -1)
+	{
+		// Keep the load factor at or below one half.
+		if (2 * (m_count + 1) > m_capacity)
+		{
+			Grow();
+		}
+
+		int32 mask = m_capacity - 1;
+		index = b2HashFixturePair(key.fixtureA, key.childA, key.fixtureB, key.childB) & mask;
+		while (m_entries[index].key.fixtureA)
+		{
+			index = (index + 1) & mask;
+		}
+		++m_count;
+
+		m_entries[index].key = key;
+		m_entries[index].pointCount = 0;
+	}
+	else if (m_entries[index].stamp == stamp)
+	{
+		return m_entries + index;
+	}
+
+	// An entry stored again leaves its older key in an earlier bucket, where Step
+	// skips it because the stamp no longer matches.
+	b2WarmStartBucket* bucket = m_buckets + stamp % e_bucketCount;
+	if (bucket->count == bucket->capacity)
+	{
+		int32 capacity = bucket->capacity ? 2 * bucket->capacity : 64;
+		b2WarmStartKey* keys = (b2WarmStartKey*)b2Alloc(capacity * sizeof(b2WarmStartKey));
+		for (int32 i = 0; i < bucket->count; ++i)
+		{
+			keys[i] = bucket->keys[i];
+		}
+		b2Free(bucket->keys);
+		bucket->keys = keys;
+		bucket->capacity = capacity;
+	}
+	bucket->keys[bucket->count++] = key;
+
+	m_entries[index].stamp = stamp;
+	return m_entries + index;
+}
+
+void b2WarmStartCache::Store(const b2Contact* contact, const b2Manifold& manifold)
+{
+	if (manifold.pointCount == 0)
+	{
+		return;
+	}
+
+	b2WarmStartEntry* e = Insert(MakeKey(contact), m_stamp);
+	e->pointCount = manifold.pointCount;
+	for (int32 i = 0; i < manifold.pointCount; ++i)
+	{
+		e->points[i] = manifold.points[i];
+	}
+}
+
+int32 b2WarmStartCache::GetPoints(const b2Contact* contact, b2ManifoldPoint* points) const
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	int32 index = Find(MakeKey(contact));
+	if (index == -1)
+	{
+		return 0;
+	}
+
+	const b2WarmStartEntry* e = m_entries + index;
+	for (int32 i = 0; i < e->pointCount; ++i)
+	{
+		points[i] = e->points[i];
+	}
+	return e->pointCount;
+}
+
+bool b2WarmStartCache::Consume(b2Contact* contact)
+{
+	if (m_count == 0)
+	{
+		return false;
+	}
+
+	int32 index = Find(MakeKey(contact));
+	if (index == -1)
+	{
+		return false;
+	}
+
+	RemoveAt(index);
+	++m_hitCount;
+	return true;
+}
+
+void b2WarmStartCache::Step()
+{
+	++m_stamp;
+
+	// The bucket of this stamp holds the keys stored b2_warmStartCacheSteps + 1
+	// steps ago. Their entries expire now unless they were stored again since.
+	b2WarmStartBucket* bucket = m_buckets + m_stamp % e_bucketCount;
+	int32 expired = m_stamp - e_bucketCount;
+	for (int32 i = 0; i < bucket->count && m_count > 0; ++i)
+	{
+		int32 index = Find(bucket->keys[i]);
+		if (index != -1 && m_entries[index].stamp == expired)
+		{
+			RemoveAt(index);
+		}
+	}
+	bucket->count = 0;
+}
+
+void b2WarmStartCache::Clear()
+{
+	if (m_count > 0)
+	{
+		for (int32 i = 0; i < m_capacity; ++i)
+		{
+			m_entries[i] = b2WarmStartEntry();
+		}
+		m_count = 0;
+	}
+
+	for (int32 i = 0; i < e_bucketCount; ++i)
+	{
+		m_buckets[i].count = 0;
+	}
+}
@@ -0,0 +1,109 @@
+//
+//  b2WarmStartCache.h
+//  GameDevFramework
+//
+
+#ifndef B2_WARM_START_CACHE_H
+#define B2_WARM_START_CACHE_H
+
+#include "b2Collision.h"
+
+class b2Contact;
+class b2Fixture;
+
+/// Keeps the manifold impulses of contacts that stopped touching, or that the
+/// broad-phase destroyed, for b2_warmStartCacheSteps steps, keyed by fixture
+/// and child pair. When the pair touches again in that time the cached points
+/// are matched by contact id like the previous manifold, so the contact is warm
+/// started instead of starting from zero impulses.
+///
+/// The key holds each fixture's serial as well as its address, so a fixture that
+/// the block allocator puts at the address of a destroyed one never matches the
+/// destroyed one's entries. Those are not looked for on destroy, they expire.
+class b2WarmStartCache
+{
+public:
+	b2WarmStartCache();
+	~b2WarmStartCache();
+
+	/// Remember the impulses of a manifold of this contact's fixture pair.
+	void Store(const b2Contact* contact, const b2Manifold& manifold);
+
+	/// Copy the cached points of this contact's fixture pair, returns the point count.
+	/// This only reads the cache, so it may be called concurrently.
+	int32 GetPoints(const b2Contact* contact, b2ManifoldPoint* points) const;
+
+	/// Call when the contact starts touching. Drops the entry of its fixture pair,
+	/// counting a hit if there was one.
+	bool Consume(b2Contact* contact);
+
+	/// Advance one step and drop the entries that expire, without visiting the others.
+	void Step();
+
+	/// Drop every entry.
+	void Clear();
+
+	/// Grow the table so this many entries fit without rehashing.
+	void Reserve(int32 count);
+
+	int32 GetCount() const { return m_count; }
+
+	/// Contacts warm started from the cache since the last reset.
+	int32 GetHitCount() const { return m_hitCount; }
+	void ResetHitCount() { m_hitCount = 0; }
+
+private:
+	friend class b2World;
+
+	struct b2WarmStartKey
+	{
+		const b2Fixture* fixtureA;
+		const b2Fixture* fixtureB;
+		uint32 serialA;
+		uint32 serialB;
+		int32 childA;
+		int32 childB;
+	};
+
+	struct b2WarmStartEntry
+	{
+		b2WarmStartKey key;
+		int32 stamp;
+		int32 pointCount;
+		b2ManifoldPoint points[b2_maxManifoldPoints];
+	};
+
+	// The keys stored in one step, in the slot of that step's stamp. Step goes
+	// through the slot whose entries expire and then reuses it for the new step.
+	struct b2WarmStartBucket
+	{
+		b2WarmStartKey* keys;
+		int32 count;
+		int32 capacity;
+	};
+
+	enum
+	{
+		e_bucketCount = b2_warmStartCacheSteps + 1
+	};
+
+	static b2WarmStartKey MakeKey(const b2Fixture* fixtureA, int32 childA, const b2Fixture* fixtureB, int32 childB);
+	static b2WarmStartKey MakeKey(const b2Contact* contact);
+
+	int32 Find(const b2WarmStartKey& key) const;
+
+	// The entry of this key with the given stamp, a new one without points if there
+	// was none. Files the key under the stamp unless it already is.
+	b2WarmStartEntry* Insert(const b2WarmStartKey& key, int32 stamp);
+	void RemoveAt(int32 index);
+	void Grow();
+
+	b2WarmStartEntry* m_entries;
+	int32 m_capacity;
+	int32 m_count;
+	int32 m_stamp;
+	int32 m_hitCount;
+	b2WarmStartBucket m_buckets[e_bucketCount];
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "b2PulleyJoint.h"
 #include "b2Contact.h"
 #include "b2ContactSolver.h"
+#include "b2PolygonContact.h"
 #include "b2Collision.h"
 #include "b2BroadPhase.h"
 #include "b2CircleShape.h"
@@ -32,10 +33,24 @@
 #include "b2TimeOfImpact.h"
 #include "b2Draw.h"
 #include "b2Timer.h"
+#include "b2Profiler.h"
+#include "b2ThreadPool.h"
 #include <new>
 
-b2World::b2World(const b2Vec2& gravity)
+// An island gathered by b2World::SolveParallel, as ranges into flat arrays.
+struct b2IslandRange
 {
+	int32 bodyStart, bodyCount;
+	int32 staticStart, staticCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+};
+
+b2World::b2World(const b2Vec2& gravity, b2BroadPhaseType broadPhaseType, int32 stackSize)
+	: m_stackAllocator(stackSize)
+{
+	m_stackSize = stackSize;
+
 	m_destructionListener = NULL;
 	m_debugDraw = NULL;
 
@@ -44,12 +59,17 @@ b2World::b2World(const b2Vec2& gravity)
 
 	m_bodyCount = 0;
 	m_jointCount = 0;
+	m_fixtureSerial = 0;
 
 	m_warmStarting = true;
+	m_simdSolver = false;
+	m_simdSolverReference = false;
+	m_speculativeContacts = false;
 	m_continuousPhysics = true;
 	m_subStepping = false;
 
 	m_stepComplete = true;
+	m_maxTOIEvents = 0;
 
 	m_allowSleep = true;
 	m_gravity = gravity;
@@ -59,28 +79,121 @@ b2World::b2World(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_contactManager.m_stackAllocator = &m_stackAllocator;
+	m_contactManager.m_broadPhase.SetType(broadPhaseType);
+
+	m_threadPool = NULL;
+	m_workerAllocators = NULL;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
 
 b2World::~b2World()
 {
-	// Some shapes allocate using b2Alloc.
-	b2Body* b = m_bodyList;
-	while (b)
+	SetThreadCount(1);
+
+	// The block allocator frees the rest with its chunks.
+	FreeChainShapes();
+}
+
+void b2World::FreeChainShapes()
+{
+	// Chain shapes allocate their vertices using b2Alloc, and a long chain's
+	// proxy array is too large for a block so it comes from b2Alloc as well.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			if (f->m_shape->m_type == b2Shape::e_chain)
+			{
+				int32 proxiesSize = f->m_shape->GetChildCount() * sizeof(b2FixtureProxy);
+				if (proxiesSize > b2_maxBlockSize)
+				{
+					m_blockAllocator.Free(f->m_proxies, proxiesSize);
+					f->m_proxies = NULL;
+				}
+
+				b2ChainShape* s = (b2ChainShape*)f->m_shape;
+				s->~b2ChainShape();
+			}
+		}
+	}
+}
+
+void b2World::SetThreadCount(int32 count)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
 	{
-		b2Body* bNext = b->m_next;
+		return;
+	}
 
-		b2Fixture* f = b->m_fixtureList;
-		while (f)
+	count = b2Max(count, 1);
+	if (count == GetThreadCount())
+	{
+		return;
+	}
+
+	if (m_threadPool)
+	{
+		int32 workerCount = m_threadPool->GetThreadCount();
+		for (int32 i = 0; i < workerCount; ++i)
 		{
-			b2Fixture* fNext = f->m_next;
-			f->m_proxyCount = 0;
-			f->Destroy(&m_blockAllocator);
-			f = fNext;
+			m_workerAllocators[i].~b2StackAllocator();
 		}
+		b2Free(m_workerAllocators);
+		m_workerAllocators = NULL;
 
-		b = bNext;
+		m_threadPool->~b2ThreadPool();
+		b2Free(m_threadPool);
+		m_threadPool = NULL;
+	}
+
+	if (count > 1)
+	{
+		m_threadPool = new (b2Alloc(sizeof(b2ThreadPool))) b2ThreadPool(count);
+		m_workerAllocators = (b2StackAllocator*)b2Alloc(count * sizeof(b2StackAllocator));
+		for (int32 i = 0; i < count; ++i)
+		{
+			new (m_workerAllocators + i) b2StackAllocator(m_stackSize);
+		}
+	}
+
+	m_contactManager.m_threadPool = m_threadPool;
+	m_contactManager.m_broadPhase.SetThreadPool(m_threadPool);
+}
+
+int32 b2World::GetThreadCount() const
+{
+	return m_threadPool ? m_threadPool->GetThreadCount() : 1;
+}
+
+void b2World::SetWarmStartCache(bool flag)
+{
+	m_contactManager.m_warmStartCacheEnabled = flag;
+	if (flag == false)
+	{
+		m_contactManager.m_warmStartCache.Clear();
+	}
+}
+
+void b2World::SetSpeculativeContacts(bool flag)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_speculativeContacts = flag;
+	if (flag)
+	{
+		// Finish a sub-stepped TOI phase as a regular step.
+		m_stepComplete = true;
+	}
+	else
+	{
+		m_contactManager.ClearSpeculativeContacts();
 	}
 }
 
@@ -269,6 +382,72 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 	return j;
 }
 
+void b2World::DestroyAllBodies()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	FreeChainShapes();
+
+	m_bodyList = NULL;
+	m_jointList = NULL;
+	m_bodyCount = 0;
+	m_jointCount = 0;
+
+	m_contactManager.m_contactList = NULL;
+	m_contactManager.m_contactCount = 0;
+	m_contactManager.m_warmStartCache.Clear();
+	m_contactManager.m_broadPhase.Reset();
+
+	m_blockAllocator.Reset();
+
+	m_flags &= ~e_newFixture;
+}
+
+void b2World::Reserve(int32 bodyCount, int32 contactCount, int32 proxyCount)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	bodyCount = b2Max(bodyCount, 0);
+	contactCount = b2Max(contactCount, 0);
+	proxyCount = b2Max(proxyCount, 0);
+
+	// Every fixture has at least one proxy. The contact classes add no
+	// members, so one size class covers all of them.
+	m_blockAllocator.Reserve(sizeof(b2Body), bodyCount - m_bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2Fixture), proxyCount - m_contactManager.m_broadPhase.GetProxyCount());
+	m_blockAllocator.Reserve(sizeof(b2FixtureProxy), proxyCount - m_contactManager.m_broadPhase.GetProxyCount());
+	m_blockAllocator.Reserve(sizeof(b2PolygonContact), contactCount - m_contactManager.m_contactCount);
+
+	// The step peaks either in the narrow phase updates or in the solver,
+	// with the gather arrays of SolveParallel under an island's arrays.
+	int32 updateBytes = contactCount * sizeof(b2ContactUpdate);
+	int32 solveBytes = bodyCount * (5 * sizeof(b2Body*) + sizeof(b2IslandRange) + sizeof(b2Velocity) + sizeof(b2Position) + sizeof(uint64));
+	solveBytes += contactCount * (2 * sizeof(b2Contact*) + sizeof(int32)) + b2ContactSolver::GetConstraintBytes(contactCount);
+	int32 stackSize = b2Max(updateBytes, solveBytes);
+	if (stackSize > m_stackSize)
+	{
+		m_stackSize = stackSize;
+		m_stackAllocator.Reserve(m_stackSize);
+		int32 workerCount = m_threadPool ? m_threadPool->GetThreadCount() : 0;
+		for (int32 i = 0; i < workerCount; ++i)
+		{
+			m_workerAllocators[i].Reserve(m_stackSize);
+		}
+	}
+
+	m_contactManager.m_warmStartCache.Reserve(contactCount);
+	m_contactManager.m_broadPhase.Reserve(proxyCount, contactCount);
+	m_toiQueue.Reserve(contactCount);
+}
+
 void b2World::DestroyJoint(b2Joint* j)
 {
 	b2Assert(IsLocked() == false);
@@ -385,10 +564,56 @@ void b2World::SetAllowSleeping(bool flag)
 // Find islands, integrate and solve constraints, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
+	B2_PROFILE_ZONE("b2World::Solve");
 	m_profile.solveInit = 0.0f;
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
+	if (m_threadPool)
+	{
+		SolveParallel(step);
+	}
+	else
+	{
+		SolveSerial(step);
+	}
+
+	{
+		b2Timer timer;
+		// Synchronize fixtures, check for out of range bodies.
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			// If a body was not in an island then it did not move.
+			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				continue;
+			}
+
+			if (b->GetType() == b2_staticBody)
+			{
+				continue;
+			}
+
+			// Update fixtures (for broad-phase).
+			if (m_speculativeContacts)
+			{
+				b->SynchronizeFixtures(step.dt);
+			}
+			else
+			{
+				b->SynchronizeFixtures();
+			}
+		}
+
+		// Look for new contacts.
+		m_contactManager.FindNewContacts();
+		m_profile.broadphase = timer.GetMilliseconds();
+	}
+}
+
+// Build and solve each island as soon as it is found.
+void b2World::SolveSerial(const b2TimeStep& step)
+{
 	// Size the island for the worst case.
 	b2Island island(m_bodyCount,
 					m_contactManager.m_contactCount,
@@ -466,9 +691,9 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				// Is this contact solid and touching?
+				// Is this contact solid and touching, or about to?
 				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
+					(contact->IsTouching() == false && contact->IsSpeculative() == false))
 				{
 					continue;
 				}
@@ -546,169 +771,585 @@ void b2World::Solve(const b2TimeStep& step)
 	}
 
 	m_stackAllocator.Free(stack);
+}
 
+// Solves the gathered islands, one b2Island per island on the worker's own
+// stack allocator. The static bodies are shared by every island, each island
+// only fills the slots of the static bodies it reaches.
+class b2IslandSolveTask : public b2ThreadTask
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		b2StackAllocator* allocator = allocators + workerIndex;
+		for (int32 i = begin; i < end; ++i)
 		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			const b2IslandRange* range = ranges + i;
+			b2Island island(sharedCount + range->bodyCount,
+							range->contactCount,
+							range->jointCount,
+							allocator,
+							NULL);
+
+			island.SetShared(statics + range->staticStart, range->staticCount, sharedCount);
+			for (int32 j = 0; j < range->bodyCount; ++j)
 			{
-				continue;
+				island.Add(bodies[range->bodyStart + j]);
 			}
-
-			if (b->GetType() == b2_staticBody)
+			for (int32 j = 0; j < range->contactCount; ++j)
 			{
-				continue;
+				island.Add(contacts[range->contactStart + j]);
+			}
+			for (int32 j = 0; j < range->jointCount; ++j)
+			{
+				island.Add(joints[range->jointStart + j]);
 			}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
+			island.Solve(profiles + i, *step, gravity, allowSleep);
 		}
-
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
 	}
-}
 
-// Find TOI contacts and solve them.
-void b2World::SolveTOI(const b2TimeStep& step)
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool allowSleep;
+	b2StackAllocator* allocators;
+	const b2IslandRange* ranges;
+	b2Body** statics;
+	int32 sharedCount;
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2Profile* profiles;
+};
+
+// Gather every awake island first, then solve them on the thread pool.
+// This gives the same results as SolveSerial, islands never share a
+// dynamic body and the solver only reads the static bodies.
+void b2World::SolveParallel(const b2TimeStep& step)
 {
-	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	// Clear all the island flags. Static bodies get their shared island
+	// index the first time an island reaches them.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+		if (b->GetType() == b2_staticBody)
+		{
+			b->m_islandIndex = -1;
+		}
+	}
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_islandFlag = false;
+	}
 
-	if (m_stepComplete)
+	// Each static body appears at most once per island and is reached
+	// through a contact or joint edge.
+	int32 bodyCapacity = m_bodyCount;
+	int32 staticCapacity = m_contactManager.m_contactCount + m_jointCount;
+	int32 contactCapacity = m_contactManager.m_contactCount;
+	int32 jointCapacity = m_jointCount;
+
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Body*));
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Body*));
+	b2Body** statics = (b2Body**)m_stackAllocator.Allocate(staticCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b2Contact*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(jointCapacity * sizeof(b2Joint*));
+	b2IslandRange* ranges = (b2IslandRange*)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2IslandRange));
+
+	int32 bodyCount = 0;
+	int32 sharedCount = 0;
+	int32 staticCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 islandCount = 0;
+
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		if (seed->m_flags & b2Body::e_islandFlag)
 		{
-			b->m_flags &= ~b2Body::e_islandFlag;
-			b->m_sweep.alpha0 = 0.0f;
+			continue;
 		}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		if (seed->IsAwake() == false || seed->IsActive() == false)
 		{
-			// Invalidate TOI
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
+			continue;
 		}
-	}
 
-	// Find TOI events and solve them.
-	for (;;)
-	{
-		// Find the first TOI.
-		b2Contact* minContact = NULL;
-		float32 minAlpha = 1.0f;
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
+		{
+			continue;
+		}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		b2IslandRange* range = ranges + islandCount;
+		range->bodyStart = bodyCount;
+		range->staticStart = staticCount;
+		range->contactStart = contactCount;
+		range->jointStart = jointCount;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// Perform a depth first search (DFS) on the constraint graph. This
+		// must visit the graph in the same order as SolveSerial.
+		while (stackCount > 0)
 		{
-			// Is this contact disabled?
-			if (c->IsEnabled() == false)
-			{
-				continue;
-			}
+			b2Body* b = stack[--stackCount];
+			b2Assert(b->IsActive() == true);
+
+			// Make sure the body is awake.
+			b->SetAwake(true);
 
-			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
+			// To keep islands as small as possible, we don't
+			// propagate islands across static bodies.
+			if (b->GetType() == b2_staticBody)
 			{
+				if (b->m_islandIndex == -1)
+				{
+					b->m_islandIndex = sharedCount++;
+				}
+
+				statics[staticCount++] = b;
 				continue;
 			}
 
-			float32 alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
-			{
-				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
-			}
-			else
+			bodies[bodyCount++] = b;
+
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
+				b2Contact* contact = ce->contact;
 
-				// Is there a sensor?
-				if (fA->IsSensor() || fB->IsSensor())
+				// Has this contact already been added to an island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
+
+				// Is this contact solid and touching, or about to?
+				if (contact->IsEnabled() == false ||
+					(contact->IsTouching() == false && contact->IsSpeculative() == false))
 				{
 					continue;
 				}
 
-				b2Body* bA = fA->GetBody();
-				b2Body* bB = fB->GetBody();
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
 
-				b2BodyType typeA = bA->m_type;
-				b2BodyType typeB = bB->m_type;
-				b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+				contacts[contactCount++] = contact;
+				contact->m_flags |= b2Contact::e_islandFlag;
 
-				bool activeA = bA->IsAwake() && typeA != b2_staticBody;
-				bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+				b2Body* other = ce->other;
 
-				// Is at least one body active (awake and dynamic or kinematic)?
-				if (activeA == false && activeB == false)
+				// Was the other body already added to this island?
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
 					continue;
 				}
 
-				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
-				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+				b2Assert(stackCount < bodyCapacity);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
 
-				// Are these two non-bullet dynamic bodies?
-				if (collideA == false && collideB == false)
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
 				{
 					continue;
 				}
 
-				// Compute the TOI for this contact.
-				// Put the sweeps onto the same time interval.
-				float32 alpha0 = bA->m_sweep.alpha0;
+				b2Body* other = je->other;
 
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
 				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
+					continue;
 				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+
+				joints[jointCount++] = je->joint;
+				je->joint->m_islandFlag = true;
+
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
+					continue;
 				}
 
-				b2Assert(alpha0 < 1.0f);
+				b2Assert(stackCount < bodyCapacity);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+		}
 
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
+		range->bodyCount = bodyCount - range->bodyStart;
+		range->staticCount = staticCount - range->staticStart;
+		range->contactCount = contactCount - range->contactStart;
+		range->jointCount = jointCount - range->jointStart;
+		++islandCount;
 
-				// Compute the time of impact in interval [0, minTOI]
-				b2TOIInput input;
-				input.proxyA.Set(fA->GetShape(), indexA);
-				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
-				input.tMax = 1.0f;
+		// Allow static bodies to participate in other islands.
+		for (int32 i = 0; i < range->staticCount; ++i)
+		{
+			statics[range->staticStart + i]->m_flags &= ~b2Body::e_islandFlag;
+		}
+	}
 
-				b2TOIOutput output;
-				b2TimeOfImpact(&output, &input);
+	b2Profile* profiles = (b2Profile*)m_stackAllocator.Allocate(b2Max(islandCount, 1) * sizeof(b2Profile));
+
+	b2IslandSolveTask task;
+	task.step = &step;
+	task.gravity = m_gravity;
+	task.allowSleep = m_allowSleep;
+	task.allocators = m_workerAllocators;
+	task.ranges = ranges;
+	task.statics = statics;
+	task.sharedCount = sharedCount;
+	task.bodies = bodies;
+	task.contacts = contacts;
+	task.joints = joints;
+	task.profiles = profiles;
+	m_threadPool->Run(&task, islandCount, 1);
+
+	// Apply what the islands would have done to the shared bodies and the
+	// listener, in the order SolveSerial visits the islands.
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		const b2IslandRange* range = ranges + i;
 
-				// Beta is the fraction of the remaining portion of the .
-				float32 beta = output.t;
-				if (output.state == b2TOIOutput::e_touching)
+		m_profile.solveInit += profiles[i].solveInit;
+		m_profile.solveVelocity += profiles[i].solveVelocity;
+		m_profile.solvePosition += profiles[i].solvePosition;
+
+		if (listener)
+		{
+			for (int32 j = 0; j < range->contactCount; ++j)
+			{
+				b2Contact* c = contacts[range->contactStart + j];
+				if (c->IsTouching() == false)
 				{
-					alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+					continue;
 				}
-				else
+
+				const b2Manifold* manifold = c->GetManifold();
+
+				b2ContactImpulse impulse;
+				impulse.count = manifold->pointCount;
+				for (int32 k = 0; k < manifold->pointCount; ++k)
 				{
-					alpha = 1.0f;
+					impulse.normalImpulses[k] = manifold->points[k].normalImpulse;
+					impulse.tangentImpulses[k] = manifold->points[k].tangentImpulse;
 				}
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
+				listener->PostSolve(c, &impulse);
 			}
+		}
 
-			if (alpha < minAlpha)
+		// An island either goes to sleep as a whole or stays awake.
+		bool asleep = bodies[range->bodyStart]->IsAwake() == false;
+		for (int32 j = 0; j < range->staticCount; ++j)
+		{
+			b2Body* b = statics[range->staticStart + j];
+			b->SetAwake(true);
+			if (asleep)
+			{
+				b->SetAwake(false);
+			}
+		}
+	}
+
+	m_stackAllocator.Free(profiles);
+	m_stackAllocator.Free(ranges);
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(statics);
+	m_stackAllocator.Free(bodies);
+	m_stackAllocator.Free(stack);
+}
+
+// Computes the TOI of contacts on the thread pool.
+class b2TOITask : public b2ThreadTask
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		world->ComputeTOIs(updates, begin, end);
+	}
+
+	const b2World* world;
+	b2TOIUpdate* updates;
+};
+
+// The TOI of each contact, found the way the serial scan over the contact list
+// did, except that the sweeps are advanced on copies. Nothing outside of the
+// b2TOIUpdate array is written.
+void b2World::ComputeTOIs(b2TOIUpdate* updates, int32 begin, int32 end) const
+{
+	B2_PROFILE_ZONE("b2World::ComputeTOIs");
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2TOIUpdate* u = updates + i;
+		b2Contact* c = u->contact;
+		u->alpha = 1.0f;
+		u->iterations = 0;
+		u->computed = false;
+
+		// Is this contact disabled?
+		if (c->IsEnabled() == false)
+		{
+			continue;
+		}
+
+		// Prevent excessive sub-stepping.
+		if (c->m_toiCount > b2_maxSubSteps)
+		{
+			continue;
+		}
+
+		b2Fixture* fA = c->GetFixtureA();
+		b2Fixture* fB = c->GetFixtureB();
+
+		// Is there a sensor?
+		if (fA->IsSensor() || fB->IsSensor())
+		{
+			continue;
+		}
+
+		b2Body* bA = fA->GetBody();
+		b2Body* bB = fB->GetBody();
+
+		b2BodyType typeA = bA->m_type;
+		b2BodyType typeB = bB->m_type;
+		b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+
+		bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+		bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+
+		// Is at least one body active (awake and dynamic or kinematic)?
+		if (activeA == false && activeB == false)
+		{
+			continue;
+		}
+
+		bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+		bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+		// Are these two non-bullet dynamic bodies?
+		if (collideA == false && collideB == false)
+		{
+			continue;
+		}
+
+		// Compute the TOI for this contact.
+		// Put the sweeps onto the same time interval.
+		b2Sweep sweepA = bA->m_sweep;
+		b2Sweep sweepB = bB->m_sweep;
+		float32 alpha0 = sweepA.alpha0;
+
+		if (sweepA.alpha0 < sweepB.alpha0)
+		{
+			alpha0 = sweepB.alpha0;
+			sweepA.Advance(alpha0);
+		}
+		else if (sweepB.alpha0 < sweepA.alpha0)
+		{
+			alpha0 = sweepA.alpha0;
+			sweepB.Advance(alpha0);
+		}
+
+		b2Assert(alpha0 < 1.0f);
+
+		int32 indexA = c->GetChildIndexA();
+		int32 indexB = c->GetChildIndexB();
+
+		// Compute the time of impact in interval [0, minTOI]
+		b2TOIInput input;
+		input.proxyA.Set(fA->GetShape(), indexA);
+		input.proxyB.Set(fB->GetShape(), indexB);
+		input.sweepA = sweepA;
+		input.sweepB = sweepB;
+		input.tMax = 1.0f;
+
+		b2TOIOutput output;
+		b2TimeOfImpact(&output, &input);
+
+		// Beta is the fraction of the remaining portion of the .
+		float32 beta = output.t;
+		if (output.state == b2TOIOutput::e_touching)
+		{
+			u->alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+		}
+
+		u->iterations = output.iterations;
+		u->computed = true;
+	}
+}
+
+// Applies the computed TOIs in the order they were added and queues the ones
+// inside the step. The serial scan advanced the sweep of the body that was
+// behind as a side effect, that is kept so the bodies end up the same. Every
+// contact that is recomputed touches a body that was just moved to the
+// current TOI, so advancing the copies first gives the same sweeps.
+void b2World::QueueTOIs()
+{
+	b2TOIUpdate* updates = m_toiQueue.GetPending();
+	int32 count = m_toiQueue.GetPendingCount();
+
+	// The contacts one sub-step invalidates are usually too few to be worth
+	// waking the pool for, the first batch of a step is the one that is split.
+	const int32 grainSize = 32;
+	if (m_threadPool && count >= 8 * grainSize)
+	{
+		b2TOITask task;
+		task.world = this;
+		task.updates = updates;
+		m_threadPool->Run(&task, count, grainSize);
+	}
+	else
+	{
+		ComputeTOIs(updates, 0, count);
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2TOIUpdate* u = updates + i;
+		b2Contact* c = u->contact;
+		c->m_flags &= ~b2Contact::e_toiPendingFlag;
+
+		if (u->computed == false)
+		{
+			continue;
+		}
+
+		b2Sweep& sweepA = c->GetFixtureA()->GetBody()->m_sweep;
+		b2Sweep& sweepB = c->GetFixtureB()->GetBody()->m_sweep;
+		if (sweepA.alpha0 < sweepB.alpha0)
+		{
+			sweepA.Advance(sweepB.alpha0);
+		}
+		else if (sweepB.alpha0 < sweepA.alpha0)
+		{
+			sweepB.Advance(sweepA.alpha0);
+		}
+
+		c->m_toi = u->alpha;
+		c->m_flags |= b2Contact::e_toiFlag;
+		++m_profile.toiCalls;
+		m_profile.toiIterations += u->iterations;
+
+		if (u->alpha < 1.0f)
+		{
+			b2TOICandidate candidate;
+			candidate.alpha = u->alpha;
+			candidate.order = c->m_toiOrder;
+			candidate.contact = c;
+			m_toiQueue.Push(candidate);
+		}
+	}
+
+	m_toiQueue.ClearPending();
+}
+
+void b2World::AddPendingTOI(b2Contact* contact)
+{
+	if ((contact->m_flags & b2Contact::e_toiPendingFlag) == 0)
+	{
+		contact->m_flags |= b2Contact::e_toiPendingFlag;
+		m_toiQueue.AddPending(contact);
+	}
+}
+
+// Find TOI contacts and solve them. The TOI of every contact is computed once
+// up front and then only for the contacts a sub-step invalidates or creates,
+// the earliest is taken from a queue instead of scanning the contact list for
+// it after every sub-step. Events come out in the same order as the scan.
+void b2World::SolveTOI(const b2TimeStep& step)
+{
+	B2_PROFILE_ZONE("b2World::SolveTOI");
+	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+
+	if (m_stepComplete)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			b->m_flags &= ~b2Body::e_islandFlag;
+			b->m_sweep.alpha0 = 0.0f;
+		}
+
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			// Invalidate TOI
+			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			c->m_toiCount = 0;
+			c->m_toi = 1.0f;
+		}
+	}
+
+	// Number the contacts in list order. Contacts created by a sub-step go to
+	// the head of the list, they are numbered down from the first one.
+	m_toiQueue.Clear();
+	int32 firstOrder = 0;
+	int32 order = 0;
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_toiOrder = order++;
+
+		// A TOI cached by the last sub-stepped call is still valid.
+		if (c->m_flags & b2Contact::e_toiFlag)
+		{
+			if (c->m_toi < 1.0f)
+			{
+				b2TOICandidate candidate;
+				candidate.alpha = c->m_toi;
+				candidate.order = c->m_toiOrder;
+				candidate.contact = c;
+				m_toiQueue.Push(candidate);
+			}
+			continue;
+		}
+
+		AddPendingTOI(c);
+	}
+	QueueTOIs();
+
+	// Find TOI events and solve them.
+	for (;;)
+	{
+		if (m_maxTOIEvents > 0 && m_profile.toiEvents == m_maxTOIEvents)
+		{
+			// Out of budget, the remaining bodies finish the step without CCD.
+			m_stepComplete = true;
+			break;
+		}
+
+		// Find the first TOI. A candidate is stale if its contact was invalidated
+		// since, or was disabled or sub-stepped too often, like the scan skips them.
+		b2Contact* minContact = NULL;
+		float32 minAlpha = 1.0f;
+		while (m_toiQueue.IsEmpty() == false)
+		{
+			b2TOICandidate candidate = m_toiQueue.Top();
+			m_toiQueue.Pop();
+
+			b2Contact* c = candidate.contact;
+			if ((c->m_flags & b2Contact::e_toiFlag) && c->m_toi == candidate.alpha &&
+				c->IsEnabled() && c->m_toiCount <= b2_maxSubSteps)
 			{
-				// This is the minimum TOI found so far.
 				minContact = c;
-				minAlpha = alpha;
+				minAlpha = candidate.alpha;
+				break;
 			}
 		}
 
@@ -719,6 +1360,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			break;
 		}
 
+		++m_profile.toiEvents;
+
 		// Advance the bodies to the TOI.
 		b2Fixture* fA = minContact->GetFixtureA();
 		b2Fixture* fB = minContact->GetFixtureB();
@@ -732,7 +1375,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		bB->Advance(minAlpha);
 
 		// The TOI contact likely has some new contact points.
-		minContact->Update(m_contactManager.m_contactListener);
+		minContact->Update(m_contactManager.m_contactListener, m_contactManager.GetWarmStartCache());
 		minContact->m_flags &= ~b2Contact::e_toiFlag;
 		++minContact->m_toiCount;
 
@@ -812,7 +1455,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Update the contact points
-					contact->Update(m_contactManager.m_contactListener);
+					contact->Update(m_contactManager.m_contactListener, m_contactManager.GetWarmStartCache());
 
 					// Was the contact disabled by the user?
 					if (contact->IsEnabled() == false)
@@ -860,6 +1503,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		subStep.simdSolver = false;
+		subStep.simdSolverReference = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
@@ -879,25 +1524,71 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
 			{
 				ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+				AddPendingTOI(ce->contact);
 			}
 		}
 
 		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
 		// Also, some contacts can be destroyed.
+		b2Contact* oldHead = m_contactManager.m_contactList;
 		m_contactManager.FindNewContacts();
 
+		int32 newCount = 0;
+		for (b2Contact* c = m_contactManager.m_contactList; c != oldHead; c = c->m_next)
+		{
+			++newCount;
+		}
+
+		firstOrder -= newCount;
+		order = firstOrder;
+		for (b2Contact* c = m_contactManager.m_contactList; c != oldHead; c = c->m_next)
+		{
+			c->m_toiOrder = order++;
+			AddPendingTOI(c);
+		}
+
 		if (m_subStepping)
 		{
+			// The next call numbers the list again and finds these then.
+			b2TOIUpdate* pending = m_toiQueue.GetPending();
+			for (int32 i = 0; i < m_toiQueue.GetPendingCount(); ++i)
+			{
+				pending[i].contact->m_flags &= ~b2Contact::e_toiPendingFlag;
+			}
+			m_toiQueue.ClearPending();
+
 			m_stepComplete = false;
 			break;
 		}
+
+		QueueTOIs();
 	}
 }
 
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
 {
+	B2_PROFILE_ZONE("b2World::Step");
 	b2Timer stepTimer;
 
+	m_contactManager.m_warmStartCache.ResetHitCount();
+	m_profile.toiEvents = 0;
+	m_profile.toiCalls = 0;
+	m_profile.toiIterations = 0;
+	m_stackAllocator.ResetCounters();
+	for (int32 i = 0; m_threadPool && i < m_threadPool->GetThreadCount(); ++i)
+	{
+		m_workerAllocators[i].ResetCounters();
+	}
+
+	// Remember where every body started so the step can be interpolated when rendering.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_xf0 = b->m_xf;
+	}
+
+	// The tree has to be built before new contacts can be found.
+	EndBulkInsert();
+
 	// If new fixtures were added, we need to find the new contacts.
 	if (m_flags & e_newFixture)
 	{
@@ -923,6 +1614,8 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.simdSolver = m_simdSolver;
+	step.simdSolverReference = m_simdSolverReference;
 	
 	// Update contacts. This is where some contacts are destroyed.
 	{
@@ -931,6 +1624,14 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 		m_profile.collide = timer.GetMilliseconds();
 	}
 
+	// Contacts that are not touching yet but will be within the step.
+	if (m_speculativeContacts && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		m_contactManager.FindSpeculativeContacts(step.dt);
+		m_profile.collide += timer.GetMilliseconds();
+	}
+
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (m_stepComplete && step.dt > 0.0f)
 	{
@@ -939,8 +1640,8 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 		m_profile.solve = timer.GetMilliseconds();
 	}
 
-	// Handle TOI events.
-	if (m_continuousPhysics && step.dt > 0.0f)
+	// Handle TOI events. Speculative contacts already kept the bodies apart.
+	if (m_continuousPhysics && m_speculativeContacts == false && step.dt > 0.0f)
 	{
 		b2Timer timer;
 		SolveTOI(step);
@@ -959,6 +1660,14 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 
 	m_flags &= ~e_locked;
 
+	m_profile.warmStartCacheHits = m_contactManager.m_warmStartCache.GetHitCount();
+	m_profile.stackPeak = m_stackAllocator.GetPeakAllocation();
+	m_profile.stackGrowCount = m_stackAllocator.GetGrowCount();
+	for (int32 i = 0; m_threadPool && i < m_threadPool->GetThreadCount(); ++i)
+	{
+		m_profile.stackPeak = b2Max(m_profile.stackPeak, m_workerAllocators[i].GetPeakAllocation());
+		m_profile.stackGrowCount += m_workerAllocators[i].GetGrowCount();
+	}
 	m_profile.step = stepTimer.GetMilliseconds();
 }
 
@@ -1132,7 +1841,7 @@ void b2World::DrawJoint(b2Joint* joint)
 	}
 }
 
-void b2World::DrawDebugData()
+void b2World::DrawDebugData(float32 alpha)
 {
 	if (m_debugDraw == NULL)
 	{
@@ -1145,7 +1854,7 @@ void b2World::DrawDebugData()
 	{
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			const b2Transform& xf = b->GetTransform();
+			b2Transform xf = alpha < 1.0f ? b->GetInterpolatedTransform(alpha) : b->GetTransform();
 			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
 			{
 				if (b->IsActive() == false)
@@ -1256,6 +1965,16 @@ float32 b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::BeginBulkInsert()
+{
+	m_contactManager.m_broadPhase.BeginBulkInsert();
+}
+
+void b2World::EndBulkInsert()
+{
+	m_contactManager.m_broadPhase.EndBulkInsert();
+}
+
 void b2World::Dump()
 {
 	if ((m_flags & e_locked) == e_locked)
@@ -25,6 +25,7 @@
 #include "b2ContactManager.h"
 #include "b2WorldCallbacks.h"
 #include "b2TimeStep.h"
+#include "b2TOIQueue.h"
 
 struct b2AABB;
 struct b2BodyDef;
@@ -34,6 +35,19 @@ class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2Snapshot;
+class b2SnapshotReader;
+class b2ThreadPool;
+
+/// The closest fixture a ray of b2World::RayCastBatch hit. The fixture is
+/// NULL if the ray hit nothing.
+struct b2RayCastHit
+{
+	b2Fixture* fixture;
+	b2Vec2 point;
+	b2Vec2 normal;
+	float32 fraction;
+};
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -43,7 +57,12 @@ class b2World
 public:
 	/// Construct a world object.
 	/// @param gravity the world gravity vector.
-	b2World(const b2Vec2& gravity);
+	/// @param broadPhaseType the structure the broad-phase keeps the proxies in.
+	/// Sweep-and-prune can beat the dynamic tree in wide, mostly resting scenes.
+	/// @param stackSize the initial size of the per step stack allocators. They
+	/// grow when a step needs more, see b2Profile::stackGrowCount.
+	b2World(const b2Vec2& gravity, b2BroadPhaseType broadPhaseType = b2_dynamicTreeBroadPhase,
+			int32 stackSize = b2_stackSize);
 
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
@@ -86,6 +105,38 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyJoint(b2Joint* joint);
 
+	/// Destroy every body, joint and contact at once by resetting the block
+	/// allocator and the broad-phase, instead of unlinking them one at a time.
+	/// This costs O(chunks); the fixtures are only walked to free the vertices
+	/// of chain shapes. The destruction listener is not called.
+	/// @warning This function is locked during callbacks.
+	void DestroyAllBodies();
+
+	/// Reserve memory for a scene expected to grow to this many bodies,
+	/// contacts and broad-phase proxies, so that creating them and stepping
+	/// the world don't reach the heap. Counts already reached are ignored.
+	/// @warning This function is locked during callbacks.
+	void Reserve(int32 bodyCount, int32 contactCount, int32 proxyCount);
+
+	/// Append the whole world to a snapshot: the bodies, fixtures, shapes and
+	/// joints, the contacts with their impulses, the broad-phase and the warm
+	/// start cache. Restoring it and stepping takes bit for bit the steps this
+	/// world takes from here. User data pointers are saved as they are.
+	/// @warning This function is locked during callbacks.
+	void SaveState(b2Snapshot* snapshot);
+
+	/// Restore a world written by SaveState. When the world still has the
+	/// same bodies, fixtures and joints in the same order, they are updated
+	/// in place and pointers to them stay valid. Otherwise every body is
+	/// destroyed and the saved ones are created again. Contacts are replaced
+	/// without listener callbacks either way.
+	/// The whole snapshot is checked before anything is changed.
+	/// @return false if the snapshot wasn't written by this build, is cut
+	/// short or has an index out of range, or the world would have to be
+	/// created again and has a gear joint. The world is left as it was then.
+	/// @warning This function is locked during callbacks.
+	bool RestoreState(b2SnapshotReader* reader);
+
 	/// Take a time step. This performs collision detection, integration,
 	/// and constraint solution.
 	/// @param timeStep the amount of time to simulate, this should not vary.
@@ -105,7 +156,9 @@ public:
 	void ClearForces();
 
 	/// Call this to draw shapes and other debug draw data.
-	void DrawDebugData();
+	/// @param alpha blends each body from its previous to its current transform,
+	/// see b2Body::GetInterpolatedTransform.
+	void DrawDebugData(float32 alpha = 1.0f);
 
 	/// Query the world for all fixtures that potentially overlap the
 	/// provided AABB.
@@ -121,6 +174,22 @@ public:
 	/// @param point2 the ray ending point
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const;
 
+	/// Ray-cast many rays for the closest fixture each one hits, without a
+	/// callback per hit. Sensors and fixtures whose category bits are not in
+	/// maskBits are skipped. Like RayCast, shapes that contain the start of a
+	/// ray are not hit. Large batches are split across the thread pool.
+	/// @param inputs the rays, each from p1 to p1 + maxFraction * (p2 - p1).
+	/// @param hits receives the closest hit of each ray.
+	/// @param count the number of rays.
+	void RayCastBatch(const b2RayCastInput* inputs, b2RayCastHit* hits, int32 count, uint16 maskBits = 0xFFFF) const;
+
+	/// Query many AABBs for the fixtures that potentially overlap them, like
+	/// QueryAABB but into flat arrays. The fixtures of aabbs[i] are written from
+	/// fixtures[i * maxFixtures] on and their number to fixtureCounts[i]. A count
+	/// above maxFixtures means the rest did not fit. Large batches are split
+	/// across the thread pool.
+	void QueryAABBBatch(const b2AABB* aabbs, int32 count, b2Fixture** fixtures, int32 maxFixtures, int32* fixtureCounts) const;
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A NULL body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -153,13 +222,66 @@ public:
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 	bool GetContinuousPhysics() const { return m_continuousPhysics; }
 
+	/// Set the most TOI events the continuous solver handles in one step. The
+	/// earliest events are solved first, the bodies of the rest move the whole
+	/// step and may tunnel. Zero, the default, is no limit.
+	void SetMaxTOIEvents(int32 count) { m_maxTOIEvents = b2Max(count, 0); }
+	int32 GetMaxTOIEvents() const { return m_maxTOIEvents; }
+
+	/// Enable/disable speculative contacts. Contacts that are not touching but that
+	/// could close within the step are solved with the gap as their allowed approach,
+	/// and proxies are swept along the velocity instead of the last step's motion.
+	/// This replaces the TOI phase: continuous physics is skipped while it is on and
+	/// those contacts do not bounce. A body knocked into another within the step
+	/// can still pass through it, its gap was only checked against its old velocity.
+	void SetSpeculativeContacts(bool flag);
+	bool GetSpeculativeContacts() const { return m_speculativeContacts; }
+
 	/// Enable/disable single stepped continuous physics. For testing.
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable the SIMD contact velocity solver. Contacts are graph
+	/// colored and solved b2_simdWidth at a time, which changes the order
+	/// contacts are visited in, so results differ slightly from the default.
+	void SetSimdSolver(bool flag) { m_simdSolver = flag; }
+	bool GetSimdSolver() const { return m_simdSolver; }
+
+	/// With the SIMD solver on, solve its colored batch order one contact at a
+	/// time with the scalar code instead. Both visit the contacts in the same
+	/// order, so they should agree up to float rounding. For testing.
+	void SetSimdSolverReference(bool flag) { m_simdSolverReference = flag; }
+	bool GetSimdSolverReference() const { return m_simdSolverReference; }
+
+	/// Enable/disable warm starting contacts that start touching with the impulses
+	/// their fixture pair had when it stopped touching in the last few steps.
+	void SetWarmStartCache(bool flag);
+	bool GetWarmStartCache() const { return m_contactManager.m_warmStartCacheEnabled; }
+
+	/// Enable/disable sort-free pair generation in the broad-phase. New contacts
+	/// are the same, but they are created in a different order, so results
+	/// differ slightly from the default. See b2BroadPhase::SetSortFreePairs.
+	void SetSortFreePairs(bool flag) { m_contactManager.m_broadPhase.SetSortFreePairs(flag); }
+	bool GetSortFreePairs() const { return m_contactManager.m_broadPhase.GetSortFreePairs(); }
+
+	/// Set the number of threads used to solve islands. With more than one
+	/// thread the islands are collected first and then solved concurrently,
+	/// each worker with its own stack allocator. Post-solve callbacks are
+	/// still reported on the calling thread, in island order, after all
+	/// islands are solved. The narrow phase also evaluates contact manifolds
+	/// on these threads; begin/end/pre-solve callbacks keep their serial order.
+	/// The broad-phase queries large move buffers on them too.
+	/// The default of one keeps the serial solver.
+	/// @warning This function is locked during callbacks.
+	void SetThreadCount(int32 count);
+	int32 GetThreadCount() const;
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
+	/// Get the structure the broad-phase keeps its proxies in.
+	b2BroadPhaseType GetBroadPhaseType() const { return m_contactManager.m_broadPhase.GetType(); }
+
 	/// Get the number of bodies.
 	int32 GetBodyCount() const;
 
@@ -179,6 +301,14 @@ public:
 	/// The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Call before creating the fixtures of a level. Their broad-phase proxies
+	/// are held back from the dynamic tree until EndBulkInsert, which builds
+	/// the tree in one pass instead of inserting the proxies one at a time.
+	/// The world cannot be queried in between, and Step ends the bulk insert
+	/// if it is still open.
+	void BeginBulkInsert();
+	void EndBulkInsert();
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 	
@@ -200,6 +330,9 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Get the memory used by bodies, fixtures, shapes, joints and contacts.
+	void GetBlockStats(b2BlockStats* stats) const { m_blockAllocator.GetStats(stats); }
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
@@ -218,15 +351,45 @@ private:
 	friend class b2Fixture;
 	friend class b2ContactManager;
 	friend class b2Controller;
+	friend class b2TOITask;
 
 	void Solve(const b2TimeStep& step);
+	void SolveSerial(const b2TimeStep& step);
+	void SolveParallel(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
+	// The TOI steps of SolveTOI. ComputeTOIs only writes the b2TOIUpdate array and
+	// runs on the thread pool, QueueTOIs then applies the results in order.
+	void ComputeTOIs(b2TOIUpdate* updates, int32 begin, int32 end) const;
+	void QueueTOIs();
+	void AddPendingTOI(b2Contact* contact);
+
+	void FreeChainShapes();
+
+	// Read the bodies, fixtures and joints a snapshot has. MatchLayout fills
+	// the arrays with the world's own if they are the same, BuildLayout
+	// creates them anew.
+	bool MatchLayout(b2SnapshotReader* reader, b2Body** bodies, b2Fixture** fixtures, b2Joint** joints, bool* canBuild);
+	void BuildLayout(b2SnapshotReader* reader, b2Body** bodies, b2Fixture** fixtures, b2Joint** joints);
+
+	// Read the rest of a snapshot without changing anything, failing the
+	// reader where restoring would index out of range or loop forever.
+	void CheckState(b2SnapshotReader* reader, int32 layoutStart);
+
+	// The index of a fixture in a snapshot, SaveState keeps the body indices
+	// in m_islandIndex and the index of each body's first fixture in firstFixtures.
+	int32 GetSnapshotIndex(const b2Fixture* fixture, const int32* firstFixtures) const;
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
+	int32 m_stackSize;
+
+	// Worker pool and one stack allocator per worker, NULL when single threaded.
+	b2ThreadPool* m_threadPool;
+	b2StackAllocator* m_workerAllocators;
 
 	int32 m_flags;
 
@@ -238,6 +401,9 @@ private:
 	int32 m_bodyCount;
 	int32 m_jointCount;
 
+	// The serial of the last fixture created.
+	uint32 m_fixtureSerial;
+
 	b2Vec2 m_gravity;
 	bool m_allowSleep;
 
@@ -252,9 +418,15 @@ private:
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	bool m_simdSolver;
+	bool m_simdSolverReference;
+	bool m_speculativeContacts;
 
 	bool m_stepComplete;
 
+	int32 m_maxTOIEvents;
+	b2TOIQueue m_toiQueue;
+
 	b2Profile m_profile;
 };
 
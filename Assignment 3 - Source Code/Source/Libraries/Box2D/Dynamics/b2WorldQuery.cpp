@@ -0,0 +1,176 @@
+//
+//  b2WorldQuery.cpp
+//  GameDevFramework
+//
+//  b2World::RayCastBatch and b2World::QueryAABBBatch.
+//
+
+#include "b2World.h"
+#include "b2Fixture.h"
+#include "b2BroadPhase.h"
+#include "b2ThreadPool.h"
+#include "b2Profiler.h"
+
+// Batches smaller than this are not worth waking the pool for.
+static const int32 b2_queryBatchGrain = 64;
+
+// Keeps the closest hit of one ray. The broad-phase calls this directly, so
+// there is no virtual call per proxy the ray reaches.
+struct b2ClosestRayCast
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if (fixture->IsSensor() || (fixture->GetFilterData().categoryBits & maskBits) == 0)
+		{
+			return input.maxFraction;
+		}
+
+		b2RayCastOutput output;
+		if (fixture->RayCast(&output, input, proxy->childIndex) == false)
+		{
+			return input.maxFraction;
+		}
+
+		hit->fixture = fixture;
+		hit->point = (1.0f - output.fraction) * input.p1 + output.fraction * input.p2;
+		hit->normal = output.normal;
+		hit->fraction = output.fraction;
+
+		// Clip the ray so only closer proxies are visited.
+		return output.fraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RayCastHit* hit;
+	uint16 maskBits;
+};
+
+static void b2RayCastRange(const b2BroadPhase* broadPhase, const b2RayCastInput* inputs, b2RayCastHit* hits,
+						   int32 begin, int32 end, uint16 maskBits)
+{
+	b2ClosestRayCast rayCast;
+	rayCast.broadPhase = broadPhase;
+	rayCast.maskBits = maskBits;
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2RayCastHit* hit = hits + i;
+		hit->fixture = NULL;
+		hit->point = inputs[i].p2;
+		hit->normal.SetZero();
+		hit->fraction = inputs[i].maxFraction;
+
+		rayCast.hit = hit;
+		broadPhase->RayCast(&rayCast, inputs[i]);
+	}
+}
+
+class b2RayCastBatchTask : public b2ThreadTask
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		b2RayCastRange(broadPhase, inputs, hits, begin, end, maskBits);
+	}
+
+	const b2BroadPhase* broadPhase;
+	const b2RayCastInput* inputs;
+	b2RayCastHit* hits;
+	uint16 maskBits;
+};
+
+void b2World::RayCastBatch(const b2RayCastInput* inputs, b2RayCastHit* hits, int32 count, uint16 maskBits) const
+{
+	B2_PROFILE_ZONE("b2World::RayCastBatch");
+	const b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+
+	// The pool is busy with the step while the world is locked.
+	if (m_threadPool && IsLocked() == false && count > b2_queryBatchGrain)
+	{
+		b2RayCastBatchTask task;
+		task.broadPhase = broadPhase;
+		task.inputs = inputs;
+		task.hits = hits;
+		task.maskBits = maskBits;
+		m_threadPool->Run(&task, count, b2_queryBatchGrain);
+	}
+	else
+	{
+		b2RayCastRange(broadPhase, inputs, hits, 0, count, maskBits);
+	}
+}
+
+// Writes the fixtures of each query into its own slice of the output.
+struct b2FlatQuery
+{
+	void QueryCallback(int32 queryIndex, int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		int32 n = fixtureCounts[queryIndex]++;
+		if (n < maxFixtures)
+		{
+			fixtures[queryIndex * maxFixtures + n] = proxy->fixture;
+		}
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2Fixture** fixtures;
+	int32 maxFixtures;
+	int32* fixtureCounts;
+};
+
+static void b2QueryAABBRange(const b2BroadPhase* broadPhase, const b2AABB* aabbs, b2Fixture** fixtures,
+							 int32 maxFixtures, int32* fixtureCounts, int32 begin, int32 end)
+{
+	for (int32 i = begin; i < end; ++i)
+	{
+		fixtureCounts[i] = 0;
+	}
+
+	// Offset the outputs so the query indices of the range start at zero.
+	b2FlatQuery query;
+	query.broadPhase = broadPhase;
+	query.fixtures = fixtures + begin * maxFixtures;
+	query.maxFixtures = maxFixtures;
+	query.fixtureCounts = fixtureCounts + begin;
+	broadPhase->QueryBatch(&query, aabbs + begin, end - begin);
+}
+
+class b2QueryAABBBatchTask : public b2ThreadTask
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		b2QueryAABBRange(broadPhase, aabbs, fixtures, maxFixtures, fixtureCounts, begin, end);
+	}
+
+	const b2BroadPhase* broadPhase;
+	const b2AABB* aabbs;
+	b2Fixture** fixtures;
+	int32 maxFixtures;
+	int32* fixtureCounts;
+};
+
+void b2World::QueryAABBBatch(const b2AABB* aabbs, int32 count, b2Fixture** fixtures, int32 maxFixtures, int32* fixtureCounts) const
+{
+	B2_PROFILE_ZONE("b2World::QueryAABBBatch");
+	const b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+
+	if (m_threadPool && IsLocked() == false && count > b2_queryBatchGrain)
+	{
+		b2QueryAABBBatchTask task;
+		task.broadPhase = broadPhase;
+		task.aabbs = aabbs;
+		task.fixtures = fixtures;
+		task.maxFixtures = maxFixtures;
+		task.fixtureCounts = fixtureCounts;
+		m_threadPool->Run(&task, count, b2_queryBatchGrain);
+	}
+	else
+	{
+		b2QueryAABBRange(broadPhase, aabbs, fixtures, maxFixtures, fixtureCounts, 0, count);
+	}
+}
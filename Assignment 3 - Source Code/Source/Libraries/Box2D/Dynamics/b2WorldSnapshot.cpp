@@ -0,0 +1,1107 @@
+//
+//  b2WorldSnapshot.cpp
+//  GameDevFramework
+//
+//  b2World::SaveState and b2World::RestoreState.
+//
+
+#include "b2World.h"
+#include "b2Body.h"
+#include "b2Fixture.h"
+#include "b2Contact.h"
+#include "b2CircleShape.h"
+#include "b2EdgeShape.h"
+#include "b2ChainShape.h"
+#include "b2PolygonShape.h"
+#include "b2DistanceJoint.h"
+#include "b2FrictionJoint.h"
+#include "b2MouseJoint.h"
+#include "b2PrismaticJoint.h"
+#include "b2PulleyJoint.h"
+#include "b2RevoluteJoint.h"
+#include "b2RopeJoint.h"
+#include "b2WeldJoint.h"
+#include "b2WheelJoint.h"
+#include "b2Snapshot.h"
+#include "b2Profiler.h"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <functional>
+
+static const uint32 b2_snapshotMagic = 0x53573262;	// "b2WS"
+static const int32 b2_snapshotVersion = 6;
+
+static int32 b2GetChainCount(const b2Shape* shape)
+{
+	return shape->m_type == b2Shape::e_chain ? ((const b2ChainShape*)shape)->m_count : 0;
+}
+
+static void b2SaveShape(b2Snapshot* snapshot, const b2Shape* shape)
+{
+	snapshot->Write(shape->m_radius);
+
+	switch (shape->m_type)
+	{
+	case b2Shape::e_circle:
+		{
+			const b2CircleShape* circle = (const b2CircleShape*)shape;
+			snapshot->Write(circle->m_p);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			const b2EdgeShape* edge = (const b2EdgeShape*)shape;
+			snapshot->Write(edge->m_vertex0);
+			snapshot->Write(edge->m_vertex1);
+			snapshot->Write(edge->m_vertex2);
+			snapshot->Write(edge->m_vertex3);
+			snapshot->Write(edge->m_hasVertex0);
+			snapshot->Write(edge->m_hasVertex3);
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			const b2PolygonShape* polygon = (const b2PolygonShape*)shape;
+			snapshot->Write(polygon->m_centroid);
+			snapshot->Write(polygon->m_count);
+			snapshot->Write(polygon->m_vertices, polygon->m_count * sizeof(b2Vec2));
+			snapshot->Write(polygon->m_normals, polygon->m_count * sizeof(b2Vec2));
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			// The vertex count is part of the layout.
+			const b2ChainShape* chain = (const b2ChainShape*)shape;
+			snapshot->Write(chain->m_vertices, chain->m_count * sizeof(b2Vec2));
+			snapshot->Write(chain->m_prevVertex);
+			snapshot->Write(chain->m_nextVertex);
+			snapshot->Write(chain->m_hasPrevVertex);
+			snapshot->Write(chain->m_hasNextVertex);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+}
+
+static void b2RestoreShape(b2SnapshotReader* reader, b2Shape* shape)
+{
+	shape->m_radius = reader->Read<float32>();
+
+	switch (shape->m_type)
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* circle = (b2CircleShape*)shape;
+			circle->m_p = reader->Read<b2Vec2>();
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* edge = (b2EdgeShape*)shape;
+			edge->m_vertex0 = reader->Read<b2Vec2>();
+			edge->m_vertex1 = reader->Read<b2Vec2>();
+			edge->m_vertex2 = reader->Read<b2Vec2>();
+			edge->m_vertex3 = reader->Read<b2Vec2>();
+			edge->m_hasVertex0 = reader->Read<bool>();
+			edge->m_hasVertex3 = reader->Read<bool>();
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* polygon = (b2PolygonShape*)shape;
+			polygon->m_centroid = reader->Read<b2Vec2>();
+			int32 count = reader->Read<int32>();
+			if (count < 0 || count > b2_maxPolygonVertices)
+			{
+				reader->Fail();
+				count = 0;
+			}
+			polygon->m_count = count;
+			reader->Read(polygon->m_vertices, count * sizeof(b2Vec2));
+			reader->Read(polygon->m_normals, count * sizeof(b2Vec2));
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* chain = (b2ChainShape*)shape;
+			reader->Read(chain->m_vertices, chain->m_count * sizeof(b2Vec2));
+			chain->m_prevVertex = reader->Read<b2Vec2>();
+			chain->m_nextVertex = reader->Read<b2Vec2>();
+			chain->m_hasPrevVertex = reader->Read<bool>();
+			chain->m_hasNextVertex = reader->Read<bool>();
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+}
+
+template <typename T>
+static b2Joint* b2CreateDefaultJoint(b2World* world, b2Body* bodyA, b2Body* bodyB)
+{
+	T def;
+	def.bodyA = bodyA;
+	def.bodyB = bodyB;
+	return world->CreateJoint(&def);
+}
+
+// Lists are built by prepending, so objects created in saved order come out
+// backwards. Swapping the links of every edge turns a list around.
+template <typename T>
+static T* b2ReverseEdges(T* edge)
+{
+	T* head = NULL;
+	while (edge)
+	{
+		T* next = edge->next;
+		edge->next = edge->prev;
+		edge->prev = next;
+		head = edge;
+		edge = next;
+	}
+	return head;
+}
+
+// Whether a fixture with this address is in the sorted live fixtures.
+static bool b2HasFixture(const b2Fixture** fixtures, int32 count, const b2Fixture* fixture)
+{
+	const b2Fixture** f = std::lower_bound(fixtures, fixtures + count, fixture, std::less<const b2Fixture*>());
+	return f != fixtures + count && *f == fixture;
+}
+
+int32 b2World::GetSnapshotIndex(const b2Fixture* fixture, const int32* firstFixtures) const
+{
+	const b2Body* b = fixture->m_body;
+	int32 index = firstFixtures[b->m_islandIndex];
+	for (const b2Fixture* f = b->m_fixtureList; f != fixture; f = f->m_next)
+	{
+		++index;
+	}
+	return index;
+}
+
+void b2World::SaveState(b2Snapshot* snapshot)
+{
+	b2Assert(IsLocked() == false);
+	B2_PROFILE_ZONE("b2World::SaveState");
+
+	// Bodies are numbered through m_islandIndex like b2World::Dump does, so
+	// looking up the fixtures of a contact costs no more than a list walk.
+	int32* firstFixtures = (int32*)m_stackAllocator.Allocate(m_bodyCount * sizeof(int32));
+	int32 fixtureCount = 0;
+	int32 bodyIndex = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_islandIndex = bodyIndex;
+		firstFixtures[bodyIndex++] = fixtureCount;
+		fixtureCount += b->m_fixtureCount;
+	}
+
+	snapshot->Write(b2_snapshotMagic);
+	snapshot->Write(b2_snapshotVersion);
+	snapshot->Write((int32)sizeof(void*));
+
+	snapshot->Write(m_gravity);
+	snapshot->Write(m_flags);
+	snapshot->Write(m_allowSleep);
+	snapshot->Write(m_warmStarting);
+	snapshot->Write(m_continuousPhysics);
+	snapshot->Write(m_subStepping);
+	snapshot->Write(m_simdSolver);
+	snapshot->Write(m_speculativeContacts);
+	snapshot->Write(m_stepComplete);
+	snapshot->Write(m_maxTOIEvents);
+	snapshot->Write(m_inv_dt0);
+	snapshot->Write(m_contactManager.m_warmStartCacheEnabled);
+	snapshot->Write(m_contactManager.m_broadPhase.GetSortFreePairs());
+
+	// Layout, compared against the world on restore.
+	snapshot->Write(m_contactManager.m_broadPhase.GetType());
+	snapshot->Write(m_bodyCount);
+	snapshot->Write(fixtureCount);
+	snapshot->Write(m_jointCount);
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		snapshot->Write(b->m_fixtureCount);
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			snapshot->Write((int32)f->m_shape->m_type);
+			snapshot->Write(b2GetChainCount(f->m_shape));
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		snapshot->Write(j->m_type);
+		snapshot->Write(j->m_bodyA->m_islandIndex);
+		snapshot->Write(j->m_bodyB->m_islandIndex);
+	}
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		snapshot->Write(b->m_type);
+		snapshot->Write(b->m_flags);
+		snapshot->Write(b->m_xf);
+		snapshot->Write(b->m_xf0);
+		snapshot->Write(b->m_sweep);
+		snapshot->Write(b->m_linearVelocity);
+		snapshot->Write(b->m_angularVelocity);
+		snapshot->Write(b->m_force);
+		snapshot->Write(b->m_torque);
+		snapshot->Write(b->m_mass);
+		snapshot->Write(b->m_invMass);
+		snapshot->Write(b->m_I);
+		snapshot->Write(b->m_invI);
+		snapshot->Write(b->m_linearDamping);
+		snapshot->Write(b->m_angularDamping);
+		snapshot->Write(b->m_gravityScale);
+		snapshot->Write(b->m_sleepTime);
+		snapshot->Write(b->m_userData);
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			snapshot->Write(f->m_density);
+			snapshot->Write(f->m_friction);
+			snapshot->Write(f->m_restitution);
+			snapshot->Write(f->m_filter);
+			snapshot->Write(f->m_isSensor);
+			snapshot->Write(f->m_userData);
+			b2SaveShape(snapshot, f->m_shape);
+
+			snapshot->Write(f->m_proxyCount);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				snapshot->Write(f->m_proxies[i].aabb);
+				snapshot->Write(f->m_proxies[i].proxyId);
+			}
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		snapshot->Write(j->m_collideConnected);
+		snapshot->Write(j->m_userData);
+
+		// The size of what the joint writes, so a restore can check the rest
+		// of the snapshot without knowing every joint type.
+		int32 sizePosition = snapshot->GetSize();
+		snapshot->Write((int32)0);
+		j->SaveState(snapshot);
+		snapshot->WriteAt(sizePosition, snapshot->GetSize() - sizePosition - (int32)sizeof(int32));
+	}
+
+	snapshot->Write(m_contactManager.m_contactCount);
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		snapshot->Write(GetSnapshotIndex(c->m_fixtureA, firstFixtures));
+		snapshot->Write(c->m_indexA);
+		snapshot->Write(GetSnapshotIndex(c->m_fixtureB, firstFixtures));
+		snapshot->Write(c->m_indexB);
+		snapshot->Write(c->m_flags);
+		snapshot->Write(c->m_manifold);
+		snapshot->Write(c->m_toiCount);
+		snapshot->Write(c->m_toi);
+		snapshot->Write(c->m_friction);
+		snapshot->Write(c->m_restitution);
+		snapshot->Write(c->m_tangentSpeed);
+	}
+
+	m_contactManager.m_broadPhase.SaveState(snapshot);
+
+	// An entry can name a destroyed fixture until it expires. Its address is only
+	// followed if a live fixture has it, and then the serial tells if it is the
+	// same fixture.
+	const b2Fixture** liveFixtures = (const b2Fixture**)m_stackAllocator.Allocate(b2Max(fixtureCount, 1) * sizeof(b2Fixture*));
+	int32 liveFixtureCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			liveFixtures[liveFixtureCount++] = f;
+		}
+	}
+	std::sort(liveFixtures, liveFixtures + liveFixtureCount, std::less<const b2Fixture*>());
+
+	const b2WarmStartCache& cache = m_contactManager.m_warmStartCache;
+	int32* entries = (int32*)m_stackAllocator.Allocate(b2Max(cache.m_count, 1) * sizeof(int32));
+	int32 entryCount = 0;
+	for (int32 i = 0; i < cache.m_capacity; ++i)
+	{
+		const b2WarmStartCache::b2WarmStartKey& key = cache.m_entries[i].key;
+		if (key.fixtureA && b2HasFixture(liveFixtures, liveFixtureCount, key.fixtureA) && key.fixtureA->m_serial == key.serialA &&
+			b2HasFixture(liveFixtures, liveFixtureCount, key.fixtureB) && key.fixtureB->m_serial == key.serialB)
+		{
+			entries[entryCount++] = i;
+		}
+	}
+
+	snapshot->Write(cache.m_stamp);
+	snapshot->Write(cache.m_hitCount);
+	snapshot->Write(entryCount);
+	for (int32 i = 0; i < entryCount; ++i)
+	{
+		const b2WarmStartCache::b2WarmStartEntry* e = cache.m_entries + entries[i];
+		snapshot->Write(GetSnapshotIndex(e->key.fixtureA, firstFixtures));
+		snapshot->Write(e->key.childA);
+		snapshot->Write(GetSnapshotIndex(e->key.fixtureB, firstFixtures));
+		snapshot->Write(e->key.childB);
+		snapshot->Write(e->stamp);
+		snapshot->Write(e->pointCount);
+		snapshot->Write(e->points, e->pointCount * sizeof(b2ManifoldPoint));
+	}
+
+	m_stackAllocator.Free(entries);
+	m_stackAllocator.Free(liveFixtures);
+	m_stackAllocator.Free(firstFixtures);
+}
+
+bool b2World::MatchLayout(b2SnapshotReader* reader, b2Body** bodies, b2Fixture** fixtures, b2Joint** joints, bool* canBuild)
+{
+	b2BroadPhaseType broadPhaseType = reader->Read<b2BroadPhaseType>();
+	int32 bodyCount = reader->Read<int32>();
+	int32 fixtureCount = reader->Read<int32>();
+	int32 jointCount = reader->Read<int32>();
+
+	bool match = broadPhaseType == m_contactManager.m_broadPhase.GetType();
+	match = match && bodyCount == m_bodyCount && jointCount == m_jointCount;
+
+	// Keep reading on a mismatch, BuildLayout needs to know about the chains and gear joints.
+	b2Body* b = m_bodyList;
+	int32 fixtureIndex = 0;
+	for (int32 i = 0; i < bodyCount && reader->HasFailed() == false; ++i)
+	{
+		int32 count = reader->Read<int32>();
+		match = match && b && b->m_fixtureCount == count;
+		if (match)
+		{
+			bodies[i] = b;
+		}
+
+		b2Fixture* f = match ? b->m_fixtureList : NULL;
+		for (int32 j = 0; j < count && reader->HasFailed() == false; ++j)
+		{
+			int32 type = reader->Read<int32>();
+			int32 chainCount = reader->Read<int32>();
+			if (type < 0 || type >= b2Shape::e_typeCount || fixtureIndex == fixtureCount ||
+				chainCount < 0 || chainCount > INT_MAX / (int32)sizeof(b2Vec2) - 2)
+			{
+				reader->Fail();
+				break;
+			}
+
+			*canBuild = *canBuild && (type != b2Shape::e_chain || chainCount >= 2);
+			match = match && f && f->m_shape->m_type == type && b2GetChainCount(f->m_shape) == chainCount;
+			if (match)
+			{
+				fixtures[fixtureIndex] = f;
+				f = f->m_next;
+			}
+			++fixtureIndex;
+		}
+
+		b = b ? b->m_next : NULL;
+	}
+	if (fixtureIndex != fixtureCount)
+	{
+		reader->Fail();
+	}
+
+	b2Joint* joint = m_jointList;
+	for (int32 i = 0; i < jointCount && reader->HasFailed() == false; ++i)
+	{
+		b2JointType type = reader->Read<b2JointType>();
+		int32 indexA = reader->Read<int32>();
+		int32 indexB = reader->Read<int32>();
+		if (type <= e_unknownJoint || type > e_ropeJoint || indexA < 0 || indexA >= bodyCount || indexB < 0 || indexB >= bodyCount)
+		{
+			reader->Fail();
+			break;
+		}
+
+		// A gear joint is created from two other joints, it can't be created again on its own.
+		*canBuild = *canBuild && type != e_gearJoint;
+		match = match && joint && joint->m_type == type && joint->m_bodyA == bodies[indexA] && joint->m_bodyB == bodies[indexB];
+		if (match)
+		{
+			joints[i] = joint;
+			joint = joint->m_next;
+		}
+	}
+
+	return match && reader->HasFailed() == false;
+}
+
+void b2World::CheckState(b2SnapshotReader* reader, int32 layoutStart)
+{
+	// MatchLayout has checked the layout, the shape types and child counts
+	// are read from it again.
+	b2SnapshotReader layout = *reader;
+	layout.SetPosition(layoutStart);
+	layout.Read<b2BroadPhaseType>();
+	int32 bodyCount = layout.Read<int32>();
+	int32 fixtureCount = layout.Read<int32>();
+	int32 jointCount = layout.Read<int32>();
+
+	int32* types = (int32*)m_stackAllocator.Allocate(fixtureCount * sizeof(int32));
+	int32* childCounts = (int32*)m_stackAllocator.Allocate(fixtureCount * sizeof(int32));
+	int32 maxProxyId = b2BroadPhase::e_nullProxy;
+	int32 fixtureIndex = 0;
+	for (int32 i = 0; i < bodyCount && reader->HasFailed() == false; ++i)
+	{
+		b2BodyType bodyType = reader->Read<b2BodyType>();
+		if (bodyType < b2_staticBody || bodyType > b2_dynamicBody)
+		{
+			reader->Fail();
+		}
+
+		// The flags up to the user data.
+		reader->Skip((int32)(sizeof(uint16) + 2 * sizeof(b2Transform) + sizeof(b2Sweep) + 2 * sizeof(b2Vec2) + 10 * sizeof(float32) + sizeof(void*)));
+
+		int32 count = layout.Read<int32>();
+		for (int32 j = 0; j < count && reader->HasFailed() == false; ++j)
+		{
+			int32 type = layout.Read<int32>();
+			int32 chainCount = layout.Read<int32>();
+			int32 childCount = type == b2Shape::e_chain ? chainCount - 1 : 1;
+			types[fixtureIndex] = type;
+			childCounts[fixtureIndex] = childCount;
+			++fixtureIndex;
+
+			// The density up to the shape radius.
+			reader->Skip((int32)(3 * sizeof(float32) + sizeof(b2Filter) + sizeof(bool) + sizeof(void*) + sizeof(float32)));
+			switch (type)
+			{
+			case b2Shape::e_circle:
+				reader->Skip((int32)sizeof(b2Vec2));
+				break;
+
+			case b2Shape::e_edge:
+				reader->Skip((int32)(4 * sizeof(b2Vec2) + 2 * sizeof(bool)));
+				break;
+
+			case b2Shape::e_polygon:
+				{
+					reader->Skip((int32)sizeof(b2Vec2));
+					int32 vertexCount = reader->Read<int32>();
+					if (vertexCount < 0 || vertexCount > b2_maxPolygonVertices)
+					{
+						reader->Fail();
+						break;
+					}
+					reader->Skip(2 * vertexCount * (int32)sizeof(b2Vec2));
+				}
+				break;
+
+			case b2Shape::e_chain:
+				reader->Skip((chainCount + 2) * (int32)sizeof(b2Vec2) + 2 * (int32)sizeof(bool));
+				break;
+			}
+
+			int32 proxyCount = reader->Read<int32>();
+			if (proxyCount != 0 && proxyCount != childCount)
+			{
+				reader->Fail();
+			}
+			for (int32 k = 0; k < proxyCount && reader->HasFailed() == false; ++k)
+			{
+				reader->Skip((int32)sizeof(b2AABB));
+				int32 proxyId = reader->Read<int32>();
+				if (proxyId < 0)
+				{
+					reader->Fail();
+				}
+				maxProxyId = b2Max(maxProxyId, proxyId);
+			}
+		}
+	}
+
+	for (int32 i = 0; i < jointCount && reader->HasFailed() == false; ++i)
+	{
+		reader->Skip((int32)(sizeof(bool) + sizeof(void*)));
+		reader->Skip(reader->Read<int32>());
+	}
+
+	bool isPrimary[b2Shape::e_typeCount][b2Shape::e_typeCount];
+	for (int32 i = 0; i < b2Shape::e_typeCount; ++i)
+	{
+		for (int32 j = 0; j < b2Shape::e_typeCount; ++j)
+		{
+			isPrimary[i][j] = b2Contact::IsPrimary((b2Shape::Type)i, (b2Shape::Type)j);
+		}
+	}
+
+	int32 contactCount = reader->Read<int32>();
+	if (contactCount < 0)
+	{
+		reader->Fail();
+	}
+	for (int32 i = 0; i < contactCount && reader->HasFailed() == false; ++i)
+	{
+		int32 indexA = reader->Read<int32>();
+		int32 childA = reader->Read<int32>();
+		int32 indexB = reader->Read<int32>();
+		int32 childB = reader->Read<int32>();
+		if (indexA < 0 || indexA >= fixtureCount || indexB < 0 || indexB >= fixtureCount)
+		{
+			reader->Fail();
+			break;
+		}
+
+		// RestoreState creates the contact with its fixtures in saved order.
+		if (childA < 0 || childA >= childCounts[indexA] || childB < 0 || childB >= childCounts[indexB] ||
+			isPrimary[types[indexA]][types[indexB]] == false)
+		{
+			reader->Fail();
+		}
+
+		reader->Read<uint32>();
+		int32 manifoldStart = reader->GetPosition();
+		reader->Skip((int32)offsetof(b2Manifold, pointCount));
+		int32 pointCount = reader->Read<int32>();
+		if (pointCount < 0 || pointCount > b2_maxManifoldPoints)
+		{
+			reader->Fail();
+		}
+		reader->Skip(manifoldStart + (int32)sizeof(b2Manifold) - reader->GetPosition());
+
+		// The TOI count up to the tangent speed.
+		reader->Skip((int32)(sizeof(int32) + 4 * sizeof(float32)));
+	}
+
+	if (reader->HasFailed() == false && maxProxyId >= b2BroadPhase::CheckState(reader))
+	{
+		reader->Fail();
+	}
+
+	int32 stamp = reader->Read<int32>();
+	reader->Read<int32>();
+	int32 entryCount = reader->Read<int32>();
+	if (stamp < 0 || entryCount < 0)
+	{
+		reader->Fail();
+	}
+	for (int32 i = 0; i < entryCount && reader->HasFailed() == false; ++i)
+	{
+		int32 indexA = reader->Read<int32>();
+		reader->Read<int32>();
+		int32 indexB = reader->Read<int32>();
+		reader->Read<int32>();
+		int32 entryStamp = reader->Read<int32>();
+		int32 pointCount = reader->Read<int32>();
+		if (indexA < 0 || indexA >= fixtureCount || indexB < 0 || indexB >= fixtureCount ||
+			entryStamp < 0 || stamp - entryStamp > b2_warmStartCacheSteps || entryStamp > stamp ||
+			pointCount < 0 || pointCount > b2_maxManifoldPoints)
+		{
+			reader->Fail();
+			break;
+		}
+		reader->Skip(pointCount * (int32)sizeof(b2ManifoldPoint));
+	}
+
+	m_stackAllocator.Free(childCounts);
+	m_stackAllocator.Free(types);
+}
+
+void b2World::BuildLayout(b2SnapshotReader* reader, b2Body** bodies, b2Fixture** fixtures, b2Joint** joints)
+{
+	DestroyAllBodies();
+
+	b2BroadPhaseType broadPhaseType = reader->Read<b2BroadPhaseType>();
+	int32 bodyCount = reader->Read<int32>();
+	reader->Read<int32>();
+	int32 jointCount = reader->Read<int32>();
+	m_contactManager.m_broadPhase.SetType(broadPhaseType);
+
+	// Placeholders of the right shape types and sizes, inactive so they get
+	// no proxies. The saved state overwrites all of them.
+	b2Vec2 chainVertices[b2_maxPolygonVertices];
+	int32 fixtureIndex = 0;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2BodyDef bodyDef;
+		bodyDef.active = false;
+		b2Body* b = CreateBody(&bodyDef);
+		bodies[i] = b;
+
+		int32 count = reader->Read<int32>();
+		for (int32 j = 0; j < count; ++j)
+		{
+			int32 type = reader->Read<int32>();
+			int32 chainCount = reader->Read<int32>();
+
+			b2CircleShape circle;
+			b2EdgeShape edge;
+			b2PolygonShape polygon;
+			b2ChainShape chain;
+			b2FixtureDef fixtureDef;
+			switch (type)
+			{
+			case b2Shape::e_circle:
+				fixtureDef.shape = &circle;
+				break;
+
+			case b2Shape::e_edge:
+				fixtureDef.shape = &edge;
+				break;
+
+			case b2Shape::e_polygon:
+				fixtureDef.shape = &polygon;
+				break;
+
+			case b2Shape::e_chain:
+				{
+					b2Vec2* vertices = chainCount <= b2_maxPolygonVertices ? chainVertices : (b2Vec2*)b2Alloc(chainCount * sizeof(b2Vec2));
+					for (int32 k = 0; k < chainCount; ++k)
+					{
+						vertices[k].SetZero();
+					}
+					chain.CreateChain(vertices, chainCount);
+					if (vertices != chainVertices)
+					{
+						b2Free(vertices);
+					}
+					fixtureDef.shape = &chain;
+				}
+				break;
+			}
+
+			fixtures[fixtureIndex++] = b->CreateFixture(&fixtureDef);
+		}
+
+		// Fixtures were prepended, put them back in saved order.
+		b2Fixture* list = NULL;
+		for (b2Fixture* f = b->m_fixtureList; f;)
+		{
+			b2Fixture* next = f->m_next;
+			f->m_next = list;
+			list = f;
+			f = next;
+		}
+		b->m_fixtureList = list;
+	}
+
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2JointType type = reader->Read<b2JointType>();
+		b2Body* bodyA = bodies[reader->Read<int32>()];
+		b2Body* bodyB = bodies[reader->Read<int32>()];
+
+		b2Joint* joint = NULL;
+		switch (type)
+		{
+		case e_distanceJoint:
+			joint = b2CreateDefaultJoint<b2DistanceJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_frictionJoint:
+			joint = b2CreateDefaultJoint<b2FrictionJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_mouseJoint:
+			joint = b2CreateDefaultJoint<b2MouseJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_prismaticJoint:
+			joint = b2CreateDefaultJoint<b2PrismaticJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_pulleyJoint:
+			joint = b2CreateDefaultJoint<b2PulleyJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_revoluteJoint:
+			joint = b2CreateDefaultJoint<b2RevoluteJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_ropeJoint:
+			joint = b2CreateDefaultJoint<b2RopeJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_weldJoint:
+			joint = b2CreateDefaultJoint<b2WeldJointDef>(this, bodyA, bodyB);
+			break;
+
+		case e_wheelJoint:
+			joint = b2CreateDefaultJoint<b2WheelJointDef>(this, bodyA, bodyB);
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+		joints[i] = joint;
+	}
+
+	// Bodies and joints were prepended too. A body's joint edges follow the
+	// order of the world joint list, so they are turned around as well.
+	b2Body* bodyList = NULL;
+	for (b2Body* b = m_bodyList; b;)
+	{
+		b2Body* next = b->m_next;
+		b->m_next = b->m_prev;
+		b->m_prev = next;
+		bodyList = b;
+		b = next;
+	}
+	m_bodyList = bodyList;
+
+	b2Joint* jointList = NULL;
+	for (b2Joint* j = m_jointList; j;)
+	{
+		b2Joint* next = j->m_next;
+		j->m_next = j->m_prev;
+		j->m_prev = next;
+		jointList = j;
+		j = next;
+	}
+	m_jointList = jointList;
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_jointList = b2ReverseEdges(b->m_jointList);
+	}
+}
+
+bool b2World::RestoreState(b2SnapshotReader* reader)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return false;
+	}
+
+	B2_PROFILE_ZONE("b2World::RestoreState");
+
+	uint32 magic = reader->Read<uint32>();
+	int32 version = reader->Read<int32>();
+	int32 pointerSize = reader->Read<int32>();
+	if (magic != b2_snapshotMagic || version != b2_snapshotVersion || pointerSize != (int32)sizeof(void*))
+	{
+		return false;
+	}
+
+	b2Vec2 gravity = reader->Read<b2Vec2>();
+	int32 flags = reader->Read<int32>();
+	bool allowSleep = reader->Read<bool>();
+	bool warmStarting = reader->Read<bool>();
+	bool continuousPhysics = reader->Read<bool>();
+	bool subStepping = reader->Read<bool>();
+	bool simdSolver = reader->Read<bool>();
+	bool speculativeContacts = reader->Read<bool>();
+	bool stepComplete = reader->Read<bool>();
+	int32 maxTOIEvents = reader->Read<int32>();
+	float32 inv_dt0 = reader->Read<float32>();
+	bool warmStartCache = reader->Read<bool>();
+	bool sortFreePairs = reader->Read<bool>();
+
+	int32 layoutStart = reader->GetPosition();
+	reader->Read<b2BroadPhaseType>();
+	int32 bodyCount = reader->Read<int32>();
+	int32 fixtureCount = reader->Read<int32>();
+	int32 jointCount = reader->Read<int32>();
+	if (reader->HasFailed() || bodyCount < 0 || fixtureCount < 0 || jointCount < 0)
+	{
+		return false;
+	}
+	reader->SetPosition(layoutStart);
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+	b2Fixture** fixtures = (b2Fixture**)m_stackAllocator.Allocate(fixtureCount * sizeof(b2Fixture*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(jointCount * sizeof(b2Joint*));
+
+	// Nothing is changed before the whole snapshot has been read once, so one
+	// that doesn't hold up leaves the world as it was.
+	bool canBuild = true;
+	bool match = MatchLayout(reader, bodies, fixtures, joints, &canBuild);
+	b2SnapshotReader state = *reader;
+	if (state.HasFailed() == false && (match || canBuild))
+	{
+		CheckState(&state, layoutStart);
+	}
+
+	if (state.HasFailed() || (match == false && canBuild == false))
+	{
+		m_stackAllocator.Free(joints);
+		m_stackAllocator.Free(fixtures);
+		m_stackAllocator.Free(bodies);
+		return false;
+	}
+
+	if (match == false)
+	{
+		reader->SetPosition(layoutStart);
+		BuildLayout(reader, bodies, fixtures, joints);
+	}
+
+	// The world's contacts are replaced by the saved ones. A contact only
+	// depends on the shape types of its fixtures, so the old ones are kept
+	// aside by type and reused instead of going back to the allocator.
+	b2Contact* unused[b2Shape::e_typeCount][b2Shape::e_typeCount];
+	memset(unused, 0, sizeof(unused));
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
+	{
+		b2Contact* next = c->m_next;
+		b2Contact** pool = &unused[c->m_fixtureA->GetType()][c->m_fixtureB->GetType()];
+		c->m_next = *pool;
+		*pool = c;
+		c = next;
+	}
+	m_contactManager.m_contactList = NULL;
+	m_contactManager.m_contactCount = 0;
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* b = bodies[i];
+		b->m_type = reader->Read<b2BodyType>();
+		b->m_flags = reader->Read<uint16>();
+		b->m_xf = reader->Read<b2Transform>();
+		b->m_xf0 = reader->Read<b2Transform>();
+		b->m_sweep = reader->Read<b2Sweep>();
+		b->m_linearVelocity = reader->Read<b2Vec2>();
+		b->m_angularVelocity = reader->Read<float32>();
+		b->m_force = reader->Read<b2Vec2>();
+		b->m_torque = reader->Read<float32>();
+		b->m_mass = reader->Read<float32>();
+		b->m_invMass = reader->Read<float32>();
+		b->m_I = reader->Read<float32>();
+		b->m_invI = reader->Read<float32>();
+		b->m_linearDamping = reader->Read<float32>();
+		b->m_angularDamping = reader->Read<float32>();
+		b->m_gravityScale = reader->Read<float32>();
+		b->m_sleepTime = reader->Read<float32>();
+		b->m_userData = reader->Read<void*>();
+		b->m_contactList = NULL;
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->m_density = reader->Read<float32>();
+			f->m_friction = reader->Read<float32>();
+			f->m_restitution = reader->Read<float32>();
+			f->m_filter = reader->Read<b2Filter>();
+			f->m_isSensor = reader->Read<bool>();
+			f->m_userData = reader->Read<void*>();
+			b2RestoreShape(reader, f->m_shape);
+
+			int32 proxyCount = reader->Read<int32>();
+			if (proxyCount != 0 && proxyCount != f->m_shape->GetChildCount())
+			{
+				reader->Fail();
+				proxyCount = 0;
+			}
+
+			f->m_proxyCount = proxyCount;
+			for (int32 k = 0; k < proxyCount; ++k)
+			{
+				b2FixtureProxy* proxy = f->m_proxies + k;
+				proxy->aabb = reader->Read<b2AABB>();
+				proxy->proxyId = reader->Read<int32>();
+				proxy->fixture = f;
+				proxy->childIndex = k;
+			}
+		}
+	}
+
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2Joint* j = joints[i];
+		j->m_collideConnected = reader->Read<bool>();
+		j->m_userData = reader->Read<void*>();
+
+		int32 size = reader->Read<int32>();
+		b2SnapshotReader jointReader(*reader, size);
+		j->RestoreState(&jointReader);
+		b2Assert(jointReader.IsAtEnd() && jointReader.HasFailed() == false);
+		reader->Skip(size);
+	}
+
+	// Contacts are prepended like b2ContactManager::AddPair does, which
+	// leaves the world list and every body's edges in reverse saved order.
+	int32 contactCount = reader->Read<int32>();
+	for (int32 i = 0; i < contactCount && reader->HasFailed() == false; ++i)
+	{
+		int32 indexA = reader->Read<int32>();
+		int32 childA = reader->Read<int32>();
+		int32 indexB = reader->Read<int32>();
+		int32 childB = reader->Read<int32>();
+		if (indexA < 0 || indexA >= fixtureCount || indexB < 0 || indexB >= fixtureCount)
+		{
+			reader->Fail();
+			break;
+		}
+
+		b2Fixture* fixtureA = fixtures[indexA];
+		b2Fixture* fixtureB = fixtures[indexB];
+		b2Contact** pool = &unused[fixtureA->GetType()][fixtureB->GetType()];
+		if (*pool)
+		{
+			c = *pool;
+			*pool = c->m_next;
+			c->m_fixtureA = fixtureA;
+			c->m_fixtureB = fixtureB;
+			c->m_indexA = childA;
+			c->m_indexB = childB;
+		}
+		else
+		{
+			c = b2Contact::Create(fixtureA, childA, fixtureB, childB, &m_blockAllocator);
+			if (c == NULL)
+			{
+				reader->Fail();
+				break;
+			}
+		}
+
+		// The speculative manifold is not saved, the next step builds it again.
+		c->m_flags = reader->Read<uint32>() & ~b2Contact::e_speculativeFlag;
+		c->m_manifold = reader->Read<b2Manifold>();
+		c->m_toiCount = reader->Read<int32>();
+		c->m_toi = reader->Read<float32>();
+		c->m_friction = reader->Read<float32>();
+		c->m_restitution = reader->Read<float32>();
+		c->m_tangentSpeed = reader->Read<float32>();
+
+		c->m_prev = NULL;
+		c->m_next = m_contactManager.m_contactList;
+		if (m_contactManager.m_contactList)
+		{
+			m_contactManager.m_contactList->m_prev = c;
+		}
+		m_contactManager.m_contactList = c;
+		++m_contactManager.m_contactCount;
+
+		b2Body* bodyA = c->m_fixtureA->m_body;
+		b2Body* bodyB = c->m_fixtureB->m_body;
+
+		c->m_nodeA.contact = c;
+		c->m_nodeA.other = bodyB;
+		c->m_nodeA.prev = NULL;
+		c->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList)
+		{
+			bodyA->m_contactList->prev = &c->m_nodeA;
+		}
+		bodyA->m_contactList = &c->m_nodeA;
+
+		c->m_nodeB.contact = c;
+		c->m_nodeB.other = bodyA;
+		c->m_nodeB.prev = NULL;
+		c->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList)
+		{
+			bodyB->m_contactList->prev = &c->m_nodeB;
+		}
+		bodyB->m_contactList = &c->m_nodeB;
+	}
+
+	b2Contact* contactList = NULL;
+	for (c = m_contactManager.m_contactList; c;)
+	{
+		b2Contact* next = c->m_next;
+		c->m_next = c->m_prev;
+		c->m_prev = next;
+		contactList = c;
+		c = next;
+	}
+	m_contactManager.m_contactList = contactList;
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_contactList = b2ReverseEdges(bodies[i]->m_contactList);
+	}
+
+	// Destroying a touching contact wakes its bodies, which would undo the
+	// saved sleep state. Their manifolds mean nothing now.
+	for (int32 i = 0; i < b2Shape::e_typeCount; ++i)
+	{
+		for (int32 j = 0; j < b2Shape::e_typeCount; ++j)
+		{
+			c = unused[i][j];
+			while (c)
+			{
+				b2Contact* next = c->m_next;
+				c->m_manifold.pointCount = 0;
+				b2Contact::Destroy(c, &m_blockAllocator);
+				c = next;
+			}
+		}
+	}
+
+	// The proxies keep their ids, their user data is pointed at the fixture
+	// proxies, which may live somewhere else now.
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	broadPhase->RestoreState(reader);
+	for (int32 i = 0; i < fixtureCount && reader->HasFailed() == false; ++i)
+	{
+		b2Fixture* f = fixtures[i];
+		for (int32 k = 0; k < f->m_proxyCount; ++k)
+		{
+			broadPhase->SetUserData(f->m_proxies[k].proxyId, f->m_proxies + k);
+		}
+	}
+
+	b2WarmStartCache* cache = &m_contactManager.m_warmStartCache;
+	cache->Clear();
+	cache->m_stamp = reader->Read<int32>();
+	cache->m_hitCount = reader->Read<int32>();
+	int32 entryCount = reader->Read<int32>();
+	if (cache->m_stamp < 0)
+	{
+		// The stamp picks the expiry bucket.
+		cache->m_stamp = 0;
+		reader->Fail();
+	}
+	for (int32 i = 0; i < entryCount && reader->HasFailed() == false; ++i)
+	{
+		int32 indexA = reader->Read<int32>();
+		int32 childA = reader->Read<int32>();
+		int32 indexB = reader->Read<int32>();
+		int32 childB = reader->Read<int32>();
+		int32 stamp = reader->Read<int32>();
+		int32 pointCount = reader->Read<int32>();
+		if (indexA < 0 || indexA >= fixtureCount || indexB < 0 || indexB >= fixtureCount ||
+			stamp < 0 || cache->m_stamp - stamp > b2_warmStartCacheSteps || stamp > cache->m_stamp ||
+			pointCount < 0 || pointCount > b2_maxManifoldPoints)
+		{
+			reader->Fail();
+			break;
+		}
+
+		b2WarmStartCache::b2WarmStartEntry* e = cache->Insert(b2WarmStartCache::MakeKey(fixtures[indexA], childA, fixtures[indexB], childB), stamp);
+		e->pointCount = pointCount;
+		reader->Read(e->points, pointCount * sizeof(b2ManifoldPoint));
+	}
+
+	m_gravity = gravity;
+	m_flags = flags;
+	m_allowSleep = allowSleep;
+	m_warmStarting = warmStarting;
+	m_continuousPhysics = continuousPhysics;
+	m_subStepping = subStepping;
+	m_simdSolver = simdSolver;
+	m_speculativeContacts = speculativeContacts;
+	m_stepComplete = stepComplete;
+	m_maxTOIEvents = maxTOIEvents;
+	m_inv_dt0 = inv_dt0;
+	m_contactManager.m_warmStartCacheEnabled = warmStartCache;
+	broadPhase->SetSortFreePairs(sortFreePairs);
+
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(fixtures);
+	m_stackAllocator.Free(bodies);
+
+	return reader->HasFailed() == false;
+}
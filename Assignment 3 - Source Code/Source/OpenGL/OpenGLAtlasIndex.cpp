@@ -0,0 +1,260 @@
+//
+//  OpenGLAtlasIndex.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLAtlasIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace
+{
+    const char OPENGL_ATLAS_INDEX_MAGIC[4] = { 'G', 'A', 'T', 'L' };
+    const uint32_t OPENGL_ATLAS_INDEX_VERSION = 1;
+    const uint32_t OPENGL_ATLAS_INDEX_EMPTY_SLOT = 0xffffffffu;
+
+    typedef struct
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t regionCount;
+        uint32_t slotCount;
+        uint32_t namesSize;
+    } OpenGLAtlasIndexHeader;
+}
+
+
+OpenGLAtlasIndex::OpenGLAtlasIndex() :
+    m_Data(NULL),
+    m_Slots(NULL),
+    m_Names(NULL),
+    m_SlotMask(0),
+    m_NamesSize(0),
+    m_Width(0),
+    m_Height(0),
+    m_RegionCount(0)
+{
+
+}
+
+OpenGLAtlasIndex::~OpenGLAtlasIndex()
+{
+    unload();
+}
+
+bool OpenGLAtlasIndex::load(const char* aPath)
+{
+    if(aPath == NULL)
+    {
+        return false;
+    }
+
+    FILE* file = fopen(aPath, "rb");
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    //Read the whole file, the index is used in place
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool isLoaded = false;
+    if(size > 0)
+    {
+        void* data = malloc(size);
+        if(fread(data, 1, size, file) == (size_t)size)
+        {
+            isLoaded = loadFromMemory(data, size);
+        }
+        free(data);
+    }
+    fclose(file);
+    return isLoaded;
+}
+
+bool OpenGLAtlasIndex::loadFromMemory(const void* aData, size_t aSize)
+{
+    unload();
+
+    //Validate the header before trusting any of the sizes in it
+    OpenGLAtlasIndexHeader header;
+    if(aData == NULL || aSize < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, aData, sizeof(header));
+    if(memcmp(header.magic, OPENGL_ATLAS_INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != OPENGL_ATLAS_INDEX_VERSION)
+    {
+        return false;
+    }
+    if(header.slotCount == 0 || (header.slotCount & (header.slotCount - 1)) != 0 || header.regionCount > header.slotCount)
+    {
+        return false;
+    }
+
+    size_t slotsSize = header.slotCount * sizeof(Slot);
+    if(aSize != sizeof(header) + slotsSize + header.namesSize || header.namesSize == 0)
+    {
+        return false;
+    }
+
+    m_Data = (unsigned char*)malloc(aSize);
+    memcpy(m_Data, aData, aSize);
+    m_Slots = (const Slot*)(m_Data + sizeof(header));
+    m_Names = (const char*)(m_Data + sizeof(header) + slotsSize);
+    m_SlotMask = header.slotCount - 1;
+    m_NamesSize = header.namesSize;
+    m_Width = header.width;
+    m_Height = header.height;
+    m_RegionCount = header.regionCount;
+
+    //Every name has to be inside the names block and terminated, and the table must have
+    //empty slots left or a lookup for a missing name would never stop probing
+    bool isValid = m_Names[m_NamesSize - 1] == '\0';
+    uint32_t usedSlots = 0;
+    for(uint32_t i = 0; i < header.slotCount && isValid == true; i++)
+    {
+        if(m_Slots[i].nameOffset != OPENGL_ATLAS_INDEX_EMPTY_SLOT)
+        {
+            isValid = m_Slots[i].nameOffset < m_NamesSize;
+            usedSlots++;
+        }
+    }
+    isValid = isValid && usedSlots == m_RegionCount && usedSlots < header.slotCount;
+    if(isValid == false)
+    {
+        unload();
+    }
+    return isValid;
+}
+
+void OpenGLAtlasIndex::unload()
+{
+    if(m_Data != NULL)
+    {
+        free(m_Data);
+        m_Data = NULL;
+    }
+    m_Slots = NULL;
+    m_Names = NULL;
+    m_SlotMask = 0;
+    m_NamesSize = 0;
+    m_Width = 0;
+    m_Height = 0;
+    m_RegionCount = 0;
+}
+
+const OpenGLAtlasRegion* OpenGLAtlasIndex::findRegion(const char* aName) const
+{
+    if(m_Slots == NULL || aName == NULL)
+    {
+        return NULL;
+    }
+
+    //Linear probing, the table is at most half full so the run ends quickly at an empty slot
+    uint32_t hash = hashName(aName);
+    for(uint32_t i = hash & m_SlotMask; m_Slots[i].nameOffset != OPENGL_ATLAS_INDEX_EMPTY_SLOT; i = (i + 1) & m_SlotMask)
+    {
+        if(m_Slots[i].hash == hash && strcmp(m_Names + m_Slots[i].nameOffset, aName) == 0)
+        {
+            return &m_Slots[i].region;
+        }
+    }
+    return NULL;
+}
+
+unsigned int OpenGLAtlasIndex::getWidth() const
+{
+    return m_Width;
+}
+
+unsigned int OpenGLAtlasIndex::getHeight() const
+{
+    return m_Height;
+}
+
+unsigned int OpenGLAtlasIndex::getRegionCount() const
+{
+    return m_RegionCount;
+}
+
+bool OpenGLAtlasIndex::write(const char* aPath, unsigned int aWidth, unsigned int aHeight, const std::vector<std::string>& aNames, const std::vector<OpenGLAtlasRegion>& aRegions)
+{
+    if(aPath == NULL || aNames.empty() == true || aNames.size() != aRegions.size())
+    {
+        return false;
+    }
+
+    //Keep the load factor at or below one half
+    uint32_t slotCount = 2;
+    while(slotCount < aNames.size() * 2)
+    {
+        slotCount *= 2;
+    }
+
+    std::vector<Slot> slots(slotCount);
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        slots[i].hash = 0;
+        slots[i].nameOffset = OPENGL_ATLAS_INDEX_EMPTY_SLOT;
+        memset(&slots[i].region, 0, sizeof(OpenGLAtlasRegion));
+    }
+
+    std::string names;
+    for(size_t i = 0; i < aNames.size(); i++)
+    {
+        uint32_t hash = hashName(aNames[i].c_str());
+        uint32_t slot = hash & (slotCount - 1);
+        while(slots[slot].nameOffset != OPENGL_ATLAS_INDEX_EMPTY_SLOT)
+        {
+            if(slots[slot].hash == hash && strcmp(names.c_str() + slots[slot].nameOffset, aNames[i].c_str()) == 0)
+            {
+                return false;
+            }
+            slot = (slot + 1) & (slotCount - 1);
+        }
+
+        slots[slot].hash = hash;
+        slots[slot].nameOffset = (uint32_t)names.size();
+        slots[slot].region = aRegions[i];
+        names.append(aNames[i]);
+        names.push_back('\0');
+    }
+
+    OpenGLAtlasIndexHeader header;
+    memcpy(header.magic, OPENGL_ATLAS_INDEX_MAGIC, sizeof(header.magic));
+    header.version = OPENGL_ATLAS_INDEX_VERSION;
+    header.width = aWidth;
+    header.height = aHeight;
+    header.regionCount = (uint32_t)aNames.size();
+    header.slotCount = slotCount;
+    header.namesSize = (uint32_t)names.size();
+
+    FILE* file = fopen(aPath, "wb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1;
+    isWritten = isWritten && fwrite(&slots[0], sizeof(Slot), slotCount, file) == slotCount;
+    isWritten = isWritten && fwrite(names.data(), 1, names.size(), file) == names.size();
+    fclose(file);
+    return isWritten;
+}
+
+uint32_t OpenGLAtlasIndex::hashName(const char* aName)
+{
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    for(const unsigned char* c = (const unsigned char*)aName; *c != '\0'; c++)
+    {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,72 @@
+//
+//  OpenGLAtlasIndex.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_ATLAS_INDEX_H
+#define OPENGL_ATLAS_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+
+//A sprite's rectangle in the atlas image in pixels, the origin is the top left corner like the plist atlases
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} OpenGLAtlasRegion;
+
+
+//Binary sprite index written next to an atlas png by the atlas_packer tool. The file holds an
+//open addressing hash table built offline, so loading is one read and finding a sprite is a
+//hash and usually a single string compare, with no parsing and no per-sprite allocation.
+//
+//Layout, in the little endian byte order of every target:
+//  header   magic "GATL", version, atlas width, atlas height, region count, slot count, names size
+//  slots    slot count x { name hash, name offset (0xffffffff when empty), region }
+//  names    nul terminated sprite names
+class OpenGLAtlasIndex
+{
+public:
+    OpenGLAtlasIndex();
+    ~OpenGLAtlasIndex();
+
+    bool load(const char* path);
+    bool loadFromMemory(const void* data, size_t size);
+    void unload();
+
+    //Returns NULL if the sprite isn't in the atlas
+    const OpenGLAtlasRegion* findRegion(const char* name) const;
+
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    unsigned int getRegionCount() const;
+
+    //Builds the table and writes it to disk, the names must be unique
+    static bool write(const char* path, unsigned int width, unsigned int height, const std::vector<std::string>& names, const std::vector<OpenGLAtlasRegion>& regions);
+
+    static uint32_t hashName(const char* name);
+
+private:
+    typedef struct
+    {
+        uint32_t hash;
+        uint32_t nameOffset;
+        OpenGLAtlasRegion region;
+    } Slot;
+
+    unsigned char* m_Data;
+    const Slot* m_Slots;
+    const char* m_Names;
+    uint32_t m_SlotMask;
+    uint32_t m_NamesSize;
+    unsigned int m_Width;
+    unsigned int m_Height;
+    unsigned int m_RegionCount;
+};
+
+#endif
@@ -13,7 +13,6 @@
 OpenGLFont::OpenGLFont(const char* aFontName, float aFontSize, const char* aCharacterSet) :
   m_FontInfo(NULL),
   m_CharacterSet(""),
-  m_Text(""),
   m_Width(0.0f),
   m_Height(0.0f),
   m_Color(OpenGLColorBlack())
@@ -41,13 +40,28 @@ OpenGLFont::OpenGLFont(const char* aFontName, float aFontSize, const char* aChar
   //Load the font
   OpenGLTextureManager::getInstance()->loadFont(&m_FontInfo);
   
-  //Cycle through and setup the font frames map
+  //Cycle through and setup the glyph tables, the uv coordinates are the ones drawTexture calculates
+  memset(m_FontFrames, 0, sizeof(m_FontFrames));
+  memset(m_Glyphs, 0, sizeof(m_Glyphs));
   for(int index = 0; index < m_CharacterSet.length(); index++)
   {
-    std::string characterIndex(m_CharacterSet.substr(index, 1));
-    m_FontFramesMap[characterIndex] = m_FontInfo->fontFrames[index];
+    unsigned char character = (unsigned char)m_CharacterSet[index];
+    OpenGLTexture* fontFrame = m_FontInfo->fontFrames[index];
+    m_FontFrames[character] = fontFrame;
+    
+    OpenGLGlyph& glyph = m_Glyphs[character];
+    glyph.uvX1 = (float)fontFrame->getSourceX() / (float)fontFrame->getTextureWidth();
+    glyph.uvY1 = 1.0f - ((float)(fontFrame->getSourceY() + fontFrame->getSourceHeight()) / (float)fontFrame->getTextureHeight());
+    glyph.uvX2 = (float)(fontFrame->getSourceX() + fontFrame->getSourceWidth()) / (float)fontFrame->getTextureWidth();
+    glyph.uvY2 = 1.0f - ((float)fontFrame->getSourceY() / (float)fontFrame->getTextureHeight());
+    glyph.width = fontFrame->getSourceWidth();
+    glyph.height = fontFrame->getSourceHeight();
+    glyph.isValid = true;
   }
   
+  //Lay out the empty text
+  m_TextLayout.setText(m_Glyphs, "");
+  
   //Set the font color
   setColor(OpenGLColorBlack());
 }
@@ -88,8 +102,7 @@ OpenGLFont::~OpenGLFont()
 
 OpenGLTexture* OpenGLFont::fontTextureForCharacter(char aCharacter)
 {
-  std::string characterIndex(1, aCharacter);
-  return m_FontFramesMap[characterIndex];
+  return m_FontFrames[(unsigned char)aCharacter];
 }
 
 OpenGLTexture* OpenGLFont::getFontTexture()
@@ -97,34 +110,24 @@ OpenGLTexture* OpenGLFont::getFontTexture()
   return m_FontInfo->fontTexture;
 }
 
+OpenGLTextLayout* OpenGLFont::getTextLayout()
+{
+  return &m_TextLayout;
+}
+
 void OpenGLFont::setText(const char* aText)
 {
-  //Set the new text
-  m_Text.assign(aText);
-  
-  //Reset the width and height
-  m_Width = 0.0f;
-  m_Height = 0.0f;
-  
-  //Safety check that there is text to process, then
-  //calculate the width and height of the text
-  if(m_Text.length() > 0)
+  //The layout is only rebuilt when the text changes, then the width and height come from it
+  if(m_TextLayout.setText(m_Glyphs, aText) == true)
   {
-    for(int index = 0; index < m_Text.length(); index++)
-    {
-      OpenGLTexture* fontTexture = fontTextureForCharacter(m_Text.c_str()[index]);
-      if(fontTexture != NULL)
-      {
-        m_Width += fontTexture->getSourceWidth();
-        m_Height = fmaxf(m_Height, fontTexture->getSourceHeight());
-      }
-    }
+    m_Width = m_TextLayout.getWidth();
+    m_Height = m_TextLayout.getHeight();
   }
 }
 
 const char* OpenGLFont::getText()
 {
-  return m_Text.c_str();
+  return m_TextLayout.getText();
 }
 
 float OpenGLFont::getWidth()
@@ -148,6 +151,9 @@ void OpenGLFont::setColor(OpenGLColor aColor)
     OpenGLTexture* fontTexture = m_FontInfo->fontFrames[index];
     fontTexture->setColor(m_Color);
   }
+  
+  //And the laid out text's vertices
+  m_TextLayout.setColor(m_Color);
 }
 
 OpenGLColor OpenGLFont::getColor()
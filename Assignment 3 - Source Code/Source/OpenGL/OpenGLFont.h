@@ -12,7 +12,7 @@
 #include "OpenGLColor.h"
 #include "OpenGLTexture.h"
 #include "OpenGLConstants.h"
-#include <map>
+#include "OpenGLTextLayout.h"
 #include <string>
 
 
@@ -51,12 +51,15 @@ private:
 
   OpenGLTexture* fontTextureForCharacter(char character);
   OpenGLTexture* getFontTexture();
+  OpenGLTextLayout* getTextLayout();
 
   OpenGLFontInfo* m_FontInfo;
 
-  std::map<std::string, OpenGLTexture*> m_FontFramesMap;
+  //Indexed by the character's byte value, NULL for characters that aren't in the character set
+  OpenGLTexture* m_FontFrames[OPENGL_GLYPH_TABLE_SIZE];
+  OpenGLGlyph m_Glyphs[OPENGL_GLYPH_TABLE_SIZE];
+  OpenGLTextLayout m_TextLayout;
   std::string m_CharacterSet;
-  std::string m_Text;
   
   float m_Width;
   float m_Height;
@@ -0,0 +1,80 @@
+//
+//  OpenGLRecordingBackend.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLRecordingBackend.h"
+
+
+OpenGLRecordingBackend::OpenGLRecordingBackend()
+{
+    reset();
+}
+
+OpenGLRecordingBackend::~OpenGLRecordingBackend()
+{
+    
+}
+
+void OpenGLRecordingBackend::begin()
+{
+    
+}
+
+void OpenGLRecordingBackend::setBlending(bool /*aIsBlended*/)
+{
+    m_BlendChanges++;
+}
+
+void OpenGLRecordingBackend::bindTexture(unsigned int aTextureId)
+{
+    m_BoundTexture = aTextureId;
+    m_TextureBinds++;
+}
+
+void OpenGLRecordingBackend::drawTriangles(const OpenGLSpriteVertex* /*aVertices*/, int aVertexCount)
+{
+    m_DrawCalls++;
+    m_VertexCount += aVertexCount;
+    m_DrawTextures.push_back(m_BoundTexture);
+}
+
+void OpenGLRecordingBackend::end()
+{
+    
+}
+
+void OpenGLRecordingBackend::reset()
+{
+    m_DrawCalls = 0;
+    m_TextureBinds = 0;
+    m_BlendChanges = 0;
+    m_VertexCount = 0;
+    m_BoundTexture = 0;
+    m_DrawTextures.clear();
+}
+
+int OpenGLRecordingBackend::getDrawCalls()
+{
+    return m_DrawCalls;
+}
+
+int OpenGLRecordingBackend::getTextureBinds()
+{
+    return m_TextureBinds;
+}
+
+int OpenGLRecordingBackend::getBlendChanges()
+{
+    return m_BlendChanges;
+}
+
+int OpenGLRecordingBackend::getVertexCount()
+{
+    return m_VertexCount;
+}
+
+const std::vector<unsigned int>& OpenGLRecordingBackend::getDrawTextures()
+{
+    return m_DrawTextures;
+}
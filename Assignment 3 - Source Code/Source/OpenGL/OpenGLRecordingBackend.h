@@ -0,0 +1,45 @@
+//
+//  OpenGLRecordingBackend.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_RECORDING_BACKEND_H
+#define OPENGL_RECORDING_BACKEND_H
+
+#include "OpenGLSpriteBatch.h"
+
+
+//Sprite batch backend that draws nothing and counts the calls it would have made,
+//used to check the batching without an OpenGL context
+class OpenGLRecordingBackend : public OpenGLSpriteBatchBackend
+{
+public:
+    OpenGLRecordingBackend();
+    virtual ~OpenGLRecordingBackend();
+    
+    void begin();
+    void setBlending(bool isBlended);
+    void bindTexture(unsigned int textureId);
+    void drawTriangles(const OpenGLSpriteVertex* vertices, int vertexCount);
+    void end();
+    
+    void reset();
+    
+    int getDrawCalls();
+    int getTextureBinds();
+    int getBlendChanges();
+    int getVertexCount();
+    
+    //The texture bound for each draw call, in order
+    const std::vector<unsigned int>& getDrawTextures();
+    
+private:
+    int m_DrawCalls;
+    int m_TextureBinds;
+    int m_BlendChanges;
+    int m_VertexCount;
+    unsigned int m_BoundTexture;
+    std::vector<unsigned int> m_DrawTextures;
+};
+
+#endif
@@ -10,6 +10,55 @@
 #include "OpenGLTexture.h"
 #include "OpenGLFont.h"
 #include "DeviceUtils.h"
+#include "b2Profiler.h"
+
+
+//Draws the sprite batch with the same client state drawTexture uses, from one interleaved vertex array
+class OpenGLRendererSpriteBackend : public OpenGLSpriteBatchBackend
+{
+public:
+    void begin()
+    {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnable(GL_TEXTURE_2D);
+    }
+    
+    void setBlending(bool aIsBlended)
+    {
+        if(aIsBlended == true)
+        {
+            OpenGLRenderer::getInstance()->enableBlending();
+        }
+        else
+        {
+            OpenGLRenderer::getInstance()->disableBlending();
+        }
+    }
+    
+    void bindTexture(unsigned int aTextureId)
+    {
+        glBindTexture(GL_TEXTURE_2D, aTextureId);
+    }
+    
+    void drawTriangles(const OpenGLSpriteVertex* aVertices, int aVertexCount)
+    {
+        glVertexPointer(2, GL_FLOAT, sizeof(OpenGLSpriteVertex), &aVertices->x);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(OpenGLSpriteVertex), &aVertices->u);
+        glColorPointer(4, GL_FLOAT, sizeof(OpenGLSpriteVertex), &aVertices->red);
+        glDrawArrays(GL_TRIANGLES, 0, aVertexCount);
+    }
+    
+    void end()
+    {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+        glDisable(GL_BLEND);
+    }
+};
 
 
 OpenGLRenderer* OpenGLRenderer::m_Instance = NULL;
@@ -38,6 +87,8 @@ OpenGLRenderer::OpenGLRenderer()
     setBackgroundColor(OpenGLColorCornFlowerBlue());
     setForegroundColor(OpenGLColorBlack());
     m_DefaultFont = new OpenGLFont(OPENGL_FONT_DEFAULT_FONT, OPENGL_FONT_DEFAULT_SIZE * DeviceUtils::getContentScaleFactor(), OPENGL_FONT_EXTENDED_CHARACTER_SET);
+    m_SpriteBatchBackend = new OpenGLRendererSpriteBackend();
+    m_SpriteBatch = new OpenGLSpriteBatch(m_SpriteBatchBackend);
 }
 
 OpenGLRenderer::~OpenGLRenderer()
@@ -47,6 +98,16 @@ OpenGLRenderer::~OpenGLRenderer()
         delete m_DefaultFont;
         m_DefaultFont = NULL;
     }
+    if(m_SpriteBatch != NULL)
+    {
+        delete m_SpriteBatch;
+        m_SpriteBatch = NULL;
+    }
+    if(m_SpriteBatchBackend != NULL)
+    {
+        delete m_SpriteBatchBackend;
+        m_SpriteBatchBackend = NULL;
+    }
 }
 
 void OpenGLRenderer::clear()
@@ -187,26 +248,19 @@ void OpenGLRenderer::drawRectangle(float aX, float aY, float aWidth, float aHeig
 
 void OpenGLRenderer::drawPolygon(GLenum aRenderMode, float* aVertices, int aVertexSize, int aVertexCount)
 {
-	//Setup the colors array based on the foreground color
-	int colorSize = 4;
-	float colors[colorSize * aVertexCount];
-	int count = 0;
-	for (int i = 0; i < aVertexCount; ++i)
-	{
-		colors[count++] = m_ForegroundColor.red;
-        colors[count++] = m_ForegroundColor.green;
-        colors[count++] = m_ForegroundColor.blue;
-        colors[count++] = m_ForegroundColor.alpha;
-	}
-    
+	B2_PROFILE_ZONE("OpenGLRenderer::drawPolygon");
 	//If the foreground alpha isn't full, enable blending
 	if(m_ForegroundColor.alpha != 1.0f)
 	{
 		enableBlending();
 	}
     
-	//Draw the polygon
-	drawPolygon(aRenderMode, aVertices, aVertexSize, aVertexCount, colors, colorSize);
+	//Draw the polygon with the foreground as the current color, rather than a color array per vertex
+	glColor4f(m_ForegroundColor.red, m_ForegroundColor.green, m_ForegroundColor.blue, m_ForegroundColor.alpha);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(aVertexSize, GL_FLOAT, 0, aVertices);
+	glDrawArrays(aRenderMode, 0, aVertexCount);
+	glDisableClientState(GL_VERTEX_ARRAY);
     
 	//If the foreground alpha isn't full, blending is enabled, disable it
 	if(m_ForegroundColor.alpha != 1.0f)
@@ -217,6 +271,7 @@ void OpenGLRenderer::drawPolygon(GLenum aRenderMode, float* aVertices, int aVert
 
 void OpenGLRenderer::drawPolygon(GLenum aRenderMode, float* aVertices, int aVertexSize, int aVertexCount, float* aColors, int aColorSize)
 {
+	B2_PROFILE_ZONE("OpenGLRenderer::drawPolygon");
 	//Enable the vertex array
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(aVertexSize, GL_FLOAT, 0, aVertices);
@@ -243,6 +298,7 @@ void OpenGLRenderer::drawTexture(OpenGLTexture* aTexture, float aX, float aY, fl
 
 void OpenGLRenderer::drawTexture(OpenGLTexture* aTexture, float aX, float aY, float aWidth, float aHeight, float aAngle)
 {
+	B2_PROFILE_ZONE("OpenGLRenderer::drawTexture");
 	//Safety check the texture
 	if(aTexture != NULL)
 	{
@@ -292,6 +348,7 @@ void OpenGLRenderer::drawTexture(OpenGLTexture* aTexture, float aX, float aY, fl
 
 void OpenGLRenderer::drawTexture(OpenGLTexture* aTexture, float* aUvCoordinates, float* aVertices)
 {
+	B2_PROFILE_ZONE("OpenGLRenderer::drawTexture");
 	if(aTexture != NULL)
 	{
 		int vertexCount = 4;
@@ -344,27 +401,82 @@ void OpenGLRenderer::drawTexture(OpenGLTexture* aTexture, float* aUvCoordinates,
 
 void OpenGLRenderer::drawFont(OpenGLFont* aFont, float aX, float aY)
 {
+    B2_PROFILE_ZONE("OpenGLRenderer::drawFont");
     if(aFont != NULL)
     {
-        //Used to keep track of the current character's x position.
-        float startingX = aX;
-        const char* text = aFont->getText();
-        int length = strlen(text);
-        
-        //Cycle through and draw each character in the font's text.
-        for(int i = 0; i < length; i++)
+        //The font's text is laid out when it is set, every glyph is in the font texture so it is one draw
+        OpenGLTextLayout* textLayout = aFont->getTextLayout();
+        OpenGLTexture* fontTexture = aFont->getFontTexture();
+        if(textLayout->getVertexCount() > 0 && fontTexture != NULL)
         {
-            //Get the current character to render.
-            char character = text[i];
+            //Push the Matrix and move the pen to the text's position
+            glPushMatrix();
+            glTranslatef(aX, aY, 0.0f);
             
-            //Get the Font Texture for the character.
-            OpenGLTexture *fontTexture = aFont->fontTextureForCharacter(character);
-            if(fontTexture != NULL)
-            {
-                //Set the font texture's position, then draw it.
-                drawTexture(fontTexture, startingX, aY);
-                startingX += fontTexture->getSourceWidth();
-            }
+            //Same client state and blending test as drawTexture
+            m_SpriteBatchBackend->begin();
+            m_SpriteBatchBackend->setBlending(fontTexture->getFormat() == GL_RGBA || aFont->getAlpha() != 1.0f);
+            m_SpriteBatchBackend->bindTexture(fontTexture->getId());
+            m_SpriteBatchBackend->drawTriangles(textLayout->getVertices(), textLayout->getVertexCount());
+            m_SpriteBatchBackend->end();
+            
+            //Pop the Matrix
+            glPopMatrix();
         }
     }
 }
+
+void OpenGLRenderer::beginSpriteBatch()
+{
+    m_SpriteBatch->begin();
+}
+
+void OpenGLRenderer::submitTexture(OpenGLTexture* aTexture, float aX, float aY, float aAngle, int aLayer)
+{
+    if(aTexture != NULL)
+    {
+        submitTexture(aTexture, aX, aY, aTexture->getSourceWidth(), aTexture->getSourceHeight(), aAngle, aLayer);
+    }
+}
+
+void OpenGLRenderer::submitTexture(OpenGLTexture* aTexture, float aX, float aY, float aWidth, float aHeight, float aAngle, int aLayer)
+{
+    //Outside of a batch, fall back to drawing the texture straight away
+    if(m_SpriteBatch->isDrawing() == false)
+    {
+        drawTexture(aTexture, aX, aY, aWidth, aHeight, aAngle);
+        return;
+    }
+    
+    if(aTexture != NULL)
+    {
+        //Same uv coordinates and anchor point offset as drawTexture
+        OpenGLSprite sprite;
+        sprite.textureId = aTexture->getId();
+        sprite.uvX1 = (float)aTexture->getSourceX() / (float)aTexture->getTextureWidth();
+        sprite.uvY1 = 1.0f - ((float)(aTexture->getSourceY() + aTexture->getSourceHeight()) / (float)aTexture->getTextureHeight());
+        sprite.uvX2 = (float)(aTexture->getSourceX() + aTexture->getSourceWidth()) / (float)aTexture->getTextureWidth();
+        sprite.uvY2 = 1.0f - ((float)aTexture->getSourceY() / (float)aTexture->getTextureHeight());
+        sprite.x = aX - (aTexture->getSourceWidth() * aTexture->getAnchorPointX());
+        sprite.y = aY - (aTexture->getSourceHeight() * aTexture->getAnchorPointY());
+        sprite.width = aWidth;
+        sprite.height = aHeight;
+        sprite.angle = aAngle;
+        sprite.color = aTexture->getColor();
+        sprite.isBlended = aTexture->getFormat() == GL_RGBA || aTexture->getAlpha() != 1.0f;
+        sprite.layer = aLayer;
+        m_SpriteBatch->submit(sprite);
+    }
+}
+
+void OpenGLRenderer::flushSpriteBatch()
+{
+    B2_PROFILE_ZONE("OpenGLRenderer::flushSpriteBatch");
+    m_SpriteBatch->flush();
+}
+
+void OpenGLRenderer::endSpriteBatch()
+{
+    B2_PROFILE_ZONE("OpenGLRenderer::endSpriteBatch");
+    m_SpriteBatch->end();
+}
@@ -10,6 +10,7 @@
 #define OPENGL_RENDERER_H
 
 #include "OpenGLColor.h"
+#include "OpenGLSpriteBatch.h"
 #include <OpenGLES/ES1/gl.h>
 #include <OpenGLES/ES1/glext.h>
 
@@ -61,6 +62,13 @@ public:
     
     void drawFont(OpenGLFont* font, float x, float y);
     
+    //Sprite batch, textures submitted between begin and end are drawn with one draw call per texture run
+    void beginSpriteBatch();
+    void submitTexture(OpenGLTexture* texture, float x, float y, float angle = 0.0f, int layer = 0);
+    void submitTexture(OpenGLTexture* texture, float x, float y, float width, float height, float angle = 0.0f, int layer = 0);
+    void flushSpriteBatch();
+    void endSpriteBatch();
+    
 private:
     OpenGLRenderer();
     ~OpenGLRenderer();
@@ -69,6 +77,8 @@ private:
     OpenGLColor m_BackgroundColor;
     OpenGLColor m_ForegroundColor;
     OpenGLFont* m_DefaultFont;
+    OpenGLSpriteBatchBackend* m_SpriteBatchBackend;
+    OpenGLSpriteBatch* m_SpriteBatch;
 };
 
 #endif
@@ -0,0 +1,177 @@
+//
+//  OpenGLSpriteBatch.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLSpriteBatch.h"
+#include <algorithm>
+#include <math.h>
+
+
+OpenGLSpriteBatch::CompareSprites::CompareSprites(const std::vector<OpenGLSprite>& aSprites) :
+    m_Sprites(&aSprites)
+{
+
+}
+
+bool OpenGLSpriteBatch::CompareSprites::operator()(int aIndexA, int aIndexB) const
+{
+    const OpenGLSprite& a = (*m_Sprites)[aIndexA];
+    const OpenGLSprite& b = (*m_Sprites)[aIndexB];
+    if(a.layer != b.layer)
+    {
+        return a.layer < b.layer;
+    }
+    if(a.isBlended != b.isBlended)
+    {
+        return a.isBlended == false;
+    }
+    return a.textureId < b.textureId;
+}
+
+OpenGLSpriteBatch::OpenGLSpriteBatch(OpenGLSpriteBatchBackend* aBackend) :
+    m_Backend(aBackend),
+    m_IsDrawing(false)
+{
+
+}
+
+OpenGLSpriteBatch::~OpenGLSpriteBatch()
+{
+
+}
+
+void OpenGLSpriteBatch::begin()
+{
+    m_Sprites.clear();
+    m_IsDrawing = true;
+}
+
+void OpenGLSpriteBatch::submit(const OpenGLSprite& aSprite)
+{
+    if(m_IsDrawing == true)
+    {
+        m_Sprites.push_back(aSprite);
+    }
+}
+
+void OpenGLSpriteBatch::flush()
+{
+    if(m_Sprites.empty() == true || m_Backend == NULL)
+    {
+        m_Sprites.clear();
+        return;
+    }
+
+    //Sort the sprites into runs of the same blend state and texture, the stable sort keeps the
+    //submission order inside a run so overlapping sprites of one texture still draw in order
+    int spriteCount = (int)m_Sprites.size();
+    m_Order.resize(spriteCount);
+    for(int i = 0; i < spriteCount; i++)
+    {
+        m_Order[i] = i;
+    }
+    std::stable_sort(m_Order.begin(), m_Order.end(), CompareSprites(m_Sprites));
+
+    //Transform every quad into the one vertex buffer, in draw order
+    m_Vertices.clear();
+    m_Vertices.reserve(spriteCount * 6);
+    for(int i = 0; i < spriteCount; i++)
+    {
+        appendVertices(m_Sprites[m_Order[i]]);
+    }
+
+    //Issue one draw per run, only changing the state that differs from the previous run
+    m_Backend->begin();
+    int runStart = 0;
+    for(int i = 0; i < spriteCount; i++)
+    {
+        const OpenGLSprite& sprite = m_Sprites[m_Order[i]];
+        const OpenGLSprite* previous = i > 0 ? &m_Sprites[m_Order[i - 1]] : NULL;
+
+        if(previous == NULL || previous->isBlended != sprite.isBlended)
+        {
+            if(i > runStart)
+            {
+                m_Backend->drawTriangles(&m_Vertices[runStart * 6], (i - runStart) * 6);
+                runStart = i;
+            }
+            m_Backend->setBlending(sprite.isBlended);
+        }
+        if(previous == NULL || previous->textureId != sprite.textureId)
+        {
+            if(i > runStart)
+            {
+                m_Backend->drawTriangles(&m_Vertices[runStart * 6], (i - runStart) * 6);
+                runStart = i;
+            }
+            m_Backend->bindTexture(sprite.textureId);
+        }
+    }
+    m_Backend->drawTriangles(&m_Vertices[runStart * 6], (spriteCount - runStart) * 6);
+    m_Backend->end();
+
+    m_Sprites.clear();
+}
+
+void OpenGLSpriteBatch::end()
+{
+    flush();
+    m_IsDrawing = false;
+}
+
+bool OpenGLSpriteBatch::isDrawing()
+{
+    return m_IsDrawing;
+}
+
+int OpenGLSpriteBatch::getSpriteCount()
+{
+    return (int)m_Sprites.size();
+}
+
+void OpenGLSpriteBatch::appendVertices(const OpenGLSprite& aSprite)
+{
+    //Rotate the corners around the center of the quad, the same transform drawTexture builds on the matrix stack
+    float halfWidth = aSprite.width / 2.0f;
+    float halfHeight = aSprite.height / 2.0f;
+    float centerX = aSprite.x + halfWidth;
+    float centerY = aSprite.y + halfHeight;
+
+    float cosine = 1.0f;
+    float sine = 0.0f;
+    if(aSprite.angle != 0.0f)
+    {
+        float radians = aSprite.angle * (float)M_PI / 180.0f;
+        cosine = cosf(radians);
+        sine = sinf(radians);
+    }
+
+    //Corners in drawTexture's triangle strip order: top left, top right, bottom left, bottom right
+    const float cornerX[4] = { -halfWidth, halfWidth, -halfWidth, halfWidth };
+    const float cornerY[4] = { halfHeight, halfHeight, -halfHeight, -halfHeight };
+    const float cornerU[4] = { aSprite.uvX1, aSprite.uvX2, aSprite.uvX1, aSprite.uvX2 };
+    const float cornerV[4] = { aSprite.uvY1, aSprite.uvY1, aSprite.uvY2, aSprite.uvY2 };
+
+    OpenGLSpriteVertex corners[4];
+    for(int i = 0; i < 4; i++)
+    {
+        OpenGLSpriteVertex& vertex = corners[i];
+        vertex.x = centerX + cornerX[i] * cosine - cornerY[i] * sine;
+        vertex.y = centerY + cornerX[i] * sine + cornerY[i] * cosine;
+        vertex.u = cornerU[i];
+        vertex.v = cornerV[i];
+        vertex.red = aSprite.color.red;
+        vertex.green = aSprite.color.green;
+        vertex.blue = aSprite.color.blue;
+        vertex.alpha = aSprite.color.alpha;
+    }
+
+    //Two triangles, the strip is split so every sprite can share one GL_TRIANGLES draw
+    m_Vertices.push_back(corners[0]);
+    m_Vertices.push_back(corners[1]);
+    m_Vertices.push_back(corners[2]);
+    m_Vertices.push_back(corners[2]);
+    m_Vertices.push_back(corners[1]);
+    m_Vertices.push_back(corners[3]);
+}
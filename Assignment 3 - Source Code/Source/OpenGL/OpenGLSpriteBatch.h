@@ -0,0 +1,83 @@
+//
+//  OpenGLSpriteBatch.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_SPRITE_BATCH_H
+#define OPENGL_SPRITE_BATCH_H
+
+#include "OpenGLColor.h"
+#include <vector>
+
+
+//One interleaved vertex, the position, uv coordinates and color are read with a stride
+typedef struct
+{
+    float x, y;
+    float u, v;
+    float red, green, blue, alpha;
+} OpenGLSpriteVertex;
+
+//A textured quad submitted to the batch, positioned the same way as OpenGLRenderer::drawTexture
+typedef struct
+{
+    unsigned int textureId;
+    float uvX1, uvY1, uvX2, uvY2;
+    float x, y;             //Bottom left corner, before rotation
+    float width, height;
+    float angle;            //Degrees, around the center of the quad
+    OpenGLColor color;
+    bool isBlended;
+    int layer;              //Lower layers are drawn first, sprites in the same layer may be reordered
+} OpenGLSprite;
+
+
+//The state changes and draws a batch needs, OpenGLRenderer implements it with OpenGL ES
+//calls and OpenGLRecordingBackend counts them so batching can be checked without a context
+class OpenGLSpriteBatchBackend
+{
+public:
+    virtual ~OpenGLSpriteBatchBackend() {}
+
+    virtual void begin() = 0;
+    virtual void setBlending(bool isBlended) = 0;
+    virtual void bindTexture(unsigned int textureId) = 0;
+    virtual void drawTriangles(const OpenGLSpriteVertex* vertices, int vertexCount) = 0;
+    virtual void end() = 0;
+};
+
+
+class OpenGLSpriteBatch
+{
+public:
+    OpenGLSpriteBatch(OpenGLSpriteBatchBackend* backend);
+    ~OpenGLSpriteBatch();
+
+    //Sprites are collected between begin() and end(), nothing is drawn until flush() or end()
+    void begin();
+    void submit(const OpenGLSprite& sprite);
+    void flush();
+    void end();
+
+    bool isDrawing();
+    int getSpriteCount();
+
+private:
+    //Orders sprites by layer, then blend state, then texture, keeping the submission order within a run
+    struct CompareSprites
+    {
+        CompareSprites(const std::vector<OpenGLSprite>& sprites);
+        bool operator()(int indexA, int indexB) const;
+        const std::vector<OpenGLSprite>* m_Sprites;
+    };
+
+    void appendVertices(const OpenGLSprite& sprite);
+
+    OpenGLSpriteBatchBackend* m_Backend;
+    std::vector<OpenGLSprite> m_Sprites;
+    std::vector<int> m_Order;
+    std::vector<OpenGLSpriteVertex> m_Vertices;
+    bool m_IsDrawing;
+};
+
+#endif
@@ -0,0 +1,117 @@
+//
+//  OpenGLTextLayout.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLTextLayout.h"
+#include <math.h>
+#include <string.h>
+
+
+OpenGLTextLayout::OpenGLTextLayout() :
+    m_Text(""),
+    m_Color(OpenGLColorBlack()),
+    m_Width(0.0f),
+    m_Height(0.0f),
+    m_LayoutCount(0)
+{
+}
+
+bool OpenGLTextLayout::setText(const OpenGLGlyph* aGlyphs, const char* aText)
+{
+    //The HUD sets its text every frame, most of the time to what it already says
+    if(m_LayoutCount > 0 && strcmp(m_Text.c_str(), aText) == 0)
+    {
+        return false;
+    }
+    
+    m_Text.assign(aText);
+    m_Vertices.clear();
+    m_Width = 0.0f;
+    m_Height = 0.0f;
+    m_LayoutCount++;
+    
+    for(size_t index = 0; index < m_Text.length(); index++)
+    {
+        const OpenGLGlyph& glyph = aGlyphs[(unsigned char)m_Text[index]];
+        if(glyph.isValid == false)
+        {
+            continue;
+        }
+        
+        //Corners in drawTexture's triangle strip order: top left, top right, bottom left, bottom right
+        const float cornerX[4] = { m_Width, m_Width + glyph.width, m_Width, m_Width + glyph.width };
+        const float cornerY[4] = { glyph.height, glyph.height, 0.0f, 0.0f };
+        const float cornerU[4] = { glyph.uvX1, glyph.uvX2, glyph.uvX1, glyph.uvX2 };
+        const float cornerV[4] = { glyph.uvY1, glyph.uvY1, glyph.uvY2, glyph.uvY2 };
+        
+        OpenGLSpriteVertex corners[4];
+        for(int i = 0; i < 4; i++)
+        {
+            OpenGLSpriteVertex& vertex = corners[i];
+            vertex.x = cornerX[i];
+            vertex.y = cornerY[i];
+            vertex.u = cornerU[i];
+            vertex.v = cornerV[i];
+            vertex.red = m_Color.red;
+            vertex.green = m_Color.green;
+            vertex.blue = m_Color.blue;
+            vertex.alpha = m_Color.alpha;
+        }
+        
+        m_Vertices.push_back(corners[0]);
+        m_Vertices.push_back(corners[1]);
+        m_Vertices.push_back(corners[2]);
+        m_Vertices.push_back(corners[2]);
+        m_Vertices.push_back(corners[1]);
+        m_Vertices.push_back(corners[3]);
+        
+        m_Width += glyph.width;
+        m_Height = fmaxf(m_Height, glyph.height);
+    }
+    
+    return true;
+}
+
+const char* OpenGLTextLayout::getText()
+{
+    return m_Text.c_str();
+}
+
+void OpenGLTextLayout::setColor(OpenGLColor aColor)
+{
+    m_Color = aColor;
+    for(size_t i = 0; i < m_Vertices.size(); i++)
+    {
+        OpenGLSpriteVertex& vertex = m_Vertices[i];
+        vertex.red = m_Color.red;
+        vertex.green = m_Color.green;
+        vertex.blue = m_Color.blue;
+        vertex.alpha = m_Color.alpha;
+    }
+}
+
+float OpenGLTextLayout::getWidth()
+{
+    return m_Width;
+}
+
+float OpenGLTextLayout::getHeight()
+{
+    return m_Height;
+}
+
+const OpenGLSpriteVertex* OpenGLTextLayout::getVertices()
+{
+    return m_Vertices.empty() == true ? NULL : &m_Vertices[0];
+}
+
+int OpenGLTextLayout::getVertexCount()
+{
+    return (int)m_Vertices.size();
+}
+
+int OpenGLTextLayout::getLayoutCount()
+{
+    return m_LayoutCount;
+}
@@ -0,0 +1,60 @@
+//
+//  OpenGLTextLayout.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_TEXT_LAYOUT_H
+#define OPENGL_TEXT_LAYOUT_H
+
+#include "OpenGLColor.h"
+#include "OpenGLSpriteBatch.h"
+#include <string>
+#include <vector>
+
+
+//Glyphs are looked up by the character's byte value
+const int OPENGL_GLYPH_TABLE_SIZE = 256;
+
+//Where a character sits in the font texture, the pen moves right by its width
+typedef struct
+{
+    float uvX1, uvY1, uvX2, uvY2;
+    float width, height;
+    bool isValid;           //False for characters that aren't in the font's character set
+} OpenGLGlyph;
+
+
+//The quads for one line of text, built from a glyph table when the text changes and kept
+//until it changes again, so drawing the same text every frame is a single draw call
+class OpenGLTextLayout
+{
+public:
+    OpenGLTextLayout();
+    
+    //Lays the text out from the pen at 0,0, returns false without doing anything if it is the text already laid out
+    bool setText(const OpenGLGlyph* glyphs, const char* text);
+    const char* getText();
+    
+    //Recolors the vertices in place, the layout is kept
+    void setColor(OpenGLColor color);
+    
+    float getWidth();
+    float getHeight();
+    
+    //Six vertices per glyph, in the sprite batch's GL_TRIANGLES order
+    const OpenGLSpriteVertex* getVertices();
+    int getVertexCount();
+    
+    //How many times the text was laid out
+    int getLayoutCount();
+    
+private:
+    std::string m_Text;
+    std::vector<OpenGLSpriteVertex> m_Vertices;
+    OpenGLColor m_Color;
+    float m_Width;
+    float m_Height;
+    int m_LayoutCount;
+};
+
+#endif
@@ -0,0 +1,270 @@
+//
+//  OpenGLTextureCache.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLTextureCache.h"
+#include "OpenGLAtlasIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+namespace
+{
+    const size_t OPENGL_TEXTURE_CACHE_FILENAME_BLOCK_SIZE = 4096;
+    const uint32_t OPENGL_TEXTURE_CACHE_INITIAL_SLOTS = 64;
+}
+
+
+OpenGLTextureCache::OpenGLTextureCache() :
+    m_FilenameBlockUsed(OPENGL_TEXTURE_CACHE_FILENAME_BLOCK_SIZE),
+    m_NameSlots(OPENGL_TEXTURE_CACHE_INITIAL_SLOTS, OPENGL_TEXTURE_HANDLE_NONE),
+    m_TextureCount(0)
+{
+    TextureSlot emptySlot;
+    memset(&emptySlot, 0, sizeof(emptySlot));
+    m_TextureSlots.assign(OPENGL_TEXTURE_CACHE_INITIAL_SLOTS, emptySlot);
+}
+
+OpenGLTextureCache::~OpenGLTextureCache()
+{
+    for(size_t i = 0; i < m_FilenameBlocks.size(); i++)
+    {
+        free(m_FilenameBlocks[i]);
+    }
+    m_FilenameBlocks.clear();
+}
+
+OpenGLTextureHandle OpenGLTextureCache::intern(const char* aFilename)
+{
+    if(aFilename == NULL)
+    {
+        return OPENGL_TEXTURE_HANDLE_NONE;
+    }
+
+    uint32_t hash = OpenGLAtlasIndex::hashName(aFilename);
+    uint32_t slot = findNameSlot(aFilename, hash);
+    if(m_NameSlots[slot] != OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        return m_NameSlots[slot];
+    }
+
+    //First time this filename is seen, copy it so the handle doesn't depend on the caller's string
+    m_Filenames.push_back(copyFilename(aFilename));
+    m_FilenameHashes.push_back(hash);
+    OpenGLTextureHandle handle = (OpenGLTextureHandle)m_Filenames.size();
+    m_NameSlots[slot] = handle;
+
+    if(m_Filenames.size() * 2 > m_NameSlots.size())
+    {
+        growNameTable();
+    }
+    return handle;
+}
+
+OpenGLTextureHandle OpenGLTextureCache::findHandle(const char* aFilename) const
+{
+    if(aFilename == NULL)
+    {
+        return OPENGL_TEXTURE_HANDLE_NONE;
+    }
+    return m_NameSlots[findNameSlot(aFilename, OpenGLAtlasIndex::hashName(aFilename))];
+}
+
+const char* OpenGLTextureCache::getFilename(OpenGLTextureHandle aHandle) const
+{
+    if(aHandle == OPENGL_TEXTURE_HANDLE_NONE || aHandle > m_Filenames.size())
+    {
+        return NULL;
+    }
+    return m_Filenames[aHandle - 1];
+}
+
+OpenGLTextureCacheEntry* OpenGLTextureCache::findTexture(OpenGLTextureHandle aHandle)
+{
+    if(aHandle == OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        return NULL;
+    }
+
+    TextureSlot& slot = m_TextureSlots[findTextureSlot(aHandle)];
+    return slot.handle != OPENGL_TEXTURE_HANDLE_NONE ? &slot.entry : NULL;
+}
+
+OpenGLTextureCacheEntry* OpenGLTextureCache::retainTexture(OpenGLTextureHandle aHandle)
+{
+    OpenGLTextureCacheEntry* entry = findTexture(aHandle);
+    if(entry != NULL)
+    {
+        entry->retainCount++;
+    }
+    return entry;
+}
+
+OpenGLTextureCacheEntry* OpenGLTextureCache::insertTexture(OpenGLTextureHandle aHandle, const OpenGLTextureCacheEntry& aEntry)
+{
+    if(aHandle == OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        return NULL;
+    }
+
+    //Grow first so the returned entry isn't moved by the rehash
+    if((m_TextureCount + 1) * 2 > (int)m_TextureSlots.size())
+    {
+        growTextureTable();
+    }
+
+    TextureSlot& slot = m_TextureSlots[findTextureSlot(aHandle)];
+    if(slot.handle == OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        m_TextureCount++;
+    }
+    slot.handle = aHandle;
+    slot.entry = aEntry;
+    slot.entry.retainCount = 1;
+    return &slot.entry;
+}
+
+bool OpenGLTextureCache::releaseTexture(OpenGLTextureHandle aHandle, unsigned int* aTextureId)
+{
+    if(aHandle == OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        return false;
+    }
+
+    uint32_t index = findTextureSlot(aHandle);
+    if(m_TextureSlots[index].handle == OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        return false;
+    }
+
+    m_TextureSlots[index].entry.retainCount--;
+    if(m_TextureSlots[index].entry.retainCount > 0)
+    {
+        return false;
+    }
+
+    if(aTextureId != NULL)
+    {
+        *aTextureId = m_TextureSlots[index].entry.textureId;
+    }
+
+    //Remove the slot by shifting the rest of its probe run back, so lookups never need tombstones
+    uint32_t mask = (uint32_t)m_TextureSlots.size() - 1;
+    uint32_t hole = index;
+    for(uint32_t next = (hole + 1) & mask; m_TextureSlots[next].handle != OPENGL_TEXTURE_HANDLE_NONE; next = (next + 1) & mask)
+    {
+        //An entry can fill the hole only if its home slot isn't cyclically between the hole and itself
+        uint32_t home = hashHandle(m_TextureSlots[next].handle) & mask;
+        if(((next - home) & mask) >= ((next - hole) & mask))
+        {
+            m_TextureSlots[hole] = m_TextureSlots[next];
+            hole = next;
+        }
+    }
+    memset(&m_TextureSlots[hole], 0, sizeof(TextureSlot));
+    m_TextureCount--;
+    return true;
+}
+
+int OpenGLTextureCache::getHandleCount() const
+{
+    return (int)m_Filenames.size();
+}
+
+int OpenGLTextureCache::getTextureCount() const
+{
+    return m_TextureCount;
+}
+
+uint32_t OpenGLTextureCache::findNameSlot(const char* aFilename, uint32_t aHash) const
+{
+    //Returns the slot holding the filename, or the empty slot it would go in
+    uint32_t mask = (uint32_t)m_NameSlots.size() - 1;
+    uint32_t slot = aHash & mask;
+    while(m_NameSlots[slot] != OPENGL_TEXTURE_HANDLE_NONE)
+    {
+        uint32_t index = m_NameSlots[slot] - 1;
+        if(m_FilenameHashes[index] == aHash && strcmp(m_Filenames[index], aFilename) == 0)
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+uint32_t OpenGLTextureCache::findTextureSlot(OpenGLTextureHandle aHandle) const
+{
+    //Returns the slot holding the handle, or the empty slot it would go in
+    uint32_t mask = (uint32_t)m_TextureSlots.size() - 1;
+    uint32_t slot = hashHandle(aHandle) & mask;
+    while(m_TextureSlots[slot].handle != OPENGL_TEXTURE_HANDLE_NONE && m_TextureSlots[slot].handle != aHandle)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+const char* OpenGLTextureCache::copyFilename(const char* aFilename)
+{
+    size_t size = strlen(aFilename) + 1;
+    char* copy = NULL;
+    if(size > OPENGL_TEXTURE_CACHE_FILENAME_BLOCK_SIZE)
+    {
+        //Too long to share a block, keep the current block at the back for the next filename
+        copy = (char*)malloc(size);
+        m_FilenameBlocks.insert(m_FilenameBlocks.begin(), copy);
+    }
+    else
+    {
+        if(m_FilenameBlockUsed + size > OPENGL_TEXTURE_CACHE_FILENAME_BLOCK_SIZE)
+        {
+            m_FilenameBlocks.push_back((char*)malloc(OPENGL_TEXTURE_CACHE_FILENAME_BLOCK_SIZE));
+            m_FilenameBlockUsed = 0;
+        }
+        copy = m_FilenameBlocks.back() + m_FilenameBlockUsed;
+        m_FilenameBlockUsed += size;
+    }
+    memcpy(copy, aFilename, size);
+    return copy;
+}
+
+void OpenGLTextureCache::growNameTable()
+{
+    //The hashes were kept, so rehashing never touches the filenames
+    m_NameSlots.assign(m_NameSlots.size() * 2, OPENGL_TEXTURE_HANDLE_NONE);
+    uint32_t mask = (uint32_t)m_NameSlots.size() - 1;
+    for(uint32_t i = 0; i < m_Filenames.size(); i++)
+    {
+        uint32_t slot = m_FilenameHashes[i] & mask;
+        while(m_NameSlots[slot] != OPENGL_TEXTURE_HANDLE_NONE)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_NameSlots[slot] = i + 1;
+    }
+}
+
+void OpenGLTextureCache::growTextureTable()
+{
+    std::vector<TextureSlot> oldSlots;
+    oldSlots.swap(m_TextureSlots);
+
+    TextureSlot emptySlot;
+    memset(&emptySlot, 0, sizeof(emptySlot));
+    m_TextureSlots.assign(oldSlots.size() * 2, emptySlot);
+    for(size_t i = 0; i < oldSlots.size(); i++)
+    {
+        if(oldSlots[i].handle != OPENGL_TEXTURE_HANDLE_NONE)
+        {
+            m_TextureSlots[findTextureSlot(oldSlots[i].handle)] = oldSlots[i];
+        }
+    }
+}
+
+uint32_t OpenGLTextureCache::hashHandle(OpenGLTextureHandle aHandle)
+{
+    //Handles are handed out in order, so spread them over the table with a Fibonacci multiply
+    return (aHandle * 2654435769u) >> 7;
+}
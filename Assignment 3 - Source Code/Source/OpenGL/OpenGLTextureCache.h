@@ -0,0 +1,90 @@
+//
+//  OpenGLTextureCache.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_TEXTURE_CACHE_H
+#define OPENGL_TEXTURE_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+
+
+//A texture filename interned by OpenGLTextureCache, 0 is never handed out
+typedef uint32_t OpenGLTextureHandle;
+const OpenGLTextureHandle OPENGL_TEXTURE_HANDLE_NONE = 0;
+
+//A texture uploaded to OpenGL and the number of OpenGLTextures sharing it
+typedef struct
+{
+    unsigned int textureId;
+    int retainCount;
+    unsigned int imageWidth;
+    unsigned int imageHeight;
+    unsigned int textureWidth;
+    unsigned int textureHeight;
+} OpenGLTextureCacheEntry;
+
+
+//Keeps track of the textures OpenGLTextureManager has loaded. Filenames are interned once into
+//stable handles, so after the first lookup a texture is found by hashing a 32 bit integer instead
+//of comparing strings. Both the filename table and the retain table are flat open addressing
+//tables with linear probing, kept at most half full.
+class OpenGLTextureCache
+{
+public:
+    OpenGLTextureCache();
+    ~OpenGLTextureCache();
+
+    //Returns the filename's handle, interning a copy of the filename the first time it's seen
+    OpenGLTextureHandle intern(const char* filename);
+
+    //Returns OPENGL_TEXTURE_HANDLE_NONE if the filename was never interned
+    OpenGLTextureHandle findHandle(const char* filename) const;
+    const char* getFilename(OpenGLTextureHandle handle) const;
+
+    //Returns NULL if no texture is loaded for the handle
+    OpenGLTextureCacheEntry* findTexture(OpenGLTextureHandle handle);
+
+    //Increments the texture's retain count, returns NULL if no texture is loaded for the handle
+    OpenGLTextureCacheEntry* retainTexture(OpenGLTextureHandle handle);
+
+    //Adds a freshly uploaded texture with a retain count of one
+    OpenGLTextureCacheEntry* insertTexture(OpenGLTextureHandle handle, const OpenGLTextureCacheEntry& entry);
+
+    //Decrements the retain count, returns true and the texture id to delete when it hits zero
+    bool releaseTexture(OpenGLTextureHandle handle, unsigned int* textureId);
+
+    int getHandleCount() const;
+    int getTextureCount() const;
+
+private:
+    typedef struct
+    {
+        OpenGLTextureHandle handle;
+        OpenGLTextureCacheEntry entry;
+    } TextureSlot;
+
+    uint32_t findNameSlot(const char* filename, uint32_t hash) const;
+    uint32_t findTextureSlot(OpenGLTextureHandle handle) const;
+    const char* copyFilename(const char* filename);
+    void growNameTable();
+    void growTextureTable();
+
+    static uint32_t hashHandle(OpenGLTextureHandle handle);
+
+    //Indexed by handle - 1, the filenames live in blocks that are never moved or freed until the cache is
+    std::vector<const char*> m_Filenames;
+    std::vector<uint32_t> m_FilenameHashes;
+    std::vector<char*> m_FilenameBlocks;
+    size_t m_FilenameBlockUsed;
+
+    //Filename table slots hold a handle, 0 when empty
+    std::vector<OpenGLTextureHandle> m_NameSlots;
+
+    //Retain table slots are empty when their handle is OPENGL_TEXTURE_HANDLE_NONE
+    std::vector<TextureSlot> m_TextureSlots;
+    int m_TextureCount;
+};
+
+#endif
@@ -0,0 +1,331 @@
+//
+//  OpenGLTextureDecoder.cpp
+//  GameDevFramework
+//
+
+#include "OpenGLTextureDecoder.h"
+#include "png.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+
+//A queued png, it stays in the job list until it's collected
+struct OpenGLTextureDecodeJob
+{
+    OpenGLTextureHandle handle;
+    std::string path;
+    bool isStarted;
+    bool isFinished;
+    bool isDecoded;
+    OpenGLDecodedImage image;
+};
+
+struct OpenGLTextureDecoderState
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    //Every job not collected yet, and the ones no thread has started in the order they were queued
+    std::vector<OpenGLTextureDecodeJob*> jobs;
+    std::deque<OpenGLTextureDecodeJob*> queue;
+    bool quit;
+};
+
+
+namespace
+{
+    unsigned int nextPowerOf2(unsigned int aValue)
+    {
+        unsigned int powerOf2 = 1;
+        while(powerOf2 < aValue)
+        {
+            powerOf2 *= 2;
+        }
+        return powerOf2;
+    }
+}
+
+
+OpenGLTextureDecoder::OpenGLTextureDecoder(int aThreadCount) :
+    m_State(new OpenGLTextureDecoderState()),
+    m_ThreadCount(aThreadCount > 0 ? aThreadCount : 0)
+{
+    m_State->quit = false;
+    for(int i = 0; i < m_ThreadCount; i++)
+    {
+        m_State->threads.push_back(std::thread(&OpenGLTextureDecoder::workerMain, this));
+    }
+}
+
+OpenGLTextureDecoder::~OpenGLTextureDecoder()
+{
+    //Jobs that haven't started are dropped, the workers finish the one they're on
+    {
+        std::lock_guard<std::mutex> lock(m_State->mutex);
+        m_State->quit = true;
+        m_State->queue.clear();
+    }
+    m_State->wake.notify_all();
+    for(size_t i = 0; i < m_State->threads.size(); i++)
+    {
+        m_State->threads[i].join();
+    }
+
+    for(size_t i = 0; i < m_State->jobs.size(); i++)
+    {
+        OpenGLTextureDecodeJob* job = m_State->jobs[i];
+        freeImage(job->image);
+        delete job;
+    }
+    delete m_State;
+    m_State = NULL;
+}
+
+void OpenGLTextureDecoder::decode(OpenGLTextureHandle aHandle, const char* aPath)
+{
+    if(aHandle == OPENGL_TEXTURE_HANDLE_NONE || aPath == NULL)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_State->mutex);
+        if(findJob(aHandle) != NULL)
+        {
+            return;
+        }
+
+        OpenGLTextureDecodeJob* job = new OpenGLTextureDecodeJob();
+        job->handle = aHandle;
+        job->path = aPath;
+        job->isStarted = false;
+        job->isFinished = false;
+        job->isDecoded = false;
+        memset(&job->image, 0, sizeof(OpenGLDecodedImage));
+        m_State->jobs.push_back(job);
+        m_State->queue.push_back(job);
+    }
+    m_State->wake.notify_one();
+}
+
+bool OpenGLTextureDecoder::isQueued(OpenGLTextureHandle aHandle)
+{
+    std::lock_guard<std::mutex> lock(m_State->mutex);
+    return findJob(aHandle) != NULL;
+}
+
+bool OpenGLTextureDecoder::waitForImage(OpenGLTextureHandle aHandle, OpenGLDecodedImage& aImage)
+{
+    memset(&aImage, 0, sizeof(OpenGLDecodedImage));
+
+    std::unique_lock<std::mutex> lock(m_State->mutex);
+    OpenGLTextureDecodeJob* job = findJob(aHandle);
+    if(job == NULL)
+    {
+        return false;
+    }
+
+    //Nobody has picked it up yet, decode it here rather than wait behind the rest of the queue
+    if(job->isStarted == false)
+    {
+        job->isStarted = true;
+        for(std::deque<OpenGLTextureDecodeJob*>::iterator i = m_State->queue.begin(); i != m_State->queue.end(); i++)
+        {
+            if(*i == job)
+            {
+                m_State->queue.erase(i);
+                break;
+            }
+        }
+
+        lock.unlock();
+        OpenGLDecodedImage image;
+        bool isDecoded = decodePng(job->path.c_str(), image);
+        lock.lock();
+        job->isFinished = true;
+        job->isDecoded = isDecoded;
+        job->image = image;
+    }
+
+    while(job->isFinished == false)
+    {
+        m_State->finished.wait(lock);
+    }
+
+    //Hand the pixels over and forget the job
+    for(size_t i = 0; i < m_State->jobs.size(); i++)
+    {
+        if(m_State->jobs[i] == job)
+        {
+            m_State->jobs[i] = m_State->jobs.back();
+            m_State->jobs.pop_back();
+            break;
+        }
+    }
+    bool isDecoded = job->isDecoded;
+    aImage = job->image;
+    delete job;
+    return isDecoded;
+}
+
+int OpenGLTextureDecoder::getThreadCount()
+{
+    return m_ThreadCount;
+}
+
+bool OpenGLTextureDecoder::decodePng(const char* aPath, OpenGLDecodedImage& aImage)
+{
+    memset(&aImage, 0, sizeof(OpenGLDecodedImage));
+
+    FILE* file = aPath != NULL ? fopen(aPath, "rb") : NULL;
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    //Xcode's png compression writes an Apple only variant libpng rejects here, those fall back to UIImage
+    unsigned char signature[8];
+    if(fread(signature, 1, sizeof(signature), file) != sizeof(signature) || png_sig_cmp(signature, 0, sizeof(signature)) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+    if(info == NULL)
+    {
+        png_destroy_read_struct(&png, NULL, NULL);
+        fclose(file);
+        return false;
+    }
+
+    //libpng reports errors by jumping back here, so nothing allocated below may rely on a destructor
+    std::vector<png_bytep> rows;
+    if(setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(file);
+        freeImage(aImage);
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_set_sig_bytes(png, sizeof(signature));
+    png_read_info(png, info);
+
+    //Expand everything to 8 bit RGBA, the only format the texture upload takes
+    png_byte colorType = png_get_color_type(png, info);
+    png_set_expand(png);
+    png_set_strip_16(png);
+    if(colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+    {
+        png_set_gray_to_rgb(png);
+    }
+    png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+    png_read_update_info(png, info);
+
+    aImage.imageWidth = png_get_image_width(png, info);
+    aImage.imageHeight = png_get_image_height(png, info);
+    aImage.textureWidth = nextPowerOf2(aImage.imageWidth);
+    aImage.textureHeight = nextPowerOf2(aImage.imageHeight);
+    aImage.pixels = (unsigned char*)calloc(aImage.textureWidth * aImage.textureHeight, 4);
+
+    //The CoreGraphics loader draws the image into the bottom of the texture, and the renderer's
+    //uv coordinates count on it, so the rows go in below any padding
+    unsigned int firstRow = aImage.textureHeight - aImage.imageHeight;
+    rows.resize(aImage.imageHeight);
+    for(unsigned int y = 0; y < aImage.imageHeight; y++)
+    {
+        rows[y] = aImage.pixels + (firstRow + y) * aImage.textureWidth * 4;
+    }
+    png_read_image(png, &rows[0]);
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(file);
+
+    //Premultiply like kCGImageAlphaPremultipliedLast
+    for(unsigned int y = 0; y < aImage.imageHeight; y++)
+    {
+        unsigned char* pixel = rows[y];
+        for(unsigned int x = 0; x < aImage.imageWidth; x++, pixel += 4)
+        {
+            unsigned int alpha = pixel[3];
+            if(alpha != 255)
+            {
+                pixel[0] = (unsigned char)((pixel[0] * alpha + 127) / 255);
+                pixel[1] = (unsigned char)((pixel[1] * alpha + 127) / 255);
+                pixel[2] = (unsigned char)((pixel[2] * alpha + 127) / 255);
+            }
+        }
+    }
+    return true;
+}
+
+void OpenGLTextureDecoder::freeImage(OpenGLDecodedImage& aImage)
+{
+    if(aImage.pixels != NULL)
+    {
+        free(aImage.pixels);
+    }
+    memset(&aImage, 0, sizeof(OpenGLDecodedImage));
+}
+
+void OpenGLTextureDecoder::workerMain()
+{
+    for(;;)
+    {
+        OpenGLTextureDecodeJob* job = NULL;
+        {
+            std::unique_lock<std::mutex> lock(m_State->mutex);
+            while(m_State->quit == false && m_State->queue.empty() == true)
+            {
+                m_State->wake.wait(lock);
+            }
+            if(m_State->quit == true)
+            {
+                return;
+            }
+            job = m_State->queue.front();
+            m_State->queue.pop_front();
+            job->isStarted = true;
+        }
+
+        //The job can't be collected or deleted until it's marked finished
+        OpenGLDecodedImage image;
+        bool isDecoded = decodePng(job->path.c_str(), image);
+        finishJob(job, isDecoded, image);
+    }
+}
+
+OpenGLTextureDecodeJob* OpenGLTextureDecoder::findJob(OpenGLTextureHandle aHandle)
+{
+    for(size_t i = 0; i < m_State->jobs.size(); i++)
+    {
+        OpenGLTextureDecodeJob* job = m_State->jobs[i];
+        if(job->handle == aHandle)
+        {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+void OpenGLTextureDecoder::finishJob(OpenGLTextureDecodeJob* aJob, bool aIsDecoded, const OpenGLDecodedImage& aImage)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_State->mutex);
+        aJob->isFinished = true;
+        aJob->isDecoded = aIsDecoded;
+        aJob->image = aImage;
+    }
+    m_State->finished.notify_all();
+}
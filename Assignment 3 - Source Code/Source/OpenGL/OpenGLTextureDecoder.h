@@ -0,0 +1,59 @@
+//
+//  OpenGLTextureDecoder.h
+//  GameDevFramework
+//
+
+#ifndef OPENGL_TEXTURE_DECODER_H
+#define OPENGL_TEXTURE_DECODER_H
+
+#include "OpenGLTextureCache.h"
+
+
+//A png decoded into the pixel layout the CoreGraphics loader uploads: a power of two RGBA buffer with
+//premultiplied alpha, the image sitting top row first in the bottom left corner of the texture
+typedef struct
+{
+    unsigned int imageWidth;
+    unsigned int imageHeight;
+    unsigned int textureWidth;
+    unsigned int textureHeight;
+    unsigned char* pixels;
+} OpenGLDecodedImage;
+
+struct OpenGLTextureDecodeJob;
+struct OpenGLTextureDecoderState;
+
+
+//Decodes pngs with the bundled libpng on a pool of worker threads, so only the upload to OpenGL is
+//left for the render thread. Images are queued by texture handle and collected with waitForImage,
+//which decodes the image on the calling thread if no worker has started it yet.
+class OpenGLTextureDecoder
+{
+public:
+    OpenGLTextureDecoder(int threadCount);
+    ~OpenGLTextureDecoder();
+
+    //Queues the png for decoding, does nothing if the handle is already queued
+    void decode(OpenGLTextureHandle handle, const char* path);
+    bool isQueued(OpenGLTextureHandle handle);
+
+    //Blocks until the image is decoded and hands its pixels over, free them with freeImage. Returns
+    //false if the handle was never queued or the file isn't a png libpng can read
+    bool waitForImage(OpenGLTextureHandle handle, OpenGLDecodedImage& image);
+
+    int getThreadCount();
+
+    //Decodes on the calling thread
+    static bool decodePng(const char* path, OpenGLDecodedImage& image);
+    static void freeImage(OpenGLDecodedImage& image);
+
+private:
+    void workerMain();
+    OpenGLTextureDecodeJob* findJob(OpenGLTextureHandle handle);
+    void finishJob(OpenGLTextureDecodeJob* job, bool isDecoded, const OpenGLDecodedImage& image);
+
+    OpenGLTextureDecoderState* m_State;
+    int m_ThreadCount;
+};
+
+#endif
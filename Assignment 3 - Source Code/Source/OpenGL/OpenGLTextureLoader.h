@@ -16,10 +16,19 @@ namespace OpenGLTextureLoader
 {
   void loadTextureFromPath(const char* path, OpenGLTextureInfo** textureInfo);
   void loadTextureFromImage(void* image, OpenGLTextureInfo** textureInfo);
+  
+  //Creates a texture from power of two RGBA pixels and returns its id
+  GLuint uploadTexture(const void* pixels, GLuint textureWidth, GLuint textureHeight);
     
   void loadTextureFromAtlas(const char* pngPath, const char* plistPath, const char* atlasKey, OpenGLTextureInfo** textureInfo);
+  
+  //Sets the texture info's source position and size to the atlas key's frame, without loading the png
+  void loadAtlasFrame(const char* plistPath, const char* atlasKey, OpenGLTextureInfo** textureInfo);
     
   void loadAnimatedTextureFromPath(const char* path, const char* plistPath, OpenGLAnimatedTextureInfo** animatedTextureInfo);
+  
+  //Creates the animation frames from the plist, the animated texture info's texture must already be loaded
+  void loadAnimatedTextureFrames(const char* plistPath, OpenGLAnimatedTextureInfo** animatedTextureInfo);
 }
 
 #endif
@@ -68,27 +68,8 @@ namespace OpenGLTextureLoader
       //You don't need the context anymore, release it.
       CGContextRelease(cgContext);
       
-      //Use OpenGL ES to generate a name for the texture.
-      glGenTextures(1, &textureId);
-      
-      //Bind the texture name. 
-      glBindTexture(GL_TEXTURE_2D, textureId);
-      
-      //Does the texture options sepcify if the texture has mipmaps?
-      GLint mipmapLevel = 0;//[[aOptions objectForKey:@"GLImageMipmapLevel"] intValue];
-
-      //Set the texture parameters to use a minifying filter and a linear filer (weighted average)
-      if(mipmapLevel > 0)
-      {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      }
-      else
-      {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      }
-      
-      //Specify a 2D texture image, provideing the a pointer to the image data in memory
-      glTexImage2D(GL_TEXTURE_2D, mipmapLevel, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);			
+      //Upload the image data to OpenGL
+      textureId = uploadTexture(imageData, textureWidth, textureHeight);
               
       //Free the image data buffer.
       free(imageData);
@@ -127,7 +108,43 @@ namespace OpenGLTextureLoader
     }
   }
   
+  GLuint uploadTexture(const void* aPixels, GLuint aTextureWidth, GLuint aTextureHeight)
+  {
+    //Use OpenGL ES to generate a name for the texture.
+    GLuint textureId = 0;
+    glGenTextures(1, &textureId);
+    
+    //Bind the texture name. 
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    
+    //Does the texture options sepcify if the texture has mipmaps?
+    GLint mipmapLevel = 0;//[[aOptions objectForKey:@"GLImageMipmapLevel"] intValue];
+
+    //Set the texture parameters to use a minifying filter and a linear filer (weighted average)
+    if(mipmapLevel > 0)
+    {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    else
+    {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    
+    //Specify a 2D texture image, provideing the a pointer to the image data in memory
+    glTexImage2D(GL_TEXTURE_2D, mipmapLevel, GL_RGBA, aTextureWidth, aTextureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, aPixels);
+    return textureId;
+  }
+  
   void loadTextureFromAtlas(const char* aPngPath, const char* aPlistPath, const char* aAtlasKey, OpenGLTextureInfo** aTextureInfo)
+  {
+    //Set the texture info position and size from the plist
+    loadAtlasFrame(aPlistPath, aAtlasKey, aTextureInfo);
+
+    //Load the texture with the updated source position and size
+    loadTextureFromPath(aPngPath, aTextureInfo);
+  }
+  
+  void loadAtlasFrame(const char* aPlistPath, const char* aAtlasKey, OpenGLTextureInfo** aTextureInfo)
   {
     //Create the plistPath and atlasKey and rootDictionary
     NSString *plistPath = [[NSString alloc] initWithCString:aPlistPath encoding:NSUTF8StringEncoding];
@@ -151,9 +168,6 @@ namespace OpenGLTextureLoader
     textureInfo->sourceHeight = atlasFrame.size.height;
     textureInfo->sourceX = atlasFrame.origin.x;
     textureInfo->sourceY = textureSize.height - (atlasFrame.origin.y + atlasFrame.size.height);
-
-    //Load the texture with the updated source position and size
-    loadTextureFromPath(aPngPath, aTextureInfo);
     
     //Release the atlas key, plist path and atlas dictionary
     [plistPath release];
@@ -162,6 +176,16 @@ namespace OpenGLTextureLoader
   }
     
   void loadAnimatedTextureFromPath(const char* aPngPath, const char* aPlistPath, OpenGLAnimatedTextureInfo** aAnimatedTextureInfo)
+  {
+    //Load the full animated texture image
+    OpenGLAnimatedTextureInfo* animatedTextureInfo = *aAnimatedTextureInfo;
+    OpenGLTextureLoader::loadTextureFromPath(aPngPath, &animatedTextureInfo->textureInfo);
+    
+    //Setup each frame in the animation
+    loadAnimatedTextureFrames(aPlistPath, aAnimatedTextureInfo);
+  }
+  
+  void loadAnimatedTextureFrames(const char* aPlistPath, OpenGLAnimatedTextureInfo** aAnimatedTextureInfo)
   {
     //Create the plistPath and atlasKey and rootDictionary
     NSString *plistPath = [[NSString alloc] initWithCString:aPlistPath encoding:NSUTF8StringEncoding];
@@ -177,9 +201,6 @@ namespace OpenGLTextureLoader
     //Dereference the Animated texture struct
     OpenGLAnimatedTextureInfo* animatedTextureInfo = *aAnimatedTextureInfo;
     animatedTextureInfo->frameCount = [framesDictionary count];
-  
-    //Load the full animated texture image
-    OpenGLTextureLoader::loadTextureFromPath(aPngPath, &animatedTextureInfo->textureInfo);
     
     //Create the animated texture frames array
     animatedTextureInfo->frames = new OpenGLTexture *[animatedTextureInfo->frameCount];
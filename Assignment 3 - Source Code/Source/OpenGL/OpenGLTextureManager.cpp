@@ -9,6 +9,7 @@
 #include "OpenGLTextureManager.h"
 #include "OpenGLFontLoader.h"
 #include "OpenGLTextureLoader.h"
+#include "OpenGLConstants.h"
 #include "Utils.h"
 #include <OpenGLES/ES1/gl.h>
 #include <OpenGLES/ES1/glext.h>
@@ -26,14 +27,50 @@ OpenGLTextureManager* OpenGLTextureManager::getInstance()
   return m_Instance;
 }
 
-OpenGLTextureManager::OpenGLTextureManager()
+OpenGLTextureManager::OpenGLTextureManager() :
+  m_TextureDecoder(new OpenGLTextureDecoder(OPENGL_TEXTURE_DECODER_THREAD_COUNT))
 {
 
 }
 
 OpenGLTextureManager::~OpenGLTextureManager()
 {
+  delete m_TextureDecoder;
+  m_TextureDecoder = NULL;
+  
+  for(size_t i = 0; i < m_AtlasIndices.size(); i++)
+  {
+    delete m_AtlasIndices[i].atlasIndex;
+  }
+  m_AtlasIndices.clear();
+}
 
+OpenGLAtlasIndex* OpenGLTextureManager::getAtlasIndex(const char* aFilename)
+{
+  //Has the index for this atlas already been looked for
+  uint32_t filenameHash = OpenGLAtlasIndex::hashName(aFilename);
+  for(size_t i = 0; i < m_AtlasIndices.size(); i++)
+  {
+    if(m_AtlasIndices[i].filenameHash == filenameHash && m_AtlasIndices[i].filename == aFilename)
+    {
+      return m_AtlasIndices[i].atlasIndex;
+    }
+  }
+  
+  //Load the index if there is one, a missing index is remembered as NULL so the bundle is only searched once
+  OpenGLAtlasIndex* atlasIndex = new OpenGLAtlasIndex();
+  if(atlasIndex->load(ResourceUtils::getPathForAtlasResource(aFilename)) == false)
+  {
+    delete atlasIndex;
+    atlasIndex = NULL;
+  }
+  
+  AtlasIndexInfo atlasIndexInfo;
+  atlasIndexInfo.filenameHash = filenameHash;
+  atlasIndexInfo.filename = aFilename;
+  atlasIndexInfo.atlasIndex = atlasIndex;
+  m_AtlasIndices.push_back(atlasIndexInfo);
+  return atlasIndex;
 }
 
 void OpenGLTextureManager::loadFont(OpenGLFontInfo** aFontInfo)
@@ -43,123 +80,75 @@ void OpenGLTextureManager::loadFont(OpenGLFontInfo** aFontInfo)
 
 void OpenGLTextureManager::loadTexture(const char* aFilename, OpenGLTextureInfo** aTextureInfo)
 {
-  //Find the filename in the map
-  std::map<const char*, TextureIdRetainInfo>::iterator textureIdRetainIterator;
-  textureIdRetainIterator = m_TextureIdRetainMap.find(aFilename);
-  
-  //Does the filename already exist in our map
-  bool doesFilenameExist = textureIdRetainIterator != m_TextureIdRetainMap.end();
-  if(doesFilenameExist == true)
+  //Get the texture, loading it if this is the first time the filename is used
+  OpenGLTextureCacheEntry* textureEntry = retainTexture(aFilename);
+  if(textureEntry == NULL)
   {
-    //Setup the texture info
-    TextureIdRetainInfo textureIdRetainInfo = (*textureIdRetainIterator).second;
-
-    //Increment the retain count
-    OpenGLTextureInfo* textureInfo = *aTextureInfo;
-    textureInfo->textureId = textureIdRetainInfo.textureId;
-    textureIdRetainInfo.retainCount++;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
+    return;
   }
   
-  //Get the path for the png file from the resource manager
-  const char* pngPath = ResourceUtils::getPathForPngResource(aFilename);
-  
-  //Load the texture from the png path
-  OpenGLTextureLoader::loadTextureFromPath(pngPath, aTextureInfo);
-  
-  //If the texture info was not found we need to add it to the map
-  if(doesFilenameExist == false)
+  //Set the texture info struct data, a source rectangle set by an atlas is kept
+  OpenGLTextureInfo* textureInfo = *aTextureInfo;
+  if(textureInfo->sourceWidth == 0)
   {
-    //Load the texture data
-    TextureIdRetainInfo textureIdRetainInfo;
-    
-    //Set the texture info id and set the retain count to 1
-    OpenGLTextureInfo* textureInfo = *aTextureInfo;
-    textureIdRetainInfo.textureId = textureInfo->textureId;
-    textureIdRetainInfo.retainCount = 1;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
+    textureInfo->sourceWidth = textureEntry->imageWidth;
+  }
+  if(textureInfo->sourceHeight == 0)
+  {
+    textureInfo->sourceHeight = textureEntry->imageHeight;
   }
+  textureInfo->textureId = textureEntry->textureId;
+  textureInfo->textureWidth = textureEntry->textureWidth;
+  textureInfo->textureHeight = textureEntry->textureHeight;
+  textureInfo->textureFormat = GL_RGBA;
 }
 
 void OpenGLTextureManager::loadTextureFromAtlas(const char* aFilename, const char* aAtlasKey, OpenGLTextureInfo** aTextureInfo)
 {
-  //Find the filename in the map
-  std::map<const char*, TextureIdRetainInfo>::iterator textureIdRetainIterator;
-  textureIdRetainIterator = m_TextureIdRetainMap.find(aFilename);
-  
-  //Does the filename already exist in our map
-  bool doesFilenameExist = textureIdRetainIterator != m_TextureIdRetainMap.end();
-  if(doesFilenameExist == true)
+  //Prefer the binary index built by atlas_packer, the sprite's rectangle is a hash lookup away
+  OpenGLAtlasIndex* atlasIndex = getAtlasIndex(aFilename);
+  const OpenGLAtlasRegion* atlasRegion = atlasIndex != NULL ? atlasIndex->findRegion(aAtlasKey) : NULL;
+  if(atlasRegion != NULL)
   {
-    //Setup the texture info
-    TextureIdRetainInfo textureIdRetainInfo = (*textureIdRetainIterator).second;
-
-    //Increment the retain count
+    //The index origin is the top left corner, the same as the plist frames
     OpenGLTextureInfo* textureInfo = *aTextureInfo;
-    textureInfo->textureId = textureIdRetainInfo.textureId;
-    textureIdRetainInfo.retainCount++;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
+    textureInfo->sourceWidth = atlasRegion->width;
+    textureInfo->sourceHeight = atlasRegion->height;
+    textureInfo->sourceX = atlasRegion->x;
+    textureInfo->sourceY = atlasIndex->getHeight() - (atlasRegion->y + atlasRegion->height);
   }
-  
-  //Get the path for the png file from the resource manager
-  const char* pngPath = ResourceUtils::getPathForPngResource(aFilename);
-  const char* plistPath = ResourceUtils::getPathForPlistResource(aFilename);
-  
-  //Load the texture from the png path
-  OpenGLTextureLoader::loadTextureFromAtlas(pngPath, plistPath, aAtlasKey, aTextureInfo);
-  
-  //If the texture info was not found we need to add it to the map
-  if(doesFilenameExist == false)
+  else
   {
-    //Load the texture data
-    TextureIdRetainInfo textureIdRetainInfo;
-    
-    //Set the texture info id and set the retain count to 1
-    OpenGLTextureInfo* textureInfo = *aTextureInfo;
-    textureIdRetainInfo.textureId = textureInfo->textureId;
-    textureIdRetainInfo.retainCount = 1;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
+    //Get the sprite's rectangle from the atlas plist
+    const char* plistPath = ResourceUtils::getPathForPlistResource(aFilename);
+    OpenGLTextureLoader::loadAtlasFrame(plistPath, aAtlasKey, aTextureInfo);
   }
+  
+  //Load the atlas png, this shares the texture and retain count with every other sprite in the atlas
+  loadTexture(aFilename, aTextureInfo);
 }
 
 void OpenGLTextureManager::loadAnimatedTexture(const char* aFilename, OpenGLAnimatedTextureInfo** aAnimatedTextureInfo)
 {
-  //Find the filename in the map
-  std::map<const char*, TextureIdRetainInfo>::iterator textureIdRetainIterator;
-  textureIdRetainIterator = m_TextureIdRetainMap.find(aFilename);
+  //Load the full animated texture image
+  OpenGLAnimatedTextureInfo* animatedTextureInfo = *aAnimatedTextureInfo;
+  loadTexture(aFilename, &animatedTextureInfo->textureInfo);
   
-  //Does the filename already exist in our map
-  bool doesFilenameExist = textureIdRetainIterator != m_TextureIdRetainMap.end();
-  if(doesFilenameExist == true)
-  {
-    //Setup the texture info
-    TextureIdRetainInfo textureIdRetainInfo = (*textureIdRetainIterator).second;
-
-    //Increment the retain count
-    OpenGLAnimatedTextureInfo* animatedTextureInfo = *aAnimatedTextureInfo;
-    animatedTextureInfo->textureInfo->textureId = textureIdRetainInfo.textureId;
-    textureIdRetainInfo.retainCount++;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
-  }
-  
-  //Get the path for the png file from the resource manager
-  const char* pngPath = ResourceUtils::getPathForPngResource(aFilename);
+  //Setup the animation frames from the plist
   const char* plistPath = ResourceUtils::getPathForPlistResource(aFilename);
-  
-  //Load the texture from the png path
-  OpenGLTextureLoader::loadAnimatedTextureFromPath(pngPath, plistPath, aAnimatedTextureInfo);
-  
-  //If the texture info was not found we need to add it to the map
-  if(doesFilenameExist == false)
-  {
-    //Load the texture data
-    TextureIdRetainInfo textureIdRetainInfo;
+  OpenGLTextureLoader::loadAnimatedTextureFrames(plistPath, aAnimatedTextureInfo);
+}
 
-    //Set the texture info id and set the retain count to 1
-    OpenGLAnimatedTextureInfo* animatedTextureInfo = *aAnimatedTextureInfo;
-    textureIdRetainInfo.textureId = animatedTextureInfo->textureInfo->textureId;
-    textureIdRetainInfo.retainCount = 1;
-    m_TextureIdRetainMap[aFilename] = textureIdRetainInfo;
+void OpenGLTextureManager::preloadTextures(const char** aFilenames, int aCount)
+{
+  for(int i = 0; i < aCount; i++)
+  {
+    //Textures that are already loaded or queued are skipped
+    OpenGLTextureHandle handle = m_TextureCache.intern(aFilenames[i]);
+    if(m_TextureCache.findTexture(handle) == NULL)
+    {
+      m_TextureDecoder->decode(handle, ResourceUtils::getPathForPngResource(aFilenames[i]));
+    }
   }
 }
 
@@ -172,37 +161,12 @@ void OpenGLTextureManager::unloadTexture(OpenGLTextureInfo* aTextureInfo)
       glDeleteTextures(1, &aTextureInfo->textureId);
       return;
     }
-  
-    //Find the filename in the map
-    std::map<const char*, TextureIdRetainInfo>::iterator textureIdRetainIterator;
-    textureIdRetainIterator = m_TextureIdRetainMap.find(aTextureInfo->textureFilename);
-    
-    bool unloadTexture = false;
     
-    //Does the filename already exist in our map
-    if(textureIdRetainIterator != m_TextureIdRetainMap.end())
+    //If the retain count hit 0, unload the texture, the cache has already forgotten it
+    unsigned int textureId = 0;
+    if(m_TextureCache.releaseTexture(m_TextureCache.findHandle(aTextureInfo->textureFilename), &textureId) == true)
     {
-      //Setup the texture info
-      TextureIdRetainInfo textureIdRetainInfo = (*textureIdRetainIterator).second;
-
-      //Decrement the retain count
-      textureIdRetainInfo.retainCount--;
-      
-      //If we hit zero, set the unloadTexture flag to true
-      if(textureIdRetainInfo.retainCount == 0)
-      {
-        unloadTexture = true;
-      }
-      
-      //Update the retain map
-      m_TextureIdRetainMap[aTextureInfo->textureFilename] = textureIdRetainInfo;
-    }
-  
-    //If the retain count hit 0, unload the texture, and erase the filename from the retain map
-    if(unloadTexture == true)
-    {
-      m_TextureIdRetainMap.erase(aTextureInfo->textureFilename);
-      glDeleteTextures(1, &aTextureInfo->textureId);
+      glDeleteTextures(1, &textureId);
     }
   }
 }
@@ -214,3 +178,60 @@ void OpenGLTextureManager::unloadAnimatedTexture(OpenGLAnimatedTextureInfo* aAni
     unloadTexture(aAnimatedTextureInfo->textureInfo);
   }
 }
+
+OpenGLTextureCacheEntry* OpenGLTextureManager::retainTexture(const char* aFilename)
+{
+  //Is the texture already loaded, after the first load this is a hash of the handle and no string compares
+  OpenGLTextureHandle handle = m_TextureCache.intern(aFilename);
+  OpenGLTextureCacheEntry* textureEntry = m_TextureCache.retainTexture(handle);
+  if(textureEntry != NULL)
+  {
+    return textureEntry;
+  }
+  
+  //Collect the pixels if the png was preloaded, otherwise decode it now
+  const char* pngPath = ResourceUtils::getPathForPngResource(aFilename);
+  OpenGLDecodedImage image;
+  bool isDecoded = false;
+  if(m_TextureDecoder->isQueued(handle) == true)
+  {
+    isDecoded = m_TextureDecoder->waitForImage(handle, image);
+  }
+  else
+  {
+    isDecoded = OpenGLTextureDecoder::decodePng(pngPath, image);
+  }
+  
+  OpenGLTextureCacheEntry newTextureEntry;
+  memset(&newTextureEntry, 0, sizeof(OpenGLTextureCacheEntry));
+  if(isDecoded == true)
+  {
+    //Only the upload is left to do on this thread
+    newTextureEntry.textureId = OpenGLTextureLoader::uploadTexture(image.pixels, image.textureWidth, image.textureHeight);
+    newTextureEntry.imageWidth = image.imageWidth;
+    newTextureEntry.imageHeight = image.imageHeight;
+    newTextureEntry.textureWidth = image.textureWidth;
+    newTextureEntry.textureHeight = image.textureHeight;
+    OpenGLTextureDecoder::freeImage(image);
+  }
+  else
+  {
+    //libpng can't read the pngs Xcode compresses for the device, UIImage can
+    OpenGLTextureInfo textureInfo;
+    memset(&textureInfo, 0, sizeof(OpenGLTextureInfo));
+    OpenGLTextureInfo* textureInfoPointer = &textureInfo;
+    OpenGLTextureLoader::loadTextureFromPath(pngPath, &textureInfoPointer);
+    newTextureEntry.textureId = textureInfo.textureId;
+    newTextureEntry.imageWidth = textureInfo.sourceWidth;
+    newTextureEntry.imageHeight = textureInfo.sourceHeight;
+    newTextureEntry.textureWidth = textureInfo.textureWidth;
+    newTextureEntry.textureHeight = textureInfo.textureHeight;
+  }
+  
+  //Don't remember a texture that failed to load, the next load will try again
+  if(newTextureEntry.textureId == 0)
+  {
+    return NULL;
+  }
+  return m_TextureCache.insertTexture(handle, newTextureEntry);
+}
@@ -12,7 +12,9 @@
 #include "OpenGLFont.h"
 #include "OpenGLTexture.h"
 #include "OpenGLAnimatedTexture.h"
-#include <map>
+#include "OpenGLAtlasIndex.h"
+#include "OpenGLTextureCache.h"
+#include "OpenGLTextureDecoder.h"
 
 
 class OpenGLTextureManager
@@ -25,34 +27,40 @@ public:
   void loadTextureFromAtlas(const char* filename, const char* atlasKey, OpenGLTextureInfo** textureInfo);
   void loadAnimatedTexture(const char* filename, OpenGLAnimatedTextureInfo** animatedTextureInfo);
   
+  //Starts decoding the pngs on the decoder threads and returns straight away, call it with a level's
+  //texture list before creating its OpenGLTextures so their loads only have to upload
+  void preloadTextures(const char** filenames, int count);
+  
   void unloadTexture(OpenGLTextureInfo* textureInfo);
   void unloadAnimatedTexture(OpenGLAnimatedTextureInfo* animatedTextureInfo);
 
 private:
   OpenGLTextureManager();
   ~OpenGLTextureManager();
+  
+  //Returns the loaded texture for the filename retained once more, uploading it first if it isn't loaded yet
+  OpenGLTextureCacheEntry* retainTexture(const char* filename);
+  
+  //Returns the binary index built by atlas_packer for the filename, or NULL if the atlas only has a plist
+  OpenGLAtlasIndex* getAtlasIndex(const char* filename);
 
   //Singleton instance of OpenGLTextureManager
   static OpenGLTextureManager* m_Instance;
-
-  //Private struct to keep track of the OpenGL id and its retain count.
-  typedef struct TextureIdRetainInfo
-  {
-    unsigned int textureId;
-    int retainCount;
-  }TextureIdRetainInfo;
-
-  //Compare filenames function for the texture retain map
-  struct compareFilenames
+  
+  //Keeps track of the OpenGL texture's loaded into memory and their retain counts, this prevents us from loading the same texture into memory twice
+  OpenGLTextureCache m_TextureCache;
+  
+  //Decodes pngs off the render thread
+  OpenGLTextureDecoder* m_TextureDecoder;
+  
+  //Atlas indices loaded so far, there are only ever a handful so they are searched by hash
+  typedef struct AtlasIndexInfo
   {
-    bool operator()(char const* filenameA, char const* filenameB)
-    {
-      return std::strcmp(filenameA, filenameB) < 0;
-    }
-  };
-  
-  //Map to keep track of the OpenGL texture's loaded into memory, this prevents us from loading the same texture into memory twice
-  std::map<const char*, TextureIdRetainInfo, compareFilenames> m_TextureIdRetainMap;
+    uint32_t filenameHash;
+    std::string filename;
+    OpenGLAtlasIndex* atlasIndex;
+  }AtlasIndexInfo;
+  std::vector<AtlasIndexInfo> m_AtlasIndices;
 };
 
 #endif
@@ -0,0 +1,272 @@
+//
+//  AtlasPacker.cpp
+//  GameDevFramework
+//
+//  Offline texture atlas builder. Packs every png in a directory into one power of two
+//  atlas with MaxRectsPacker, and writes NAME.png plus the NAME.atlas index read by
+//  OpenGLTextureManager::loadTextureFromAtlas. Sprites are named after their file,
+//  without the extension.
+//
+//    atlas_packer <input directory> <output path without extension> [--max-size N] [--padding N]
+//
+
+#include "MaxRectsPacker.h"
+#include "PngImage.h"
+#include "OpenGLAtlasIndex.h"
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    typedef struct
+    {
+        std::string name;
+        PngImage image;
+        int x;
+        int y;
+    } AtlasSprite;
+
+    //Largest sides first, max-rects leaves less waste when the big pieces go in early
+    struct CompareSpriteSize
+    {
+        CompareSpriteSize(const std::vector<AtlasSprite>& sprites) : m_Sprites(&sprites) {}
+        bool operator()(int indexA, int indexB) const
+        {
+            const PngImage& a = (*m_Sprites)[indexA].image;
+            const PngImage& b = (*m_Sprites)[indexB].image;
+            int maxSideA = std::max(a.getWidth(), a.getHeight());
+            int maxSideB = std::max(b.getWidth(), b.getHeight());
+            if(maxSideA != maxSideB)
+            {
+                return maxSideA > maxSideB;
+            }
+            return a.getWidth() * a.getHeight() > b.getWidth() * b.getHeight();
+        }
+        const std::vector<AtlasSprite>* m_Sprites;
+    };
+
+    bool hasPngExtension(const char* aFilename)
+    {
+        size_t length = strlen(aFilename);
+        return length > 4 && strcmp(aFilename + length - 4, ".png") == 0;
+    }
+
+    bool loadSprites(const char* aDirectory, std::vector<AtlasSprite>& aSprites)
+    {
+        DIR* directory = opendir(aDirectory);
+        if(directory == NULL)
+        {
+            printf("Can't open %s\n", aDirectory);
+            return false;
+        }
+
+        std::vector<std::string> filenames;
+        for(dirent* entry = readdir(directory); entry != NULL; entry = readdir(directory))
+        {
+            if(hasPngExtension(entry->d_name) == true)
+            {
+                filenames.push_back(entry->d_name);
+            }
+        }
+        closedir(directory);
+
+        //Sorted so the same directory always packs the same way
+        std::sort(filenames.begin(), filenames.end());
+        aSprites.resize(filenames.size());
+        for(size_t i = 0; i < filenames.size(); i++)
+        {
+            std::string path = std::string(aDirectory) + "/" + filenames[i];
+            if(aSprites[i].image.load(path.c_str()) == false)
+            {
+                printf("Can't read %s\n", path.c_str());
+                return false;
+            }
+            aSprites[i].name = filenames[i].substr(0, filenames[i].size() - 4);
+        }
+        return true;
+    }
+
+    //Tries to place every sprite in a width x height bin, the order is largest first
+    bool pack(std::vector<AtlasSprite>& aSprites, const std::vector<int>& aOrder, int aWidth, int aHeight, int aPadding, float& aOccupancy)
+    {
+        MaxRectsPacker packer(aWidth, aHeight);
+        for(size_t i = 0; i < aOrder.size(); i++)
+        {
+            AtlasSprite& sprite = aSprites[aOrder[i]];
+            if(packer.insert(sprite.image.getWidth() + aPadding, sprite.image.getHeight() + aPadding, sprite.x, sprite.y) == false)
+            {
+                return false;
+            }
+        }
+        aOccupancy = packer.getOccupancy();
+        return true;
+    }
+
+    //Reads the written files back and checks every sprite's pixels through the index
+    bool verify(const std::vector<AtlasSprite>& aSprites, const char* aPngPath, const char* aIndexPath)
+    {
+        PngImage atlas;
+        OpenGLAtlasIndex index;
+        if(atlas.load(aPngPath) == false || index.load(aIndexPath) == false)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < aSprites.size(); i++)
+        {
+            const OpenGLAtlasRegion* region = index.findRegion(aSprites[i].name.c_str());
+            const PngImage& image = aSprites[i].image;
+            if(region == NULL || region->width != image.getWidth() || region->height != image.getHeight())
+            {
+                return false;
+            }
+            for(int y = 0; y < image.getHeight(); y++)
+            {
+                if(memcmp(atlas.getPixel(region->x, region->y + y), image.getPixel(0, y), image.getWidth() * 4) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return index.findRegion("") == NULL;
+    }
+}
+
+int main(int aArgc, char** aArgv)
+{
+    int maxSize = 2048;
+    int padding = 1;
+    const char* inputDirectory = NULL;
+    const char* outputPath = NULL;
+
+    for(int i = 1; i < aArgc; i++)
+    {
+        if(strcmp(aArgv[i], "--max-size") == 0 && i + 1 < aArgc)
+        {
+            maxSize = atoi(aArgv[++i]);
+        }
+        else if(strcmp(aArgv[i], "--padding") == 0 && i + 1 < aArgc)
+        {
+            padding = std::max(0, atoi(aArgv[++i]));
+        }
+        else if(inputDirectory == NULL)
+        {
+            inputDirectory = aArgv[i];
+        }
+        else if(outputPath == NULL)
+        {
+            outputPath = aArgv[i];
+        }
+    }
+
+    if(inputDirectory == NULL || outputPath == NULL || maxSize <= 0)
+    {
+        printf("usage: %s <input directory> <output path without extension> [--max-size N] [--padding N]\n", aArgv[0]);
+        return 1;
+    }
+
+    std::vector<AtlasSprite> sprites;
+    if(loadSprites(inputDirectory, sprites) == false)
+    {
+        return 1;
+    }
+    if(sprites.empty() == true)
+    {
+        printf("No png files in %s\n", inputDirectory);
+        return 1;
+    }
+
+    std::vector<int> order(sprites.size());
+    long area = 0;
+    int maxWidth = 0;
+    int maxHeight = 0;
+    for(size_t i = 0; i < sprites.size(); i++)
+    {
+        order[i] = (int)i;
+        area += (long)(sprites[i].image.getWidth() + padding) * (sprites[i].image.getHeight() + padding);
+        maxWidth = std::max(maxWidth, sprites[i].image.getWidth() + padding);
+        maxHeight = std::max(maxHeight, sprites[i].image.getHeight() + padding);
+    }
+    std::sort(order.begin(), order.end(), CompareSpriteSize(sprites));
+
+    //Start from the smallest power of two bin that could hold everything, and grow the shorter side until it fits
+    int width = 1;
+    int height = 1;
+    while(width < maxWidth)
+    {
+        width *= 2;
+    }
+    while(height < maxHeight)
+    {
+        height *= 2;
+    }
+    while((long)width * height < area)
+    {
+        if(width <= height)
+        {
+            width *= 2;
+        }
+        else
+        {
+            height *= 2;
+        }
+    }
+
+    float occupancy = 0.0f;
+    while(width <= maxSize && height <= maxSize && pack(sprites, order, width, height, padding, occupancy) == false)
+    {
+        if(width <= height)
+        {
+            width *= 2;
+        }
+        else
+        {
+            height *= 2;
+        }
+    }
+    if(width > maxSize || height > maxSize)
+    {
+        printf("%d sprites don't fit in %dx%d\n", (int)sprites.size(), maxSize, maxSize);
+        return 1;
+    }
+
+    PngImage atlas(width, height);
+    std::vector<std::string> names(sprites.size());
+    std::vector<OpenGLAtlasRegion> regions(sprites.size());
+    for(size_t i = 0; i < sprites.size(); i++)
+    {
+        atlas.blit(sprites[i].image, sprites[i].x, sprites[i].y);
+        names[i] = sprites[i].name;
+        regions[i].x = (uint16_t)sprites[i].x;
+        regions[i].y = (uint16_t)sprites[i].y;
+        regions[i].width = (uint16_t)sprites[i].image.getWidth();
+        regions[i].height = (uint16_t)sprites[i].image.getHeight();
+    }
+
+    std::string pngPath = std::string(outputPath) + ".png";
+    std::string indexPath = std::string(outputPath) + ".atlas";
+    if(atlas.save(pngPath.c_str()) == false)
+    {
+        printf("Can't write %s\n", pngPath.c_str());
+        return 1;
+    }
+    if(OpenGLAtlasIndex::write(indexPath.c_str(), width, height, names, regions) == false)
+    {
+        printf("Can't write %s, are the sprite names unique?\n", indexPath.c_str());
+        return 1;
+    }
+    if(verify(sprites, pngPath.c_str(), indexPath.c_str()) == false)
+    {
+        printf("%s doesn't match the sprites it was built from\n", indexPath.c_str());
+        return 1;
+    }
+
+    printf("Packed %d sprites into %dx%d, %.1f%% used\n", (int)sprites.size(), width, height, occupancy * 100.0f);
+    return 0;
+}
@@ -0,0 +1,136 @@
+//
+//  MaxRectsPacker.cpp
+//  GameDevFramework
+//
+
+#include "MaxRectsPacker.h"
+#include <algorithm>
+#include <limits.h>
+
+
+MaxRectsPacker::MaxRectsPacker(int aWidth, int aHeight) :
+    m_Width(aWidth),
+    m_Height(aHeight),
+    m_UsedArea(0)
+{
+    Rect bin = { 0, 0, aWidth, aHeight };
+    m_FreeRects.push_back(bin);
+}
+
+bool MaxRectsPacker::insert(int aWidth, int aHeight, int& aX, int& aY)
+{
+    //Find the free rectangle that leaves the shortest side over, then the shortest long side
+    int bestIndex = -1;
+    int bestShortSide = INT_MAX;
+    int bestLongSide = INT_MAX;
+    for(size_t i = 0; i < m_FreeRects.size(); i++)
+    {
+        const Rect& freeRect = m_FreeRects[i];
+        if(freeRect.width >= aWidth && freeRect.height >= aHeight)
+        {
+            int leftoverX = freeRect.width - aWidth;
+            int leftoverY = freeRect.height - aHeight;
+            int shortSide = std::min(leftoverX, leftoverY);
+            int longSide = std::max(leftoverX, leftoverY);
+            if(shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+            {
+                bestIndex = (int)i;
+                bestShortSide = shortSide;
+                bestLongSide = longSide;
+            }
+        }
+    }
+    
+    if(bestIndex == -1)
+    {
+        return false;
+    }
+    
+    Rect usedRect = { m_FreeRects[bestIndex].x, m_FreeRects[bestIndex].y, aWidth, aHeight };
+    splitFreeRects(usedRect);
+    pruneFreeRects();
+    
+    m_UsedArea += (long)aWidth * aHeight;
+    aX = usedRect.x;
+    aY = usedRect.y;
+    return true;
+}
+
+float MaxRectsPacker::getOccupancy()
+{
+    return (float)m_UsedArea / ((float)m_Width * (float)m_Height);
+}
+
+void MaxRectsPacker::splitFreeRects(const Rect& aUsedRect)
+{
+    //Every free rectangle the new one overlaps is replaced by the up to four maximal rectangles around it
+    std::vector<Rect> splitRects;
+    for(size_t i = 0; i < m_FreeRects.size();)
+    {
+        Rect freeRect = m_FreeRects[i];
+        bool overlaps = aUsedRect.x < freeRect.x + freeRect.width && aUsedRect.x + aUsedRect.width > freeRect.x &&
+                        aUsedRect.y < freeRect.y + freeRect.height && aUsedRect.y + aUsedRect.height > freeRect.y;
+        if(overlaps == false)
+        {
+            i++;
+            continue;
+        }
+        
+        if(aUsedRect.x > freeRect.x)
+        {
+            Rect left = { freeRect.x, freeRect.y, aUsedRect.x - freeRect.x, freeRect.height };
+            splitRects.push_back(left);
+        }
+        if(aUsedRect.x + aUsedRect.width < freeRect.x + freeRect.width)
+        {
+            Rect right = { aUsedRect.x + aUsedRect.width, freeRect.y, freeRect.x + freeRect.width - (aUsedRect.x + aUsedRect.width), freeRect.height };
+            splitRects.push_back(right);
+        }
+        if(aUsedRect.y > freeRect.y)
+        {
+            Rect top = { freeRect.x, freeRect.y, freeRect.width, aUsedRect.y - freeRect.y };
+            splitRects.push_back(top);
+        }
+        if(aUsedRect.y + aUsedRect.height < freeRect.y + freeRect.height)
+        {
+            Rect bottom = { freeRect.x, aUsedRect.y + aUsedRect.height, freeRect.width, freeRect.y + freeRect.height - (aUsedRect.y + aUsedRect.height) };
+            splitRects.push_back(bottom);
+        }
+        
+        m_FreeRects[i] = m_FreeRects.back();
+        m_FreeRects.pop_back();
+    }
+    m_FreeRects.insert(m_FreeRects.end(), splitRects.begin(), splitRects.end());
+}
+
+void MaxRectsPacker::pruneFreeRects()
+{
+    //Drop free rectangles that are inside another one, they add nothing but search time
+    for(size_t i = 0; i < m_FreeRects.size(); i++)
+    {
+        for(size_t j = i + 1; j < m_FreeRects.size();)
+        {
+            if(contains(m_FreeRects[i], m_FreeRects[j]) == true)
+            {
+                m_FreeRects.erase(m_FreeRects.begin() + j);
+            }
+            else if(contains(m_FreeRects[j], m_FreeRects[i]) == true)
+            {
+                m_FreeRects.erase(m_FreeRects.begin() + i);
+                i--;
+                break;
+            }
+            else
+            {
+                j++;
+            }
+        }
+    }
+}
+
+bool MaxRectsPacker::contains(const Rect& aOuter, const Rect& aInner)
+{
+    return aInner.x >= aOuter.x && aInner.y >= aOuter.y &&
+           aInner.x + aInner.width <= aOuter.x + aOuter.width &&
+           aInner.y + aInner.height <= aOuter.y + aOuter.height;
+}
@@ -0,0 +1,42 @@
+//
+//  MaxRectsPacker.h
+//  GameDevFramework
+//
+
+#ifndef MAX_RECTS_PACKER_H
+#define MAX_RECTS_PACKER_H
+
+#include <vector>
+
+
+//Packs rectangles into a fixed size bin with the max-rects algorithm, keeping every maximal free
+//rectangle and placing each new one where it leaves the shortest side over (best short side fit).
+//Rectangles are never rotated, the sprites are drawn with the uv coordinates as they are.
+class MaxRectsPacker
+{
+public:
+    MaxRectsPacker(int width, int height);
+    
+    //Returns false, and leaves the bin as it was, if the rectangle doesn't fit
+    bool insert(int width, int height, int& x, int& y);
+    
+    //Fraction of the bin covered by inserted rectangles
+    float getOccupancy();
+    
+private:
+    typedef struct
+    {
+        int x, y, width, height;
+    } Rect;
+    
+    void splitFreeRects(const Rect& usedRect);
+    void pruneFreeRects();
+    static bool contains(const Rect& outer, const Rect& inner);
+    
+    int m_Width;
+    int m_Height;
+    long m_UsedArea;
+    std::vector<Rect> m_FreeRects;
+};
+
+#endif
@@ -0,0 +1,152 @@
+//
+//  PngImage.cpp
+//  GameDevFramework
+//
+
+#include "PngImage.h"
+#include "png.h"
+#include <stdio.h>
+#include <string.h>
+
+
+PngImage::PngImage() :
+    m_Width(0),
+    m_Height(0)
+{
+    
+}
+
+PngImage::PngImage(int aWidth, int aHeight) :
+    m_Width(aWidth),
+    m_Height(aHeight),
+    m_Pixels(aWidth * aHeight * 4, 0)
+{
+    
+}
+
+bool PngImage::load(const char* aPath)
+{
+    FILE* file = fopen(aPath, "rb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    
+    unsigned char signature[8];
+    if(fread(signature, 1, sizeof(signature), file) != sizeof(signature) || png_sig_cmp(signature, 0, sizeof(signature)) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+    
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+    if(info == NULL)
+    {
+        png_destroy_read_struct(&png, NULL, NULL);
+        fclose(file);
+        return false;
+    }
+    
+    //libpng reports errors by jumping back here
+    std::vector<png_bytep> rows;
+    if(setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(file);
+        return false;
+    }
+    
+    png_init_io(png, file);
+    png_set_sig_bytes(png, sizeof(signature));
+    png_read_info(png, info);
+    
+    //Expand palette, gray and low bit depth images, and add an opaque alpha channel where there is none
+    png_byte colorType = png_get_color_type(png, info);
+    png_set_expand(png);
+    png_set_strip_16(png);
+    if(colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+    {
+        png_set_gray_to_rgb(png);
+    }
+    png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+    png_read_update_info(png, info);
+    
+    m_Width = png_get_image_width(png, info);
+    m_Height = png_get_image_height(png, info);
+    m_Pixels.assign(m_Width * m_Height * 4, 0);
+    rows.resize(m_Height);
+    for(int y = 0; y < m_Height; y++)
+    {
+        rows[y] = &m_Pixels[y * m_Width * 4];
+    }
+    png_read_image(png, &rows[0]);
+    png_read_end(png, NULL);
+    
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(file);
+    return true;
+}
+
+bool PngImage::save(const char* aPath)
+{
+    FILE* file = fopen(aPath, "wb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png != NULL ? png_create_info_struct(png) : NULL;
+    if(info == NULL)
+    {
+        png_destroy_write_struct(&png, NULL);
+        fclose(file);
+        return false;
+    }
+    
+    std::vector<png_bytep> rows(m_Height);
+    if(setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        fclose(file);
+        return false;
+    }
+    
+    png_init_io(png, file);
+    png_set_IHDR(png, info, m_Width, m_Height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for(int y = 0; y < m_Height; y++)
+    {
+        rows[y] = &m_Pixels[y * m_Width * 4];
+    }
+    png_write_image(png, &rows[0]);
+    png_write_end(png, NULL);
+    
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return true;
+}
+
+void PngImage::blit(const PngImage& aSource, int aX, int aY)
+{
+    for(int y = 0; y < aSource.m_Height; y++)
+    {
+        memcpy(&m_Pixels[((aY + y) * m_Width + aX) * 4], &aSource.m_Pixels[y * aSource.m_Width * 4], aSource.m_Width * 4);
+    }
+}
+
+int PngImage::getWidth() const
+{
+    return m_Width;
+}
+
+int PngImage::getHeight() const
+{
+    return m_Height;
+}
+
+const unsigned char* PngImage::getPixel(int aX, int aY) const
+{
+    return &m_Pixels[(aY * m_Width + aX) * 4];
+}
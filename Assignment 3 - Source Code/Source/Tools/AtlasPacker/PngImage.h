@@ -0,0 +1,36 @@
+//
+//  PngImage.h
+//  GameDevFramework
+//
+
+#ifndef PNG_IMAGE_H
+#define PNG_IMAGE_H
+
+#include <vector>
+
+
+//An 8 bit RGBA image read and written with the bundled libpng, rows run top to bottom
+class PngImage
+{
+public:
+    PngImage();
+    PngImage(int width, int height);
+    
+    //Any png is expanded to 8 bit RGBA on load
+    bool load(const char* path);
+    bool save(const char* path);
+    
+    //Copies the whole of the source image with its top left corner at x, y
+    void blit(const PngImage& source, int x, int y);
+    
+    int getWidth() const;
+    int getHeight() const;
+    const unsigned char* getPixel(int x, int y) const;
+    
+private:
+    int m_Width;
+    int m_Height;
+    std::vector<unsigned char> m_Pixels;
+};
+
+#endif
@@ -31,6 +31,11 @@ namespace DeviceUtils
     unsigned long long getMemorySize();
     bool hasLowOnMemorySize();
     bool hasDualCoreCPU();
+    
+#if GAME_HEADLESS
+    //There is no screen in a headless build, the resolution is set by the host instead
+    void setScreenResolution(float width, float height, float contentScaleFactor = 1.0f);
+#endif
 }
 
 #endif
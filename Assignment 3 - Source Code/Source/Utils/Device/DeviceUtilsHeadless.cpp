@@ -0,0 +1,116 @@
+//
+//  DeviceUtilsHeadless.cpp
+//  GameDevFramework
+//
+//  Stand-in for DeviceUtils.mm when building without UIKit, reports a
+//  fixed landscape screen that can be changed by the host application.
+//
+
+#include "DeviceUtils.h"
+
+
+namespace DeviceUtils
+{
+  static float s_ScreenWidth = 1024.0f;
+  static float s_ScreenHeight = 768.0f;
+  static float s_ContentScaleFactor = 1.0f;
+  
+  void setScreenResolution(float aWidth, float aHeight, float aContentScaleFactor)
+  {
+    s_ScreenWidth = aWidth;
+    s_ScreenHeight = aHeight;
+    s_ContentScaleFactor = aContentScaleFactor;
+  }
+  
+  void getScreenResolution(float& aWidth, float& aHeight, bool aScaled)
+  {
+    aWidth = s_ScreenWidth;
+    aHeight = s_ScreenHeight;
+    
+    //If the scaled flag is true, multiply the size by the content scale factor
+    if(aScaled == true)
+    {
+      aWidth *= getContentScaleFactor();
+      aHeight *= getContentScaleFactor();
+    }
+  }
+  
+  float getScreenResolutionWidth(bool scaled)
+  {
+    float width, height;
+    getScreenResolution(width, height, scaled);
+    return width;
+  }
+  
+  float getScreenResolutionHeight(bool scaled)
+  {
+    float width, height;
+    getScreenResolution(width, height, scaled);
+    return height;
+  }
+  
+  float getContentScaleFactor()
+  {
+    return s_ContentScaleFactor;
+  }
+  
+  bool hasRetinaDisplay()
+  {
+    return getContentScaleFactor() == 2.0f;
+  }
+  
+  bool isDeviceIPad()
+  {
+    return false;
+  }
+  
+  bool isDeviceSimulator()
+  {
+    return true;
+  }
+  
+  bool isOrientationPortrait()
+  {
+    return isOrientationLandscape() == false;
+  }
+  
+  bool isOrientationLandscape()
+  {
+    return s_ScreenWidth >= s_ScreenHeight;
+  }
+  
+  const char* getName()
+  {
+    return "Headless";
+  }
+  
+  const char* getModel()
+  {
+    return "Headless";
+  }
+  
+  const char* getSystemName()
+  {
+    return "Headless";
+  }
+  
+  const char* getSystemVersion()
+  {
+    return "1.0";
+  }
+  
+  unsigned long long getMemorySize()
+  {
+    return 0;
+  }
+  
+  bool hasLowOnMemorySize()
+  {
+    return false;
+  }
+  
+  bool hasDualCoreCPU()
+  {
+    return true;
+  }
+}
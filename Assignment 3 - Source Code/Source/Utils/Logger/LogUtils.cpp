@@ -7,52 +7,413 @@
 //
 
 #include "LogUtils.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+
+namespace
+{
+  const int LOG_MESSAGE_SIZE = 256;
+  const unsigned int LOG_RING_SIZE = 1024;
+  const int LOG_FULL_RETRIES = 64;
+  const int LOG_IDLE_WAIT_MILLISECONDS = 2;
+  const int LOG_WRITE_BUFFER_SIZE = 64 * 1024;
+  const int LOG_MAX_LABEL_LENGTH = 32;
+
+  //One line, newline included, cut short if it doesn't fit
+  typedef struct
+  {
+    int length;
+    char text[LOG_MESSAGE_SIZE - sizeof(int)];
+  } LogMessage;
+
+  //The messages of one thread. Only the owner moves head and only the writer thread moves tail,
+  //so neither side locks. A ring outlives its thread and goes to the next thread that logs.
+  struct LogRing
+  {
+    LogMessage messages[LOG_RING_SIZE];
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+    std::atomic<unsigned long> dropped;
+    std::atomic<bool> isOwned;
+    LogRing* next;
+  };
+
+  //Gives the ring back when its thread exits
+  struct LogRingOwner
+  {
+    LogRingOwner() : ring(NULL) {}
+    ~LogRingOwner()
+    {
+      if(ring != NULL)
+      {
+        ring->isOwned.store(false, std::memory_order_release);
+      }
+    }
+    LogRing* ring;
+  };
+
+  class LogWriter
+  {
+  public:
+    LogWriter() :
+      m_Rings(NULL),
+      m_File(stdout),
+      m_Path(),
+      m_MaxBytes(0),
+      m_MaxFiles(0),
+      m_FileBytes(0),
+      m_Written(0),
+      m_DroppedReported(0),
+      m_FlushRequested(0),
+      m_FlushCompleted(0),
+      m_IsQuitting(false)
+    {
+      m_Thread = std::thread(&LogWriter::run, this);
+    }
+
+    ~LogWriter()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsQuitting = true;
+      }
+      m_Wake.notify_one();
+      m_Thread.join();
+      closeFile();
+    }
+
+    LogRing* acquireRing()
+    {
+      for(LogRing* ring = m_Rings.load(std::memory_order_acquire); ring != NULL; ring = ring->next)
+      {
+        bool isOwned = false;
+        if(ring->isOwned.load(std::memory_order_relaxed) == false && ring->isOwned.compare_exchange_strong(isOwned, true, std::memory_order_acquire))
+        {
+          return ring;
+        }
+      }
+
+      LogRing* ring = new LogRing();
+      ring->head.store(0, std::memory_order_relaxed);
+      ring->tail.store(0, std::memory_order_relaxed);
+      ring->dropped.store(0, std::memory_order_relaxed);
+      ring->isOwned.store(true, std::memory_order_relaxed);
+      ring->next = m_Rings.load(std::memory_order_relaxed);
+      while(m_Rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed) == false)
+      {
+      }
+      return ring;
+    }
+
+    void flush()
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      unsigned long ticket = ++m_FlushRequested;
+      m_Wake.notify_one();
+      while(m_FlushCompleted < ticket)
+      {
+        m_Flushed.wait(lock);
+      }
+    }
+
+    bool setOutput(const char* aPath, long aMaxBytes, int aMaxFiles)
+    {
+      //Whatever was logged for the old output goes there first
+      flush();
+
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      FILE* file = stdout;
+      if(aPath != NULL)
+      {
+        file = fopen(aPath, "ab");
+        if(file == NULL)
+        {
+          return false;
+        }
+      }
+
+      closeFile();
+      m_File = file;
+      m_Path = aPath != NULL ? aPath : "";
+      m_MaxBytes = aMaxBytes;
+      m_MaxFiles = aMaxFiles;
+      fseek(m_File, 0, SEEK_END);
+      m_FileBytes = aPath != NULL ? ftell(m_File) : 0;
+      return true;
+    }
+
+    //Called by a thread whose ring is filling up, instead of waiting for the writer's next poll
+    void wake()
+    {
+      m_Wake.notify_one();
+    }
+
+    unsigned long getWritten()
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      return m_Written;
+    }
+
+    unsigned long getDropped()
+    {
+      unsigned long dropped = 0;
+      for(LogRing* ring = m_Rings.load(std::memory_order_acquire); ring != NULL; ring = ring->next)
+      {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+      }
+      return dropped;
+    }
+
+  private:
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      for(;;)
+      {
+        //Rings are drained with the lock held, only flush and setOutput ever wait on it
+        unsigned long flushRequested = m_FlushRequested;
+        bool isQuitting = m_IsQuitting;
+        int drained = drain();
+
+        if(flushRequested > m_FlushCompleted)
+        {
+          fflush(m_File);
+          m_FlushCompleted = flushRequested;
+          m_Flushed.notify_all();
+        }
+
+        if(isQuitting == true && drained == 0)
+        {
+          fflush(m_File);
+          return;
+        }
+
+        if(drained == 0)
+        {
+          m_Wake.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_WAIT_MILLISECONDS));
+        }
+      }
+    }
+
+    int drain()
+    {
+      char buffer[LOG_WRITE_BUFFER_SIZE];
+      int bufferLength = 0;
+      int drained = 0;
+
+      for(LogRing* ring = m_Rings.load(std::memory_order_acquire); ring != NULL; ring = ring->next)
+      {
+        unsigned int head = ring->head.load(std::memory_order_acquire);
+        unsigned int tail = ring->tail.load(std::memory_order_relaxed);
+        for(; tail != head; tail++)
+        {
+          const LogMessage& message = ring->messages[tail & (LOG_RING_SIZE - 1)];
+          if(bufferLength + message.length > LOG_WRITE_BUFFER_SIZE)
+          {
+            write(buffer, bufferLength);
+            bufferLength = 0;
+          }
+          memcpy(buffer + bufferLength, message.text, message.length);
+          bufferLength += message.length;
+          drained++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+      }
+
+      unsigned long dropped = getDropped();
+      if(dropped > m_DroppedReported)
+      {
+        if(bufferLength + LOG_MESSAGE_SIZE > LOG_WRITE_BUFFER_SIZE)
+        {
+          write(buffer, bufferLength);
+          bufferLength = 0;
+        }
+        bufferLength += snprintf(buffer + bufferLength, LOG_MESSAGE_SIZE, "[LOG] - %lu messages dropped\n", dropped - m_DroppedReported);
+        m_DroppedReported = dropped;
+      }
+
+      write(buffer, bufferLength);
+      m_Written += drained;
+      return drained;
+    }
+
+    void write(const char* aBuffer, int aLength)
+    {
+      if(aLength == 0)
+      {
+        return;
+      }
+
+      fwrite(aBuffer, 1, aLength, m_File);
+      m_FileBytes += aLength;
+      if(m_Path.empty() == false && m_MaxBytes > 0 && m_FileBytes >= m_MaxBytes)
+      {
+        rotate();
+      }
+    }
+
+    //path becomes path.1, path.1 becomes path.2 and so on, the oldest is deleted
+    void rotate()
+    {
+      fclose(m_File);
+      for(int i = m_MaxFiles; i > 0; i--)
+      {
+        std::string from = i > 1 ? m_Path + "." + std::to_string(i - 1) : m_Path;
+        std::string to = m_Path + "." + std::to_string(i);
+        rename(from.c_str(), to.c_str());
+      }
+      if(m_MaxFiles <= 0)
+      {
+        remove(m_Path.c_str());
+      }
+
+      m_File = fopen(m_Path.c_str(), "wb");
+      if(m_File == NULL)
+      {
+        //Better to keep logging somewhere than to lose everything from here on
+        m_File = stdout;
+        m_Path.clear();
+      }
+      m_FileBytes = 0;
+    }
+
+    void closeFile()
+    {
+      if(m_File != stdout)
+      {
+        fclose(m_File);
+      }
+      else
+      {
+        fflush(stdout);
+      }
+    }
+
+    std::atomic<LogRing*> m_Rings;
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Flushed;
+
+    //Guarded by m_Mutex
+    FILE* m_File;
+    std::string m_Path;
+    long m_MaxBytes;
+    int m_MaxFiles;
+    long m_FileBytes;
+    unsigned long m_Written;
+    unsigned long m_DroppedReported;
+    unsigned long m_FlushRequested;
+    unsigned long m_FlushCompleted;
+    bool m_IsQuitting;
+  };
+
+  //Started by the first message, stopped and flushed when the program exits
+  LogWriter& getWriter()
+  {
+    static LogWriter writer;
+    return writer;
+  }
+
+  thread_local LogRingOwner s_RingOwner;
+}
 
 
 bool Log::m_IsEnabled = true;
 
 void Log::error(const char* aOutput, ...)
 {
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
   va_list arguments;
   va_start(arguments, aOutput);
   output("ERROR", aOutput, arguments);
   va_end (arguments);
+#endif
 }
 
 void Log::trace(const char* aOutput, ...)
 {
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
   va_list arguments;
   va_start(arguments, aOutput);
   output("TRACE", aOutput, arguments);
   va_end(arguments);
+#endif
 }
 
 void Log::debug(const char* aOutput, ...)
 {
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
   va_list arguments;
   va_start(arguments, aOutput);
   output("DEBUG", aOutput, arguments);
   va_end(arguments);
+#endif
 }
 
 void Log::custom(const char* aCustom, const char* aOutput, ...)
 {
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
   va_list arguments;
   va_start(arguments, aOutput);
   output(aCustom, aOutput, arguments);
   va_end(arguments);
+#endif
 }
 
 void Log::output(const char* aLabel, const char* aOutput, va_list aArgumentsList)
 {
-#if DEBUG
-  if(m_IsEnabled == true)
+  if(m_IsEnabled == false)
   {
-    printf("[%s] - ", aLabel);
-    vprintf(aOutput, aArgumentsList);
-    printf("\n");
+    return;
   }
-#endif
+
+  LogWriter& writer = getWriter();
+  LogRing* ring = s_RingOwner.ring;
+  if(ring == NULL)
+  {
+    ring = s_RingOwner.ring = writer.acquireRing();
+  }
+
+  //Wake the writer once the ring is half full, and give it a chance to catch up before dropping the message
+  unsigned int head = ring->head.load(std::memory_order_relaxed);
+  unsigned int count = head - ring->tail.load(std::memory_order_acquire);
+  if(count == LOG_RING_SIZE / 2)
+  {
+    writer.wake();
+  }
+  for(int retry = 0; count == LOG_RING_SIZE; retry++)
+  {
+    if(retry == LOG_FULL_RETRIES)
+    {
+      ring->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    writer.wake();
+    std::this_thread::yield();
+    count = head - ring->tail.load(std::memory_order_acquire);
+  }
+
+  //The label is copied in, so the message's own vsnprintf is the only formatting the caller pays for
+  LogMessage& message = ring->messages[head & (LOG_RING_SIZE - 1)];
+  int capacity = (int)sizeof(message.text) - 1;
+  int labelLength = (int)strnlen(aLabel, LOG_MAX_LABEL_LENGTH);
+  message.text[0] = '[';
+  memcpy(message.text + 1, aLabel, labelLength);
+  memcpy(message.text + 1 + labelLength, "] - ", 4);
+  int length = labelLength + 5;
+  int textLength = vsnprintf(message.text + length, capacity - length, aOutput, aArgumentsList);
+  length = textLength >= 0 && length + textLength < capacity ? length + textLength : capacity - 1;
+  message.text[length++] = '\n';
+  message.length = length;
+  ring->head.store(head + 1, std::memory_order_release);
 }
 
 void Log::enable()
@@ -63,4 +424,29 @@ void Log::enable()
 void Log::disable()
 {
   m_IsEnabled = false;
-}
\ No newline at end of file
+}
+
+void Log::setOutputStdout()
+{
+  getWriter().setOutput(NULL, 0, 0);
+}
+
+bool Log::setOutputFile(const char* aPath, long aMaxBytes, int aMaxFiles)
+{
+  return aPath != NULL && getWriter().setOutput(aPath, aMaxBytes, aMaxFiles);
+}
+
+void Log::flush()
+{
+  getWriter().flush();
+}
+
+unsigned long Log::getWrittenCount()
+{
+  return getWriter().getWritten();
+}
+
+unsigned long Log::getDroppedCount()
+{
+  return getWriter().getDropped();
+}
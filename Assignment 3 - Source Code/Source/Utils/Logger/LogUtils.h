@@ -9,6 +9,30 @@
 #ifndef LOG_UTILS_H
 #define LOG_UTILS_H
 
+#include <stdarg.h>
+
+//Levels above LOG_LEVEL are compiled out, calls made through the LOG_ macros don't even evaluate their arguments
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_TRACE 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+#if DEBUG
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL LOG_LEVEL_NONE
+#endif
+#endif
+
+#define LOG_ERROR(...) do { if(LOG_LEVEL >= LOG_LEVEL_ERROR) { Log::error(__VA_ARGS__); } } while(0)
+#define LOG_TRACE(...) do { if(LOG_LEVEL >= LOG_LEVEL_TRACE) { Log::trace(__VA_ARGS__); } } while(0)
+#define LOG_DEBUG(...) do { if(LOG_LEVEL >= LOG_LEVEL_DEBUG) { Log::debug(__VA_ARGS__); } } while(0)
+#define LOG_CUSTOM(...) do { if(LOG_LEVEL >= LOG_LEVEL_TRACE) { Log::custom(__VA_ARGS__); } } while(0)
+
+//Messages are formatted on the calling thread into a buffer of its own, without locking, and written out
+//by a background thread. A message is one line, lines from different threads never interleave. When a
+//thread's buffer stays full the message is dropped and counted instead of stalling the caller.
 class Log
 {
 public:
@@ -16,10 +40,22 @@ public:
 	static void trace(const char* output, ...);
 	static void debug(const char* output, ...);
 	static void custom(const char* custom, const char* output, ...);
-  
+
 	static void enable();
 	static void disable();
 
+	//Writes to stdout, the default
+	static void setOutputStdout();
+
+	//Writes to a file, rotated once it passes maxBytes into path.1 up to path.maxFiles
+	static bool setOutputFile(const char* path, long maxBytes, int maxFiles);
+
+	//Blocks until every message logged before the call is written
+	static void flush();
+
+	static unsigned long getWrittenCount();
+	static unsigned long getDroppedCount();
+
 private:
 	static void output(const char* label, const char* output, va_list argumentsList);
     static bool m_IsEnabled;
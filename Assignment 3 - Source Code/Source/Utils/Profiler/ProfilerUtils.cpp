@@ -0,0 +1,98 @@
+//
+//  ProfilerUtils.cpp
+//  GameDevFramework
+//
+
+#include "ProfilerUtils.h"
+#include "LogUtils.h"
+#include "b2Profiler.h"
+#include "json.h"
+#include <stdio.h>
+
+
+void Profiler::start(int aMaxEvents)
+{
+    b2Profiler::Reset();
+    b2Profiler::StartCapture(aMaxEvents);
+    b2Profiler::SetEnabled(true);
+}
+
+void Profiler::stop()
+{
+    //Close the last frame so its zones make it into the capture
+    b2Profiler::EndFrame();
+    b2Profiler::SetEnabled(false);
+    b2Profiler::StopCapture();
+}
+
+std::string Profiler::chromeTrace()
+{
+    Json::Value events(Json::arrayValue);
+    const b2ProfileEvent* capture = b2Profiler::GetCapture();
+    int threadCount = 0;
+    for(int i = 0; i < b2Profiler::GetCaptureCount(); i++)
+    {
+        //Complete events, the viewer nests them by time on each thread
+        Json::Value event(Json::objectValue);
+        event["name"] = Json::StaticString(capture[i].name);
+        event["cat"] = "zone";
+        event["ph"] = "X";
+        event["ts"] = capture[i].start;
+        event["dur"] = capture[i].duration;
+        event["pid"] = 0;
+        event["tid"] = capture[i].thread;
+        events.append(event);
+        if(capture[i].thread >= threadCount)
+        {
+            threadCount = capture[i].thread + 1;
+        }
+    }
+
+    //Name the threads, the first one to open a zone is normally the main thread
+    for(int i = 0; i < threadCount; i++)
+    {
+        char name[32] = "main";
+        if(i > 0)
+        {
+            snprintf(name, sizeof(name), "worker %d", i);
+        }
+        Json::Value metadata(Json::objectValue);
+        metadata["name"] = "thread_name";
+        metadata["ph"] = "M";
+        metadata["pid"] = 0;
+        metadata["tid"] = i;
+        metadata["args"]["name"] = name;
+        events.append(metadata);
+    }
+
+    Json::Value root(Json::objectValue);
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    Json::FastWriter writer;
+    return writer.write(root);
+}
+
+bool Profiler::writeChromeTrace(const char* aPath)
+{
+    FILE* file = aPath != NULL ? fopen(aPath, "wb") : NULL;
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    std::string trace = chromeTrace();
+    bool isWritten = fwrite(trace.data(), 1, trace.size(), file) == trace.size();
+    isWritten = fclose(file) == 0 && isWritten;
+    return isWritten;
+}
+
+void Profiler::logZoneStats()
+{
+    for(int i = 0; i < b2Profiler::GetZoneCount(); i++)
+    {
+        b2ProfileZoneStats stats;
+        b2Profiler::GetZoneStats(i, &stats);
+        Log::trace("%s: %d frames, mean %.4f p50 %.4f p95 %.4f p99 %.4f max %.4f ms", stats.name, stats.frameCount, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+    }
+}
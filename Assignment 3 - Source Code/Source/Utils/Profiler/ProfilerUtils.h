@@ -0,0 +1,28 @@
+//
+//  ProfilerUtils.h
+//  GameDevFramework
+//
+
+#ifndef PROFILER_UTILS_H
+#define PROFILER_UTILS_H
+
+#include <string>
+
+//Exports what b2Profiler recorded. Zones are opened with B2_PROFILE_ZONE, in Box2D and in the game alike,
+//and Game::update closes a profiler frame every time it's called.
+class Profiler
+{
+public:
+    //Starts collecting zones, keeping up to maxEvents of them for a trace
+    static void start(int maxEvents);
+    static void stop();
+
+    //The capture in the Chrome trace event format, load it in chrome://tracing or Perfetto
+    static std::string chromeTrace();
+    static bool writeChromeTrace(const char* path);
+
+    //Logs every zone's rolling percentiles, in milliseconds per frame
+    static void logZoneStats();
+};
+
+#endif
@@ -16,6 +16,7 @@ namespace ResourceUtils
   const char* getPathForResource(const char* filename, const char* fileExtension, bool checkForIPadVersion = true);
   const char* getPathForPngResource(const char* filename);
   const char* getPathForPlistResource(const char* filename);
+  const char* getPathForAtlasResource(const char* filename);
 
   bool doesFileExistsAtResourcePath(const char* path);
 }
@@ -80,6 +80,11 @@ namespace ResourceUtils
   {
     return getPathForResource(aFilename, "plist");
   }
+  
+  const char* getPathForAtlasResource(const char* aFilename)
+  {
+    return getPathForResource(aFilename, "atlas");
+  }
     
   bool doesFileExistsAtResourcePath(const char* aPath)
   {
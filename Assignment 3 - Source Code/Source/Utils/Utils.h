@@ -14,6 +14,7 @@
 #include "ResourceUtils.h"
 #include "FileUtils.h"
 #include "MathUtils.h"
+#include "ProfilerUtils.h"
 #include "AudioUtils.h"
 
 #endif